@@ -0,0 +1,39 @@
+#include "answer_sheet.h"
+#include <string.h>
+
+static unsigned char encode_mark(char selected, int is_correct) {
+    unsigned char mark = 0;
+    if (selected >= 'a' && selected <= 'd') selected -= 'a' - 'A';
+    if (selected >= 'A' && selected <= 'D') mark = (unsigned char)(selected - 'A' + 1);
+    if (mark && is_correct) mark |= ANSWER_MARK_CORRECT;
+    return mark;
+}
+
+void answer_sheet_pack(int count, const int *question_ids, const char *selected,
+                       const int *is_correct, unsigned char *ids_out, unsigned char *marks_out) {
+    memset(marks_out, 0, ANSWER_SHEET_MARKS_SIZE(count));
+    for (int i = 0; i < count; i++) {
+        unsigned int id = (unsigned int)question_ids[i];
+        ids_out[i * 4] = (unsigned char)(id >> 24);
+        ids_out[i * 4 + 1] = (unsigned char)(id >> 16);
+        ids_out[i * 4 + 2] = (unsigned char)(id >> 8);
+        ids_out[i * 4 + 3] = (unsigned char)id;
+
+        unsigned char mark = encode_mark(selected[i], is_correct[i]);
+        marks_out[i / 2] |= (i % 2 == 0) ? (unsigned char)(mark << 4) : mark;
+    }
+}
+
+void answer_sheet_unpack(int count, const unsigned char *ids, const unsigned char *marks,
+                         int *question_ids, char *selected, int *is_correct) {
+    for (int i = 0; i < count; i++) {
+        if (question_ids) {
+            question_ids[i] = (int)(((unsigned int)ids[i * 4] << 24) | ((unsigned int)ids[i * 4 + 1] << 16) |
+                                    ((unsigned int)ids[i * 4 + 2] << 8) | ids[i * 4 + 3]);
+        }
+        unsigned char mark = (i % 2 == 0) ? marks[i / 2] >> 4 : marks[i / 2] & 0xF;
+        int option = mark & 0x7;
+        if (selected) selected[i] = (option >= 1 && option <= 4) ? (char)('A' + option - 1) : '.';
+        if (is_correct) is_correct[i] = (mark & ANSWER_MARK_CORRECT) ? 1 : 0;
+    }
+}
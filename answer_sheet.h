@@ -0,0 +1,51 @@
+#ifndef ANSWER_SHEET_H
+#define ANSWER_SHEET_H
+
+// Packed answer sheets: one row per submission instead of one row per answer.
+//
+//   question_ids  big-endian uint32 per question, in exam order
+//   marks         one nibble per question, question 2j in the high nibble of
+//                 byte j and 2j+1 in the low nibble (so hex(marks) has exactly
+//                 one digit per question, which the SQL views decode)
+//
+// Nibble layout: bits 0-2 selected option (0 = blank, 1-4 = A-D), bit 3 correct.
+
+#define ANSWER_SHEET_MAX 255
+
+// Bodies of the answer_sheet_rows / answer_rows views (db_init.c, archive.c):
+// packed sheets expanded to one row per answer, and both storages combined
+#define ANSWER_SHEET_ROWS_SQL \
+    "WITH RECURSIVE slot(k) AS (SELECT 0 UNION ALL SELECT k + 1 FROM slot WHERE k < 254) " \
+    "SELECT s.participant_id AS participant_id, slot.k AS position," \
+    "  (SELECT SUM((instr('0123456789ABCDEF', substr(hex(s.question_ids), 8 * slot.k + d.column1, 1)) - 1)" \
+    "          << (4 * (8 - d.column1)))" \
+    "   FROM (VALUES (1), (2), (3), (4), (5), (6), (7), (8)) d) AS question_id," \
+    "  substr('.ABCD', ((instr('0123456789ABCDEF', substr(hex(s.marks), slot.k + 1, 1)) - 1) & 7) + 1, 1)" \
+    "    AS selected_option," \
+    "  (instr('0123456789ABCDEF', substr(hex(s.marks), slot.k + 1, 1)) - 1) >> 3 AS is_correct," \
+    "  s.submitted_at AS submitted_at " \
+    "FROM answer_sheets s JOIN slot ON slot.k < s.question_count"
+
+#define ANSWER_ROWS_SQL \
+    "SELECT participant_id, id AS position, question_id, selected_option, is_correct, submitted_at " \
+    "FROM answers " \
+    "UNION ALL " \
+    "SELECT participant_id, position, question_id, selected_option, is_correct, submitted_at " \
+    "FROM answer_sheet_rows"
+
+#define ANSWER_MARK_CORRECT 0x8
+
+// Bytes needed for count questions
+#define ANSWER_SHEET_IDS_SIZE(count) ((count) * 4)
+#define ANSWER_SHEET_MARKS_SIZE(count) (((count) + 1) / 2)
+
+// Pack count answers. selected[i] is 'A'-'D' (either case) or anything else for
+// blank; is_correct[i] is 0/1. Buffers must hold the sizes above.
+void answer_sheet_pack(int count, const int *question_ids, const char *selected,
+                       const int *is_correct, unsigned char *ids_out, unsigned char *marks_out);
+
+// Unpack into caller arrays (selected gets 'A'-'D' or '.'). Any output may be NULL.
+void answer_sheet_unpack(int count, const unsigned char *ids, const unsigned char *marks,
+                         int *question_ids, char *selected, int *is_correct);
+
+#endif // ANSWER_SHEET_H
@@ -0,0 +1,484 @@
+#define _DEFAULT_SOURCE  // pthread_rwlock_t under -std=c11
+#include "archive.h"
+#include "answer_sheet.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+typedef struct {
+    const char *name;
+    const char *key;                // Monotonic key: rows are taken oldest key first
+    const char *time_col;
+    const char *columns;
+    const char *ddl;                // %s = schema
+} ArchivedTable;
+
+static const ArchivedTable archived_tables[] = {
+    { "logs", "id", "timestamp",
+      "id, user_id, event_type, description, timestamp",
+      "CREATE TABLE IF NOT EXISTS %s.logs (id INTEGER PRIMARY KEY, user_id INTEGER, "
+      "event_type TEXT NOT NULL, description TEXT, timestamp DATETIME);" },
+    { "results", "id", "submitted_at",
+      "id, participant_id, room_id, score, total_questions, correct_answers, submitted_at",
+      "CREATE TABLE IF NOT EXISTS %s.results (id INTEGER PRIMARY KEY, participant_id INTEGER NOT NULL, "
+      "room_id INTEGER NOT NULL, score INTEGER, total_questions INTEGER, correct_answers INTEGER, "
+      "submitted_at DATETIME);" },
+    { "answers", "id", "submitted_at",
+      "id, participant_id, question_id, selected_option, is_correct, submitted_at",
+      "CREATE TABLE IF NOT EXISTS %s.answers (id INTEGER PRIMARY KEY, participant_id INTEGER NOT NULL, "
+      "question_id INTEGER NOT NULL, selected_option TEXT, is_correct INTEGER, submitted_at DATETIME);" },
+    { "answer_sheets", "participant_id", "submitted_at",
+      "participant_id, question_count, question_ids, marks, submitted_at",
+      "CREATE TABLE IF NOT EXISTS %s.answer_sheets (participant_id INTEGER PRIMARY KEY, "
+      "question_count INTEGER NOT NULL, question_ids BLOB NOT NULL, marks BLOB NOT NULL, "
+      "submitted_at DATETIME);" }
+};
+#define ARCHIVED_TABLE_COUNT (int)(sizeof(archived_tables) / sizeof(archived_tables[0]))
+#define ARCHIVE_PURGE_BATCH 64      // Queued rooms purged per pass
+
+static int purge_queued_rooms(sqlite3 *conn);
+
+// Secondary structures of a month file, so range reads stay indexed and answer
+// queries can use the same answer_rows view as the hot database
+static const char *archive_extra_ddl[] = {
+    "CREATE INDEX IF NOT EXISTS %s.idx_logs_timestamp ON logs(timestamp);",
+    "CREATE INDEX IF NOT EXISTS %s.idx_results_room ON results(room_id);",
+    "CREATE INDEX IF NOT EXISTS %s.idx_answers_participant ON answers(participant_id);",
+    "CREATE VIEW IF NOT EXISTS %s.answer_sheet_rows AS " ANSWER_SHEET_ROWS_SQL ";",
+    "CREATE VIEW IF NOT EXISTS %s.answer_rows AS " ANSWER_ROWS_SQL ";"
+};
+#define ARCHIVE_EXTRA_DDL_COUNT (int)(sizeof(archive_extra_ddl) / sizeof(archive_extra_ddl[0]))
+
+// Readers hold it shared while months are attached; the archiver only moves rows
+// when it can take it exclusively, so a reader never sees a row in two places
+static pthread_rwlock_t archive_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// ===== HELPERS =====
+
+static int exec_sql(sqlite3 *conn, const char *sql) {
+    char *err_msg = NULL;
+    if (sqlite3_exec(conn, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Archive error: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return 0;
+    }
+    return 1;
+}
+
+static int attach_month(sqlite3 *conn, const char *month, const char *schema) {
+    char path[64], sql[64];
+    snprintf(path, sizeof(path), "%s/%s.db", ARCHIVE_DIR, month);
+    snprintf(sql, sizeof(sql), "ATTACH DATABASE ? AS %s;", schema);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive attach error: %s\n", sqlite3_errmsg(conn));
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Archive attach %s failed: %s\n", path, sqlite3_errmsg(conn));
+        return 0;
+    }
+    return 1;
+}
+
+static void detach_schema(sqlite3 *conn, const char *schema) {
+    char sql[64];
+    snprintf(sql, sizeof(sql), "DETACH DATABASE %s;", schema);
+    exec_sql(conn, sql);
+}
+
+static int ensure_month_schema(sqlite3 *conn, const char *schema) {
+    char sql[2048];
+    for (int i = 0; i < ARCHIVED_TABLE_COUNT; i++) {
+        snprintf(sql, sizeof(sql), archived_tables[i].ddl, schema);
+        if (!exec_sql(conn, sql)) return 0;
+    }
+    for (int i = 0; i < ARCHIVE_EXTRA_DDL_COUNT; i++) {
+        snprintf(sql, sizeof(sql), archive_extra_ddl[i], schema);
+        if (!exec_sql(conn, sql)) return 0;
+    }
+    return 1;
+}
+
+// "YYYY-MM" of a datetime() input; empty when value is NULL or not a date
+static void month_of(sqlite3 *conn, const char *value, char out[8]) {
+    out[0] = '\0';
+    if (!value) return;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, "SELECT strftime('%Y-%m', ?)", -1, &stmt, NULL) != SQLITE_OK) return;
+    sqlite3_bind_text(stmt, 1, value, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+        snprintf(out, 8, "%s", (const char*)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+}
+
+static int is_month_file(const char *name) {
+    // YYYY-MM.db
+    if (strlen(name) != 10 || strcmp(name + 7, ".db") != 0 || name[4] != '-') return 0;
+    for (int i = 0; i < 7; i++) {
+        if (i != 4 && !isdigit((unsigned char)name[i])) return 0;
+    }
+    return 1;
+}
+
+static int compare_months(const void *a, const void *b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+// Archived months overlapping [since, until), oldest first
+static int list_months(sqlite3 *conn, const char *since, const char *until,
+                       char months[][8], int max) {
+    char first[8], last[8];
+    month_of(conn, since, first);
+    month_of(conn, until, last);
+
+    DIR *dir = opendir(ARCHIVE_DIR);
+    if (!dir) return 0;
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < max) {
+        if (!is_month_file(entry->d_name)) continue;
+        char month[8];
+        memcpy(month, entry->d_name, 7);
+        month[7] = '\0';
+        if (first[0] && strcmp(month, first) < 0) continue;
+        if (last[0] && strcmp(month, last) > 0) continue;
+        memcpy(months[count++], month, 8);
+    }
+    closedir(dir);
+    qsort(months, count, 8, compare_months);
+    return count;
+}
+
+// ===== ARCHIVER =====
+
+// Month of the oldest due row among the first batch_size rows by key; 0 if none
+static int next_due_month(sqlite3 *conn, const ArchivedTable *t, const char *age, int batch_size,
+                          char month[8]) {
+    char sql[512];
+    snprintf(sql, sizeof(sql),
+             "SELECT strftime('%%Y-%%m', t) FROM (SELECT %s AS k, %s AS t FROM main.%s ORDER BY %s LIMIT ?) "
+             "WHERE t < datetime('now', ?) ORDER BY k LIMIT 1",
+             t->key, t->time_col, t->name, t->key);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, batch_size);
+    sqlite3_bind_text(stmt, 2, age, -1, SQLITE_STATIC);
+    int found = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+        snprintf(month, 8, "%s", (const char*)sqlite3_column_text(stmt, 0));
+        found = 1;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Collect the keys to move into temp.archive_batch
+static int select_batch(sqlite3 *conn, const ArchivedTable *t, const char *age, int batch_size,
+                        const char *month) {
+    if (!exec_sql(conn, "CREATE TEMP TABLE IF NOT EXISTS archive_batch (id INTEGER PRIMARY KEY);") ||
+        !exec_sql(conn, "DELETE FROM temp.archive_batch;")) {
+        return 0;
+    }
+
+    char sql[512];
+    snprintf(sql, sizeof(sql),
+             "INSERT INTO temp.archive_batch SELECT k FROM "
+             "(SELECT %s AS k, %s AS t FROM main.%s ORDER BY %s LIMIT ?) "
+             "WHERE t < datetime('now', ?) AND strftime('%%Y-%%m', t) = ?",
+             t->key, t->time_col, t->name, t->key);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+        return 0;
+    }
+    sqlite3_bind_int(stmt, 1, batch_size);
+    sqlite3_bind_text(stmt, 2, age, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, month, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Copy the batch into the month file, then delete it from main
+static int move_batch(sqlite3 *conn, const ArchivedTable *t) {
+    char sql[1024];
+
+    snprintf(sql, sizeof(sql),
+             "BEGIN; INSERT OR IGNORE INTO arc.%s (%s) SELECT %s FROM main.%s "
+             "WHERE %s IN (SELECT id FROM temp.archive_batch); COMMIT;",
+             t->name, t->columns, t->columns, t->name, t->key);
+    if (!exec_sql(conn, sql)) {
+        exec_sql(conn, "ROLLBACK;");
+        return -1;
+    }
+
+    int ok = exec_sql(conn, "BEGIN;");
+    snprintf(sql, sizeof(sql), "DELETE FROM main.%s WHERE %s IN (SELECT id FROM temp.archive_batch);",
+             t->name, t->key);
+    ok = ok && exec_sql(conn, sql);
+    int moved = sqlite3_changes(conn);
+    if (ok && strcmp(t->name, "results") == 0) {
+        // The delete trigger took these results out of user_stats; archived
+        // results still count toward the global ranking, so add them back
+        ok = exec_sql(conn,
+            "INSERT INTO main.user_stats (user_id, results_count, score_sum, total_sum) "
+            "SELECT p.user_id, COUNT(*), SUM(r.score), SUM(r.total_questions) FROM arc.results r "
+            "JOIN main.participants p ON r.participant_id = p.id "
+            "WHERE r.id IN (SELECT id FROM temp.archive_batch) GROUP BY p.user_id "
+            "ON CONFLICT(user_id) DO UPDATE SET results_count = results_count + excluded.results_count, "
+            "score_sum = score_sum + excluded.score_sum, total_sum = total_sum + excluded.total_sum;");
+    }
+    if (ok) ok = exec_sql(conn, "COMMIT;");
+    if (!ok) {
+        exec_sql(conn, "ROLLBACK;");
+        return -1;
+    }
+    return moved;
+}
+
+static int archive_table(sqlite3 *conn, const ArchivedTable *t, const char *age, int batch_size) {
+    char month[8];
+    int due = next_due_month(conn, t, age, batch_size, month);
+    if (due <= 0) return due;
+
+    mkdir(ARCHIVE_DIR, 0755);
+    if (!attach_month(conn, month, "arc")) return -1;
+
+    int moved = -1;
+    if (ensure_month_schema(conn, "arc") && select_batch(conn, t, age, batch_size, month)) {
+        moved = move_batch(conn, t);
+    }
+    detach_schema(conn, "arc");
+    return moved;
+}
+
+int archive_run(sqlite3 *conn, int max_age_days, int batch_size) {
+    if (!conn || max_age_days < 0 || batch_size <= 0) return -1;
+    if (!sqlite3_get_autocommit(conn)) return -1;
+    if (pthread_rwlock_trywrlock(&archive_lock) != 0) return 0;
+
+    char age[32];
+    snprintf(age, sizeof(age), "-%d days", max_age_days);
+
+    // Rooms deleted while a reader held the archive; not counted as moved rows
+    int total = purge_queued_rooms(conn) < 0 ? -1 : 0;
+    for (int i = 0; i < ARCHIVED_TABLE_COUNT && total >= 0; i++) {
+        int moved = archive_table(conn, &archived_tables[i], age, batch_size);
+        total = moved < 0 ? -1 : total + moved;
+    }
+
+    pthread_rwlock_unlock(&archive_lock);
+    return total;
+}
+
+// ===== ROOM DELETION =====
+
+// Take one month's results of room_id out of user_stats, then delete them
+static int delete_month_room(sqlite3 *conn, int room_id) {
+    static const char *sql[] = {
+        "UPDATE main.user_stats SET "
+        "results_count = results_count - (SELECT COUNT(*) FROM arc.results r "
+        "  JOIN main.participants p ON r.participant_id = p.id "
+        "  WHERE r.room_id = ?1 AND p.user_id = user_stats.user_id), "
+        "score_sum = score_sum - (SELECT COALESCE(SUM(r.score), 0) FROM arc.results r "
+        "  JOIN main.participants p ON r.participant_id = p.id "
+        "  WHERE r.room_id = ?1 AND p.user_id = user_stats.user_id), "
+        "total_sum = total_sum - (SELECT COALESCE(SUM(r.total_questions), 0) FROM arc.results r "
+        "  JOIN main.participants p ON r.participant_id = p.id "
+        "  WHERE r.room_id = ?1 AND p.user_id = user_stats.user_id) "
+        "WHERE user_id IN (SELECT p.user_id FROM arc.results r "
+        "  JOIN main.participants p ON r.participant_id = p.id WHERE r.room_id = ?1)",
+        "DELETE FROM arc.results WHERE room_id = ?1"
+    };
+
+    if (!exec_sql(conn, "BEGIN;")) return -1;
+    int deleted = 0;
+    for (int i = 0; i < 2; i++) {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(conn, sql[i], -1, &stmt, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+            exec_sql(conn, "ROLLBACK;");
+            return -1;
+        }
+        sqlite3_bind_int(stmt, 1, room_id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            fprintf(stderr, "Archive delete error: %s\n", sqlite3_errmsg(conn));
+            exec_sql(conn, "ROLLBACK;");
+            return -1;
+        }
+        deleted = sqlite3_changes(conn);
+    }
+    if (!exec_sql(conn, "COMMIT;")) {
+        exec_sql(conn, "ROLLBACK;");
+        return -1;
+    }
+    return deleted;
+}
+
+// Purge up to ARCHIVE_PURGE_BATCH queued rooms from every month file and take
+// them off the queue (caller holds archive_lock for writing). Returns results
+// deleted, -1 on error (the queue is kept for the next pass).
+static int purge_queued_rooms(sqlite3 *conn) {
+    int rooms[ARCHIVE_PURGE_BATCH], room_count = 0;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, "SELECT room_id FROM main.archive_purges ORDER BY room_id LIMIT ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, ARCHIVE_PURGE_BATCH);
+    while (sqlite3_step(stmt) == SQLITE_ROW) rooms[room_count++] = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    if (room_count == 0) return 0;
+
+    char months[ARCHIVE_MONTHS_MAX][8];
+    int count = list_months(conn, NULL, NULL, months, ARCHIVE_MONTHS_MAX);
+    int total = 0;
+    for (int i = 0; i < count && total >= 0; i++) {
+        if (!attach_month(conn, months[i], "arc")) {
+            total = -1;
+            break;
+        }
+        for (int r = 0; r < room_count && total >= 0; r++) {
+            int deleted = delete_month_room(conn, rooms[r]);
+            total = deleted < 0 ? -1 : total + deleted;
+        }
+        detach_schema(conn, "arc");
+    }
+    if (total < 0) return -1;
+
+    // Each month committed on its own: a purge cut short is simply repeated
+    if (sqlite3_prepare_v2(conn, "DELETE FROM main.archive_purges WHERE room_id = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+    for (int r = 0; r < room_count; r++) {
+        sqlite3_bind_int(stmt, 1, rooms[r]);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return total;
+}
+
+int archive_delete_room(sqlite3 *conn, int room_id) {
+    if (!conn || room_id <= 0) return -1;
+    if (!sqlite3_get_autocommit(conn)) return -1;
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, "INSERT OR IGNORE INTO main.archive_purges (room_id) VALUES (?)",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Archive query error: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, room_id);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) return -1;
+
+    // Never wait for readers (an export or backup may hold the archive for
+    // minutes while the caller holds the server lock): left queued, the rows
+    // go with the archiver's next pass
+    if (pthread_rwlock_trywrlock(&archive_lock) != 0) return 0;
+    int deleted = purge_queued_rooms(conn);
+    pthread_rwlock_unlock(&archive_lock);
+    return deleted;
+}
+
+int archive_purge_rooms(sqlite3 *conn) {
+    if (!conn || !sqlite3_get_autocommit(conn)) return -1;
+    if (pthread_rwlock_trywrlock(&archive_lock) != 0) return 0;
+    int total = 0, deleted;
+    do {
+        deleted = purge_queued_rooms(conn);
+        if (deleted > 0) total += deleted;
+    } while (deleted > 0);
+    pthread_rwlock_unlock(&archive_lock);
+    return deleted < 0 ? -1 : total;
+}
+
+// ===== READERS =====
+
+int archive_attach_range(sqlite3 *conn, const char *since, const char *until,
+                         char schemas[][16], int max) {
+    char months[ARCHIVE_MONTHS_MAX][8];
+    pthread_rwlock_rdlock(&archive_lock);
+
+    int count = list_months(conn, since, until, months, ARCHIVE_MONTHS_MAX);
+    if (count > max) {
+        fprintf(stderr, "Archive: range spans %d archived months (at most %d can be read at once)\n",
+                count, max);
+        pthread_rwlock_unlock(&archive_lock);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(schemas[i], 16, "arc%d", i);
+        if (!attach_month(conn, months[i], schemas[i])) {
+            while (--i >= 0) detach_schema(conn, schemas[i]);
+            pthread_rwlock_unlock(&archive_lock);
+            return -1;
+        }
+    }
+    return count;
+}
+
+void archive_detach(sqlite3 *conn, int count) {
+    char schema[16];
+    for (int i = 0; i < count; i++) {
+        snprintf(schema, sizeof(schema), "arc%d", i);
+        detach_schema(conn, schema);
+    }
+    pthread_rwlock_unlock(&archive_lock);
+}
+
+int archive_list_months(char months[][8], int max) {
+    return list_months(NULL, NULL, NULL, months, max);
+}
+
+void archive_hold(void) {
+    pthread_rwlock_rdlock(&archive_lock);
+}
+
+void archive_release(void) {
+    pthread_rwlock_unlock(&archive_lock);
+}
+
+int archive_for_each_month(sqlite3 *conn, const char *since, const char *until,
+                           archive_month_callback cb, void *ctx) {
+    char months[ARCHIVE_MONTHS_MAX][8];
+    pthread_rwlock_rdlock(&archive_lock);
+
+    int count = list_months(conn, since, until, months, ARCHIVE_MONTHS_MAX);
+    int visited = 0;
+    for (int i = 0; i < count; i++) {
+        if (!attach_month(conn, months[i], "arc")) {
+            visited = -1;
+            break;
+        }
+        int more = cb(conn, "arc", ctx);
+        detach_schema(conn, "arc");
+        visited++;
+        if (!more) break;
+    }
+
+    pthread_rwlock_unlock(&archive_lock);
+    return visited;
+}
@@ -0,0 +1,65 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <sqlite3.h>
+
+// Time-partitioned archive for the append-only tables (logs, results, answers,
+// answer_sheets). Rows older than a configurable age move out of the hot
+// database into one SQLite file per calendar month, ARCHIVE_DIR/YYYY-MM.db,
+// with the same columns and original ids. Readers that ask for historical
+// ranges ATTACH the months they overlap and read them alongside main.
+//
+// Moving a row takes two short transactions: copy into the month file
+// (INSERT OR IGNORE keyed by id), then delete from main. A crash in between
+// leaves a duplicate that the next pass resolves, never a lost row.
+// Archived results keep counting toward user_stats (the global ranking)
+// until their room is deleted.
+
+#define ARCHIVE_DIR "archive"
+#define ARCHIVE_MAX_ATTACHED 8      // Months one archive_attach_range() may attach
+#define ARCHIVE_MONTHS_MAX 1200     // Month files considered by one listing
+
+// Move up to batch_size rows per table older than max_age_days from conn's
+// main database. Must not run inside a transaction (the server calls it with
+// its lock held). Returns rows moved, 0 when nothing is due or a reader has the
+// archive open, -1 on error.
+int archive_run(sqlite3 *conn, int max_age_days, int batch_size);
+
+// Delete room_id's results from every month file and subtract them from
+// user_stats. Never waits: while a reader has the archive open the room is
+// queued (main.archive_purges) and purged by the next archive_run(). Must not
+// run inside a transaction. Returns the results deleted (0 when queued), -1 on
+// error.
+int archive_delete_room(sqlite3 *conn, int room_id);
+
+// Purge every queued room now unless a reader has the archive open. For
+// startup, before user_stats is read. Returns results deleted, -1 on error.
+int archive_purge_rooms(sqlite3 *conn);
+
+// Attach every archived month overlapping [since, until) (either may be NULL,
+// any SQLite datetime() input) as arc0, arc1, ... and write the schema names,
+// oldest first. Holds the archive open for reading until archive_detach().
+// Returns the number attached, -1 on error or when more than max months overlap.
+int archive_attach_range(sqlite3 *conn, const char *since, const char *until,
+                         char schemas[][16], int max);
+void archive_detach(sqlite3 *conn, int count);
+
+// List the archived months, oldest first, as stored in ARCHIVE_DIR/<month>.db.
+// Returns the month count.
+int archive_list_months(char months[][8], int max);
+
+// Keep every month file unchanged (no archiving, room purges queued) while the
+// caller reads the files directly; release with archive_release(). Hold it
+// briefly: the archiver skips its passes meanwhile.
+void archive_hold(void);
+void archive_release(void);
+
+// Call cb once per archived month overlapping [since, until), oldest first,
+// with the month attached as schema "arc". For scans over all history, which
+// may span more months than can be attached at once. Returns months visited,
+// -1 on error; stops early when cb returns 0.
+typedef int (*archive_month_callback)(sqlite3 *conn, const char *schema, void *ctx);
+int archive_for_each_month(sqlite3 *conn, const char *since, const char *until,
+                           archive_month_callback cb, void *ctx);
+
+#endif // ARCHIVE_H
@@ -0,0 +1,263 @@
+#define _DEFAULT_SOURCE  // localtime_r, usleep under -std=c11
+#include "backup.h"
+#include "archive.h"
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BACKUP_LIST_MAX 1024
+
+static pthread_mutex_t progress_lock = PTHREAD_MUTEX_INITIALIZER;
+static BackupProgress progress;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// "test_system" for "path/to/test_system.db"
+static void backup_base_name(const char *db_path, char *out, size_t size) {
+    const char *slash = strrchr(db_path, '/');
+    snprintf(out, size, "%s", slash ? slash + 1 : db_path);
+    char *dot = strrchr(out, '.');
+    if (dot && dot != out) *dot = '\0';
+}
+
+// Pages and bytes of the files a backup has copied so far
+typedef struct {
+    double start;
+    int pages;
+    long bytes;
+} CopyTotals;
+
+static void update_progress(int pages_total, int pages_done, long bytes, double elapsed_ms) {
+    pthread_mutex_lock(&progress_lock);
+    progress.pages_total = pages_total;
+    progress.pages_done = pages_done;
+    progress.bytes = bytes;
+    progress.elapsed_ms = elapsed_ms;
+    progress.mb_per_sec = elapsed_ms > 0 ? (bytes / 1048576.0) / (elapsed_ms / 1000.0) : 0;
+    pthread_mutex_unlock(&progress_lock);
+}
+
+// Copy src into dest_path page batch by page batch, adding to totals; returns 1 on success
+static int copy_pages(sqlite3 *src, const char *dest_path, int pages_per_step, int pause_ms,
+                      CopyTotals *totals) {
+    sqlite3 *dest = NULL;
+    if (sqlite3_open(dest_path, &dest) != SQLITE_OK) {
+        fprintf(stderr, "Backup: cannot create %s: %s\n", dest_path, sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return 0;
+    }
+
+    sqlite3_backup *backup = sqlite3_backup_init(dest, "main", src, "main");
+    if (!backup) {
+        fprintf(stderr, "Backup: init failed: %s\n", sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return 0;
+    }
+
+    int page_size = 4096;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(src, "PRAGMA page_size;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) page_size = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+
+    int rc, total = 0;
+    do {
+        rc = sqlite3_backup_step(backup, pages_per_step);
+        total = sqlite3_backup_pagecount(backup);
+        int done = total - sqlite3_backup_remaining(backup);
+        update_progress(totals->pages + total, totals->pages + done,
+                        totals->bytes + (long)done * page_size, now_ms() - totals->start);
+
+        // Yield between batches; a busy destination is retried after the pause
+        if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            if (pause_ms > 0) usleep(pause_ms * 1000);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    int ok = (rc == SQLITE_DONE);
+    if (!ok) fprintf(stderr, "Backup: step failed: %s\n", sqlite3_errstr(rc));
+    if (sqlite3_close(dest) != SQLITE_OK) ok = 0;
+    totals->pages += total;
+    totals->bytes += (long)total * page_size;
+    return ok;
+}
+
+// Copy the database at src_path into dest_path on a dedicated read-only
+// connection; the open read transaction pins one snapshot for the whole copy,
+// so in WAL mode concurrent commits never restart it
+static int copy_database(const char *src_path, const char *dest_path, int pages_per_step,
+                         int pause_ms, CopyTotals *totals) {
+    sqlite3 *src = NULL;
+    int ok = sqlite3_open_v2(src_path, &src, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK;
+    if (ok) {
+        sqlite3_busy_timeout(src, 5000);
+        ok = sqlite3_exec(src, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", NULL, NULL, NULL) == SQLITE_OK;
+    } else {
+        fprintf(stderr, "Backup: cannot open %s: %s\n", src_path, sqlite3_errmsg(src));
+    }
+
+    ok = ok && copy_pages(src, dest_path, pages_per_step, pause_ms, totals);
+    sqlite3_exec(src, "COMMIT;", NULL, NULL, NULL);
+    sqlite3_close(src);
+    return ok;
+}
+
+// Remove dir and the files directly in it
+static void remove_dir(const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+    rmdir(dir_path);
+}
+
+// Copy every archive month file into dir_path, holding the archive for one
+// month file at a time
+static int copy_archive(const char *dir_path, int pages_per_step, int pause_ms, CopyTotals *totals) {
+    char (*months)[8] = malloc(ARCHIVE_MONTHS_MAX * 8);
+    if (!months) return 0;
+    int count = archive_list_months(months, ARCHIVE_MONTHS_MAX);
+    int ok = 1;
+    if (count > 0) ok = mkdir(dir_path, 0755) == 0;
+    for (int i = 0; ok && i < count; i++) {
+        char src_path[64], dest_path[512];
+        snprintf(src_path, sizeof(src_path), "%s/%s.db", ARCHIVE_DIR, months[i]);
+        snprintf(dest_path, sizeof(dest_path), "%s/%s.db", dir_path, months[i]);
+        archive_hold();
+        ok = copy_database(src_path, dest_path, pages_per_step, pause_ms, totals);
+        archive_release();
+    }
+    free(months);
+    return ok;
+}
+
+int backup_run(const char *db_path, const char *dest_dir, int pages_per_step, int pause_ms,
+               BackupProgress *result) {
+    pthread_mutex_lock(&progress_lock);
+    if (progress.running) {
+        pthread_mutex_unlock(&progress_lock);
+        return -1;
+    }
+
+    char base[128], stamp[32];
+    time_t now = time(NULL);
+    struct tm t;
+    localtime_r(&now, &t);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &t);
+    backup_base_name(db_path, base, sizeof(base));
+
+    memset(&progress, 0, sizeof(progress));
+    progress.running = 1;
+    snprintf(progress.path, sizeof(progress.path), "%s/%s_%s.db", dest_dir, base, stamp);
+    char path[256], part_path[272], archive_path[272], archive_part[280];
+    snprintf(path, sizeof(path), "%s", progress.path);
+    pthread_mutex_unlock(&progress_lock);
+
+    snprintf(part_path, sizeof(part_path), "%s.part", path);
+    snprintf(archive_path, sizeof(archive_path), "%s/%s_%s.archive", dest_dir, base, stamp);
+    snprintf(archive_part, sizeof(archive_part), "%s.part", archive_path);
+    mkdir(dest_dir, 0755);
+    unlink(part_path);
+    remove_dir(archive_part);
+
+    // Main database first, then the month files: a row the archiver moves in
+    // between lands in both copies (which the next archive pass resolves),
+    // never in neither
+    if (pages_per_step <= 0) pages_per_step = 1;
+    CopyTotals totals = { now_ms(), 0, 0 };
+    int ok = copy_database(db_path, part_path, pages_per_step, pause_ms, &totals);
+    ok = ok && copy_archive(archive_part, pages_per_step, pause_ms, &totals);
+
+    // The .db file appears last, so a backup is complete once it exists
+    struct stat st;
+    if (ok && stat(archive_part, &st) == 0 && rename(archive_part, archive_path) != 0) {
+        perror(archive_path);
+        ok = 0;
+    }
+    if (ok && rename(part_path, path) != 0) {
+        perror(path);
+        ok = 0;
+    }
+    if (!ok) {
+        unlink(part_path);
+        remove_dir(archive_part);
+        remove_dir(archive_path);
+    }
+
+    pthread_mutex_lock(&progress_lock);
+    progress.running = 0;
+    progress.ok = ok;
+    progress.finished_at = time(NULL);
+    if (result) *result = progress;
+    pthread_mutex_unlock(&progress_lock);
+    return ok;
+}
+
+void backup_get_progress(BackupProgress *out) {
+    pthread_mutex_lock(&progress_lock);
+    *out = progress;
+    pthread_mutex_unlock(&progress_lock);
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int backup_prune(const char *db_path, const char *dest_dir, int keep) {
+    char base[128], prefix[136];
+    backup_base_name(db_path, base, sizeof(base));
+    snprintf(prefix, sizeof(prefix), "%s_", base);
+    size_t prefix_len = strlen(prefix);
+
+    DIR *dir = opendir(dest_dir);
+    if (!dir) return 0;
+
+    // <base>_YYYYmmdd-HHMMSS.db sorts oldest first by name
+    char *names[BACKUP_LIST_MAX];
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < BACKUP_LIST_MAX) {
+        size_t len = strlen(entry->d_name);
+        if (len != prefix_len + 18 || strncmp(entry->d_name, prefix, prefix_len) != 0 ||
+            strcmp(entry->d_name + len - 3, ".db") != 0) {
+            continue;
+        }
+        names[count] = malloc(len + 1);
+        if (!names[count]) break;
+        memcpy(names[count], entry->d_name, len + 1);
+        count++;
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(char*), compare_names);
+
+    int removed = 0;
+    for (int i = 0; i < count; i++) {
+        if (i < count - keep) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dest_dir, names[i]);
+            if (unlink(path) == 0) removed++;
+            // Its archive copy: <base>_YYYYmmdd-HHMMSS.archive
+            snprintf(path, sizeof(path), "%s/%.*s.archive", dest_dir, (int)strlen(names[i]) - 3, names[i]);
+            remove_dir(path);
+        }
+        free(names[i]);
+    }
+    return removed;
+}
@@ -0,0 +1,41 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <time.h>
+
+// Online backup of the live database with the SQLite backup API.
+// The copy runs on its own connection inside one read transaction, so in WAL
+// mode it is a consistent snapshot that never blocks (or restarts because of)
+// the server's writers. Pages are copied a few at a time with a short pause in
+// between so the disk is never saturated. Each backup is written as
+// BACKUP_DIR/<db name>_<YYYYmmdd-HHMMSS>.db (via a .part file renamed on success),
+// with the archive month files copied into <db name>_<YYYYmmdd-HHMMSS>.archive/.
+
+#define BACKUP_DIR "backups"
+
+typedef struct {
+    int running;
+    int ok;                        // Last finished backup succeeded
+    char path[256];
+    int pages_total;
+    int pages_done;
+    long bytes;
+    double elapsed_ms;
+    double mb_per_sec;
+    time_t finished_at;            // 0 while running / never run
+} BackupProgress;
+
+// Back up db_path into dest_dir. Only one backup runs at a time; returns 1 on
+// success, 0 on failure, -1 if another backup is already running. result
+// (optional) receives the final progress record.
+int backup_run(const char *db_path, const char *dest_dir, int pages_per_step, int pause_ms,
+               BackupProgress *result);
+
+// Progress of the running backup, or of the last one
+void backup_get_progress(BackupProgress *out);
+
+// Delete all but the newest keep backups of db_path (and their archive copies)
+// in dest_dir. Returns backups removed.
+int backup_prune(const char *db_path, const char *dest_dir, int keep);
+
+#endif // BACKUP_H
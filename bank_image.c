@@ -0,0 +1,418 @@
+#define _DEFAULT_SOURCE  // fsync under -std=c11
+#include "bank_image.h"
+#include "storage.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct BankImage {
+    const unsigned char *base;
+    size_t size;
+    const BankImageHeader *header;
+    const uint32_t *slots;
+    const BankImageRecord *records;
+    const BankImageKey *keys;
+    const uint32_t *postings;
+    const char *heap;
+    const BankImageSignature *signatures;
+};
+
+// ===== READING =====
+
+// Section [offset, offset + count * width) lies inside the file and is aligned
+static int section_ok(const BankImageHeader *h, uint32_t offset, uint64_t count, size_t width) {
+    return offset % 4 == 0 && offset >= sizeof(BankImageHeader) &&
+           (uint64_t)offset + count * width <= h->file_size;
+}
+
+static int header_ok(const BankImageHeader *h, size_t size) {
+    return memcmp(h->magic, BANK_IMAGE_MAGIC, 4) == 0 &&
+           h->format == BANK_IMAGE_FORMAT &&
+           h->byte_order == BANK_IMAGE_BYTE_ORDER &&
+           h->file_size == size &&
+           section_ok(h, h->slots_offset, (uint64_t)h->max_id + 1, sizeof(uint32_t)) &&
+           section_ok(h, h->records_offset, h->question_count, sizeof(BankImageRecord)) &&
+           section_ok(h, h->keys_offset, (uint64_t)h->topic_count + h->difficulty_count,
+                      sizeof(BankImageKey)) &&
+           section_ok(h, h->postings_offset, h->posting_count, sizeof(uint32_t)) &&
+           section_ok(h, h->heap_offset, h->heap_size, 1) &&
+           section_ok(h, h->signatures_offset, h->question_count, sizeof(BankImageSignature)) &&
+           h->heap_size > 0;
+}
+
+BankImage *bank_image_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BankImageHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    const BankImageHeader *h = base;
+    BankImage *img = malloc(sizeof(BankImage));
+    if (!img || !header_ok(h, size)) {
+        fprintf(stderr, "Bank image %s is invalid, ignoring it\n", path);
+        free(img);
+        munmap(base, size);
+        return NULL;
+    }
+    img->base = base;
+    img->size = size;
+    img->header = h;
+    img->slots = (const uint32_t*)(img->base + h->slots_offset);
+    img->records = (const BankImageRecord*)(img->base + h->records_offset);
+    img->keys = (const BankImageKey*)(img->base + h->keys_offset);
+    img->postings = (const uint32_t*)(img->base + h->postings_offset);
+    img->heap = (const char*)(img->base + h->heap_offset);
+    img->signatures = (const BankImageSignature*)(img->base + h->signatures_offset);
+
+    // The heap ends in a NUL, so any in-range offset is a terminated string
+    int ok = img->heap[h->heap_size - 1] == '\0';
+    uint32_t keys = h->topic_count + h->difficulty_count;
+    for (uint32_t i = 0; ok && i < keys; i++) {
+        const BankImageKey *k = &img->keys[i];
+        ok = k->name < h->heap_size && (uint64_t)k->first + k->count <= h->posting_count;
+    }
+    if (!ok) {
+        fprintf(stderr, "Bank image %s is invalid, ignoring it\n", path);
+        bank_image_close(img);
+        return NULL;
+    }
+    return img;
+}
+
+void bank_image_close(BankImage *img) {
+    if (!img) return;
+    munmap((void*)img->base, img->size);
+    free(img);
+}
+
+unsigned long bank_image_version(const BankImage *img) {
+    return (unsigned long)img->header->bank_version;
+}
+
+int bank_image_question_count(const BankImage *img) {
+    return (int)img->header->question_count;
+}
+
+int bank_image_max_id(const BankImage *img) {
+    return (int)img->header->max_id;
+}
+
+int bank_image_topic_count(const BankImage *img) {
+    return (int)img->header->topic_count;
+}
+
+int bank_image_difficulty_count(const BankImage *img) {
+    return (int)img->header->difficulty_count;
+}
+
+static const char *heap_string(const BankImage *img, uint32_t offset) {
+    return offset < img->header->heap_size ? img->heap + offset : "";
+}
+
+int bank_image_question(const BankImage *img, int id, BankImageQuestion *out) {
+    if (!img || id <= 0 || (uint32_t)id > img->header->max_id) return 0;
+    uint32_t slot = img->slots[id];
+    if (slot == 0 || slot > img->header->question_count) return 0;
+
+    const BankImageRecord *r = &img->records[slot - 1];
+    if (out) {
+        out->id = (int)r->id;
+        out->text = heap_string(img, r->strings[0]);
+        for (int i = 0; i < 4; i++) out->options[i] = heap_string(img, r->strings[i + 1]);
+        out->topic_id = (int)r->topic_id;
+        out->difficulty_id = (int)r->difficulty_id;
+        out->correct = (char)r->correct;
+    }
+    return 1;
+}
+
+const BankImageSignature *bank_image_signature(const BankImage *img, int i) {
+    if (!img || i < 0 || (uint32_t)i >= img->header->question_count) return NULL;
+    return &img->signatures[i];
+}
+
+static void key_view(const BankImage *img, const BankImageKey *k, BankImageKeyView *out) {
+    out->id = (int)k->id;
+    out->name = heap_string(img, k->name);
+    out->level = k->level;
+    out->ids = (const int*)(img->postings + k->first);
+    out->count = (int)k->count;
+}
+
+int bank_image_topic(const BankImage *img, int i, BankImageKeyView *out) {
+    if (!img || i < 0 || (uint32_t)i >= img->header->topic_count) return 0;
+    key_view(img, &img->keys[i], out);
+    return 1;
+}
+
+int bank_image_difficulty(const BankImage *img, int i, BankImageKeyView *out) {
+    if (!img || i < 0 || (uint32_t)i >= img->header->difficulty_count) return 0;
+    key_view(img, &img->keys[img->header->topic_count + i], out);
+    return 1;
+}
+
+// ===== COMPILING =====
+
+typedef struct {
+    char *heap;
+    size_t heap_len, heap_cap;
+    BankImageRecord *records;
+    BankImageSignature *signatures;    // Parallel to records
+    uint32_t record_count, record_cap;
+    BankImageKey *keys;
+    uint32_t key_count, key_cap;
+    uint32_t topic_count;
+    int failed;
+} ImageBuilder;
+
+static uint32_t heap_add(ImageBuilder *b, const char *s) {
+    size_t len = strlen(s ? s : "") + 1;
+    if (b->heap_len + len > b->heap_cap) {
+        size_t cap = b->heap_cap ? b->heap_cap : 65536;
+        while (b->heap_len + len > cap) cap *= 2;
+        char *grown = realloc(b->heap, cap);
+        if (!grown) {
+            b->failed = 1;
+            return 0;
+        }
+        b->heap = grown;
+        b->heap_cap = cap;
+    }
+    uint32_t offset = (uint32_t)b->heap_len;
+    memcpy(b->heap + b->heap_len, s ? s : "", len);
+    b->heap_len += len;
+    return offset;
+}
+
+static void add_key(int id, const char *name, int level, void *ctx) {
+    ImageBuilder *b = ctx;
+    if (id <= 0) return;
+    if (b->key_count == b->key_cap) {
+        uint32_t cap = b->key_cap ? b->key_cap * 2 : 16;
+        BankImageKey *grown = realloc(b->keys, cap * sizeof(BankImageKey));
+        if (!grown) {
+            b->failed = 1;
+            return;
+        }
+        b->keys = grown;
+        b->key_cap = cap;
+    }
+    BankImageKey *k = &b->keys[b->key_count++];
+    memset(k, 0, sizeof(*k));
+    k->id = (uint32_t)id;
+    k->name = heap_add(b, name);
+    k->level = level;
+}
+
+static void add_record(const DBQuestionView *v, void *ctx) {
+    ImageBuilder *b = ctx;
+    if (v->id <= 0) return;
+    if (b->record_count == b->record_cap) {
+        uint32_t cap = b->record_cap ? b->record_cap * 2 : 1024;
+        BankImageRecord *grown = realloc(b->records, cap * sizeof(BankImageRecord));
+        if (grown) b->records = grown;
+        BankImageSignature *grown_sigs = realloc(b->signatures, cap * sizeof(BankImageSignature));
+        if (grown_sigs) b->signatures = grown_sigs;
+        if (!grown || !grown_sigs) {
+            b->failed = 1;
+            return;
+        }
+        b->record_cap = cap;
+    }
+
+    // The server's duplicate index already holds the signature; the standalone
+    // compiler (or a question the index does not know) computes it
+    DedupSignature sig;
+    if (!dedup_get_signature(v->id, &sig)) {
+        dedup_compute_signature(v->text, v->option_a, v->option_b, v->option_c, v->option_d, &sig);
+    }
+    BankImageSignature *bs = &b->signatures[b->record_count];
+    bs->id = (uint32_t)v->id;
+    bs->content[0] = (uint32_t)sig.content;
+    bs->content[1] = (uint32_t)(sig.content >> 32);
+    memcpy(bs->minhash, sig.minhash, sizeof(bs->minhash));
+
+    BankImageRecord *r = &b->records[b->record_count++];
+    r->id = (uint32_t)v->id;
+    r->strings[0] = heap_add(b, v->text);
+    r->strings[1] = heap_add(b, v->option_a);
+    r->strings[2] = heap_add(b, v->option_b);
+    r->strings[3] = heap_add(b, v->option_c);
+    r->strings[4] = heap_add(b, v->option_d);
+    r->topic_id = (uint32_t)v->topic_id;
+    r->difficulty_id = (uint32_t)v->difficulty_id;
+    r->correct = (uint32_t)(unsigned char)v->correct_option;
+}
+
+static int compare_record_id(const void *a, const void *b) {
+    uint32_t ia = ((const BankImageRecord*)a)->id, ib = ((const BankImageRecord*)b)->id;
+    return (ia > ib) - (ia < ib);
+}
+
+static int compare_signature_id(const void *a, const void *b) {
+    uint32_t ia = ((const BankImageSignature*)a)->id, ib = ((const BankImageSignature*)b)->id;
+    return (ia > ib) - (ia < ib);
+}
+
+// Map key ids of keys[first, first + count) to their index (or -1) for posting construction
+static int *key_index(const BankImageKey *keys, uint32_t first, uint32_t count, uint32_t *max_key) {
+    uint32_t max = 0;
+    for (uint32_t i = first; i < first + count; i++) {
+        if (keys[i].id > max) max = keys[i].id;
+    }
+    int *index = malloc(((size_t)max + 1) * sizeof(int));
+    if (!index) return NULL;
+    for (uint32_t i = 0; i <= max; i++) index[i] = -1;
+    for (uint32_t i = first; i < first + count; i++) index[keys[i].id] = (int)i;
+    *max_key = max;
+    return index;
+}
+
+// Counting sort of record ids into one ascending run per key
+static uint32_t *build_postings(ImageBuilder *b, uint32_t *posting_count) {
+    uint32_t max_topic = 0, max_diff = 0;
+    int *topic_index = key_index(b->keys, 0, b->topic_count, &max_topic);
+    int *diff_index = key_index(b->keys, b->topic_count, b->key_count - b->topic_count, &max_diff);
+    uint32_t *postings = malloc(((size_t)b->record_count * 2 + 1) * sizeof(uint32_t));
+    uint32_t *cursor = calloc(b->key_count + 1, sizeof(uint32_t));
+    if (!topic_index || !diff_index || !postings || !cursor) {
+        free(topic_index);
+        free(diff_index);
+        free(postings);
+        free(cursor);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < b->record_count; i++) {
+        const BankImageRecord *r = &b->records[i];
+        if (r->topic_id <= max_topic && topic_index[r->topic_id] >= 0) b->keys[topic_index[r->topic_id]].count++;
+        if (r->difficulty_id <= max_diff && diff_index[r->difficulty_id] >= 0) b->keys[diff_index[r->difficulty_id]].count++;
+    }
+    uint32_t total = 0;
+    for (uint32_t k = 0; k < b->key_count; k++) {
+        b->keys[k].first = total;
+        cursor[k] = total;
+        total += b->keys[k].count;
+    }
+    for (uint32_t i = 0; i < b->record_count; i++) {
+        const BankImageRecord *r = &b->records[i];
+        if (r->topic_id <= max_topic && topic_index[r->topic_id] >= 0) postings[cursor[topic_index[r->topic_id]]++] = r->id;
+        if (r->difficulty_id <= max_diff && diff_index[r->difficulty_id] >= 0) postings[cursor[diff_index[r->difficulty_id]]++] = r->id;
+    }
+
+    free(topic_index);
+    free(diff_index);
+    free(cursor);
+    *posting_count = total;
+    return postings;
+}
+
+static int write_section(FILE *f, const void *data, size_t size) {
+    static const char zeros[4] = {0};
+    size_t pad = (4 - size % 4) % 4;
+    return (size == 0 || fwrite(data, 1, size, f) == size) &&
+           (pad == 0 || fwrite(zeros, 1, pad, f) == pad);
+}
+
+static uint32_t align4(uint64_t n) {
+    return (uint32_t)((n + 3) & ~(uint64_t)3);
+}
+
+int bank_image_compile(const char *path, unsigned long bank_version) {
+    ImageBuilder b;
+    memset(&b, 0, sizeof(b));
+    heap_add(&b, "");            // Offset 0 is the empty string
+
+    storage->for_each_topic(add_key, &b);
+    b.topic_count = b.key_count;
+    storage->for_each_difficulty(add_key, &b);
+    storage->for_each_question(add_record, &b);
+    int ok = !b.failed;
+
+    // Records must be in id order so every posting run comes out ascending
+    for (uint32_t i = 1; ok && i < b.record_count; i++) {
+        if (b.records[i - 1].id >= b.records[i].id) {
+            qsort(b.records, b.record_count, sizeof(BankImageRecord), compare_record_id);
+            qsort(b.signatures, b.record_count, sizeof(BankImageSignature), compare_signature_id);
+            break;
+        }
+    }
+
+    uint32_t posting_count = 0, max_id = b.record_count ? b.records[b.record_count - 1].id : 0;
+    uint32_t *postings = ok ? build_postings(&b, &posting_count) : NULL;
+    uint32_t *slots = ok ? calloc((size_t)max_id + 1, sizeof(uint32_t)) : NULL;
+    ok = postings && slots;
+    for (uint32_t i = 0; ok && i < b.record_count; i++) slots[b.records[i].id] = i + 1;
+
+    BankImageHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BANK_IMAGE_MAGIC, 4);
+    h.format = BANK_IMAGE_FORMAT;
+    h.byte_order = BANK_IMAGE_BYTE_ORDER;
+    h.question_count = b.record_count;
+    h.bank_version = bank_version;
+    h.max_id = max_id;
+    h.topic_count = b.topic_count;
+    h.difficulty_count = b.key_count - b.topic_count;
+    h.posting_count = posting_count;
+    uint64_t end = sizeof(h);
+    h.slots_offset = align4(end);
+    end = h.slots_offset + ((uint64_t)max_id + 1) * sizeof(uint32_t);
+    h.records_offset = align4(end);
+    end = h.records_offset + (uint64_t)b.record_count * sizeof(BankImageRecord);
+    h.keys_offset = align4(end);
+    end = h.keys_offset + (uint64_t)b.key_count * sizeof(BankImageKey);
+    h.postings_offset = align4(end);
+    end = h.postings_offset + (uint64_t)posting_count * sizeof(uint32_t);
+    h.heap_offset = align4(end);
+    h.heap_size = (uint32_t)b.heap_len;
+    end = h.heap_offset + b.heap_len;
+    h.signatures_offset = align4(end);
+    h.file_size = (uint64_t)h.signatures_offset + (uint64_t)b.record_count * sizeof(BankImageSignature);
+    if (ok && h.file_size > UINT32_MAX) {
+        fprintf(stderr, "Bank image: question bank too large for the image format\n");
+        ok = 0;
+    }
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = ok ? fopen(tmp_path, "wb") : NULL;
+    if (ok && !f) perror(tmp_path);
+    ok = f &&
+         write_section(f, &h, sizeof(h)) &&
+         write_section(f, slots, ((size_t)max_id + 1) * sizeof(uint32_t)) &&
+         write_section(f, b.records, (size_t)b.record_count * sizeof(BankImageRecord)) &&
+         write_section(f, b.keys, (size_t)b.key_count * sizeof(BankImageKey)) &&
+         write_section(f, postings, (size_t)posting_count * sizeof(uint32_t)) &&
+         write_section(f, b.heap, b.heap_len) &&
+         write_section(f, b.signatures, (size_t)b.record_count * sizeof(BankImageSignature)) &&
+         fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (f && fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp_path, path) != 0) {
+        perror(path);
+        ok = 0;
+    }
+    if (!ok && f) unlink(tmp_path);
+    if (!ok) fprintf(stderr, "Bank image: failed to compile %s\n", path);
+
+    int count = ok ? (int)b.record_count : -1;
+    free(b.heap);
+    free(b.records);
+    free(b.signatures);
+    free(b.keys);
+    free(postings);
+    free(slots);
+    return count;
+}
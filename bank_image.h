@@ -0,0 +1,118 @@
+#ifndef BANK_IMAGE_H
+#define BANK_IMAGE_H
+
+#include "dedup.h"
+#include <stdint.h>
+
+// Compiled question-bank image: a read-only binary snapshot of every live
+// question, topic and difficulty that the server mmaps at startup instead of
+// reading the bank row by row. Layout (native byte order, 4-byte aligned):
+//
+//   BankImageHeader
+//   slots     uint32[max_id + 1]       question id -> record index + 1 (0 = none)
+//   records   BankImageRecord[question_count], ascending id
+//   keys      BankImageKey[topic_count + difficulty_count], topics first
+//   postings  uint32 question ids, one ascending run per key
+//   heap      NUL-terminated strings, addressed by offset
+//   signatures BankImageSignature[question_count], same order as records
+//
+// The header records the database bank version (bank_meta.version, bumped by
+// triggers on every question/topic/difficulty change) it was compiled from;
+// an image whose version differs from the database is stale and is rebuilt.
+// Opening validates the header and section bounds only, so it costs the same
+// for ten questions or a million; pages are faulted in on first touch and
+// shared through the page cache by every process mapping the file. The
+// signatures are the duplicate index's fingerprints (dedup.h), so the server
+// indexes the bank for duplicate detection without hashing it again.
+
+#define BANK_IMAGE_MAGIC "QBNK"
+#define BANK_IMAGE_FORMAT 2
+#define BANK_IMAGE_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    uint32_t byte_order;          // BANK_IMAGE_BYTE_ORDER as written by the compiler
+    uint32_t question_count;
+    uint64_t bank_version;
+    uint64_t file_size;
+    uint32_t max_id;
+    uint32_t topic_count;
+    uint32_t difficulty_count;
+    uint32_t posting_count;       // Total ids across all posting lists
+    uint32_t slots_offset;
+    uint32_t records_offset;
+    uint32_t keys_offset;
+    uint32_t postings_offset;
+    uint32_t heap_offset;
+    uint32_t heap_size;
+    uint32_t signatures_offset;
+} BankImageHeader;
+
+typedef struct {
+    uint32_t id;
+    uint32_t strings[5];          // Heap offsets: text, A, B, C, D
+    uint32_t topic_id;
+    uint32_t difficulty_id;
+    uint32_t correct;             // 'A'..'D'
+} BankImageRecord;
+
+typedef struct {
+    uint32_t id;
+    uint32_t content[2];          // Content hash, low word first (4-byte aligned)
+    uint32_t minhash[DEDUP_MINHASH_SIZE];
+} BankImageSignature;
+
+typedef struct {
+    uint32_t id;                  // Database id
+    uint32_t name;                // Heap offset
+    int32_t level;                // Difficulties only
+    uint32_t first;               // Index of the first id in the postings section
+    uint32_t count;
+} BankImageKey;
+
+typedef struct BankImage BankImage;
+
+// Borrowed views into the mapping, valid until bank_image_close()
+typedef struct {
+    int id;
+    const char *text;
+    const char *options[4];
+    int topic_id;
+    int difficulty_id;
+    char correct;
+} BankImageQuestion;
+
+typedef struct {
+    int id;
+    const char *name;
+    int level;
+    const int *ids;               // Ascending question ids
+    int count;
+} BankImageKeyView;
+
+// Map and validate an image. Returns NULL if the file is missing or invalid.
+BankImage *bank_image_open(const char *path);
+void bank_image_close(BankImage *img);
+
+unsigned long bank_image_version(const BankImage *img);
+int bank_image_question_count(const BankImage *img);
+int bank_image_max_id(const BankImage *img);
+int bank_image_topic_count(const BankImage *img);
+int bank_image_difficulty_count(const BankImage *img);
+
+// Returns 1 and fills out if the image holds question id
+int bank_image_question(const BankImage *img, int id, BankImageQuestion *out);
+
+// Signature of the i-th question in id order; NULL if i is out of range
+const BankImageSignature *bank_image_signature(const BankImage *img, int i);
+
+// i-th topic / difficulty; returns 0 if i is out of range
+int bank_image_topic(const BankImage *img, int i, BankImageKeyView *out);
+int bank_image_difficulty(const BankImage *img, int i, BankImageKeyView *out);
+
+// Stream the active storage engine's bank into path (written to path.tmp and
+// renamed into place). Returns the number of questions written, -1 on error.
+int bank_image_compile(const char *path, unsigned long bank_version);
+
+#endif // BANK_IMAGE_H
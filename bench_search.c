@@ -0,0 +1,121 @@
+// Benchmark for SEARCH_QUESTIONS text (FTS5 index over questions)
+//
+// Builds a synthetic question bank in a scratch database, then times ranked
+// full-text queries through db_search_questions_text().
+//
+// Usage: ./bench_search [rows] [db_path]      (defaults: 1000000 bench_search.db)
+
+#include "db_init.h"
+#include "db_queries.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUERY_REPEATS 20
+
+static const char *vocabulary[] = {
+    "network", "packet", "socket", "server", "client", "protocol", "router", "switch",
+    "address", "port", "stream", "datagram", "buffer", "thread", "process", "kernel",
+    "memory", "cache", "latency", "bandwidth", "window", "congestion", "timeout", "retry",
+    "header", "payload", "checksum", "frame", "layer", "session", "transport", "link",
+    "physical", "application", "encryption", "certificate", "handshake", "domain", "query",
+    "record", "table", "index", "join", "transaction", "commit", "rollback", "lock", "queue"
+};
+#define VOCAB_SIZE (int)(sizeof(vocabulary) / sizeof(vocabulary[0]))
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void random_sentence(char *out, size_t size, int words) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (int i = 0; i < words && len < size; i++) {
+        len += snprintf(out + len, size - len, "%s%s", i ? " " : "",
+                        vocabulary[rand() % VOCAB_SIZE]);
+    }
+}
+
+static int populate(int rows) {
+    sqlite3_exec(db, "INSERT OR IGNORE INTO topics (id, name) VALUES (1, 'networking');", NULL, NULL, NULL);
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+
+    sqlite3_stmt *stmt;
+    const char *query =
+        "INSERT INTO questions (text, option_a, option_b, option_c, option_d, "
+        "correct_option, topic_id, difficulty_id) VALUES (?, ?, ?, ?, ?, 'A', 1, 1)";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing insert: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+
+    char text[256], opts[4][128];
+    for (int i = 0; i < rows; i++) {
+        random_sentence(text, sizeof(text), 12);
+        // A handful of needles so the selective query has something to find
+        if (i % 100000 == 7) strcat(text, " what is the tcp three-way handshake");
+        for (int o = 0; o < 4; o++) random_sentence(opts[o], sizeof(opts[o]), 3);
+
+        sqlite3_bind_text(stmt, 1, text, -1, SQLITE_TRANSIENT);
+        for (int o = 0; o < 4; o++) sqlite3_bind_text(stmt, 2 + o, opts[o], -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+
+        if ((i + 1) % 100000 == 0) {
+            sqlite3_exec(db, "COMMIT; BEGIN;", NULL, NULL, NULL);
+            printf("  inserted %d rows\n", i + 1);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : 1000000;
+    const char *path = argc > 2 ? argv[2] : "bench_search.db";
+    srand(42);
+
+    unlink(path);
+    if (!db_init(path) || !db_create_tables() || !db_init_default_difficulties()) {
+        fprintf(stderr, "Failed to initialize benchmark database\n");
+        return 1;
+    }
+    sqlite3_exec(db, "PRAGMA journal_mode = WAL; PRAGMA synchronous = OFF;", NULL, NULL, NULL);
+
+    printf("Building bank of %d questions...\n", rows);
+    double t0 = now_ms();
+    if (!populate(rows)) return 1;
+    printf("Build: %.0f ms (%.0f rows/sec)\n\n", now_ms() - t0, rows / ((now_ms() - t0) / 1000.0));
+
+    const char *queries[] = {
+        "tcp handshake",             // selective: a few planted rows
+        "three-way",                 // selective, punctuation in input
+        "socket timeout",            // broad two-term AND
+        "congestion window retry",   // three-term AND
+        "hand*"                      // prefix match
+    };
+    int num_queries = sizeof(queries) / sizeof(queries[0]);
+
+    static char output[8192];
+    printf("%-28s %8s %12s %12s\n", "query", "matches", "avg ms", "max ms");
+    for (int i = 0; i < num_queries; i++) {
+        double total = 0, worst = 0;
+        int matches = 0;
+        for (int r = 0; r < QUERY_REPEATS; r++) {
+            double start = now_ms();
+            matches = db_search_questions_text(queries[i], output, sizeof(output), 50);
+            double elapsed = now_ms() - start;
+            total += elapsed;
+            if (elapsed > worst) worst = elapsed;
+        }
+        printf("%-28s %8d %12.3f %12.3f\n", queries[i], matches, total / QUERY_REPEATS, worst);
+    }
+
+    db_close();
+    return 0;
+}
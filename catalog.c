@@ -0,0 +1,691 @@
+#include "catalog.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
+
+typedef struct {
+    int *ids;                  // Ascending question ids
+    int count;
+    int cap;
+    int borrowed;              // ids point into the bank image; copied on first write
+} PostingList;
+
+typedef struct {
+    int present;
+    char name[64];
+    int level;                 // Difficulties only (display order)
+    PostingList list;
+} CatalogKey;
+
+// One allocation per question: "text\0A\0B\0C\0D\0"
+typedef struct {
+    char *strings;
+    unsigned int opt_off[4];
+    int topic_id;
+    int difficulty_id;
+    char correct;
+} CatalogQuestion;
+
+typedef struct {
+    CatalogKey *keys;          // Indexed by database id
+    int cap;
+} KeyTable;
+
+static CatalogQuestion **by_id = NULL;   // Primary index, indexed by question id - by_id_base
+static int by_id_cap = 0;
+static int by_id_base = 0;
+static int question_count = 0;
+static KeyTable topics = {0};
+static KeyTable difficulties = {0};
+static int loaded = 0;
+static unsigned long version = 0;
+
+// Every live id in one dense array, for uniform sampling of the whole bank.
+// live_pos[id] is the id's slot + 1 (0 when absent); a delete moves the last
+// id into the hole, so both updates are O(1).
+static int *live_ids = NULL;
+static int live_count = 0;
+static int live_cap = 0;
+static int *live_pos = NULL;
+static int live_pos_cap = 0;
+
+// Formatted responses, valid while *_cache_version == version
+static char *topics_cache = NULL;
+static unsigned long topics_cache_version = (unsigned long)-1;
+static char *diffs_cache = NULL;
+static unsigned long diffs_cache_version = (unsigned long)-1;
+
+// Base layer after catalog_load_image(): questions up to the image's max id are
+// read from the mapping, by_id holds those added since (ids only grow), and
+// image_deleted marks image questions deleted since
+static BankImage *image = NULL;
+static unsigned char *image_deleted = NULL;
+
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== POSTING LISTS =====
+
+static int posting_own(PostingList *pl) {
+    if (!pl->borrowed) return 1;
+    int cap = pl->count > 16 ? pl->count : 16;
+    int *ids = malloc(cap * sizeof(int));
+    if (!ids) return 0;
+    memcpy(ids, pl->ids, pl->count * sizeof(int));
+    pl->ids = ids;
+    pl->cap = cap;
+    pl->borrowed = 0;
+    return 1;
+}
+
+static void posting_free(PostingList *pl) {
+    if (!pl->borrowed) free(pl->ids);
+    memset(pl, 0, sizeof(*pl));
+}
+
+static int posting_insert(PostingList *pl, int id) {
+    if (!posting_own(pl)) return 0;
+    if (pl->count == pl->cap) {
+        int new_cap = pl->cap ? pl->cap * 2 : 16;
+        int *grown = realloc(pl->ids, new_cap * sizeof(int));
+        if (!grown) return 0;
+        pl->ids = grown;
+        pl->cap = new_cap;
+    }
+    // New ids are almost always the largest, so this is normally an append
+    int pos = pl->count;
+    while (pos > 0 && pl->ids[pos - 1] > id) pos--;
+    memmove(&pl->ids[pos + 1], &pl->ids[pos], (pl->count - pos) * sizeof(int));
+    pl->ids[pos] = id;
+    pl->count++;
+    return 1;
+}
+
+// First position whose id is greater than after_id
+static int posting_upper_bound(const PostingList *pl, int after_id) {
+    int lo = 0, hi = pl->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (pl->ids[mid] <= after_id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void posting_remove(PostingList *pl, int id) {
+    int pos = posting_upper_bound(pl, id - 1);
+    if (pos < pl->count && pl->ids[pos] == id && posting_own(pl)) {
+        memmove(&pl->ids[pos], &pl->ids[pos + 1], (pl->count - pos - 1) * sizeof(int));
+        pl->count--;
+    }
+}
+
+// ===== LIVE SET =====
+
+static int live_add(int id) {
+    if (id >= live_pos_cap) {
+        int new_cap = live_pos_cap ? live_pos_cap : 1024;
+        while (new_cap <= id) new_cap *= 2;
+        int *grown = realloc(live_pos, new_cap * sizeof(int));
+        if (!grown) return 0;
+        memset(grown + live_pos_cap, 0, (new_cap - live_pos_cap) * sizeof(int));
+        live_pos = grown;
+        live_pos_cap = new_cap;
+    }
+    if (live_pos[id]) return 1;
+    if (live_count == live_cap) {
+        int new_cap = live_cap ? live_cap * 2 : 1024;
+        int *grown = realloc(live_ids, new_cap * sizeof(int));
+        if (!grown) return 0;
+        live_ids = grown;
+        live_cap = new_cap;
+    }
+    live_ids[live_count++] = id;
+    live_pos[id] = live_count;
+    return 1;
+}
+
+static void live_remove(int id) {
+    if (id <= 0 || id >= live_pos_cap || !live_pos[id]) return;
+    int slot = live_pos[id] - 1;
+    int last = live_ids[--live_count];
+    live_ids[slot] = last;
+    live_pos[last] = slot + 1;
+    live_pos[id] = 0;
+}
+
+// ===== KEY TABLES (topics / difficulties) =====
+
+static CatalogKey *key_slot(KeyTable *t, int id) {
+    if (id <= 0) return NULL;
+    if (id >= t->cap) {
+        int new_cap = t->cap ? t->cap : 16;
+        while (new_cap <= id) new_cap *= 2;
+        CatalogKey *grown = realloc(t->keys, new_cap * sizeof(CatalogKey));
+        if (!grown) return NULL;
+        memset(grown + t->cap, 0, (new_cap - t->cap) * sizeof(CatalogKey));
+        t->keys = grown;
+        t->cap = new_cap;
+    }
+    return &t->keys[id];
+}
+
+static void key_register(KeyTable *t, int id, const char *name, int level) {
+    CatalogKey *k = key_slot(t, id);
+    if (!k) return;
+    k->present = 1;
+    k->level = level;
+    snprintf(k->name, sizeof(k->name), "%s", name ? name : "");
+}
+
+static CatalogKey *key_find(KeyTable *t, const char *name) {
+    if (!name) return NULL;
+    for (int i = 0; i < t->cap; i++) {
+        if (t->keys[i].present && strcasecmp(t->keys[i].name, name) == 0) return &t->keys[i];
+    }
+    return NULL;
+}
+
+static CatalogKey *key_get(KeyTable *t, int id) {
+    if (id <= 0 || id >= t->cap || !t->keys[id].present) return NULL;
+    return &t->keys[id];
+}
+
+// ===== QUESTIONS (caller holds catalog_lock) =====
+
+static CatalogQuestion *question_get(int id) {
+    if (id < by_id_base || id <= 0 || id - by_id_base >= by_id_cap) return NULL;
+    return by_id[id - by_id_base];
+}
+
+// A question from either layer, strings borrowed
+typedef struct {
+    const char *strings[5];    // text, A, B, C, D
+    int topic_id;
+    int difficulty_id;
+    char correct;
+    CatalogQuestion *owned;    // NULL for a question in the bank image
+} QuestionRef;
+
+static int image_has(int id) {
+    return image && id > 0 && id <= bank_image_max_id(image) &&
+           !(image_deleted[id >> 3] & (1 << (id & 7)));
+}
+
+static int question_ref(int id, QuestionRef *ref) {
+    CatalogQuestion *q = question_get(id);
+    if (q) {
+        if (ref) {
+            ref->strings[0] = q->strings;
+            for (int i = 0; i < 4; i++) ref->strings[i + 1] = q->strings + q->opt_off[i];
+            ref->topic_id = q->topic_id;
+            ref->difficulty_id = q->difficulty_id;
+            ref->correct = q->correct;
+            ref->owned = q;
+        }
+        return 1;
+    }
+
+    BankImageQuestion iq;
+    if (!image_has(id) || !bank_image_question(image, id, &iq)) return 0;
+    if (ref) {
+        ref->strings[0] = iq.text;
+        for (int i = 0; i < 4; i++) ref->strings[i + 1] = iq.options[i];
+        ref->topic_id = iq.topic_id;
+        ref->difficulty_id = iq.difficulty_id;
+        ref->correct = iq.correct;
+        ref->owned = NULL;
+    }
+    return 1;
+}
+
+static void add_locked(int id, const char *text, const char *opt_a, const char *opt_b,
+                       const char *opt_c, const char *opt_d, char correct,
+                       int topic_id, int difficulty_id) {
+    if (id <= 0 || id < by_id_base || question_ref(id, NULL)) return;
+
+    if (id - by_id_base >= by_id_cap) {
+        int new_cap = by_id_cap ? by_id_cap : 1024;
+        while (new_cap <= id - by_id_base) new_cap *= 2;
+        CatalogQuestion **grown = realloc(by_id, new_cap * sizeof(CatalogQuestion*));
+        if (!grown) return;
+        memset(grown + by_id_cap, 0, (new_cap - by_id_cap) * sizeof(CatalogQuestion*));
+        by_id = grown;
+        by_id_cap = new_cap;
+    }
+
+    const char *parts[5] = { text, opt_a, opt_b, opt_c, opt_d };
+    size_t lens[5], total = 0;
+    for (int i = 0; i < 5; i++) {
+        lens[i] = parts[i] ? strlen(parts[i]) : 0;
+        total += lens[i] + 1;
+    }
+
+    CatalogQuestion *q = malloc(sizeof(CatalogQuestion));
+    char *strings = malloc(total);
+    if (!q || !strings) {
+        free(q);
+        free(strings);
+        return;
+    }
+
+    size_t off = 0;
+    for (int i = 0; i < 5; i++) {
+        if (i > 0) q->opt_off[i - 1] = (unsigned int)off;
+        memcpy(strings + off, parts[i] ? parts[i] : "", lens[i] + 1);
+        off += lens[i] + 1;
+    }
+    q->strings = strings;
+    q->topic_id = topic_id;
+    q->difficulty_id = difficulty_id;
+    q->correct = (char)toupper((unsigned char)correct);
+
+    by_id[id - by_id_base] = q;
+    question_count++;
+    live_add(id);
+
+    CatalogKey *t = key_get(&topics, topic_id);
+    if (t) posting_insert(&t->list, id);
+    CatalogKey *d = key_get(&difficulties, difficulty_id);
+    if (d) posting_insert(&d->list, id);
+    version++;
+}
+
+// Copy a question out to the caller's arena: catalog strings may be freed by a
+// delete or reload once catalog_lock is released. Returns 0 when out of memory.
+static int fill_question(int id, const QuestionRef *q, Question *out, Arena *arena) {
+    CatalogKey *t = key_get(&topics, q->topic_id);
+    CatalogKey *d = key_get(&difficulties, q->difficulty_id);
+    return question_build(out, arena, id, q->strings[0], q->strings[1], q->strings[2],
+                          q->strings[3], q->strings[4], q->correct,
+                          t ? t->name : "", d ? d->name : "");
+}
+
+// ===== LOADING =====
+
+static void load_topic(int id, const char *name, int level, void *ctx) {
+    (void)level; (void)ctx;
+    key_register(&topics, id, name, 0);
+}
+
+static void load_difficulty(int id, const char *name, int level, void *ctx) {
+    (void)ctx;
+    key_register(&difficulties, id, name, level);
+}
+
+static void load_question(const DBQuestionView *v, void *ctx) {
+    (void)ctx;
+    add_locked(v->id, v->text, v->option_a, v->option_b, v->option_c, v->option_d,
+               v->correct_option, v->topic_id, v->difficulty_id);
+}
+
+static void reset_locked(void) {
+    for (int i = 0; i < by_id_cap; i++) {
+        if (by_id[i]) {
+            free(by_id[i]->strings);
+            free(by_id[i]);
+            by_id[i] = NULL;
+        }
+    }
+    for (int i = 0; i < topics.cap; i++) posting_free(&topics.keys[i].list);
+    for (int i = 0; i < difficulties.cap; i++) posting_free(&difficulties.keys[i].list);
+    free(topics.keys);
+    free(difficulties.keys);
+    memset(&topics, 0, sizeof(topics));
+    memset(&difficulties, 0, sizeof(difficulties));
+    question_count = 0;
+    free(live_ids);
+    free(live_pos);
+    live_ids = live_pos = NULL;
+    live_count = live_cap = live_pos_cap = 0;
+
+    bank_image_close(image);
+    free(image_deleted);
+    image = NULL;
+    image_deleted = NULL;
+    by_id_base = 0;
+}
+
+int catalog_load(void) {
+    pthread_mutex_lock(&catalog_lock);
+    reset_locked();
+
+    storage->for_each_topic(load_topic, NULL);
+    storage->for_each_difficulty(load_difficulty, NULL);
+    storage->for_each_question(load_question, NULL);
+    loaded = 1;
+    version++;
+    int count = question_count;
+    pthread_mutex_unlock(&catalog_lock);
+    return count;
+}
+
+// Point a key's posting list at its run in the image
+static void attach_key(KeyTable *t, const BankImageKeyView *v) {
+    key_register(t, v->id, v->name, v->level);
+    CatalogKey *k = key_get(t, v->id);
+    if (!k) return;
+    k->list.ids = (int*)v->ids;          // Never written through: borrowed lists are copied first
+    k->list.count = v->count;
+    k->list.cap = 0;
+    k->list.borrowed = 1;
+}
+
+int catalog_load_image(BankImage *img) {
+    if (!img) return -1;
+    pthread_mutex_lock(&catalog_lock);
+    reset_locked();
+
+    image_deleted = calloc((size_t)bank_image_max_id(img) / 8 + 1, 1);
+    if (!image_deleted) {
+        pthread_mutex_unlock(&catalog_lock);
+        bank_image_close(img);
+        return -1;
+    }
+    image = img;
+    by_id_base = bank_image_max_id(img) + 1;
+
+    BankImageKeyView v;
+    for (int i = 0; bank_image_topic(img, i, &v); i++) {
+        v.level = 0;
+        attach_key(&topics, &v);
+    }
+    for (int i = 0; bank_image_difficulty(img, i, &v); i++) attach_key(&difficulties, &v);
+    question_count = bank_image_question_count(img);
+
+    // The topic lists partition the questions: together they are the live set
+    for (int i = 0; i < topics.cap; i++) {
+        PostingList *pl = &topics.keys[i].list;
+        for (int j = 0; j < pl->count; j++) live_add(pl->ids[j]);
+    }
+
+    loaded = 1;
+    version++;
+    int count = question_count;
+    pthread_mutex_unlock(&catalog_lock);
+    return count;
+}
+
+int catalog_is_loaded(void) {
+    return loaded;
+}
+
+// ===== WRITE-THROUGH HOOKS =====
+
+void catalog_on_topic_added(int topic_id, const char *name) {
+    if (!loaded) return;
+    pthread_mutex_lock(&catalog_lock);
+    if (!key_get(&topics, topic_id)) {
+        key_register(&topics, topic_id, name, 0);
+        version++;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+}
+
+void catalog_on_question_added(int id, const char *text, const char *opt_a, const char *opt_b,
+                               const char *opt_c, const char *opt_d, char correct,
+                               int topic_id, int difficulty_id) {
+    if (!loaded) return;
+    pthread_mutex_lock(&catalog_lock);
+    add_locked(id, text, opt_a, opt_b, opt_c, opt_d, correct, topic_id, difficulty_id);
+    pthread_mutex_unlock(&catalog_lock);
+}
+
+void catalog_on_question_deleted(int id) {
+    if (!loaded) return;
+    pthread_mutex_lock(&catalog_lock);
+    QuestionRef q;
+    if (question_ref(id, &q)) {
+        CatalogKey *t = key_get(&topics, q.topic_id);
+        if (t) posting_remove(&t->list, id);
+        CatalogKey *d = key_get(&difficulties, q.difficulty_id);
+        if (d) posting_remove(&d->list, id);
+        if (q.owned) {
+            free(q.owned->strings);
+            free(q.owned);
+            by_id[id - by_id_base] = NULL;
+        } else {
+            image_deleted[id >> 3] |= (unsigned char)(1 << (id & 7));
+        }
+        live_remove(id);
+        question_count--;
+        version++;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+}
+
+// ===== LOOKUPS =====
+
+int catalog_get_question(int id, Question *out, Arena *arena) {
+    pthread_mutex_lock(&catalog_lock);
+    QuestionRef q;
+    int found = question_ref(id, &q);
+    if (found && out) found = fill_question(id, &q, out, arena);
+    pthread_mutex_unlock(&catalog_lock);
+    return found;
+}
+
+int catalog_question_exists(int id) {
+    pthread_mutex_lock(&catalog_lock);
+    int exists = question_ref(id, NULL);
+    pthread_mutex_unlock(&catalog_lock);
+    return exists;
+}
+
+int catalog_question_count(void) {
+    pthread_mutex_lock(&catalog_lock);
+    int count = question_count;
+    pthread_mutex_unlock(&catalog_lock);
+    return count;
+}
+
+int catalog_topic_count(const char *topic) {
+    pthread_mutex_lock(&catalog_lock);
+    CatalogKey *k = key_find(&topics, topic);
+    int count = k ? k->list.count : 0;
+    pthread_mutex_unlock(&catalog_lock);
+    return count;
+}
+
+int catalog_difficulty_count(const char *difficulty) {
+    pthread_mutex_lock(&catalog_lock);
+    CatalogKey *k = key_find(&difficulties, difficulty);
+    int count = k ? k->list.count : 0;
+    pthread_mutex_unlock(&catalog_lock);
+    return count;
+}
+
+static int copy_ids(KeyTable *t, const char *name, int after_id, int *ids, int max) {
+    pthread_mutex_lock(&catalog_lock);
+    CatalogKey *k = key_find(t, name);
+    if (!k) {
+        pthread_mutex_unlock(&catalog_lock);
+        return -1;
+    }
+    int pos = posting_upper_bound(&k->list, after_id);
+    int n = k->list.count - pos;
+    if (n > max) n = max;
+    if (n > 0) memcpy(ids, &k->list.ids[pos], n * sizeof(int));
+    pthread_mutex_unlock(&catalog_lock);
+    return n > 0 ? n : 0;
+}
+
+int catalog_ids_by_topic(const char *topic, int after_id, int *ids, int max) {
+    return copy_ids(&topics, topic, after_id, ids, max);
+}
+
+int catalog_ids_by_difficulty(const char *difficulty, int after_id, int *ids, int max) {
+    return copy_ids(&difficulties, difficulty, after_id, ids, max);
+}
+
+// ===== SAMPLING =====
+
+#define SAMPLE_MAX_KEYS 64
+
+// Resolve a "name:count name:count ..." filter (counts ignored) to distinct keys.
+// Returns the number of keys found, -1 for an empty filter (any key matches).
+static int parse_filter(KeyTable *t, const char *filter, CatalogKey **keys) {
+    if (!filter || !*filter) return -1;
+    int n = 0;
+    const char *p = filter;
+    while (*p) {
+        p += strspn(p, " ");
+        size_t len = strcspn(p, " ");
+        if (len == 0) break;
+        char name[64];
+        size_t name_len = strcspn(p, ": ");
+        snprintf(name, sizeof(name), "%.*s", (int)(name_len < sizeof(name) ? name_len : sizeof(name) - 1), p);
+        CatalogKey *k = key_find(t, name);
+        int seen = 0;
+        for (int i = 0; i < n; i++) seen |= keys[i] == k;
+        if (k && !seen && n < SAMPLE_MAX_KEYS) keys[n++] = k;
+        p += len;
+    }
+    return n;
+}
+
+static int key_selected(KeyTable *t, int id, CatalogKey **keys, int n) {
+    CatalogKey *k = key_get(t, id);
+    if (!k) return 0;
+    if (n < 0) return 1;
+    for (int i = 0; i < n; i++) {
+        if (keys[i] == k) return 1;
+    }
+    return 0;
+}
+
+int catalog_sample(const char *topic_filter, const char *diff_filter, Question *out, int max,
+                   Arena *arena) {
+    if (!out || max <= 0) return 0;
+    pthread_mutex_lock(&catalog_lock);
+    CatalogKey *topic_keys[SAMPLE_MAX_KEYS], *diff_keys[SAMPLE_MAX_KEYS];
+    int nt = parse_filter(&topics, topic_filter, topic_keys);
+    int nd = parse_filter(&difficulties, diff_filter, diff_keys);
+
+    // Candidates: the named topics' lists, else the (named) difficulties' lists.
+    // Both partition the questions, so no id appears twice.
+    KeyTable *source = nt >= 0 ? &topics : &difficulties;
+    CatalogKey **source_keys = nt >= 0 ? topic_keys : diff_keys;
+    int ns = nt >= 0 ? nt : nd;
+    size_t total = 0;
+    for (int i = 0; i < source->cap; i++) {
+        if (key_selected(source, i, source_keys, ns)) total += source->keys[i].list.count;
+    }
+    int *candidates = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!candidates) {
+        pthread_mutex_unlock(&catalog_lock);
+        return 0;
+    }
+    size_t filled = 0;
+    for (int i = 0; i < source->cap; i++) {
+        if (!key_selected(source, i, source_keys, ns)) continue;
+        PostingList *pl = &source->keys[i].list;
+        memcpy(candidates + filled, pl->ids, pl->count * sizeof(int));
+        filled += pl->count;
+    }
+
+    // Partial Fisher-Yates; the other filter is checked only on drawn questions,
+    // so records of questions never drawn are not touched
+    Rng *rng = rng_thread();
+    int n = 0;
+    for (size_t i = 0; i < total && n < max; i++) {
+        size_t j = i + rng_below(rng, (uint32_t)(total - i));
+        int id = candidates[j];
+        candidates[j] = candidates[i];
+        candidates[i] = id;
+
+        QuestionRef q;
+        if (question_ref(id, &q) &&
+            key_selected(&topics, q.topic_id, topic_keys, nt) &&
+            key_selected(&difficulties, q.difficulty_id, diff_keys, nd)) {
+            if (!fill_question(id, &q, &out[n], arena)) break;
+            n++;
+        }
+    }
+    free(candidates);
+    pthread_mutex_unlock(&catalog_lock);
+    return n;
+}
+
+int catalog_random_id(void) {
+    pthread_mutex_lock(&catalog_lock);
+    int id = live_count > 0 ? live_ids[rng_below(rng_thread(), (uint32_t)live_count)] : 0;
+    pthread_mutex_unlock(&catalog_lock);
+    return id;
+}
+
+// ===== FORMATTED RESPONSES =====
+
+static int compare_key_name(const void *a, const void *b) {
+    const CatalogKey *ka = *(CatalogKey* const*)a, *kb = *(CatalogKey* const*)b;
+    return strcmp(ka->name, kb->name);
+}
+
+static int compare_key_level(const void *a, const void *b) {
+    const CatalogKey *ka = *(CatalogKey* const*)a, *kb = *(CatalogKey* const*)b;
+    return ka->level - kb->level;
+}
+
+// Render "Name(count)|..." for every key, sorted with cmp (caller holds catalog_lock)
+static char *render_keys(KeyTable *t, int (*cmp)(const void*, const void*)) {
+    int n = 0;
+    CatalogKey **sorted = malloc((t->cap > 0 ? t->cap : 1) * sizeof(CatalogKey*));
+    if (!sorted) return NULL;
+    for (int i = 0; i < t->cap; i++) {
+        if (t->keys[i].present) sorted[n++] = &t->keys[i];
+    }
+    qsort(sorted, n, sizeof(CatalogKey*), cmp);
+
+    size_t size = (size_t)n * 80 + 1, len = 0;
+    char *out = malloc(size);
+    if (!out) {
+        free(sorted);
+        return NULL;
+    }
+    out[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s", sorted[i]->name);
+        name[0] = (char)toupper((unsigned char)name[0]);
+        len += snprintf(out + len, size - len, "%s(%d)|", name, sorted[i]->list.count);
+    }
+    free(sorted);
+    return out;
+}
+
+static int copy_cached(char **cache, unsigned long *cache_version, KeyTable *t,
+                       int (*cmp)(const void*, const void*), char *output, int max_size) {
+    pthread_mutex_lock(&catalog_lock);
+    if (*cache_version != version || !*cache) {
+        free(*cache);
+        *cache = render_keys(t, cmp);
+        *cache_version = version;
+    }
+    int len = 0;
+    if (*cache) len = snprintf(output, max_size, "%s", *cache);
+    else if (max_size > 0) output[0] = '\0';
+    pthread_mutex_unlock(&catalog_lock);
+    return len < max_size ? len : max_size - 1;
+}
+
+int catalog_format_topics(char *output, int max_size) {
+    if (!output || max_size <= 0) return 0;
+    return copy_cached(&topics_cache, &topics_cache_version, &topics, compare_key_name,
+                       output, max_size);
+}
+
+int catalog_format_difficulties(char *output, int max_size) {
+    if (!output || max_size <= 0) return 0;
+    return copy_cached(&diffs_cache, &diffs_cache_version, &difficulties, compare_key_level,
+                       output, max_size);
+}
+
+unsigned long catalog_version(void) {
+    pthread_mutex_lock(&catalog_lock);
+    unsigned long v = version;
+    pthread_mutex_unlock(&catalog_lock);
+    return v;
+}
@@ -0,0 +1,70 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "common.h"
+#include "bank_image.h"
+
+// In-memory catalog of every live question.
+//  - primary index: question id -> entry (direct-mapped array, ids are stable)
+//  - secondary indexes: per-topic and per-difficulty posting lists of ids, kept
+//    sorted ascending so they double as precomputed counts and ordered scans
+//  - version counter bumped on every change; formatted GET_TOPICS /
+//    GET_DIFFICULTIES responses are cached until the version moves
+//  - live set: dense array of every live id, for O(1) uniform sampling (PRACTICE)
+// Kept in sync write-through: each storage engine's add_question/delete_question
+// (storage.h) calls the catalog_on_* hooks after a successful write.
+// Alternatively attached to a compiled bank image (bank_image.h): questions and
+// posting lists are then read from the mapping, and only changes made since
+// are held in memory (posting lists are copied on their first change).
+
+// Load topics, difficulties and all live questions from the database
+int catalog_load(void);
+
+// Attach a bank image (opened with bank_image_open) in O(topics + difficulties);
+// the catalog owns img from here on and closes it on the next load.
+// Returns the question count, -1 on failure (img is closed, catalog left empty).
+int catalog_load_image(BankImage *img);
+
+// 1 once catalog_load() has run (hooks are no-ops before that)
+int catalog_is_loaded(void);
+
+// Write-through hooks (called from db_queries.c and storage_memory.c)
+void catalog_on_topic_added(int topic_id, const char *name);
+void catalog_on_question_added(int id, const char *text, const char *opt_a, const char *opt_b,
+                               const char *opt_c, const char *opt_d, char correct,
+                               int topic_id, int difficulty_id);
+void catalog_on_question_deleted(int id);
+
+// Primary-key lookup; returns 1 and fills out (strings copied into arena) if
+// the question exists
+int catalog_get_question(int id, Question *out, Arena *arena);
+int catalog_question_exists(int id);
+
+// Live question counts
+int catalog_question_count(void);
+int catalog_topic_count(const char *topic);
+int catalog_difficulty_count(const char *difficulty);
+
+// Posting-list access: copies up to max ids (ascending) with id > after_id.
+// Returns the number of ids copied, -1 if the topic/difficulty is unknown.
+int catalog_ids_by_topic(const char *topic, int after_id, int *ids, int max);
+int catalog_ids_by_difficulty(const char *difficulty, int after_id, int *ids, int max);
+
+// Random sample of up to max questions, the catalog's answer to
+// storage->get_questions_with_distribution: filters are "name:count ..." lists
+// of topics / difficulties (counts ignored, empty = any). Strings are copied
+// into arena. Returns the number written.
+int catalog_sample(const char *topic_filter, const char *diff_filter, Question *out, int max,
+                   Arena *arena);
+
+// Id of a uniformly drawn live question, 0 when the bank is empty
+int catalog_random_id(void);
+
+// Cached "Topic(count)|Topic(count)|" / "Easy(n)|Medium(n)|Hard(n)|" strings
+int catalog_format_topics(char *output, int max_size);
+int catalog_format_difficulties(char *output, int max_size);
+
+// Bumped on every catalog change
+unsigned long catalog_version(void);
+
+#endif // CATALOG_H
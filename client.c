@@ -74,6 +74,7 @@ void print_banner() {
         printf("10. Practice\n");
         printf("11. Add Questions\n");
         printf("12. Delete Questions\n");
+        printf("13. Bulk Upload Questions (file)\n");
     } else {
         printf("3. View Room List\n");
         printf("4. Join Room → Start Test\n");
@@ -594,10 +595,18 @@ void handle_view_results() {
 }
 
 void handle_leaderboard() {
-    send_message("LEADERBOARD");
+    char room[100], cmd[256];
+    printf("Room name (Enter for all rooms): ");
+    fgets(room, sizeof(room), stdin); trim_input_newline(room);
+    snprintf(cmd, sizeof(cmd), "LEADERBOARD %s", room);
+    send_message(cmd);
     char buffer[BUFFER_SIZE];
     recv_message(buffer, sizeof(buffer));
     printf("\n%s\n", buffer);
+    
+    send_message("RANK");
+    recv_message(buffer, sizeof(buffer));
+    if (strncmp(buffer, "SUCCESS", 7) == 0) printf("Global rank: %s", buffer + 8);
 }
 
 void handle_practice() {
@@ -628,6 +637,8 @@ void handle_practice() {
         }
     }
     if (!correct_ans) { printf("No answer.\n"); return; }
+    int question_id = 0;
+    sscanf(lines[0], "PRACTICE_Q [ID %d", &question_id);
 
     printf("\n--- Practice ---\n");
     char *qtext = lines[0];
@@ -650,6 +661,17 @@ void handle_practice() {
     }
 
     printf(ans[0] == correct_ans ? "Correct!\n" : "Wrong! Correct: %c\n", correct_ans);
+
+    // Let the server's spaced-repetition scheduler record the outcome
+    if (question_id > 0) {
+        char cmd[64];
+        snprintf(cmd, sizeof(cmd), "PRACTICE_ANSWER %d %c", question_id, ans[0]);
+        send_message(cmd);
+        if (recv_message(buffer, sizeof(buffer)) > 0 && strncmp(buffer, "SUCCESS", 7) == 0) {
+            char *schedule = strstr(buffer, "box ");
+            if (schedule) printf("Scheduled: %s\n", schedule);
+        }
+    }
 }
 
 void handle_add_question() {
@@ -782,6 +804,121 @@ void handle_add_question() {
     printf("%s\n", buffer);
 }
 
+// Upload a file of text|A|B|C|D|correct|topic|difficulty lines with BULK_ADD_QUESTIONS
+void handle_bulk_add_questions() {
+    if (!loggedIn || strcmp(currentRole, "admin") != 0) {
+        printf("Only admin can add questions.\n");
+        return;
+    }
+    
+    printf("\n====== BULK UPLOAD QUESTIONS ======\n");
+    printf("File (one text|A|B|C|D|correct|topic|difficulty per line): ");
+    char path[256];
+    fgets(path, sizeof(path), stdin);
+    trim_input_newline(path);
+    
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Cannot open %s\n", path);
+        return;
+    }
+    
+    // Count non-empty lines first so the server knows how many records follow
+    char line[1024];
+    int count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        trim_input_newline(line);
+        if (strlen(line) > 0) count++;
+    }
+    if (count == 0) {
+        printf("File has no records.\n");
+        fclose(f);
+        return;
+    }
+    
+    char buffer[BUFFER_SIZE], cmd[64];
+    snprintf(cmd, sizeof(cmd), "BULK_ADD_QUESTIONS %d", count);
+    send_message(cmd);
+    recv_message(buffer, sizeof(buffer));
+    if (strncmp(buffer, "READY", 5) != 0) {
+        printf("%s\n", buffer);
+        fclose(f);
+        return;
+    }
+    
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        trim_input_newline(line);
+        if (strlen(line) > 0) send_message(line);
+    }
+    fclose(f);
+    
+    // "SUCCESS Added k of n ...\nCODES 0120...[\nSIMILAR rec:id ...]" - one digit per record
+    recv_message(buffer, sizeof(buffer));
+    char *similar = strstr(buffer, "\nSIMILAR ");
+    if (similar) *similar = '\0';
+    char *codes = strstr(buffer, "\nCODES ");
+    if (codes) *codes = '\0';
+    printf("%s\n", buffer);
+    if (codes) {
+        static const char *reasons[] = {
+            "ok", "bad format", "text too short", "empty option", "correct must be A-D",
+            "empty topic", "difficulty must be easy/medium/hard", "database error",
+            "topic name too long", "duplicate of an existing question"
+        };
+        codes += 7;
+        for (int i = 0; codes[i] >= '0' && codes[i] <= '9'; i++) {
+            if (codes[i] != '0') printf("  Record %d: %s\n", i + 1, reasons[codes[i] - '0']);
+        }
+    }
+    if (similar) {
+        int record, id, n;
+        for (char *p = similar + 9; sscanf(p, "%d:%d%n", &record, &id, &n) == 2; p += n) {
+            printf("  Record %d: added, similar to question ID %d\n", record, id);
+        }
+    }
+}
+
+// Print SEARCH_QUESTIONS pages, following "NEXT <id>" tokens while the user wants more.
+// Returns 1 if at least one question was shown.
+int browse_search_results(const char *filter_type, const char *search_value) {
+    char buffer[BUFFER_SIZE], cmd[512];
+    int after_id = 0, shown = 0;
+    
+    while (1) {
+        if (after_id > 0)
+            snprintf(cmd, sizeof(cmd), "SEARCH_QUESTIONS %s %s AFTER %d", filter_type, search_value, after_id);
+        else
+            snprintf(cmd, sizeof(cmd), "SEARCH_QUESTIONS %s %s", filter_type, search_value);
+        send_message(cmd);
+        recv_message(buffer, sizeof(buffer));
+        
+        if (strncmp(buffer, "SUCCESS", 7) != 0) {
+            printf("%s\n", buffer);
+            return shown;
+        }
+        
+        // Split off the continuation token, if any
+        after_id = 0;
+        char *next = strstr(buffer, "\nNEXT ");
+        if (next) {
+            after_id = atoi(next + 6);
+            next[1] = '\0';
+        }
+        
+        printf("\n====== QUESTIONS FOUND ======\n");
+        printf("%s\n", buffer + 8);
+        printf("==============================\n");
+        shown = 1;
+        
+        if (after_id == 0) return shown;
+        printf("More results? (y/n): ");
+        char choice[10];
+        fgets(choice, sizeof(choice), stdin);
+        if (choice[0] != 'y' && choice[0] != 'Y') return shown;
+    }
+}
+
 void handle_delete_question() {
     if (!loggedIn || strcmp(currentRole, "admin") != 0) {
         printf("Only admin can delete questions.\n");
@@ -846,23 +983,10 @@ void handle_delete_question() {
         trim_input_newline(search_value);
         strcpy(filter_type, "topic");
         
-        // Search for questions by topic
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "SEARCH_QUESTIONS %s %s", filter_type, search_value);
-        send_message(cmd);
-        recv_message(buffer, sizeof(buffer));
-        
-        if (strncmp(buffer, "SUCCESS", 7) != 0) {
-            printf("%s\n", buffer);
-            return;
-        }
-        
-        // Display search results
-        printf("\n====== QUESTIONS FOUND ======\n");
-        char *data = buffer + 8;
-        printf("%s\n", data);
-        printf("==============================\n");
+        // Search for questions by topic, one page at a time
+        if (!browse_search_results(filter_type, search_value)) return;
         
+        char cmd[512];
         printf("Enter Question ID to delete: ");
         char id_str[32];
         fgets(id_str, sizeof(id_str), stdin);
@@ -891,23 +1015,10 @@ void handle_delete_question() {
         to_lowercase_client(search_value);
         strcpy(filter_type, "difficulty");
         
-        // Search for questions by difficulty
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "SEARCH_QUESTIONS %s %s", filter_type, search_value);
-        send_message(cmd);
-        recv_message(buffer, sizeof(buffer));
-        
-        if (strncmp(buffer, "SUCCESS", 7) != 0) {
-            printf("%s\n", buffer);
-            return;
-        }
-        
-        // Display search results
-        printf("\n====== QUESTIONS FOUND ======\n");
-        char *data = buffer + 8;
-        printf("%s\n", data);
-        printf("==============================\n");
+        // Search for questions by difficulty, one page at a time
+        if (!browse_search_results(filter_type, search_value)) return;
         
+        char cmd[512];
         printf("Enter Question ID to delete: ");
         char id_str[32];
         fgets(id_str, sizeof(id_str), stdin);
@@ -973,6 +1084,7 @@ int main(int argc, char *argv[]) {
             else if (strcmp(choice, "10") == 0) handle_practice();
             else if (strcmp(choice, "11") == 0) handle_add_question();
             else if (strcmp(choice, "12") == 0) handle_delete_question();
+            else if (strcmp(choice, "13") == 0) handle_bulk_add_questions();
             else if (strcmp(choice, "0") == 0) break;
         } else {
             if (strcmp(choice, "3") == 0) handle_list_rooms();
@@ -9,50 +9,67 @@
 #include "db_init.h"
 #include "db_queries.h"
 #include "db_migration.h"
+#include "storage.h"
 
 #define MAX_QUESTIONS_PER_ROOM 50
 #define DB_PATH "test_system.db"
 #define DATA_DIR "data"
+#define BANK_IMAGE_PATH "data/question_bank.img"  // Compiled question bank (bank_image.h)
 
-typedef struct {
-    int id;
-    char text[256];
-    char A[128];
-    char B[128];
-    char C[128];
-    char D[128];
-    char correct;
-    char topic[64];
-    char difficulty[32];
-} QItem;
+// Questions are the compact Question of question.h; loaders copy their strings
+// into the caller's arena, which must outlive the loaded questions.
 
 // Main question loading function
-int loadQuestionsTxt(const char *filename, QItem *questions, int maxQ,
-                     const char *topic, const char *diff);
+int loadQuestionsTxt(const char *filename, Question *questions, int maxQ,
+                     const char *topic, const char *diff, Arena *arena);
 
 // Load questions with topic and difficulty distribution filters
-int loadQuestionsWithFilters(const char *filename, QItem *questions, int maxQ,
-                             const char *topic_filter, const char *diff_filter);
+int loadQuestionsWithFilters(const char *filename, Question *questions, int maxQ,
+                             const char *topic_filter, const char *diff_filter, Arena *arena);
 
 // Enumeration functions
 int get_all_topics_with_counts(char *output);
 int get_all_difficulties_with_counts(char *output);
 
+// Question validation codes (also the per-record codes of BULK_ADD_QUESTIONS)
+#define QUESTION_OK 0
+#define QUESTION_ERR_FORMAT 1        // Not text|A|B|C|D|correct|topic|difficulty
+#define QUESTION_ERR_TEXT_SHORT 2
+#define QUESTION_ERR_OPTION_EMPTY 3
+#define QUESTION_ERR_CORRECT 4
+#define QUESTION_ERR_TOPIC_EMPTY 5
+#define QUESTION_ERR_DIFFICULTY 6
+#define QUESTION_ERR_DB 7            // Insert failed
+#define QUESTION_ERR_TOPIC_LONG 8    // Topic name over MAX_TOPIC_NAME bytes
+#define QUESTION_ERR_DUPLICATE 9     // Same content as a question in the bank (dedup.h)
+
+#define MAX_TOPIC_NAME 63            // Catalog and memory-engine topic keys
+
 // Question validation
-int validate_question_input(const QItem *q, char *error_msg);
+int validate_question_code(const Question *q);
+int validate_question_input(const Question *q, char *error_msg);
 
 // Question file operations
-int add_question_to_file(const QItem *q);
+int add_question_to_file(const Question *q);
+
+// Insert items in one transaction; codes[i] receives QUESTION_OK or an error code
+// (QUESTION_ERR_DUPLICATE for content already in the bank or earlier in items),
+// ids[i] the new id (0 on failure), similar[i] (optional) a near duplicate's id
+// or 0. Items must already be validated.
+int add_questions_bulk(const Question *items, int count, int created_by, int *ids, int *codes,
+                       int *similar);
 
 // Question search and delete operations
-int search_questions_by_id(int id, QItem *result);
-int search_questions_by_topic(const char *topic, char *output);
-int search_questions_by_difficulty(const char *difficulty, char *output);
+int search_questions_by_id(int id, Question *result, Arena *arena);
+int search_questions_by_topic(const char *topic, int after_id, int limit,
+                              char *output, int max_size, int *next_id);
+int search_questions_by_difficulty(const char *difficulty, int after_id, int limit,
+                                   char *output, int max_size, int *next_id);
 int delete_question_by_id(int id);
 
 // Deduplication & randomization
-int remove_duplicate_questions(QItem *questions, int *count);
-int shuffle_questions(QItem *questions, int count);
+int remove_duplicate_questions(Question *questions, int *count);
+int shuffle_questions(Question *questions, int count);
 
 // String utilities
 void to_lowercase(char *str);
@@ -60,8 +77,6 @@ void to_uppercase(char *str);
 
 // User management
 void writeLog(const char *event);
-int validate_user(const char *username, const char *password, char *role_out);
-int register_user_with_role(const char *username, const char *password, const char *role);
 int db_get_user_id(const char *username);  // 🔧 Get user ID from database
 int db_sync_questions_from_file(const char *filename);  // 🔧 Sync file questions to database
 
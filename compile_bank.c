@@ -0,0 +1,43 @@
+// Question-bank image compiler
+//
+// Writes the live question bank of a database into the read-only binary image
+// the server maps at startup (bank_image.h). The server recompiles a stale
+// image itself when it starts; this tool does it ahead of time, e.g. right
+// after import_questions, so the next start maps the image straight away.
+//
+// Usage: ./compile_bank [db_path] [image_path]   (defaults: test_system.db, data/question_bank.img)
+
+#include "common.h"
+#include "bank_image.h"
+#include <sys/stat.h>
+#include <time.h>
+
+int main(int argc, char *argv[]) {
+    const char *db_path = argc > 1 ? argv[1] : DB_PATH;
+    const char *image_path = argc > 2 ? argv[2] : BANK_IMAGE_PATH;
+
+    if (!storage->open(db_path)) {
+        fprintf(stderr, "Failed to initialize database %s\n", db_path);
+        return 1;
+    }
+    if (argc <= 2) mkdir(DATA_DIR, 0755);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // One read transaction: the version and the rows come from the same snapshot
+    storage->begin_transaction();
+    long bank_version = db_get_bank_version();
+    int written = bank_version >= 0 ? bank_image_compile(image_path, (unsigned long)bank_version) : -1;
+    storage->commit_transaction();
+    storage->close();
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (written < 0) {
+        fprintf(stderr, "Failed to compile %s\n", image_path);
+        return 1;
+    }
+    printf("Compiled %d questions (bank version %ld) into %s in %.0f ms\n", written, bank_version,
+           image_path, (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "db_init.h"
+#include "answer_sheet.h"
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,6 +19,9 @@ int db_init(const char *db_path) {
     // Enable foreign keys
     sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
     
+    // WAL lets snapshot readers (export.c) run without blocking the server's writes
+    sqlite3_exec(db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
+    
     return 1;
 }
 
@@ -35,7 +39,7 @@ int db_create_tables(void) {
         // Topics
         "CREATE TABLE IF NOT EXISTS topics ("
         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "  name TEXT NOT NULL UNIQUE,"
+        "  name TEXT NOT NULL UNIQUE COLLATE NOCASE,"
         "  description TEXT,"
         "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
         ");",
@@ -43,7 +47,7 @@ int db_create_tables(void) {
         // Difficulties
         "CREATE TABLE IF NOT EXISTS difficulties ("
         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "  name TEXT NOT NULL UNIQUE,"
+        "  name TEXT NOT NULL UNIQUE COLLATE NOCASE,"
         "  level INTEGER NOT NULL CHECK(level BETWEEN 1 AND 3),"
         "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
         ");",
@@ -70,6 +74,7 @@ int db_create_tables(void) {
         "  difficulty_id INTEGER NOT NULL,"
         "  created_by INTEGER,"
         "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "  is_deleted INTEGER NOT NULL DEFAULT 0,"
         "  FOREIGN KEY(topic_id) REFERENCES topics(id) ON DELETE RESTRICT,"
         "  FOREIGN KEY(difficulty_id) REFERENCES difficulties(id) ON DELETE RESTRICT,"
         "  FOREIGN KEY(created_by) REFERENCES users(id) ON DELETE SET NULL"
@@ -171,6 +176,414 @@ int db_create_tables(void) {
         }
     }
     
+    return db_upgrade_schema();
+}
+
+// Check whether a column exists on a table (used for in-place schema upgrades)
+static int db_column_exists(const char *table, const char *column) {
+    sqlite3_stmt *stmt;
+    char query[128];
+    snprintf(query, sizeof(query), "PRAGMA table_info(%s);", table);
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    
+    int found = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *name = (const char*)sqlite3_column_text(stmt, 1);
+        if (name && strcmp(name, column) == 0) {
+            found = 1;
+            break;
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Check whether a table exists
+static int db_table_exists(const char *table) {
+    sqlite3_stmt *stmt;
+    const char *query = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?";
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    int exists = (sqlite3_step(stmt) == SQLITE_ROW) ? 1 : 0;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+// Whether a table was created with a COLLATE NOCASE column
+static int db_table_has_nocase(const char *table) {
+    sqlite3_stmt *stmt;
+    const char *query = "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = ?";
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    int found = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *sql = (const char*)sqlite3_column_text(stmt, 0);
+        found = sql && strstr(sql, "COLLATE NOCASE") != NULL;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Rebuild topics/difficulties so name is COLLATE NOCASE: lookups by name are
+// then case-insensitive through the UNIQUE index instead of a LOWER() scan.
+// SQLite cannot change a column's collation in place, so the rows (same ids)
+// are copied into a new table that replaces the old one. Skipped, with a
+// warning, if two names differ only in case (queries stay correct, just unindexed).
+static int db_upgrade_name_collation(const char *table, const char *create_sql, const char *columns) {
+    if (db_table_has_nocase(table)) return 1;
+    
+    char query[512];
+    sqlite3_stmt *stmt;
+    snprintf(query, sizeof(query),
+             "SELECT 1 FROM %s GROUP BY name COLLATE NOCASE HAVING COUNT(*) > 1", table);
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) return 0;
+    int clash = (sqlite3_step(stmt) == SQLITE_ROW);
+    sqlite3_finalize(stmt);
+    if (clash) {
+        fprintf(stderr, "Warning: %s has names differing only in case; kept case-sensitive\n", table);
+        return 1;
+    }
+    
+    // Foreign keys must be off (outside the transaction) for the drop to keep
+    // the rows that reference this table
+    sqlite3_exec(db, "PRAGMA foreign_keys = OFF;", NULL, NULL, NULL);
+    char *err_msg = NULL;
+    int ok = sqlite3_exec(db, "BEGIN;", NULL, NULL, &err_msg) == SQLITE_OK;
+    if (ok) ok = sqlite3_exec(db, create_sql, NULL, NULL, &err_msg) == SQLITE_OK;
+    if (ok) {
+        snprintf(query, sizeof(query), "INSERT INTO %s_new (%s) SELECT %s FROM %s;",
+                 table, columns, columns, table);
+        ok = sqlite3_exec(db, query, NULL, NULL, &err_msg) == SQLITE_OK;
+    }
+    if (ok) {
+        snprintf(query, sizeof(query), "DROP TABLE %s; ALTER TABLE %s_new RENAME TO %s;",
+                 table, table, table);
+        ok = sqlite3_exec(db, query, NULL, NULL, &err_msg) == SQLITE_OK;
+    }
+    if (ok) {
+        ok = sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg) == SQLITE_OK;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error upgrading %s collation: %s\n", table, err_msg ? err_msg : "");
+        sqlite3_free(err_msg);
+        if (!sqlite3_get_autocommit(db)) sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+    sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+    return ok;
+}
+
+// Full-text index over question text and options: an external-content FTS5
+// table shadowing the live (non-tombstoned) rows of `questions`, kept in sync
+// by triggers. Optional - if this SQLite build lacks FTS5 the server runs
+// without SEARCH_QUESTIONS text.
+static int db_create_search_index(void) {
+    if (db_table_exists("questions_fts")) return 1;
+    
+    const char *fts_queries[] = {
+        "CREATE VIRTUAL TABLE questions_fts USING fts5("
+        "  text, option_a, option_b, option_c, option_d,"
+        "  content='questions', content_rowid='id', tokenize='unicode61 remove_diacritics 2'"
+        ");",
+        "CREATE TRIGGER IF NOT EXISTS trg_questions_fts_insert AFTER INSERT ON questions BEGIN "
+        "  INSERT INTO questions_fts (rowid, text, option_a, option_b, option_c, option_d) "
+        "  VALUES (NEW.id, NEW.text, NEW.option_a, NEW.option_b, NEW.option_c, NEW.option_d); "
+        "END;",
+        // Tombstoning removes the row from the index; purging it later is then a no-op
+        "CREATE TRIGGER IF NOT EXISTS trg_questions_fts_tombstone "
+        "AFTER UPDATE OF is_deleted ON questions WHEN OLD.is_deleted = 0 AND NEW.is_deleted = 1 BEGIN "
+        "  INSERT INTO questions_fts (questions_fts, rowid, text, option_a, option_b, option_c, option_d) "
+        "  VALUES ('delete', OLD.id, OLD.text, OLD.option_a, OLD.option_b, OLD.option_c, OLD.option_d); "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_questions_fts_delete AFTER DELETE ON questions "
+        "WHEN OLD.is_deleted = 0 BEGIN "
+        "  INSERT INTO questions_fts (questions_fts, rowid, text, option_a, option_b, option_c, option_d) "
+        "  VALUES ('delete', OLD.id, OLD.text, OLD.option_a, OLD.option_b, OLD.option_c, OLD.option_d); "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_questions_fts_update "
+        "AFTER UPDATE OF text, option_a, option_b, option_c, option_d ON questions "
+        "WHEN OLD.is_deleted = 0 BEGIN "
+        "  INSERT INTO questions_fts (questions_fts, rowid, text, option_a, option_b, option_c, option_d) "
+        "  VALUES ('delete', OLD.id, OLD.text, OLD.option_a, OLD.option_b, OLD.option_c, OLD.option_d); "
+        "  INSERT INTO questions_fts (rowid, text, option_a, option_b, option_c, option_d) "
+        "  VALUES (NEW.id, NEW.text, NEW.option_a, NEW.option_b, NEW.option_c, NEW.option_d); "
+        "END;",
+        // Index the live part of the existing bank
+        "INSERT INTO questions_fts (rowid, text, option_a, option_b, option_c, option_d) "
+        "SELECT id, text, option_a, option_b, option_c, option_d FROM questions WHERE is_deleted = 0;"
+    };
+    
+    char *err_msg = NULL;
+    if (sqlite3_exec(db, "SAVEPOINT fts_setup;", NULL, NULL, NULL) != SQLITE_OK) return 0;
+    
+    int num_queries = sizeof(fts_queries) / sizeof(fts_queries[0]);
+    for (int i = 0; i < num_queries; i++) {
+        if (sqlite3_exec(db, fts_queries[i], NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Warning: full-text search disabled: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            sqlite3_exec(db, "ROLLBACK TO fts_setup; RELEASE fts_setup;", NULL, NULL, NULL);
+            return 0;
+        }
+    }
+    
+    sqlite3_exec(db, "RELEASE fts_setup;", NULL, NULL, NULL);
+    return 1;
+}
+
+// Bring databases created by older builds up to the current schema
+int db_upgrade_schema(void) {
+    char *err_msg = NULL;
+    
+    // Questions are soft-deleted (tombstoned) so ids stay stable
+    if (!db_column_exists("questions", "is_deleted")) {
+        if (sqlite3_exec(db, "ALTER TABLE questions ADD COLUMN is_deleted INTEGER NOT NULL DEFAULT 0;",
+                         NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error upgrading questions table: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
+    // Earlier builds kept a gap-free display ordinal that nothing displayed;
+    // renumbering it after every delete cost a window over the whole table
+    if (db_column_exists("questions", "ordinal")) {
+        if (sqlite3_exec(db, "DROP INDEX IF EXISTS idx_questions_ordinal; "
+                         "ALTER TABLE questions DROP COLUMN ordinal;",
+                         NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error upgrading questions table: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
+    // Per-user running sums for the global ranking, kept current by triggers on
+    // results so rankings never need a GROUP BY over the whole results table.
+    // Backfilled once from existing results when the table is first created.
+    int backfill_user_stats = !db_table_exists("user_stats");
+    // Item statistics (item_stats.h) likewise start from the answers already stored
+    int backfill_item_stats = !db_table_exists("item_stats");
+    
+    const char *upgrade_queries[] = {
+        "CREATE TABLE IF NOT EXISTS user_stats ("
+        "  user_id INTEGER PRIMARY KEY,"
+        "  results_count INTEGER NOT NULL DEFAULT 0,"
+        "  score_sum INTEGER NOT NULL DEFAULT 0,"
+        "  total_sum INTEGER NOT NULL DEFAULT 0,"
+        "  FOREIGN KEY(user_id) REFERENCES users(id) ON DELETE CASCADE"
+        ");",
+        "CREATE TRIGGER IF NOT EXISTS trg_results_stats_insert AFTER INSERT ON results BEGIN "
+        "  INSERT INTO user_stats (user_id, results_count, score_sum, total_sum) "
+        "  SELECT p.user_id, 1, NEW.score, NEW.total_questions FROM participants p "
+        "  WHERE p.id = NEW.participant_id "
+        "  ON CONFLICT(user_id) DO UPDATE SET results_count = results_count + 1, "
+        "  score_sum = score_sum + excluded.score_sum, total_sum = total_sum + excluded.total_sum; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_results_stats_delete AFTER DELETE ON results BEGIN "
+        "  UPDATE user_stats SET results_count = results_count - 1, "
+        "  score_sum = score_sum - OLD.score, total_sum = total_sum - OLD.total_questions "
+        "  WHERE user_id = (SELECT user_id FROM participants WHERE id = OLD.participant_id); "
+        "END;",
+        "CREATE INDEX IF NOT EXISTS idx_questions_deleted ON questions(is_deleted);",
+        // Compaction checks whether a tombstoned question is still referenced
+        "CREATE INDEX IF NOT EXISTS idx_room_questions_question ON room_questions(question_id);",
+        "CREATE INDEX IF NOT EXISTS idx_answers_question ON answers(question_id);",
+        // Packed answer storage (answer_sheet.h): one row per submission
+        "CREATE TABLE IF NOT EXISTS answer_sheets ("
+        "  participant_id INTEGER PRIMARY KEY,"
+        "  question_count INTEGER NOT NULL,"
+        "  question_ids BLOB NOT NULL,"
+        "  marks BLOB NOT NULL,"
+        "  submitted_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "  FOREIGN KEY(participant_id) REFERENCES participants(id) ON DELETE CASCADE"
+        ");",
+        // Indexes found missing by the query-plan audit (db_audit_query_plans):
+        // room lookup by name, leaderboard (covering, already in score order),
+        // room questions in exam order, a participant's answer rows in id order.
+        // results(room_id, ...) also serves the rooms -> results foreign key.
+        "CREATE INDEX IF NOT EXISTS idx_rooms_name ON rooms(name);",
+        "CREATE INDEX IF NOT EXISTS idx_results_room_score "
+        "ON results(room_id, score DESC, participant_id, total_questions);",
+        "CREATE INDEX IF NOT EXISTS idx_room_questions_order "
+        "ON room_questions(room_id, order_num, question_id);",
+        "CREATE INDEX IF NOT EXISTS idx_answers_participant ON answers(participant_id);",
+        // Spaced-repetition practice state (practice.h), written behind in batches
+        "CREATE TABLE IF NOT EXISTS practice_cards ("
+        "  user_id INTEGER NOT NULL,"
+        "  question_id INTEGER NOT NULL,"
+        "  box INTEGER NOT NULL,"
+        "  due_at INTEGER NOT NULL,"
+        "  PRIMARY KEY(user_id, question_id),"
+        "  FOREIGN KEY(user_id) REFERENCES users(id) ON DELETE CASCADE"
+        ") WITHOUT ROWID;",
+        // Snapshots of the running item statistics (item_stats.h)
+        "CREATE TABLE IF NOT EXISTS item_stats ("
+        "  question_id INTEGER PRIMARY KEY,"
+        "  attempts INTEGER NOT NULL,"
+        "  correct INTEGER NOT NULL,"
+        "  choice_a INTEGER NOT NULL,"
+        "  choice_b INTEGER NOT NULL,"
+        "  choice_c INTEGER NOT NULL,"
+        "  choice_d INTEGER NOT NULL,"
+        "  choice_blank INTEGER NOT NULL,"
+        "  mean_item REAL NOT NULL,"
+        "  mean_rest REAL NOT NULL,"
+        "  m2_item REAL NOT NULL,"
+        "  m2_rest REAL NOT NULL,"
+        "  co_moment REAL NOT NULL,"
+        "  updated_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ");",
+        // CREATE specs with pregenerated question sets (exam_pool.h)
+        "CREATE TABLE IF NOT EXISTS exam_templates ("
+        "  name TEXT PRIMARY KEY,"
+        "  num_questions INTEGER NOT NULL,"
+        "  pool_size INTEGER NOT NULL,"
+        "  topic_filter TEXT NOT NULL,"
+        "  diff_filter TEXT NOT NULL,"
+        "  created_by INTEGER,"
+        "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ");",
+        // Deleted rooms whose archived results are still in the month files
+        // (archive_delete_room() queues them when a reader holds the archive)
+        "CREATE TABLE IF NOT EXISTS archive_purges (room_id INTEGER PRIMARY KEY);",
+        // One row per packed answer, decoded from the hex digits of the blobs
+        "CREATE VIEW IF NOT EXISTS answer_sheet_rows AS " ANSWER_SHEET_ROWS_SQL ";",
+        // Every answer regardless of storage mode; read queries go through this
+        "CREATE VIEW IF NOT EXISTS answer_rows AS " ANSWER_ROWS_SQL ";"
+    };
+    
+    int num_queries = sizeof(upgrade_queries) / sizeof(upgrade_queries[0]);
+    for (int i = 0; i < num_queries; i++) {
+        if (sqlite3_exec(db, upgrade_queries[i], NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error upgrading schema: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
+    // Case-insensitive name columns (see db_queries.c: name = ? COLLATE NOCASE)
+    if (!db_upgrade_name_collation("topics",
+            "CREATE TABLE topics_new ("
+            "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+            "  name TEXT NOT NULL UNIQUE COLLATE NOCASE,"
+            "  description TEXT,"
+            "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+            ");", "id, name, description, created_at") ||
+        !db_upgrade_name_collation("difficulties",
+            "CREATE TABLE difficulties_new ("
+            "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+            "  name TEXT NOT NULL UNIQUE COLLATE NOCASE,"
+            "  level INTEGER NOT NULL CHECK(level BETWEEN 1 AND 3),"
+            "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+            ");", "id, name, level, created_at")) {
+        return 0;
+    }
+    
+    db_create_search_index();
+    
+    // Bank version for the compiled question-bank image (bank_image.h): bumped
+    // by any change to what the image holds, so a stale image is detected with
+    // one row read. It starts at a random value, so two databases never share a
+    // version by accident (a backup shares it only while its bank is identical).
+    // Created after the collation upgrade, which rebuilds topics and
+    // difficulties (dropping their triggers).
+    const char *bank_queries[] = {
+        "CREATE TABLE IF NOT EXISTS bank_meta ("
+        "  id INTEGER PRIMARY KEY CHECK(id = 1),"
+        "  version INTEGER NOT NULL DEFAULT 0"
+        ");",
+        "INSERT OR IGNORE INTO bank_meta (id, version) VALUES (1, abs(random() % 1000000000000));",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_questions_insert AFTER INSERT ON questions BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        // Purging tombstones does not change the image
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_questions_update AFTER UPDATE OF "
+        "text, option_a, option_b, option_c, option_d, correct_option, topic_id, difficulty_id, is_deleted "
+        "ON questions BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_questions_delete AFTER DELETE ON questions "
+        "WHEN OLD.is_deleted = 0 BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_topics_insert AFTER INSERT ON topics BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_topics_update AFTER UPDATE OF name ON topics BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_topics_delete AFTER DELETE ON topics BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_difficulties_insert AFTER INSERT ON difficulties BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_difficulties_update AFTER UPDATE OF name, level "
+        "ON difficulties BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_bank_difficulties_delete AFTER DELETE ON difficulties BEGIN "
+        "  UPDATE bank_meta SET version = version + 1 WHERE id = 1; "
+        "END;"
+    };
+    
+    num_queries = sizeof(bank_queries) / sizeof(bank_queries[0]);
+    for (int i = 0; i < num_queries; i++) {
+        if (sqlite3_exec(db, bank_queries[i], NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error upgrading schema: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
+    if (backfill_user_stats) {
+        const char *backfill = 
+            "INSERT OR REPLACE INTO user_stats (user_id, results_count, score_sum, total_sum) "
+            "SELECT p.user_id, COUNT(*), SUM(r.score), SUM(r.total_questions) FROM results r "
+            "JOIN participants p ON r.participant_id = p.id GROUP BY p.user_id;";
+        if (sqlite3_exec(db, backfill, NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error backfilling user_stats: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
+    if (backfill_item_stats) {
+        // The final state of item_stats_on_answers() run over every stored
+        // submission: x is the item score, y the submission's rest score, and
+        // the Welford moments are sums of squares about the means
+        const char *backfill =
+            "WITH a AS (SELECT participant_id, submitted_at, question_id, "
+            "           upper(selected_option) AS choice, is_correct FROM answer_rows), "
+            "sub AS (SELECT participant_id, submitted_at, COUNT(*) AS n, SUM(is_correct) AS score "
+            "        FROM a GROUP BY participant_id, submitted_at), "
+            "xy AS (SELECT a.question_id, a.choice, a.is_correct * 1.0 AS x, "
+            "       CASE WHEN sub.n > 1 THEN (sub.score - a.is_correct) * 1.0 / (sub.n - 1) "
+            "       ELSE 0.0 END AS y "
+            "       FROM a JOIN sub USING (participant_id, submitted_at)) "
+            "INSERT OR REPLACE INTO item_stats (question_id, attempts, correct, choice_a, choice_b, "
+            "choice_c, choice_d, choice_blank, mean_item, mean_rest, m2_item, m2_rest, co_moment) "
+            "SELECT question_id, COUNT(*), SUM(x), SUM(choice = 'A'), SUM(choice = 'B'), "
+            "SUM(choice = 'C'), SUM(choice = 'D'), SUM(choice NOT IN ('A', 'B', 'C', 'D')), "
+            "AVG(x), AVG(y), MAX(SUM(x * x) - SUM(x) * AVG(x), 0), MAX(SUM(y * y) - SUM(y) * AVG(y), 0), "
+            "SUM(x * y) - SUM(x) * AVG(y) FROM xy GROUP BY question_id;";
+        if (sqlite3_exec(db, backfill, NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Error backfilling item_stats: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return 0;
+        }
+    }
+    
     return 1;
 }
 
@@ -16,6 +16,9 @@ void db_close(void);
 // Create database tables
 int db_create_tables(void);
 
+// Upgrade tables created by older builds (adds missing columns/indexes)
+int db_upgrade_schema(void);
+
 // Get database connection
 sqlite3* db_get_connection(void);
 
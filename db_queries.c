@@ -1,19 +1,27 @@
 #include "db_queries.h"
 #include "db_init.h"
+#include "catalog.h"
+#include "dedup.h"
+#include "item_stats.h"
+#include "answer_sheet.h"
+#include "archive.h"
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 // ==================== USER MANAGEMENT ====================
 
+#define SQL_GET_USER_ID "SELECT id FROM users WHERE username = ?"
+
 // 🔧 Get user ID by username from database
 int db_get_user_id(const char *username) {
     if (!username || !db) return -1;
     
     sqlite3_stmt *stmt;
-    const char *query = "SELECT id FROM users WHERE username = ?";
+    const char *query = SQL_GET_USER_ID;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
@@ -33,6 +41,41 @@ int db_get_user_id(const char *username) {
 
 // ==================== QUESTIONS ====================
 
+// Columns shared by every question SELECT (read back by db_read_question_row)
+#define QUESTION_COLUMNS \
+    "q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, " \
+    "q.correct_option, t.name, d.name "
+
+// Copy a text column into a fixed buffer, always NUL-terminated
+static void copy_column_text(sqlite3_stmt *stmt, int col, char *dst, size_t size) {
+    const char *src = (const char*)sqlite3_column_text(stmt, col);
+    snprintf(dst, size, "%s", src ? src : "");
+}
+
+static const char *column_text(sqlite3_stmt *stmt, int col) {
+    return (const char*)sqlite3_column_text(stmt, col);
+}
+
+// Build a Question from a row selected with QUESTION_COLUMNS, strings copied
+// once into arena at their full length. Returns 0 when out of memory.
+static int db_read_question_row(sqlite3_stmt *stmt, Question *q, Arena *arena) {
+    const char *correct = column_text(stmt, 6);
+    return question_build(q, arena, sqlite3_column_int(stmt, 0), column_text(stmt, 1),
+                          column_text(stmt, 2), column_text(stmt, 3), column_text(stmt, 4),
+                          column_text(stmt, 5), correct ? correct[0] : 'A',
+                          column_text(stmt, 7), column_text(stmt, 8));
+}
+
+// Topic and difficulty names are COLLATE NOCASE columns, so these lookups are
+// case-insensitive and still use the UNIQUE index (LOWER(name) could not)
+#define SQL_TOPIC_ID_BY_NAME "SELECT id FROM topics WHERE name = ? COLLATE NOCASE"
+#define SQL_INSERT_TOPIC "INSERT INTO topics (name) VALUES (?)"
+#define SQL_DIFFICULTY_ID_BY_NAME "SELECT id FROM difficulties WHERE name = ? COLLATE NOCASE"
+#define SQL_INSERT_QUESTION \
+    "INSERT INTO questions (text, option_a, option_b, option_c, option_d, " \
+    "correct_option, topic_id, difficulty_id, created_by) " \
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+
 // Add question to database
 int db_add_question(const char *text, const char *opt_a, const char *opt_b,
                    const char *opt_c, const char *opt_d, char correct,
@@ -41,8 +84,8 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
     
     // 🔧 Normalize topic and difficulty to lowercase
     char topic_lower[64], difficulty_lower[32];
-    strcpy(topic_lower, topic);
-    strcpy(difficulty_lower, difficulty);
+    snprintf(topic_lower, sizeof(topic_lower), "%s", topic);
+    snprintf(difficulty_lower, sizeof(difficulty_lower), "%s", difficulty);
     
     // Convert to lowercase
     for (int i = 0; topic_lower[i]; i++) {
@@ -54,7 +97,7 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
     
     // Get topic ID (case-insensitive lookup)
     int topic_id = 0;
-    const char *topic_query = "SELECT id FROM topics WHERE LOWER(name) = LOWER(?)";
+    const char *topic_query = SQL_TOPIC_ID_BY_NAME;
     if (sqlite3_prepare_v2(db, topic_query, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, topic_lower, -1, SQLITE_STATIC);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -65,11 +108,12 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
     
     // 🔧 Auto-create topic if not found
     if (topic_id == 0) {
-        const char *insert_topic_query = "INSERT INTO topics (name) VALUES (?)";
+        const char *insert_topic_query = SQL_INSERT_TOPIC;
         if (sqlite3_prepare_v2(db, insert_topic_query, -1, &stmt, NULL) == SQLITE_OK) {
             sqlite3_bind_text(stmt, 1, topic_lower, -1, SQLITE_STATIC);
             if (sqlite3_step(stmt) == SQLITE_DONE) {
                 topic_id = (int)sqlite3_last_insert_rowid(db);
+                catalog_on_topic_added(topic_id, topic_lower);
             }
             sqlite3_finalize(stmt);
         }
@@ -82,7 +126,7 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
     
     // Get difficulty ID (strict validation - no auto-creation)
     int difficulty_id = 0;
-    const char *diff_query = "SELECT id FROM difficulties WHERE LOWER(name) = LOWER(?)";
+    const char *diff_query = SQL_DIFFICULTY_ID_BY_NAME;
     if (sqlite3_prepare_v2(db, diff_query, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, difficulty_lower, -1, SQLITE_STATIC);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -97,10 +141,7 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
     }
     
     // Insert the question
-    const char *query = 
-        "INSERT INTO questions (text, option_a, option_b, option_c, option_d, "
-        "correct_option, topic_id, difficulty_id, created_by) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    const char *query = SQL_INSERT_QUESTION;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
@@ -131,9 +172,15 @@ int db_add_question(const char *text, const char *opt_a, const char *opt_b,
         return -1;
     }
     
-    return (int)sqlite3_last_insert_rowid(db);
+    int new_id = (int)sqlite3_last_insert_rowid(db);
+    catalog_on_question_added(new_id, text, opt_a, opt_b, opt_c, opt_d, correct,
+                              topic_id, difficulty_id);
+    dedup_on_question_added(new_id, text, opt_a, opt_b, opt_c, opt_d);
+    return new_id;
 }
 
+#define SQL_QUESTION_EXISTS "SELECT id FROM questions WHERE id = ?"
+
 // 🔧 Sync questions from text file to database
 int db_sync_questions_from_file(const char *filename) {
     if (!filename || !db) return 0;
@@ -163,7 +210,7 @@ int db_sync_questions_from_file(const char *filename) {
         
         // Check if question already exists in database
         sqlite3_stmt *stmt;
-        const char *check_query = "SELECT id FROM questions WHERE id = ?";
+        const char *check_query = SQL_QUESTION_EXISTS;
         int exists = 0;
         
         if (sqlite3_prepare_v2(db, check_query, -1, &stmt, NULL) == SQLITE_OK) {
@@ -190,16 +237,17 @@ int db_sync_questions_from_file(const char *filename) {
     return synced_count;
 }
 
+#define SQL_GET_QUESTION \
+    "SELECT " QUESTION_COLUMNS \
+    "FROM questions q " \
+    "JOIN topics t ON q.topic_id = t.id " \
+    "JOIN difficulties d ON q.difficulty_id = d.id " \
+    "WHERE q.id = ? AND q.is_deleted = 0"
+
 // Get question by ID
-int db_get_question(int id, DBQuestion *q) {
+int db_get_question(int id, Question *q, Arena *arena) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-        "FROM questions q "
-        "JOIN topics t ON q.topic_id = t.id "
-        "JOIN difficulties d ON q.difficulty_id = d.id "
-        "WHERE q.id = ?";
+    const char *query = SQL_GET_QUESTION;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -208,29 +256,23 @@ int db_get_question(int id, DBQuestion *q) {
     sqlite3_bind_int(stmt, 1, id);
     
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        q->id = sqlite3_column_int(stmt, 0);
-        strcpy(q->text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(q->option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(q->option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(q->option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(q->option_d, (const char*)sqlite3_column_text(stmt, 5));
-        q->correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        q->topic_id = sqlite3_column_int(stmt, 7);
-        q->difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(q->topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(q->topic)-1);
-        strncpy(q->difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(q->difficulty)-1);
+        int ok = db_read_question_row(stmt, q, arena);
         sqlite3_finalize(stmt);
-        return 1;
+        return ok;
     }
     
     sqlite3_finalize(stmt);
     return 0;
 }
 
+#define SQL_DELETE_QUESTION "UPDATE questions SET is_deleted = 1 WHERE id = ? AND is_deleted = 0"
+
 // Delete question by ID
+// Soft delete: the row is tombstoned so ids stay stable for rooms and answers;
+// db_compact_questions() purges unreferenced tombstones later, off the hot path.
 int db_delete_question(int id) {
     sqlite3_stmt *stmt;
-    const char *query = "DELETE FROM questions WHERE id = ?";
+    const char *query = SQL_DELETE_QUESTION;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -242,19 +284,25 @@ int db_delete_question(int id) {
     int changes = sqlite3_changes(db);
     sqlite3_finalize(stmt);
     
-    return (rc == SQLITE_DONE && changes > 0) ? 1 : 0;
+    if (rc == SQLITE_DONE && changes > 0) {
+        catalog_on_question_deleted(id);
+        dedup_on_question_deleted(id);
+        return 1;
+    }
+    return 0;
 }
 
+#define SQL_GET_ALL_QUESTIONS \
+    "SELECT " QUESTION_COLUMNS \
+    "FROM questions q " \
+    "JOIN topics t ON q.topic_id = t.id " \
+    "JOIN difficulties d ON q.difficulty_id = d.id " \
+    "WHERE q.is_deleted = 0 ORDER BY q.id LIMIT ?"
+
 // Get all questions (for admin)
-int db_get_all_questions(DBQuestion *questions, int max_count) {
+int db_get_all_questions(Question *questions, int max_count, Arena *arena) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-        "FROM questions q "
-        "JOIN topics t ON q.topic_id = t.id "
-        "JOIN difficulties d ON q.difficulty_id = d.id "
-        "ORDER BY q.id LIMIT ?";
+    const char *query = SQL_GET_ALL_QUESTIONS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -263,18 +311,8 @@ int db_get_all_questions(DBQuestion *questions, int max_count) {
     sqlite3_bind_int(stmt, 1, max_count);
     
     int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
-        questions[count].id = sqlite3_column_int(stmt, 0);
-        strcpy(questions[count].text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(questions[count].option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(questions[count].option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(questions[count].option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(questions[count].option_d, (const char*)sqlite3_column_text(stmt, 5));
-        questions[count].correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        questions[count].topic_id = sqlite3_column_int(stmt, 7);
-        questions[count].difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(questions[count].topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(questions[count].topic)-1);
-        strncpy(questions[count].difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(questions[count].difficulty)-1);
+    while (count < max_count && sqlite3_step(stmt) == SQLITE_ROW &&
+           db_read_question_row(stmt, &questions[count], arena)) {
         count++;
     }
     
@@ -282,85 +320,16 @@ int db_get_all_questions(DBQuestion *questions, int max_count) {
     return count;
 }
 
-// Get questions by topic
-int db_get_questions_by_topic(const char *topic, DBQuestion *questions, int max_count) {
-    sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-        "FROM questions q "
-        "JOIN topics t ON q.topic_id = t.id "
-        "JOIN difficulties d ON q.difficulty_id = d.id "
-        "WHERE LOWER(t.name) = LOWER(?) LIMIT ?";
-    
-    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
-        return 0;
-    }
-    
-    sqlite3_bind_text(stmt, 1, topic, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, max_count);
-    
-    int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
-        questions[count].id = sqlite3_column_int(stmt, 0);
-        strcpy(questions[count].text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(questions[count].option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(questions[count].option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(questions[count].option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(questions[count].option_d, (const char*)sqlite3_column_text(stmt, 5));
-        questions[count].correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        questions[count].topic_id = sqlite3_column_int(stmt, 7);
-        questions[count].difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(questions[count].topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(questions[count].topic)-1);
-        strncpy(questions[count].difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(questions[count].difficulty)-1);
-        count++;
-    }
-    
-    sqlite3_finalize(stmt);
-    return count;
-}
-
-// Get questions by difficulty
-int db_get_questions_by_difficulty(const char *difficulty, DBQuestion *questions, int max_count) {
-    sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-        "FROM questions q "
-        "JOIN topics t ON q.topic_id = t.id "
-        "JOIN difficulties d ON q.difficulty_id = d.id "
-        "WHERE LOWER(d.name) = LOWER(?) LIMIT ?";
-    
-    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
-        return 0;
-    }
-    
-    sqlite3_bind_text(stmt, 1, difficulty, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, max_count);
-    
-    int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
-        questions[count].id = sqlite3_column_int(stmt, 0);
-        strcpy(questions[count].text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(questions[count].option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(questions[count].option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(questions[count].option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(questions[count].option_d, (const char*)sqlite3_column_text(stmt, 5));
-        questions[count].correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        questions[count].topic_id = sqlite3_column_int(stmt, 7);
-        questions[count].difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(questions[count].topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(questions[count].topic)-1);
-        strncpy(questions[count].difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(questions[count].difficulty)-1);
-        count++;
-    }
-    
-    sqlite3_finalize(stmt);
-    return count;
-}
+// Prefix of the distribution query; filters and ORDER BY are appended at runtime
+#define SQL_DISTRIBUTION_BASE \
+    "SELECT " QUESTION_COLUMNS \
+    "FROM questions q " \
+    "JOIN topics t ON q.topic_id = t.id " \
+    "JOIN difficulties d ON q.difficulty_id = d.id WHERE q.is_deleted = 0"
 
 // Get questions by topic AND difficulty with distribution
 int db_get_questions_with_distribution(const char *topic_filter, const char *diff_filter,
-                                       DBQuestion *questions, int max_count) {
+                                       Question *questions, int max_count, Arena *arena) {
     // Parse topic_filter: "topic1:count1 topic2:count2 ..."
     // Parse diff_filter: "easy:count1 medium:count2 ..."
     
@@ -369,14 +338,10 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
     strcpy(diff_copy, diff_filter ? diff_filter : "");
     
     // Build dynamic query based on filters
-    char query[2048] = "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-                       "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-                       "FROM questions q "
-                       "JOIN topics t ON q.topic_id = t.id "
-                       "JOIN difficulties d ON q.difficulty_id = d.id WHERE 1=1";
+    char query[2048] = SQL_DISTRIBUTION_BASE;
     
     if (strlen(topic_copy) > 0) {
-        strcat(query, " AND LOWER(t.name) IN (");
+        strcat(query, " AND t.name COLLATE NOCASE IN (");
         char *topic_ptr = strtok(topic_copy, " ");
         int first = 1;
         while (topic_ptr) {
@@ -384,9 +349,9 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
             if (colon) *colon = '\0';
             
             if (!first) strcat(query, ", ");
-            strcat(query, "LOWER('");
+            strcat(query, "'");
             strcat(query, topic_ptr);
-            strcat(query, "')");
+            strcat(query, "'");
             first = 0;
             topic_ptr = strtok(NULL, " ");
         }
@@ -394,7 +359,7 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
     }
     
     if (strlen(diff_copy) > 0) {
-        strcat(query, " AND LOWER(d.name) IN (");
+        strcat(query, " AND d.name COLLATE NOCASE IN (");
         char *diff_ptr = strtok(diff_copy, " ");
         int first = 1;
         while (diff_ptr) {
@@ -402,9 +367,9 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
             if (colon) *colon = '\0';
             
             if (!first) strcat(query, ", ");
-            strcat(query, "LOWER('");
+            strcat(query, "'");
             strcat(query, diff_ptr);
-            strcat(query, "')");
+            strcat(query, "'");
             first = 0;
             diff_ptr = strtok(NULL, " ");
         }
@@ -421,18 +386,8 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
     sqlite3_bind_int(stmt, 1, max_count);
     
     int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
-        questions[count].id = sqlite3_column_int(stmt, 0);
-        strcpy(questions[count].text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(questions[count].option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(questions[count].option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(questions[count].option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(questions[count].option_d, (const char*)sqlite3_column_text(stmt, 5));
-        questions[count].correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        questions[count].topic_id = sqlite3_column_int(stmt, 7);
-        questions[count].difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(questions[count].topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(questions[count].topic)-1);
-        strncpy(questions[count].difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(questions[count].difficulty)-1);
+    while (count < max_count && sqlite3_step(stmt) == SQLITE_ROW &&
+           db_read_question_row(stmt, &questions[count], arena)) {
         count++;
     }
     
@@ -440,12 +395,16 @@ int db_get_questions_with_distribution(const char *topic_filter, const char *dif
     return count;
 }
 
+#define SQL_TOPIC_COUNTS \
+    "SELECT t.name, COUNT(q.id) FROM topics t " \
+    "LEFT JOIN questions q ON q.topic_id = t.id AND q.is_deleted = 0 " \
+    "GROUP BY t.id ORDER BY t.name"
+
 // Get all topics
 int db_get_all_topics(char *output) {
     sqlite3_stmt *stmt;
     // Use LEFT JOIN to include ALL topics, even those with 0 questions
-    const char *query = "SELECT t.name, COUNT(q.id) FROM topics t "
-                       "LEFT JOIN questions q ON q.topic_id = t.id GROUP BY t.id ORDER BY t.name";
+    const char *query = SQL_TOPIC_COUNTS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -467,12 +426,16 @@ int db_get_all_topics(char *output) {
     return count;
 }
 
+#define SQL_DIFFICULTY_COUNTS \
+    "SELECT d.name, COUNT(q.id) FROM difficulties d " \
+    "LEFT JOIN questions q ON q.difficulty_id = d.id AND q.is_deleted = 0 " \
+    "GROUP BY d.id ORDER BY d.level"
+
 // Get all difficulties
 int db_get_all_difficulties(char *output) {
     sqlite3_stmt *stmt;
     // Use LEFT JOIN to include ALL difficulties, even those with 0 questions
-    const char *query = "SELECT d.name, COUNT(q.id) FROM difficulties d "
-                       "LEFT JOIN questions q ON q.difficulty_id = d.id GROUP BY d.id ORDER BY d.level";
+    const char *query = SQL_DIFFICULTY_COUNTS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -494,12 +457,209 @@ int db_get_all_difficulties(char *output) {
     return count;
 }
 
+// Stream every live question to a callback (used to build the in-memory catalog)
+// Columns read back by db_step_question_views
+#define QUESTION_VIEW_COLUMNS \
+    "id, text, option_a, option_b, option_c, option_d, correct_option, topic_id, difficulty_id "
+
+// Step a prepared QUESTION_VIEW_COLUMNS query, handing each row to cb; finalizes stmt
+static int db_step_question_views(sqlite3_stmt *stmt, db_question_callback cb, void *ctx) {
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *correct = (const char*)sqlite3_column_text(stmt, 6);
+        DBQuestionView v = {
+            .id = sqlite3_column_int(stmt, 0),
+            .text = (const char*)sqlite3_column_text(stmt, 1),
+            .option_a = (const char*)sqlite3_column_text(stmt, 2),
+            .option_b = (const char*)sqlite3_column_text(stmt, 3),
+            .option_c = (const char*)sqlite3_column_text(stmt, 4),
+            .option_d = (const char*)sqlite3_column_text(stmt, 5),
+            .correct_option = correct ? correct[0] : 'A',
+            .topic_id = sqlite3_column_int(stmt, 7),
+            .difficulty_id = sqlite3_column_int(stmt, 8)
+        };
+        cb(&v, ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+#define SQL_FOR_EACH_QUESTION \
+    "SELECT " QUESTION_VIEW_COLUMNS "FROM questions WHERE is_deleted = 0 ORDER BY id"
+
+int db_for_each_question(db_question_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    sqlite3_stmt *stmt;
+    const char *query = SQL_FOR_EACH_QUESTION;
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    return db_step_question_views(stmt, cb, ctx);
+}
+
+// Keyset page: live questions with id > after_id in one topic/difficulty, ascending.
+// The name resolves to a single id first, so the scan is a straight range over
+// the (topic_id, id) / (difficulty_id, id) index - no OFFSET, no sort. The unary
+// + on is_deleted keeps the planner off idx_questions_deleted, which would scan
+// every live row.
+static int db_for_each_question_page(const char *query, const char *name, int after_id,
+                                     int limit, db_question_callback cb, void *ctx) {
+    if (!db || !cb || !name) return 0;
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, after_id);
+    sqlite3_bind_int(stmt, 3, limit);
+    return db_step_question_views(stmt, cb, ctx);
+}
+
+#define SQL_TOPIC_PAGE \
+    "SELECT " QUESTION_VIEW_COLUMNS "FROM questions " \
+    "WHERE topic_id = (SELECT id FROM topics WHERE name = ?1 COLLATE NOCASE) " \
+    "AND id > ?2 AND +is_deleted = 0 ORDER BY id LIMIT ?3"
+
+int db_for_each_question_in_topic(const char *topic, int after_id, int limit,
+                                  db_question_callback cb, void *ctx) {
+    const char *query = SQL_TOPIC_PAGE;
+    return db_for_each_question_page(query, topic, after_id, limit, cb, ctx);
+}
+
+#define SQL_DIFFICULTY_PAGE \
+    "SELECT " QUESTION_VIEW_COLUMNS "FROM questions " \
+    "WHERE difficulty_id = (SELECT id FROM difficulties WHERE name = ?1 COLLATE NOCASE) " \
+    "AND id > ?2 AND +is_deleted = 0 ORDER BY id LIMIT ?3"
+
+int db_for_each_question_in_difficulty(const char *difficulty, int after_id, int limit,
+                                       db_question_callback cb, void *ctx) {
+    const char *query = SQL_DIFFICULTY_PAGE;
+    return db_for_each_question_page(query, difficulty, after_id, limit, cb, ctx);
+}
+
+// Run a "SELECT id, name, level" style query and hand each row to a callback
+static int db_for_each_name(const char *query, db_name_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        cb(sqlite3_column_int(stmt, 0), (const char*)sqlite3_column_text(stmt, 1),
+           sqlite3_column_int(stmt, 2), ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+#define SQL_FOR_EACH_TOPIC "SELECT id, name, 0 FROM topics"
+#define SQL_FOR_EACH_DIFFICULTY "SELECT id, name, level FROM difficulties"
+
+int db_for_each_topic(db_name_callback cb, void *ctx) {
+    return db_for_each_name(SQL_FOR_EACH_TOPIC, cb, ctx);
+}
+
+int db_for_each_difficulty(db_name_callback cb, void *ctx) {
+    return db_for_each_name(SQL_FOR_EACH_DIFFICULTY, cb, ctx);
+}
+
+#define SQL_SEARCH_TEXT \
+    "SELECT q.id, q.text FROM (" \
+    "  SELECT rowid, rank FROM questions_fts " \
+    "  WHERE questions_fts MATCH ? ORDER BY rank LIMIT ?) f " \
+    "JOIN questions q ON q.id = f.rowid ORDER BY f.rank"
+
+// Full-text search over question text and options (FTS5, ranked by bm25).
+// Each whitespace/punctuation-separated term is quoted, so user input can't
+// inject FTS query syntax; terms are ANDed and "term*" asks for a prefix match.
+// Writes "id|text\n" lines to output. Returns matches written, -1 if no index.
+int db_search_questions_text(const char *terms, char *output, int max_size, int limit) {
+    if (!db || !terms || !output || max_size <= 0) return -1;
+    output[0] = '\0';
+    
+    char match[512] = "";
+    int mlen = 0, term_count = 0;
+    const char *p = terms;
+    while (*p) {
+        while (*p && !isalnum((unsigned char)*p) && (unsigned char)*p < 0x80) p++;
+        if (!*p) break;
+        
+        const char *start = p;
+        while (*p && (isalnum((unsigned char)*p) || (unsigned char)*p >= 0x80)) p++;
+        int n = snprintf(match + mlen, sizeof(match) - mlen, "%s\"%.*s\"%s",
+                         term_count ? " " : "", (int)(p - start), start, *p == '*' ? "*" : "");
+        if (n < 0 || n >= (int)sizeof(match) - mlen - 1) break;
+        mlen += n;
+        term_count++;
+    }
+    if (term_count == 0) return 0;
+    
+    // FTS5 scores every match by bm25 (its default rank) and keeps only the best
+    // `limit` while it sorts, so common terms cost O(matches log limit) and are
+    // still ranked over all matches. Text is fetched just for the winners;
+    // tombstones are never in the index.
+    sqlite3_stmt *stmt;
+    const char *query = SQL_SEARCH_TEXT;
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, limit);
+    
+    int count = 0, len = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int n = snprintf(output + len, max_size - len, "%d|%s\n",
+                         sqlite3_column_int(stmt, 0), (const char*)sqlite3_column_text(stmt, 1));
+        if (n < 0 || n >= max_size - len) {
+            output[len] = '\0';
+            break;
+        }
+        len += n;
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+#define SQL_BANK_VERSION "SELECT version FROM bank_meta WHERE id = 1"
+
+// Current bank version, compared against the compiled bank image's
+long db_get_bank_version(void) {
+    sqlite3_stmt *stmt;
+    if (!db || sqlite3_prepare_v2(db, SQL_BANK_VERSION, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    long version = (sqlite3_step(stmt) == SQLITE_ROW) ? (long)sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return version;
+}
+
 // ==================== USERS ====================
 
+#define SQL_ADD_USER "INSERT INTO users (username, password, role) VALUES (?, ?, ?)"
+
 // Add user
 int db_add_user(const char *username, const char *password, const char *role) {
     sqlite3_stmt *stmt;
-    const char *query = "INSERT INTO users (username, password, role) VALUES (?, ?, ?)";
+    const char *query = SQL_ADD_USER;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return -1;
@@ -515,52 +675,61 @@ int db_add_user(const char *username, const char *password, const char *role) {
     return (rc == SQLITE_DONE) ? (int)sqlite3_last_insert_rowid(db) : -1;
 }
 
-// Validate user
-int db_validate_user(const char *username, const char *password) {
+#define SQL_GET_USER_AUTH "SELECT id, role, password FROM users WHERE username = ?"
+
+// Everything a login needs in one query: id, role and the stored password
+// record (see password.h). Returns 1 if found, 0 if not, -1 on error.
+int db_get_user_auth(const char *username, int *user_id, char *role, size_t role_size,
+                     char *record, size_t record_size) {
+    if (!db || !username) return -1;
+    
     sqlite3_stmt *stmt;
-    const char *query = "SELECT id FROM users WHERE username = ? AND password = ?";
+    const char *query = SQL_GET_USER_AUTH;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
         return -1;
     }
     
     sqlite3_bind_text(stmt, 1, username, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, password, -1, SQLITE_STATIC);
     
-    int user_id = -1;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        user_id = sqlite3_column_int(stmt, 0);
+    int rc = sqlite3_step(stmt);
+    int found = (rc == SQLITE_ROW) ? 1 : (rc == SQLITE_DONE) ? 0 : -1;
+    if (found == 1) {
+        if (user_id) *user_id = sqlite3_column_int(stmt, 0);
+        if (role) copy_column_text(stmt, 1, role, role_size);
+        if (record) copy_column_text(stmt, 2, record, record_size);
     }
     
     sqlite3_finalize(stmt);
-    return user_id;
+    return found;
 }
 
-// Get user role
-int db_get_user_role(const char *username, char *role) {
+#define SQL_SET_USER_PASSWORD "UPDATE users SET password = ? WHERE id = ?"
+
+// Replace a user's stored password record (e.g. a plaintext one with a hash)
+int db_set_user_password(int user_id, const char *record) {
     sqlite3_stmt *stmt;
-    const char *query = "SELECT role FROM users WHERE username = ?";
+    const char *query = SQL_SET_USER_PASSWORD;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
     }
     
-    sqlite3_bind_text(stmt, 1, username, -1, SQLITE_STATIC);
-    
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        strcpy(role, (const char*)sqlite3_column_text(stmt, 0));
-        sqlite3_finalize(stmt);
-        return 1;
-    }
+    sqlite3_bind_text(stmt, 1, record, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, user_id);
     
+    int rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
-    return 0;
+    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0) ? 1 : 0;
 }
 
+#define SQL_USERNAME_EXISTS "SELECT 1 FROM users WHERE username = ?"
+
 // Check if username exists
 int db_username_exists(const char *username) {
     sqlite3_stmt *stmt;
-    const char *query = "SELECT 1 FROM users WHERE username = ?";
+    const char *query = SQL_USERNAME_EXISTS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -575,10 +744,13 @@ int db_username_exists(const char *username) {
 
 // ==================== ROOMS ====================
 
+#define SQL_CREATE_ROOM \
+    "INSERT INTO rooms (name, owner_id, duration_minutes) VALUES (?, ?, ?)"
+
 // Create room
 int db_create_room(const char *name, int owner_id, int duration_minutes) {
     sqlite3_stmt *stmt;
-    const char *query = "INSERT INTO rooms (name, owner_id, duration_minutes) VALUES (?, ?, ?)";
+    const char *query = SQL_CREATE_ROOM;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return -1;
@@ -594,36 +766,50 @@ int db_create_room(const char *name, int owner_id, int duration_minutes) {
     return (rc == SQLITE_DONE) ? (int)sqlite3_last_insert_rowid(db) : -1;
 }
 
-// Add question to room
-int db_add_question_to_room(int room_id, int question_id, int order_num) {
-    sqlite3_stmt *stmt;
-    const char *query = "INSERT INTO room_questions (room_id, question_id, order_num) VALUES (?, ?, ?)";
+#define SQL_ADD_ROOM_QUESTION \
+    "INSERT INTO room_questions (room_id, question_id, order_num) VALUES (?, ?, ?)"
+
+// Add a room's questions in exam order: one statement, one transaction
+int db_add_questions_to_room(int room_id, int count, const int *question_ids) {
+    if (count <= 0) return 1;
     
-    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_ADD_ROOM_QUESTION, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing room questions: %s\n", sqlite3_errmsg(db));
         return 0;
     }
     
-    sqlite3_bind_int(stmt, 1, room_id);
-    sqlite3_bind_int(stmt, 2, question_id);
-    sqlite3_bind_int(stmt, 3, order_num);
-    
-    int rc = sqlite3_step(stmt);
+    int own_txn = sqlite3_get_autocommit(db) && db_begin_transaction();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        sqlite3_bind_int(stmt, 1, room_id);
+        sqlite3_bind_int(stmt, 2, question_ids[i]);
+        sqlite3_bind_int(stmt, 3, i);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        if (!ok) fprintf(stderr, "Error adding room question: %s\n", sqlite3_errmsg(db));
+        sqlite3_reset(stmt);
+    }
     sqlite3_finalize(stmt);
     
-    return (rc == SQLITE_DONE) ? 1 : 0;
+    if (own_txn) {
+        if (ok) ok = db_commit_transaction();
+        else db_rollback_transaction();
+    }
+    return ok;
 }
 
+#define SQL_GET_ROOM_QUESTIONS \
+    "SELECT " QUESTION_COLUMNS \
+    "FROM questions q " \
+    "JOIN room_questions rq ON q.id = rq.question_id " \
+    "JOIN topics t ON q.topic_id = t.id " \
+    "JOIN difficulties d ON q.difficulty_id = d.id " \
+    "WHERE rq.room_id = ? ORDER BY rq.order_num LIMIT ?"
+
 // Get questions in room
-int db_get_room_questions(int room_id, DBQuestion *questions, int max_count) {
+int db_get_room_questions(int room_id, Question *questions, int max_count, Arena *arena) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, t.name, d.name "
-        "FROM questions q "
-        "JOIN room_questions rq ON q.id = rq.question_id "
-        "JOIN topics t ON q.topic_id = t.id "
-        "JOIN difficulties d ON q.difficulty_id = d.id "
-        "WHERE rq.room_id = ? ORDER BY rq.order_num LIMIT ?";
+    const char *query = SQL_GET_ROOM_QUESTIONS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -633,18 +819,8 @@ int db_get_room_questions(int room_id, DBQuestion *questions, int max_count) {
     sqlite3_bind_int(stmt, 2, max_count);
     
     int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
-        questions[count].id = sqlite3_column_int(stmt, 0);
-        strcpy(questions[count].text, (const char*)sqlite3_column_text(stmt, 1));
-        strcpy(questions[count].option_a, (const char*)sqlite3_column_text(stmt, 2));
-        strcpy(questions[count].option_b, (const char*)sqlite3_column_text(stmt, 3));
-        strcpy(questions[count].option_c, (const char*)sqlite3_column_text(stmt, 4));
-        strcpy(questions[count].option_d, (const char*)sqlite3_column_text(stmt, 5));
-        questions[count].correct_option = *((char*)sqlite3_column_text(stmt, 6));
-        questions[count].topic_id = sqlite3_column_int(stmt, 7);
-        questions[count].difficulty_id = sqlite3_column_int(stmt, 8);
-        strncpy(questions[count].topic, (const char*)sqlite3_column_text(stmt, 9), sizeof(questions[count].topic)-1);
-        strncpy(questions[count].difficulty, (const char*)sqlite3_column_text(stmt, 10), sizeof(questions[count].difficulty)-1);
+    while (count < max_count && sqlite3_step(stmt) == SQLITE_ROW &&
+           db_read_question_row(stmt, &questions[count], arena)) {
         count++;
     }
     
@@ -652,11 +828,13 @@ int db_get_room_questions(int room_id, DBQuestion *questions, int max_count) {
     return count;
 }
 
+#define SQL_GET_ROOM \
+    "SELECT id, name, owner_id, duration_minutes, is_started, is_finished FROM rooms WHERE id = ?"
+
 // Get room by ID
 int db_get_room(int room_id, DBRoom *room) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT id, name, owner_id, duration_minutes, is_started, is_finished FROM rooms WHERE id = ?";
+    const char *query = SQL_GET_ROOM;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -681,10 +859,12 @@ int db_get_room(int room_id, DBRoom *room) {
 
 // ==================== PARTICIPANTS & ANSWERS ====================
 
+#define SQL_ADD_PARTICIPANT "INSERT INTO participants (room_id, user_id) VALUES (?, ?)"
+
 // Add participant to room
 int db_add_participant(int room_id, int user_id) {
     sqlite3_stmt *stmt;
-    const char *query = "INSERT INTO participants (room_id, user_id) VALUES (?, ?)";
+    const char *query = SQL_ADD_PARTICIPANT;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return -1;
@@ -699,12 +879,14 @@ int db_add_participant(int room_id, int user_id) {
     return (rc == SQLITE_DONE) ? (int)sqlite3_last_insert_rowid(db) : -1;
 }
 
+#define SQL_RECORD_ANSWER \
+    "INSERT OR REPLACE INTO answers (participant_id, question_id, selected_option, is_correct) " \
+    "VALUES (?, ?, ?, ?)"
+
 // Record answer
 int db_record_answer(int participant_id, int question_id, char selected_option, int is_correct) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "INSERT OR REPLACE INTO answers (participant_id, question_id, selected_option, is_correct) "
-        "VALUES (?, ?, ?, ?)";
+    const char *query = SQL_RECORD_ANSWER;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -721,14 +903,138 @@ int db_record_answer(int participant_id, int question_id, char selected_option,
     return (rc == SQLITE_DONE) ? 1 : 0;
 }
 
+static int answer_storage = ANSWER_STORAGE_ROWS;
+
+void db_set_answer_storage(int mode) {
+    answer_storage = (mode == ANSWER_STORAGE_PACKED) ? ANSWER_STORAGE_PACKED : ANSWER_STORAGE_ROWS;
+}
+
+int db_get_answer_storage(void) {
+    return answer_storage;
+}
+
+#define SQL_RECORD_ANSWER_SHEET \
+    "INSERT OR REPLACE INTO answer_sheets (participant_id, question_count, question_ids, marks) " \
+    "VALUES (?, ?, ?, ?)"
+
+// Store one packed sheet (replaces any earlier sheet of the participant)
+static int db_record_answer_sheet(int participant_id, int count, const int *question_ids,
+                                  const char *selected, const int *is_correct) {
+    unsigned char ids[ANSWER_SHEET_IDS_SIZE(ANSWER_SHEET_MAX)];
+    unsigned char marks[ANSWER_SHEET_MARKS_SIZE(ANSWER_SHEET_MAX)];
+    answer_sheet_pack(count, question_ids, selected, is_correct, ids, marks);
+    
+    sqlite3_stmt *stmt;
+    const char *query = SQL_RECORD_ANSWER_SHEET;
+    
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing answer sheet: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    sqlite3_bind_int(stmt, 1, participant_id);
+    sqlite3_bind_int(stmt, 2, count);
+    sqlite3_bind_blob(stmt, 3, ids, ANSWER_SHEET_IDS_SIZE(count), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 4, marks, ANSWER_SHEET_MARKS_SIZE(count), SQLITE_STATIC);
+    
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    return (rc == SQLITE_DONE) ? 1 : 0;
+}
+
+// Record a whole submission in the current storage mode. Row mode writes all
+// answers inside one transaction so a submission costs a single commit.
+int db_record_answers(int participant_id, int count, const int *question_ids,
+                      const char *selected, const int *is_correct) {
+    if (count <= 0) return 1;
+    if (answer_storage == ANSWER_STORAGE_PACKED && count <= ANSWER_SHEET_MAX) {
+        int ok = db_record_answer_sheet(participant_id, count, question_ids, selected, is_correct);
+        if (ok) item_stats_on_answers(count, question_ids, selected, is_correct);
+        return ok;
+    }
+    
+    int own_txn = sqlite3_get_autocommit(db) && db_begin_transaction();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        ok = db_record_answer(participant_id, question_ids[i], selected[i], is_correct[i]);
+    }
+    if (own_txn) {
+        if (ok) ok = db_commit_transaction();
+        else db_rollback_transaction();
+    }
+    if (ok) item_stats_on_answers(count, question_ids, selected, is_correct);
+    return ok;
+}
+
+#define SQL_GET_ANSWER_SHEET \
+    "SELECT question_count, question_ids, marks FROM answer_sheets WHERE participant_id = ?"
+#define SQL_GET_ANSWER_ROWS \
+    "SELECT question_id, selected_option, is_correct FROM answers " \
+    "WHERE participant_id = ? ORDER BY id LIMIT ?"
+
+// Read a participant's answers back from either storage, in exam order.
+// Returns the number of answers (at most max_count), -1 on error.
+int db_get_answers(int participant_id, int *question_ids, char *selected, int *is_correct,
+                   int max_count) {
+    sqlite3_stmt *stmt;
+    const char *sheet_query = SQL_GET_ANSWER_SHEET;
+    
+    if (sqlite3_prepare_v2(db, sheet_query, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, participant_id);
+    
+    int count = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+        const unsigned char *ids = sqlite3_column_blob(stmt, 1);
+        int ids_len = sqlite3_column_bytes(stmt, 1);
+        const unsigned char *marks = sqlite3_column_blob(stmt, 2);
+        int marks_len = sqlite3_column_bytes(stmt, 2);
+        if (count < 0 || ids_len < ANSWER_SHEET_IDS_SIZE(count) ||
+            marks_len < ANSWER_SHEET_MARKS_SIZE(count)) {
+            fprintf(stderr, "Corrupt answer sheet for participant %d\n", participant_id);
+            count = -2;
+        } else {
+            if (count > max_count) count = max_count;
+            answer_sheet_unpack(count, ids, marks, question_ids, selected, is_correct);
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (count == -2) return -1;
+    if (count >= 0) return count;
+    
+    const char *row_query = SQL_GET_ANSWER_ROWS;
+    
+    if (sqlite3_prepare_v2(db, row_query, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, participant_id);
+    sqlite3_bind_int(stmt, 2, max_count);
+    
+    count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *opt = (const char*)sqlite3_column_text(stmt, 1);
+        if (question_ids) question_ids[count] = sqlite3_column_int(stmt, 0);
+        if (selected) selected[count] = (opt && opt[0]) ? opt[0] : '.';
+        if (is_correct) is_correct[count] = sqlite3_column_int(stmt, 2);
+        count++;
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
 // ==================== RESULTS ====================
 
+#define SQL_ADD_RESULT \
+    "INSERT INTO results (participant_id, room_id, score, total_questions, correct_answers) " \
+    "VALUES (?, ?, ?, ?, ?)"
+
 // Add result
 int db_add_result(int participant_id, int room_id, int score, int total, int correct) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "INSERT INTO results (participant_id, room_id, score, total_questions, correct_answers) "
-        "VALUES (?, ?, ?, ?, ?)";
+    const char *query = SQL_ADD_RESULT;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return -1;
@@ -746,14 +1052,16 @@ int db_add_result(int participant_id, int room_id, int score, int total, int cor
     return (rc == SQLITE_DONE) ? (int)sqlite3_last_insert_rowid(db) : -1;
 }
 
+#define SQL_LEADERBOARD \
+    "SELECT u.username, r.score, r.total_questions FROM results r " \
+    "JOIN participants p ON r.participant_id = p.id " \
+    "JOIN users u ON p.user_id = u.id " \
+    "WHERE r.room_id = ? ORDER BY r.score DESC LIMIT 100"
+
 // Get leaderboard for room
 int db_get_leaderboard(int room_id, char *output, int max_size) {
     sqlite3_stmt *stmt;
-    const char *query = 
-        "SELECT u.username, r.score, r.total_questions FROM results r "
-        "JOIN participants p ON r.participant_id = p.id "
-        "JOIN users u ON p.user_id = u.id "
-        "WHERE r.room_id = ? ORDER BY r.score DESC LIMIT 100";
+    const char *query = SQL_LEADERBOARD;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         return 0;
@@ -761,57 +1069,507 @@ int db_get_leaderboard(int room_id, char *output, int max_size) {
     
     sqlite3_bind_int(stmt, 1, room_id);
     
-    strcpy(output, "");
-    int count = 0;
+    output[0] = '\0';
+    int count = 0, len = 0;
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         const char *username = (const char*)sqlite3_column_text(stmt, 0);
         int score = sqlite3_column_int(stmt, 1);
         int total = sqlite3_column_int(stmt, 2);
         
-        char line[256];
-        sprintf(line, "%d. %s - %d/%d\n", count + 1, username, score, total);
-        
-        if (strlen(output) + strlen(line) < max_size) {
-            strcat(output, line);
-            count++;
-        } else {
+        int n = snprintf(output + len, max_size - len, "%d. %s - %d/%d\n",
+                         count + 1, username, score, total);
+        if (n < 0 || n >= max_size - len) {
+            output[len] = '\0';
             break;
         }
+        len += n;
+        count++;
     }
     
     sqlite3_finalize(stmt);
     return count;
 }
 
-// ==================== LOGS ====================
+// Stream every stored result (oldest first) to a callback; used to rebuild
+// in-memory rankings at startup. Returns the number of rows visited.
+typedef struct {
+    db_result_callback cb;
+    void *ctx;
+    int count;
+} ResultScan;
 
-// Add log entry
-int db_add_log(int user_id, const char *event_type, const char *description) {
+// %s is the schema the results come from
+#define SQL_SCAN_RESULTS \
+    "SELECT r.room_id, rm.name, u.username, r.score, r.total_questions FROM %s.results r " \
+    "JOIN main.participants p ON r.participant_id = p.id " \
+    "JOIN main.users u ON p.user_id = u.id " \
+    "JOIN main.rooms rm ON r.room_id = rm.id " \
+    "ORDER BY r.id"
+
+// Results of one schema (main or an attached archive month), in id order
+static int db_scan_results(sqlite3 *conn, const char *schema, void *arg) {
+    ResultScan *scan = arg;
+    char query[512];
+    snprintf(query, sizeof(query), SQL_SCAN_RESULTS, schema);
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(conn));
+        return 0;
+    }
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        scan->cb(sqlite3_column_int(stmt, 0),
+                 (const char*)sqlite3_column_text(stmt, 1),
+                 (const char*)sqlite3_column_text(stmt, 2),
+                 sqlite3_column_int(stmt, 3),
+                 sqlite3_column_int(stmt, 4),
+                 scan->ctx);
+        scan->count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return 1;
+}
+
+// Every result ever stored: archived months oldest first, then the hot table
+int db_for_each_result(db_result_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    ResultScan scan = { cb, ctx, 0 };
+    archive_for_each_month(db, NULL, NULL, db_scan_results, &scan);
+    db_scan_results(db, "main", &scan);
+    return scan.count;
+}
+
+#define SQL_USER_STATS \
+    "SELECT u.username, s.results_count, s.score_sum, s.total_sum FROM user_stats s " \
+    "JOIN users u ON s.user_id = u.id WHERE s.results_count > 0"
+
+// Stream every user's running result sums (from user_stats) to a callback
+int db_for_each_user_stat(db_user_stat_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
     sqlite3_stmt *stmt;
-    const char *query = 
-        "INSERT INTO logs (user_id, event_type, description) VALUES (?, ?, ?)";
+    const char *query = SQL_USER_STATS;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        cb((const char*)sqlite3_column_text(stmt, 0),
+           sqlite3_column_int(stmt, 1),
+           (long)sqlite3_column_int64(stmt, 2),
+           (long)sqlite3_column_int64(stmt, 3),
+           ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+// %s is the schema the results come from
+#define SQL_ROOM_USER_STATS \
+    "SELECT u.username, COUNT(*), SUM(r.score), SUM(r.total_questions) FROM %s.results r " \
+    "JOIN main.participants p ON r.participant_id = p.id " \
+    "JOIN main.users u ON p.user_id = u.id " \
+    "WHERE r.room_id = ? GROUP BY p.user_id"
+
+typedef struct {
+    int room_id;
+    db_user_stat_callback cb;
+    void *ctx;
+    int count;
+} RoomStatScan;
+
+static int db_scan_room_user_stats(sqlite3 *conn, const char *schema, void *arg) {
+    RoomStatScan *scan = arg;
+    char query[512];
+    snprintf(query, sizeof(query), SQL_ROOM_USER_STATS, schema);
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(conn));
+        return 0;
+    }
+    
+    sqlite3_bind_int(stmt, 1, scan->room_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        scan->cb((const char*)sqlite3_column_text(stmt, 0),
+                 sqlite3_column_int(stmt, 1),
+                 (long)sqlite3_column_int64(stmt, 2),
+                 (long)sqlite3_column_int64(stmt, 3),
+                 scan->ctx);
+        scan->count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return 1;
+}
+
+int db_for_each_room_user_stat(int room_id, db_user_stat_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    RoomStatScan scan = { room_id, cb, ctx, 0 };
+    db_scan_room_user_stats(db, "main", &scan);
+    // Archived results count toward user_stats as well
+    archive_for_each_month(db, NULL, NULL, db_scan_room_user_stats, &scan);
+    return scan.count;
+}
+
+// ==================== PRACTICE ====================
+
+#define SQL_SAVE_PRACTICE_CARD \
+    "INSERT OR REPLACE INTO practice_cards (user_id, question_id, box, due_at) VALUES (?, ?, ?, ?)"
+#define SQL_DELETE_PRACTICE_CARD \
+    "DELETE FROM practice_cards WHERE user_id = ? AND question_id = ?"
+#define SQL_FOR_EACH_PRACTICE_CARD \
+    "SELECT user_id, question_id, box, due_at FROM practice_cards"
+
+int db_save_practice_cards(int count, const DBPracticeCard *cards) {
+    if (count <= 0) return 1;
+    
+    sqlite3_stmt *save, *del;
+    if (sqlite3_prepare_v2(db, SQL_SAVE_PRACTICE_CARD, -1, &save, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing practice save: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    if (sqlite3_prepare_v2(db, SQL_DELETE_PRACTICE_CARD, -1, &del, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing practice delete: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(save);
+        return 0;
+    }
+    
+    int own_txn = sqlite3_get_autocommit(db) && db_begin_transaction();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        sqlite3_stmt *stmt = cards[i].box < 0 ? del : save;
+        sqlite3_bind_int(stmt, 1, cards[i].user_id);
+        sqlite3_bind_int(stmt, 2, cards[i].question_id);
+        if (cards[i].box >= 0) {
+            sqlite3_bind_int(stmt, 3, cards[i].box);
+            sqlite3_bind_int64(stmt, 4, cards[i].due_at);
+        }
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        if (!ok) fprintf(stderr, "Error saving practice card: %s\n", sqlite3_errmsg(db));
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(save);
+    sqlite3_finalize(del);
+    
+    if (own_txn) {
+        if (ok) ok = db_commit_transaction();
+        else db_rollback_transaction();
+    }
+    return ok;
+}
+
+int db_for_each_practice_card(db_practice_card_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_FOR_EACH_PRACTICE_CARD, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        DBPracticeCard card;
+        card.user_id = sqlite3_column_int(stmt, 0);
+        card.question_id = sqlite3_column_int(stmt, 1);
+        card.box = sqlite3_column_int(stmt, 2);
+        card.due_at = (long)sqlite3_column_int64(stmt, 3);
+        cb(&card, ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+// ==================== ITEM STATISTICS ====================
+
+#define SQL_SAVE_ITEM_STATS \
+    "INSERT OR REPLACE INTO item_stats (question_id, attempts, correct, choice_a, choice_b, " \
+    "choice_c, choice_d, choice_blank, mean_item, mean_rest, m2_item, m2_rest, co_moment) " \
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+#define SQL_FOR_EACH_ITEM_STATS \
+    "SELECT question_id, attempts, correct, choice_a, choice_b, choice_c, choice_d, choice_blank, " \
+    "mean_item, mean_rest, m2_item, m2_rest, co_moment FROM item_stats"
+
+int db_save_item_stats(int count, const DBItemStats *items) {
+    if (count <= 0) return 1;
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_SAVE_ITEM_STATS, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing item stats save: %s\n", sqlite3_errmsg(db));
         return 0;
     }
     
-    sqlite3_bind_int(stmt, 1, user_id);
-    sqlite3_bind_text(stmt, 2, event_type, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, description, -1, SQLITE_STATIC);
+    int own_txn = sqlite3_get_autocommit(db) && db_begin_transaction();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        const DBItemStats *it = &items[i];
+        sqlite3_bind_int(stmt, 1, it->question_id);
+        sqlite3_bind_int(stmt, 2, it->attempts);
+        sqlite3_bind_int(stmt, 3, it->correct);
+        for (int c = 0; c < 5; c++) sqlite3_bind_int(stmt, 4 + c, it->choices[c]);
+        sqlite3_bind_double(stmt, 9, it->mean_item);
+        sqlite3_bind_double(stmt, 10, it->mean_rest);
+        sqlite3_bind_double(stmt, 11, it->m2_item);
+        sqlite3_bind_double(stmt, 12, it->m2_rest);
+        sqlite3_bind_double(stmt, 13, it->co_moment);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        if (!ok) fprintf(stderr, "Error saving item stats: %s\n", sqlite3_errmsg(db));
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
     
+    if (own_txn) {
+        if (ok) ok = db_commit_transaction();
+        else db_rollback_transaction();
+    }
+    return ok;
+}
+
+int db_for_each_item_stats(db_item_stats_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_FOR_EACH_ITEM_STATS, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        DBItemStats it;
+        it.question_id = sqlite3_column_int(stmt, 0);
+        it.attempts = sqlite3_column_int(stmt, 1);
+        it.correct = sqlite3_column_int(stmt, 2);
+        for (int c = 0; c < 5; c++) it.choices[c] = sqlite3_column_int(stmt, 3 + c);
+        it.mean_item = sqlite3_column_double(stmt, 8);
+        it.mean_rest = sqlite3_column_double(stmt, 9);
+        it.m2_item = sqlite3_column_double(stmt, 10);
+        it.m2_rest = sqlite3_column_double(stmt, 11);
+        it.co_moment = sqlite3_column_double(stmt, 12);
+        cb(&it, ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+// ==================== EXAM TEMPLATES ====================
+
+#define SQL_SAVE_EXAM_TEMPLATE \
+    "INSERT OR REPLACE INTO exam_templates (name, num_questions, pool_size, topic_filter, " \
+    "diff_filter, created_by) VALUES (?, ?, ?, ?, ?, ?)"
+#define SQL_DELETE_EXAM_TEMPLATE \
+    "DELETE FROM exam_templates WHERE name = ?"
+#define SQL_FOR_EACH_EXAM_TEMPLATE \
+    "SELECT name, num_questions, pool_size, topic_filter, diff_filter FROM exam_templates"
+
+int db_save_exam_template(const DBExamTemplate *t, int created_by) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_SAVE_EXAM_TEMPLATE, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing template save: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, t->name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, t->num_questions);
+    sqlite3_bind_int(stmt, 3, t->pool_size);
+    sqlite3_bind_text(stmt, 4, t->topic_filter, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, t->diff_filter, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 6, created_by);
+    
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) fprintf(stderr, "Error saving template: %s\n", sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+int db_delete_exam_template(const char *name) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_DELETE_EXAM_TEMPLATE, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
     int rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+int db_for_each_exam_template(db_exam_template_callback cb, void *ctx) {
+    if (!db || !cb) return 0;
     
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, SQL_FOR_EACH_EXAM_TEMPLATE, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing query: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        DBExamTemplate t;
+        const char *name = (const char*)sqlite3_column_text(stmt, 0);
+        const char *topics = (const char*)sqlite3_column_text(stmt, 3);
+        const char *diffs = (const char*)sqlite3_column_text(stmt, 4);
+        snprintf(t.name, sizeof(t.name), "%s", name ? name : "");
+        t.num_questions = sqlite3_column_int(stmt, 1);
+        t.pool_size = sqlite3_column_int(stmt, 2);
+        snprintf(t.topic_filter, sizeof(t.topic_filter), "%s", topics ? topics : "");
+        snprintf(t.diff_filter, sizeof(t.diff_filter), "%s", diffs ? diffs : "");
+        cb(&t, ctx);
+        count++;
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+// ==================== LOGS ====================
+
+// Audit events are queued in memory and written by db_flush_logs() as multi-row
+// INSERTs in one transaction: when LOG_BATCH_MAX events are pending, or on the
+// caller's timer (server log_flush_thread). Queued events carry their own time.
+#define LOG_BATCH_MAX 256
+#define LOG_INSERT_ROWS 64         // Rows per INSERT statement (4 parameters each)
+
+typedef struct {
+    int user_id;
+    time_t at;
+    char event_type[32];
+    char description[256];
+} PendingLog;
+
+static PendingLog log_batch[LOG_BATCH_MAX];
+static int log_batch_count = 0;
+static int log_db_enabled = 1;
+static unsigned long log_rows_written = 0, log_rows_failed = 0, log_flushes = 0;
+static pthread_mutex_t log_batch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define SQL_INSERT_LOGS "INSERT INTO logs (user_id, event_type, description, timestamp) VALUES "
+
+// Insert rows[0..n) with one statement; user_id <= 0 is stored as NULL
+static int db_insert_log_rows(const PendingLog *rows, int n) {
+    char query[128 + LOG_INSERT_ROWS * 40];
+    int len = snprintf(query, sizeof(query), SQL_INSERT_LOGS);
+    for (int i = 0; i < n; i++) {
+        len += snprintf(query + len, sizeof(query) - len, "%s(?, ?, ?, datetime(?, 'unixepoch'))",
+                        i ? ", " : "");
+    }
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Error preparing log insert: %s\n", sqlite3_errmsg(db));
+        return 0;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        if (rows[i].user_id > 0) sqlite3_bind_int(stmt, i * 4 + 1, rows[i].user_id);
+        else sqlite3_bind_null(stmt, i * 4 + 1);
+        sqlite3_bind_text(stmt, i * 4 + 2, rows[i].event_type, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, i * 4 + 3, rows[i].description, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, i * 4 + 4, (sqlite3_int64)rows[i].at);
+    }
+    
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
     return (rc == SQLITE_DONE) ? 1 : 0;
 }
 
+// Caller holds log_batch_lock
+static int db_flush_logs_locked(void) {
+    if (log_batch_count == 0) return 0;
+    
+    int own_txn = sqlite3_get_autocommit(db) && db_begin_transaction();
+    int written = 0, failed = 0;
+    for (int start = 0; start < log_batch_count; start += LOG_INSERT_ROWS) {
+        int n = log_batch_count - start;
+        if (n > LOG_INSERT_ROWS) n = LOG_INSERT_ROWS;
+        if (db_insert_log_rows(&log_batch[start], n)) {
+            written += n;
+            continue;
+        }
+        // One bad row (e.g. a foreign key) must not cost the rest of the chunk
+        for (int i = start; i < start + n; i++) {
+            if (db_insert_log_rows(&log_batch[i], 1)) written++;
+            else failed++;
+        }
+    }
+    if (own_txn && !db_commit_transaction()) {
+        db_rollback_transaction();
+        failed += written;
+        written = 0;
+    }
+    
+    log_rows_written += written;
+    log_rows_failed += failed;
+    log_flushes++;
+    log_batch_count = 0;
+    return written;
+}
+
+// Queue a log entry (written on the next flush). Returns 1 if queued or logging
+// to the database is disabled.
+int db_add_log(int user_id, const char *event_type, const char *description) {
+    pthread_mutex_lock(&log_batch_lock);
+    if (log_db_enabled) {
+        PendingLog *row = &log_batch[log_batch_count++];
+        row->user_id = user_id;
+        row->at = time(NULL);
+        snprintf(row->event_type, sizeof(row->event_type), "%s", event_type ? event_type : "");
+        snprintf(row->description, sizeof(row->description), "%s", description ? description : "");
+        if (log_batch_count == LOG_BATCH_MAX) db_flush_logs_locked();
+    }
+    pthread_mutex_unlock(&log_batch_lock);
+    return 1;
+}
+
+// Write all queued entries; returns the number of rows written
+int db_flush_logs(void) {
+    pthread_mutex_lock(&log_batch_lock);
+    int written = db_flush_logs_locked();
+    pthread_mutex_unlock(&log_batch_lock);
+    return written;
+}
+
+// Disabling flushes what is already queued, so no event is silently lost
+void db_set_log_enabled(int enabled) {
+    pthread_mutex_lock(&log_batch_lock);
+    if (!enabled) db_flush_logs_locked();
+    log_db_enabled = enabled ? 1 : 0;
+    pthread_mutex_unlock(&log_batch_lock);
+}
+
+void db_get_log_stats(DBLogStats *stats) {
+    pthread_mutex_lock(&log_batch_lock);
+    stats->enabled = log_db_enabled;
+    stats->pending = log_batch_count;
+    stats->written = log_rows_written;
+    stats->failed = log_rows_failed;
+    stats->flushes = log_flushes;
+    pthread_mutex_unlock(&log_batch_lock);
+}
+
+#define SQL_ROOM_ID_BY_NAME "SELECT id FROM rooms WHERE name = ?"
+
 // 🔧 Get room ID by name (needed for deletion)
 int db_get_room_id_by_name(const char *room_name) {
     if (!db || !room_name) return -1;
     
     sqlite3_stmt *stmt;
-    const char *query = "SELECT id FROM rooms WHERE name = ?";
+    const char *query = SQL_ROOM_ID_BY_NAME;
     
     if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
         fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
@@ -829,22 +1587,38 @@ int db_get_room_id_by_name(const char *room_name) {
     return room_id;
 }
 
+#define SQL_DELETE_ROOM_QUESTIONS "DELETE FROM room_questions WHERE room_id = ?"
+#define SQL_DELETE_ROOM_RESULTS "DELETE FROM results WHERE room_id = ?"
+#define SQL_DELETE_ROOM "DELETE FROM rooms WHERE id = ?"
+
 // 🔧 Delete room from database (and associated questions)
 int db_delete_room(int room_id) {
     if (!db || room_id <= 0) return 0;
     
+    // Archived results first, so a failure leaves the room in place to retry
+    if (archive_delete_room(db, room_id) < 0) return 0;
+    
     sqlite3_stmt *stmt;
     
     // First delete questions in this room
-    const char *delete_questions = "DELETE FROM room_questions WHERE room_id = ?";
+    const char *delete_questions = SQL_DELETE_ROOM_QUESTIONS;
     if (sqlite3_prepare_v2(db, delete_questions, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_int(stmt, 1, room_id);
         sqlite3_step(stmt);
         sqlite3_finalize(stmt);
     }
     
+    // Delete results while participants still exist, so the user_stats
+    // trigger can still map each result back to its user
+    const char *delete_results = SQL_DELETE_ROOM_RESULTS;
+    if (sqlite3_prepare_v2(db, delete_results, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, room_id);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    
     // Then delete the room itself
-    const char *delete_room = "DELETE FROM rooms WHERE id = ?";
+    const char *delete_room = SQL_DELETE_ROOM;
     if (sqlite3_prepare_v2(db, delete_room, -1, &stmt, NULL) != SQLITE_OK) {
         fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
         return 0;
@@ -857,122 +1631,190 @@ int db_delete_room(int room_id) {
     return result;
 }
 
-// Renumber questions to remove gaps after deletion
-// This creates a new questions table with sequential IDs and updates all references
-int db_renumber_questions(void) {
-    if (!db) return 0;
-    
-    char *err_msg = NULL;
-    
-    // Begin transaction
-    if (sqlite3_exec(db, "BEGIN TRANSACTION;", 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Transaction begin error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        return 0;
-    }
-    
-    // Create mapping table from old IDs to new sequential IDs
-    const char *create_mapping = 
-        "CREATE TEMPORARY TABLE id_mapping AS "
-        "SELECT id as old_id, ROW_NUMBER() OVER (ORDER BY id) as new_id FROM questions;";
-    
-    if (sqlite3_exec(db, create_mapping, 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Create mapping error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
-    }
-    
-    // Create new questions table with sequential IDs
-    const char *create_temp = 
-        "CREATE TABLE questions_new AS "
-        "SELECT m.new_id as id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, "
-        "q.correct_option, q.topic_id, q.difficulty_id, q.created_by, q.created_at "
-        "FROM questions q JOIN id_mapping m ON q.id = m.old_id ORDER BY m.new_id;";
-    
-    if (sqlite3_exec(db, create_temp, 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Create temp error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
-    }
-    
-    // Update room_questions table to use new IDs
-    const char *update_room_q = 
-        "UPDATE room_questions SET question_id = "
-        "(SELECT m.new_id FROM id_mapping m WHERE m.old_id = room_questions.question_id);";
+#define SQL_PURGE_TOMBSTONES \
+    "DELETE FROM questions WHERE id IN (" \
+    "  SELECT q.id FROM questions q WHERE q.is_deleted = 1" \
+    "  AND NOT EXISTS (SELECT 1 FROM room_questions rq WHERE rq.question_id = q.id)" \
+    "  AND NOT EXISTS (SELECT 1 FROM answers a WHERE a.question_id = q.id)" \
+    "  LIMIT ?)"
+
+// Background compaction for tombstoned questions, run in small batches so it never
+// holds the database for long. Each call purges up to batch_size tombstones no
+// longer referenced by rooms or answers (ids of live questions are never touched).
+// Returns the number of rows changed, 0 when there is nothing left to do, -1 on error.
+int db_compact_questions(int batch_size) {
+    if (!db || batch_size <= 0) return -1;
     
-    if (sqlite3_exec(db, update_room_q, 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Update room_questions error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
-    }
+    sqlite3_stmt *stmt;
+    int changed = 0;
     
-    // Update answers table to use new IDs
-    const char *update_answers = 
-        "UPDATE answers SET question_id = "
-        "(SELECT m.new_id FROM id_mapping m WHERE m.old_id = answers.question_id);";
+    // Packed sheets need no check: they belong to participants of a room, and
+    // the room's room_questions rows pin the same questions until it is deleted
+    const char *purge_query = SQL_PURGE_TOMBSTONES;
     
-    if (sqlite3_exec(db, update_answers, 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Update answers error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
+    if (sqlite3_prepare_v2(db, purge_query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Compaction purge error: %s\n", sqlite3_errmsg(db));
+        return -1;
     }
-    
-    // Drop old table and rename new one
-    if (sqlite3_exec(db, "DROP TABLE questions;", 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Drop questions error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
+    sqlite3_bind_int(stmt, 1, batch_size);
+    if (sqlite3_step(stmt) == SQLITE_DONE) {
+        changed += sqlite3_changes(db);
     }
+    sqlite3_finalize(stmt);
     
-    if (sqlite3_exec(db, "ALTER TABLE questions_new RENAME TO questions;", 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Rename error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
+    return changed;
+}
+
+// ==================== QUERY PLAN AUDIT ====================
+
+#define AUDIT_EXPECT_SCAN 1    // Full scan / temp B-tree is the point of the statement
+#define AUDIT_SCHEMA 2         // SQL has a %s schema placeholder (audited as "main")
+
+typedef struct {
+    const char *name;
+    const char *sql;
+    int flags;
+} AuditedStatement;
+
+// Every statement above; dynamic ones appear in a representative form
+static const AuditedStatement audited_statements[] = {
+    { "db_get_user_id", SQL_GET_USER_ID, 0 },
+    { "db_add_question/topic", SQL_TOPIC_ID_BY_NAME, 0 },
+    { "db_add_question/new_topic", SQL_INSERT_TOPIC, 0 },
+    { "db_add_question/difficulty", SQL_DIFFICULTY_ID_BY_NAME, 0 },
+    { "db_add_question", SQL_INSERT_QUESTION, 0 },
+    { "db_sync_questions_from_file", SQL_QUESTION_EXISTS, 0 },
+    { "db_get_question", SQL_GET_QUESTION, 0 },
+    { "db_delete_question", SQL_DELETE_QUESTION, 0 },
+    { "db_get_all_questions", SQL_GET_ALL_QUESTIONS, AUDIT_EXPECT_SCAN },
+    { "db_get_questions_with_distribution",
+      SQL_DISTRIBUTION_BASE " AND t.name COLLATE NOCASE IN ('a', 'b')"
+      " AND d.name COLLATE NOCASE IN ('easy') ORDER BY RANDOM() LIMIT ?", AUDIT_EXPECT_SCAN },
+    { "db_get_all_topics", SQL_TOPIC_COUNTS, AUDIT_EXPECT_SCAN },
+    { "db_get_all_difficulties", SQL_DIFFICULTY_COUNTS, AUDIT_EXPECT_SCAN },
+    { "db_for_each_question", SQL_FOR_EACH_QUESTION, AUDIT_EXPECT_SCAN },
+    { "db_for_each_question_in_topic", SQL_TOPIC_PAGE, 0 },
+    { "db_for_each_question_in_difficulty", SQL_DIFFICULTY_PAGE, 0 },
+    { "db_for_each_topic", SQL_FOR_EACH_TOPIC, AUDIT_EXPECT_SCAN },
+    { "db_for_each_difficulty", SQL_FOR_EACH_DIFFICULTY, AUDIT_EXPECT_SCAN },
+    { "db_search_questions_text", SQL_SEARCH_TEXT, AUDIT_EXPECT_SCAN },
+    { "db_get_bank_version", SQL_BANK_VERSION, 0 },
+    { "db_add_user", SQL_ADD_USER, 0 },
+    { "db_get_user_auth", SQL_GET_USER_AUTH, 0 },
+    { "db_set_user_password", SQL_SET_USER_PASSWORD, 0 },
+    { "db_username_exists", SQL_USERNAME_EXISTS, 0 },
+    { "db_create_room", SQL_CREATE_ROOM, 0 },
+    { "db_add_questions_to_room", SQL_ADD_ROOM_QUESTION, 0 },
+    { "db_get_room_questions", SQL_GET_ROOM_QUESTIONS, 0 },
+    { "db_get_room", SQL_GET_ROOM, 0 },
+    { "db_add_participant", SQL_ADD_PARTICIPANT, 0 },
+    { "db_record_answer", SQL_RECORD_ANSWER, 0 },
+    { "db_record_answer_sheet", SQL_RECORD_ANSWER_SHEET, 0 },
+    { "db_get_answers/sheet", SQL_GET_ANSWER_SHEET, 0 },
+    { "db_get_answers/rows", SQL_GET_ANSWER_ROWS, 0 },
+    { "db_add_result", SQL_ADD_RESULT, 0 },
+    { "db_get_leaderboard", SQL_LEADERBOARD, 0 },
+    { "db_for_each_result", SQL_SCAN_RESULTS, AUDIT_EXPECT_SCAN | AUDIT_SCHEMA },
+    { "db_for_each_user_stat", SQL_USER_STATS, AUDIT_EXPECT_SCAN },
+    // Groups one room's results (via the room_id index) by user: a small sort
+    { "db_for_each_room_user_stat", SQL_ROOM_USER_STATS, AUDIT_EXPECT_SCAN | AUDIT_SCHEMA },
+    { "db_save_practice_cards", SQL_SAVE_PRACTICE_CARD, 0 },
+    { "db_save_practice_cards/delete", SQL_DELETE_PRACTICE_CARD, 0 },
+    { "db_for_each_practice_card", SQL_FOR_EACH_PRACTICE_CARD, AUDIT_EXPECT_SCAN },
+    { "db_save_item_stats", SQL_SAVE_ITEM_STATS, 0 },
+    { "db_for_each_item_stats", SQL_FOR_EACH_ITEM_STATS, AUDIT_EXPECT_SCAN },
+    { "db_save_exam_template", SQL_SAVE_EXAM_TEMPLATE, 0 },
+    { "db_delete_exam_template", SQL_DELETE_EXAM_TEMPLATE, 0 },
+    { "db_for_each_exam_template", SQL_FOR_EACH_EXAM_TEMPLATE, AUDIT_EXPECT_SCAN },
+    { "db_flush_logs", SQL_INSERT_LOGS "(?, ?, ?, datetime(?, 'unixepoch'))", 0 },
+    { "db_get_room_id_by_name", SQL_ROOM_ID_BY_NAME, 0 },
+    { "db_delete_room/questions", SQL_DELETE_ROOM_QUESTIONS, 0 },
+    { "db_delete_room/results", SQL_DELETE_ROOM_RESULTS, 0 },
+    { "db_delete_room", SQL_DELETE_ROOM, 0 },
+    { "db_compact_questions/purge", SQL_PURGE_TOMBSTONES, 0 }
+};
+
+// A plan step that reads a whole table/index or sorts: "SCAN x" (except
+// virtual tables and constant rows) and "USE TEMP B-TREE FOR ..."
+static int plan_step_is_scan(const char *detail) {
+    if (strncmp(detail, "USE TEMP B-TREE", 15) == 0) return 1;
+    if (strncmp(detail, "SCAN ", 5) != 0) return 0;
+    return !strstr(detail, "VIRTUAL TABLE") && strcmp(detail, "SCAN CONSTANT ROW") != 0;
+}
+
+// Run EXPLAIN QUERY PLAN over every statement in this file and list the steps
+// that scan or sort: "WARN name: step" for unexpected ones, "ok   name: step"
+// for statements that stream a whole table by design. Returns the number of
+// warnings (statements that cannot be prepared count as warnings too).
+int db_audit_query_plans(char *report, int max_size, int *statements) {
+    if (!db || !report || max_size <= 0) return -1;
+    report[0] = '\0';
+    
+    int count = sizeof(audited_statements) / sizeof(audited_statements[0]);
+    int warnings = 0, len = 0;
+    if (statements) *statements = count;
+    
+    for (int i = 0; i < count; i++) {
+        const AuditedStatement *a = &audited_statements[i];
+        char query[2048];
+        if (a->flags & AUDIT_SCHEMA) {
+            int n = snprintf(query, sizeof(query), "EXPLAIN QUERY PLAN ");
+            snprintf(query + n, sizeof(query) - n, a->sql, "main");
+        } else {
+            snprintf(query, sizeof(query), "EXPLAIN QUERY PLAN %s", a->sql);
+        }
+        
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+            // FTS5 may be missing from this SQLite build; that is reported at startup
+            if (strstr(a->sql, "questions_fts")) continue;
+            len += snprintf(report + len, len < max_size ? max_size - len : 0,
+                            "WARN %s: %s\n", a->name, sqlite3_errmsg(db));
+            warnings++;
+            continue;
+        }
+        
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *detail = (const char*)sqlite3_column_text(stmt, 3);
+            if (!detail || !plan_step_is_scan(detail)) continue;
+            int expected = a->flags & AUDIT_EXPECT_SCAN;
+            if (!expected) warnings++;
+            len += snprintf(report + len, len < max_size ? max_size - len : 0,
+                            "%s %s: %s\n", expected ? "ok  " : "WARN", a->name, detail);
+        }
+        sqlite3_finalize(stmt);
     }
     
-    // Recreate indexes
-    const char *recreate_index = 
-        "CREATE INDEX IF NOT EXISTS idx_questions_topic ON questions(topic_id); "
-        "CREATE INDEX IF NOT EXISTS idx_questions_difficulty ON questions(difficulty_id);";
-    
-    if (sqlite3_exec(db, recreate_index, 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Index recreation error: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", 0, 0, &err_msg);
-        return 0;
+    // Keep the report a whole number of lines when it was truncated
+    if (len >= max_size) {
+        char *cut = strrchr(report, '\n');
+        if (cut) cut[1] = '\0';
     }
-    
-    // Commit transaction
-    if (sqlite3_exec(db, "COMMIT;", 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Commit error: %s\n", err_msg);
+    return warnings;
+}
+
+// ==================== TRANSACTIONS ====================
+
+int db_begin_transaction(void) {
+    char *err_msg = NULL;
+    if (sqlite3_exec(db, "BEGIN;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Error beginning transaction: %s\n", err_msg);
         sqlite3_free(err_msg);
         return 0;
     }
-    
     return 1;
 }
 
-// Compact question IDs to remove gaps (e.g., after deletion)
-// Creates new table with sequential IDs and swaps it
-int db_compact_question_ids(void) {
-    if (!db) return 0;
-    
+int db_commit_transaction(void) {
     char *err_msg = NULL;
-    
-    // Use VACUUM to reclaim space and compact the database
-    // This is a simpler approach than renumbering IDs
-    if (sqlite3_exec(db, "VACUUM;", 0, 0, &err_msg) != SQLITE_OK) {
-        fprintf(stderr, "Vacuum error: %s\n", err_msg);
+    if (sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Error committing transaction: %s\n", err_msg);
         sqlite3_free(err_msg);
         return 0;
     }
-    
     return 1;
 }
 
+void db_rollback_transaction(void) {
+    if (!sqlite3_get_autocommit(db)) sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+}
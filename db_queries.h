@@ -1,20 +1,22 @@
 #ifndef DB_QUERIES_H
 #define DB_QUERIES_H
 
+#include <stddef.h>
+#include "question.h"
+
 // Database structures
+// Borrowed view of a question row, valid only inside a db_for_each_question callback
 typedef struct {
     int id;
-    char text[256];
-    char option_a[128];
-    char option_b[128];
-    char option_c[128];
-    char option_d[128];
+    const char *text;
+    const char *option_a;
+    const char *option_b;
+    const char *option_c;
+    const char *option_d;
     char correct_option;
     int topic_id;
     int difficulty_id;
-    char topic[64];           // Added: topic name
-    char difficulty[32];      // Added: difficulty name
-} DBQuestion;
+} DBQuestionView;
 
 typedef struct {
     int id;
@@ -29,26 +31,40 @@ typedef struct {
 int db_add_question(const char *text, const char *opt_a, const char *opt_b,
                    const char *opt_c, const char *opt_d, char correct,
                    const char *topic, const char *difficulty, int created_by_id);
-int db_get_question(int id, DBQuestion *q);
+// Question strings are allocated from arena
+int db_get_question(int id, Question *q, Arena *arena);
 int db_delete_question(int id);
-int db_get_all_questions(DBQuestion *questions, int max_count);
-int db_get_questions_by_topic(const char *topic, DBQuestion *questions, int max_count);
-int db_get_questions_by_difficulty(const char *difficulty, DBQuestion *questions, int max_count);
+int db_get_all_questions(Question *questions, int max_count, Arena *arena);
 int db_get_questions_with_distribution(const char *topic_filter, const char *diff_filter,
-                                       DBQuestion *questions, int max_count);
+                                       Question *questions, int max_count, Arena *arena);
 int db_get_all_topics(char *output);
 int db_get_all_difficulties(char *output);
+typedef void (*db_question_callback)(const DBQuestionView *q, void *ctx);
+typedef void (*db_name_callback)(int id, const char *name, int level, void *ctx);
+int db_for_each_question(db_question_callback cb, void *ctx);
+// Keyset pages (id > after_id, ascending, at most limit rows)
+int db_for_each_question_in_topic(const char *topic, int after_id, int limit,
+                                  db_question_callback cb, void *ctx);
+int db_for_each_question_in_difficulty(const char *difficulty, int after_id, int limit,
+                                       db_question_callback cb, void *ctx);
+int db_for_each_topic(db_name_callback cb, void *ctx);
+int db_for_each_difficulty(db_name_callback cb, void *ctx);
+int db_search_questions_text(const char *terms, char *output, int max_size, int limit);
+// bank_meta.version (bumped by triggers on every question/topic/difficulty change), -1 on error
+long db_get_bank_version(void);
 
 // ==================== USERS ====================
 int db_add_user(const char *username, const char *password, const char *role);
-int db_validate_user(const char *username, const char *password);
-int db_get_user_role(const char *username, char *role);
+int db_get_user_auth(const char *username, int *user_id, char *role, size_t role_size,
+                     char *record, size_t record_size);
+int db_set_user_password(int user_id, const char *record);
 int db_username_exists(const char *username);
 
 // ==================== ROOMS ====================
 int db_create_room(const char *name, int owner_id, int duration_minutes);
-int db_add_question_to_room(int room_id, int question_id, int order_num);
-int db_get_room_questions(int room_id, DBQuestion *questions, int max_count);
+// Questions in exam order (order_num 0..count-1), in one transaction; 1 on success
+int db_add_questions_to_room(int room_id, int count, const int *question_ids);
+int db_get_room_questions(int room_id, Question *questions, int max_count, Arena *arena);
 int db_get_room(int room_id, DBRoom *room);
 int db_get_room_id_by_name(const char *room_name);  // 🔧 Get room ID for deletion
 int db_delete_room(int room_id);  // 🔧 Delete room from database
@@ -56,16 +72,108 @@ int db_delete_room(int room_id);  // 🔧 Delete room from database
 // ==================== PARTICIPANTS & ANSWERS ====================
 int db_add_participant(int room_id, int user_id);
 int db_record_answer(int participant_id, int question_id, char selected_option, int is_correct);
+// Whole-submission storage: one row per answer (answers table) or one packed
+// row per submission (answer_sheets, see answer_sheet.h). The answer_rows view
+// reads both, so queries work the same in either mode.
+#define ANSWER_STORAGE_ROWS 0
+#define ANSWER_STORAGE_PACKED 1
+void db_set_answer_storage(int mode);
+int db_get_answer_storage(void);
+int db_record_answers(int participant_id, int count, const int *question_ids,
+                      const char *selected, const int *is_correct);
+int db_get_answers(int participant_id, int *question_ids, char *selected, int *is_correct,
+                   int max_count);
 
 // ==================== RESULTS ====================
 int db_add_result(int participant_id, int room_id, int score, int total, int correct);
 int db_get_leaderboard(int room_id, char *output, int max_size);
+typedef void (*db_result_callback)(int room_id, const char *room_name, const char *username,
+                                   int score, int total, void *ctx);
+int db_for_each_result(db_result_callback cb, void *ctx);
+typedef void (*db_user_stat_callback)(const char *username, int tests, long score_sum,
+                                      long total_sum, void *ctx);
+int db_for_each_user_stat(db_user_stat_callback cb, void *ctx);
+// Per-user sums of one room's results (what deleting the room takes out of user_stats)
+int db_for_each_room_user_stat(int room_id, db_user_stat_callback cb, void *ctx);
+
+// ==================== PRACTICE ====================
+// Spaced-repetition state (practice.h), one row per (user, question) seen in
+// PRACTICE. A card with box < 0 deletes its row.
+typedef struct {
+    int user_id;
+    int question_id;
+    int box;
+    long due_at;               // Unix time of the next review
+} DBPracticeCard;
+
+// Upsert/delete a batch of cards in one transaction; returns 1 on success
+int db_save_practice_cards(int count, const DBPracticeCard *cards);
+typedef void (*db_practice_card_callback)(const DBPracticeCard *card, void *ctx);
+int db_for_each_practice_card(db_practice_card_callback cb, void *ctx);
+
+// ==================== ITEM STATISTICS ====================
+// Snapshot of the item_stats.h running aggregates, one row per answered question
+typedef struct {
+    int question_id;
+    int attempts;
+    int correct;
+    int choices[5];            // A, B, C, D, blank/other
+    double mean_item;          // Welford running means and (co-)moments
+    double mean_rest;
+    double m2_item;
+    double m2_rest;
+    double co_moment;
+} DBItemStats;
+
+// Replace the rows of a batch of questions in one transaction; 1 on success
+int db_save_item_stats(int count, const DBItemStats *items);
+typedef void (*db_item_stats_callback)(const DBItemStats *item, void *ctx);
+int db_for_each_item_stats(db_item_stats_callback cb, void *ctx);
+
+// ==================== EXAM TEMPLATES ====================
+// Admin-registered CREATE specs whose question sets are pregenerated (exam_pool.h)
+typedef struct {
+    char name[64];
+    int num_questions;
+    int pool_size;             // Variants kept ready
+    char topic_filter[256];    // As parsed by CREATE ("" = any)
+    char diff_filter[256];
+} DBExamTemplate;
+
+// Insert or replace by name; returns 1 on success
+int db_save_exam_template(const DBExamTemplate *t, int created_by);
+int db_delete_exam_template(const char *name);
+typedef void (*db_exam_template_callback)(const DBExamTemplate *t, void *ctx);
+int db_for_each_exam_template(db_exam_template_callback cb, void *ctx);
 
 // ==================== LOGS ====================
+// Queued in memory and written in batches; callers that need the rows on disk
+// call db_flush_logs() (caller holds the server lock, like any other write)
+typedef struct {
+    int enabled;
+    int pending;
+    unsigned long written;
+    unsigned long failed;
+    unsigned long flushes;
+} DBLogStats;
+
 int db_add_log(int user_id, const char *event_type, const char *description);
+int db_flush_logs(void);
+void db_set_log_enabled(int enabled);
+void db_get_log_stats(DBLogStats *stats);
 
 // ==================== MAINTENANCE ====================
-int db_renumber_questions(void);
+int db_compact_questions(int batch_size);
+
+// EXPLAIN QUERY PLAN over every statement in db_queries.c; writes one line per
+// scanning/sorting step to report and returns the number of unexpected ones
+int db_audit_query_plans(char *report, int max_size, int *statements);
+
+// ==================== TRANSACTIONS ====================
+// Group many writes into one commit (caller holds the server lock throughout)
+int db_begin_transaction(void);
+int db_commit_transaction(void);
+void db_rollback_transaction(void);
 
 #endif // DB_QUERIES_H
 
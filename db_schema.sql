@@ -39,6 +39,7 @@ CREATE TABLE IF NOT EXISTS questions (
     difficulty_id INTEGER NOT NULL,
     created_by INTEGER,
     created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    is_deleted INTEGER NOT NULL DEFAULT 0,   -- tombstone: ids are never reused or renumbered
     FOREIGN KEY(topic_id) REFERENCES topics(id) ON DELETE RESTRICT,
     FOREIGN KEY(difficulty_id) REFERENCES difficulties(id) ON DELETE RESTRICT,
     FOREIGN KEY(created_by) REFERENCES users(id) ON DELETE SET NULL
@@ -47,6 +48,14 @@ CREATE TABLE IF NOT EXISTS questions (
 -- Create index on frequently searched columns
 CREATE INDEX IF NOT EXISTS idx_questions_topic ON questions(topic_id);
 CREATE INDEX IF NOT EXISTS idx_questions_difficulty ON questions(difficulty_id);
+CREATE INDEX IF NOT EXISTS idx_questions_deleted ON questions(is_deleted);
+
+-- Full-text index over live questions (SEARCH_QUESTIONS text), kept in sync by
+-- triggers; tombstoned rows are removed from it. Created by db_upgrade_schema().
+CREATE VIRTUAL TABLE IF NOT EXISTS questions_fts USING fts5(
+    text, option_a, option_b, option_c, option_d,
+    content='questions', content_rowid='id', tokenize='unicode61 remove_diacritics 2'
+);
 
 -- Rooms table
 CREATE TABLE IF NOT EXISTS rooms (
@@ -71,6 +80,9 @@ CREATE TABLE IF NOT EXISTS room_questions (
     FOREIGN KEY(question_id) REFERENCES questions(id) ON DELETE CASCADE
 );
 
+-- Lets compaction check whether a tombstoned question is still referenced
+CREATE INDEX IF NOT EXISTS idx_room_questions_question ON room_questions(question_id);
+
 -- Participants table
 CREATE TABLE IF NOT EXISTS participants (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -101,6 +113,39 @@ CREATE TABLE IF NOT EXISTS answers (
     FOREIGN KEY(question_id) REFERENCES questions(id) ON DELETE CASCADE
 );
 
+CREATE INDEX IF NOT EXISTS idx_answers_question ON answers(question_id);
+
+-- Packed answers: one row per submission (layout in answer_sheet.h)
+CREATE TABLE IF NOT EXISTS answer_sheets (
+    participant_id INTEGER PRIMARY KEY,
+    question_count INTEGER NOT NULL,
+    question_ids BLOB NOT NULL,
+    marks BLOB NOT NULL,
+    submitted_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY(participant_id) REFERENCES participants(id) ON DELETE CASCADE
+);
+
+-- One row per packed answer, decoded from the hex digits of the blobs
+CREATE VIEW IF NOT EXISTS answer_sheet_rows AS
+WITH RECURSIVE slot(k) AS (SELECT 0 UNION ALL SELECT k + 1 FROM slot WHERE k < 254)
+SELECT s.participant_id AS participant_id, slot.k AS position,
+    (SELECT SUM((instr('0123456789ABCDEF', substr(hex(s.question_ids), 8 * slot.k + d.column1, 1)) - 1)
+                << (4 * (8 - d.column1)))
+     FROM (VALUES (1), (2), (3), (4), (5), (6), (7), (8)) d) AS question_id,
+    substr('.ABCD', ((instr('0123456789ABCDEF', substr(hex(s.marks), slot.k + 1, 1)) - 1) & 7) + 1, 1)
+        AS selected_option,
+    (instr('0123456789ABCDEF', substr(hex(s.marks), slot.k + 1, 1)) - 1) >> 3 AS is_correct,
+    s.submitted_at AS submitted_at
+FROM answer_sheets s JOIN slot ON slot.k < s.question_count;
+
+-- Every answer regardless of storage mode
+CREATE VIEW IF NOT EXISTS answer_rows AS
+SELECT participant_id, id AS position, question_id, selected_option, is_correct, submitted_at
+FROM answers
+UNION ALL
+SELECT participant_id, position, question_id, selected_option, is_correct, submitted_at
+FROM answer_sheet_rows;
+
 -- Results table (summary scores)
 CREATE TABLE IF NOT EXISTS results (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -115,6 +160,29 @@ CREATE TABLE IF NOT EXISTS results (
     FOREIGN KEY(room_id) REFERENCES rooms(id) ON DELETE CASCADE
 );
 
+-- Per-user running sums for the global ranking (maintained by triggers on results)
+CREATE TABLE IF NOT EXISTS user_stats (
+    user_id INTEGER PRIMARY KEY,
+    results_count INTEGER NOT NULL DEFAULT 0,
+    score_sum INTEGER NOT NULL DEFAULT 0,
+    total_sum INTEGER NOT NULL DEFAULT 0,
+    FOREIGN KEY(user_id) REFERENCES users(id) ON DELETE CASCADE
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_results_stats_insert AFTER INSERT ON results BEGIN
+    INSERT INTO user_stats (user_id, results_count, score_sum, total_sum)
+    SELECT p.user_id, 1, NEW.score, NEW.total_questions FROM participants p
+    WHERE p.id = NEW.participant_id
+    ON CONFLICT(user_id) DO UPDATE SET results_count = results_count + 1,
+    score_sum = score_sum + excluded.score_sum, total_sum = total_sum + excluded.total_sum;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_results_stats_delete AFTER DELETE ON results BEGIN
+    UPDATE user_stats SET results_count = results_count - 1,
+    score_sum = score_sum - OLD.score, total_sum = total_sum - OLD.total_questions
+    WHERE user_id = (SELECT user_id FROM participants WHERE id = OLD.participant_id);
+END;
+
 -- Logs table
 CREATE TABLE IF NOT EXISTS logs (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -0,0 +1,469 @@
+#define _DEFAULT_SOURCE           // pthread_rwlock_t under -std=c11
+#include "dedup.h"
+#include "storage.h"
+#include "catalog.h"
+#include "bank_image.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BAND_ROWS 2
+#define BANDS (DEDUP_MINHASH_SIZE / BAND_ROWS)
+#define ID_TABLE 0
+#define CONTENT_TABLE 1
+#define BAND_TABLE(b) (2 + (b))
+#define TABLES (2 + BANDS)
+
+typedef DedupSignature Signature;
+
+typedef struct {
+    Signature sig;
+    int id;
+    int next_id;                   // Chain links (slot + 1, 0 terminates)
+    int next_content;
+    int next_band[BANDS];
+} DedupEntry;
+
+static DedupEntry *entries = NULL;       // One slot per live question, in no order
+static int entry_count = 0;
+static int entry_cap = 0;
+static int *heads = NULL;                // TABLES tables: key -> first slot + 1
+static int table_mask = 0;               // Size - 1 of each table (power of two)
+static int built = 0;
+static pthread_rwlock_t dedup_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// ===== SIGNATURES =====
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static void add_feature(uint64_t feature, uint32_t *minhash) {
+    uint64_t h = mix64(feature);
+    for (int k = 0; k < DEDUP_MINHASH_SIZE; k++) {
+        uint32_t v = (uint32_t)(mix64(h ^ (0x9e3779b97f4a7c15ULL * (k + 1))) >> 32);
+        if (v < minhash[k]) minhash[k] = v;
+    }
+}
+
+// Features are the words of each field and the pairs of adjacent words within
+// it; options are not told apart, so reordered options still match. Signatures
+// are stored in the bank image: bump BANK_IMAGE_FORMAT when this changes.
+static void compute_signature(const char *const fields[5], Signature *sig) {
+    uint64_t content = 14695981039346656037ULL;
+    memset(sig->minhash, 0xff, sizeof(sig->minhash));
+
+    for (int f = 0; f < 5; f++) {
+        const unsigned char *p = (const unsigned char*)(fields[f] ? fields[f] : "");
+        uint64_t prev = 0;
+        while (*p) {
+            while (*p && !isalnum(*p) && *p < 0x80) p++;
+            if (!*p) break;
+            uint64_t word = 14695981039346656037ULL;
+            while (*p && (isalnum(*p) || *p >= 0x80)) {
+                unsigned char c = (unsigned char)tolower(*p++);
+                word = (word ^ c) * 1099511628211ULL;
+                content = (content ^ c) * 1099511628211ULL;
+            }
+            content = (content ^ ' ') * 1099511628211ULL;
+            add_feature(word, sig->minhash);
+            if (prev) add_feature(prev * 31 + word, sig->minhash);
+            prev = word;
+        }
+        content = (content ^ ('|' + f)) * 1099511628211ULL;
+    }
+
+    sig->content = content;
+}
+
+void dedup_compute_signature(const char *text, const char *opt_a, const char *opt_b,
+                             const char *opt_c, const char *opt_d, DedupSignature *sig) {
+    const char *fields[5] = { text, opt_a, opt_b, opt_c, opt_d };
+    compute_signature(fields, sig);
+}
+
+static int similarity(const Signature *a, const Signature *b) {
+    int same = 0;
+    for (int k = 0; k < DEDUP_MINHASH_SIZE; k++) same += a->minhash[k] == b->minhash[k];
+    return same * 100 / DEDUP_MINHASH_SIZE;
+}
+
+static int same_band(const Signature *a, const Signature *b, int band) {
+    return memcmp(&a->minhash[band * BAND_ROWS], &b->minhash[band * BAND_ROWS],
+                  BAND_ROWS * sizeof(uint32_t)) == 0;
+}
+
+static int *table_head(int table, uint64_t key) {
+    return &heads[(size_t)table * (table_mask + 1) + (key & table_mask)];
+}
+
+static int *id_head(int id) {
+    return table_head(ID_TABLE, mix64((uint64_t)id));
+}
+
+static int *band_head(const Signature *sig, int band) {
+    uint64_t key = band;
+    for (int r = 0; r < BAND_ROWS; r++) key = mix64(key ^ sig->minhash[band * BAND_ROWS + r]);
+    return table_head(BAND_TABLE(band), key);
+}
+
+// ===== INDEX (caller holds dedup_lock for writing) =====
+
+static void link_slot(int slot) {
+    DedupEntry *e = &entries[slot];
+    int *head = id_head(e->id);
+    e->next_id = *head;
+    *head = slot + 1;
+    head = table_head(CONTENT_TABLE, e->sig.content);
+    e->next_content = *head;
+    *head = slot + 1;
+    for (int b = 0; b < BANDS; b++) {
+        head = band_head(&e->sig, b);
+        e->next_band[b] = *head;
+        *head = slot + 1;
+    }
+}
+
+static void unlink_slot(int slot) {
+    DedupEntry *e = &entries[slot];
+    int *link = id_head(e->id);
+    while (*link && *link != slot + 1) link = &entries[*link - 1].next_id;
+    if (*link) *link = e->next_id;
+    link = table_head(CONTENT_TABLE, e->sig.content);
+    while (*link && *link != slot + 1) link = &entries[*link - 1].next_content;
+    if (*link) *link = e->next_content;
+    for (int b = 0; b < BANDS; b++) {
+        link = band_head(&e->sig, b);
+        while (*link && *link != slot + 1) link = &entries[*link - 1].next_band[b];
+        if (*link) *link = e->next_band[b];
+    }
+}
+
+static int find_slot(int id) {
+    for (int s = *id_head(id); s; s = entries[s - 1].next_id) {
+        if (entries[s - 1].id == id) return s - 1;
+    }
+    return -1;
+}
+
+// Unlink slot and move the last entry into it, so deleted questions leave no hole
+static void remove_slot(int slot) {
+    int last = entry_count - 1;
+    unlink_slot(slot);
+    if (slot != last) {
+        unlink_slot(last);
+        entries[slot] = entries[last];
+        link_slot(slot);
+    }
+    entry_count--;
+}
+
+// Make room for count entries (doubling, or exactly count when that is more).
+// The tables keep at most two entries per bucket on average and are relinked
+// when they grow; if that allocation fails the old ones stay, with longer chains.
+static int reserve(int count) {
+    if (count <= entry_cap) return 1;
+    int cap = entry_cap ? entry_cap * 2 : 1024;
+    if (cap < count) cap = count;
+    DedupEntry *grown = realloc(entries, (size_t)cap * sizeof(DedupEntry));
+    if (!grown) return 0;
+    entries = grown;
+    entry_cap = cap;
+
+    int size = 512;
+    while (size < cap / 2) size *= 2;
+    if (heads && size == table_mask + 1) return 1;
+    int *tables = calloc((size_t)size * TABLES, sizeof(int));
+    if (!tables) return heads != NULL;
+    free(heads);
+    heads = tables;
+    table_mask = size - 1;
+    for (int s = 0; s < entry_count; s++) link_slot(s);
+    return 1;
+}
+
+static void index_signature(int id, const Signature *sig) {
+    if (id <= 0) return;
+    int slot = find_slot(id);
+    if (slot >= 0) {
+        unlink_slot(slot);
+    } else {
+        if (!reserve(entry_count + 1)) return;
+        slot = entry_count++;
+    }
+    entries[slot].id = id;
+    entries[slot].sig = *sig;
+    link_slot(slot);
+}
+
+// Drop the index and size it for expected entries
+static int reset_index(int expected) {
+    free(entries);
+    free(heads);
+    entries = NULL;
+    heads = NULL;
+    entry_count = entry_cap = table_mask = 0;
+    built = 0;
+    return reserve(expected > 0 ? expected : 1);
+}
+
+static void index_view(const DBQuestionView *q, void *ctx) {
+    const char *fields[5] = { q->text, q->option_a, q->option_b, q->option_c, q->option_d };
+    Signature sig;
+    compute_signature(fields, &sig);
+    index_signature(q->id, &sig);
+    (*(int*)ctx)++;
+}
+
+int dedup_rebuild(void) {
+    pthread_rwlock_wrlock(&dedup_lock);
+    int count = 0;
+    if (reset_index(catalog_question_count())) {
+        storage->for_each_question(index_view, &count);
+        built = 1;
+    }
+    pthread_rwlock_unlock(&dedup_lock);
+    return built ? count : -1;
+}
+
+int dedup_load_image(const BankImage *img) {
+    int count = bank_image_question_count(img);
+    pthread_rwlock_wrlock(&dedup_lock);
+    // Headroom for the questions added before the next restart
+    if (reset_index(count + count / 8)) {
+        const BankImageSignature *r;
+        for (int i = 0; (r = bank_image_signature(img, i)) != NULL; i++) {
+            Signature sig;
+            sig.content = (uint64_t)r->content[1] << 32 | r->content[0];
+            memcpy(sig.minhash, r->minhash, sizeof(sig.minhash));
+            index_signature((int)r->id, &sig);
+        }
+        built = 1;
+    }
+    int indexed = built ? entry_count : -1;
+    pthread_rwlock_unlock(&dedup_lock);
+    return indexed;
+}
+
+int dedup_get_signature(int id, DedupSignature *sig) {
+    pthread_rwlock_rdlock(&dedup_lock);
+    int slot = built ? find_slot(id) : -1;
+    if (slot >= 0) *sig = entries[slot].sig;
+    pthread_rwlock_unlock(&dedup_lock);
+    return slot >= 0;
+}
+
+// ===== WRITE-THROUGH HOOKS =====
+
+void dedup_on_question_added(int id, const char *text, const char *opt_a, const char *opt_b,
+                             const char *opt_c, const char *opt_d) {
+    const char *fields[5] = { text, opt_a, opt_b, opt_c, opt_d };
+    Signature sig;
+    compute_signature(fields, &sig);
+    pthread_rwlock_wrlock(&dedup_lock);
+    if (built) index_signature(id, &sig);
+    pthread_rwlock_unlock(&dedup_lock);
+}
+
+void dedup_on_question_deleted(int id) {
+    pthread_rwlock_wrlock(&dedup_lock);
+    int slot = built && id > 0 ? find_slot(id) : -1;
+    if (slot >= 0) remove_slot(slot);
+    pthread_rwlock_unlock(&dedup_lock);
+}
+
+// ===== LOOKUPS (caller holds dedup_lock) =====
+
+// Lowest id with the same content, other than self
+static int first_exact(const Signature *sig, int self) {
+    int first = 0;
+    for (int s = *table_head(CONTENT_TABLE, sig->content); s; s = entries[s - 1].next_content) {
+        const DedupEntry *e = &entries[s - 1];
+        if (e->id != self && e->sig.content == sig->content && (!first || e->id < first)) first = e->id;
+    }
+    return first;
+}
+
+typedef void (*near_callback)(int id, int percent, void *ctx);
+
+// Every question sharing a band with sig (each once, exact duplicates and ids
+// >= below excluded when below > 0) that is at least min_percent similar
+static void for_each_near(const Signature *sig, int self, int below, int min_percent,
+                          near_callback cb, void *ctx) {
+    for (int b = 0; b < BANDS; b++) {
+        for (int s = *band_head(sig, b); s; s = entries[s - 1].next_band[b]) {
+            int id = entries[s - 1].id;
+            const Signature *other = &entries[s - 1].sig;
+            if (id == self || (below > 0 && id >= below) || other->content == sig->content) continue;
+            if (!same_band(sig, other, b)) continue;      // Bucket collision
+            int seen = 0;
+            for (int e = 0; e < b && !seen; e++) seen = same_band(sig, other, e);
+            if (seen) continue;
+            int percent = similarity(sig, other);
+            if (percent >= min_percent) cb(id, percent, ctx);
+        }
+    }
+}
+
+static void keep_best(int id, int percent, void *ctx) {
+    DedupMatch *m = ctx;
+    if (percent > m->similarity || (percent == m->similarity && id < m->near_id)) {
+        m->near_id = id;
+        m->similarity = percent;
+    }
+}
+
+int dedup_find(const char *text, const char *opt_a, const char *opt_b, const char *opt_c,
+               const char *opt_d, int min_percent, DedupMatch *m) {
+    const char *fields[5] = { text, opt_a, opt_b, opt_c, opt_d };
+    Signature sig;
+    compute_signature(fields, &sig);
+    memset(m, 0, sizeof(*m));
+
+    pthread_rwlock_rdlock(&dedup_lock);
+    if (built) {
+        m->exact_id = first_exact(&sig, 0);
+        for_each_near(&sig, 0, 0, min_percent, keep_best, m);
+    }
+    pthread_rwlock_unlock(&dedup_lock);
+    return m->exact_id || m->near_id;
+}
+
+// ===== PARALLEL REPORT =====
+
+typedef struct {
+    int id;                        // Newer question
+    int other;                     // Older question it duplicates
+    int percent;                   // 0 for an exact duplicate
+} DupPair;
+
+typedef struct {
+    int count;
+    int first, stride;             // This worker's slots: first, first + stride, ...
+    int min_percent;
+    DupPair *pairs;
+    int pair_count, pair_cap;
+    int failed;
+} ReportWorker;
+
+static void add_pair(ReportWorker *w, int id, int other, int percent) {
+    if (w->pair_count == w->pair_cap) {
+        int cap = w->pair_cap ? w->pair_cap * 2 : 256;
+        DupPair *grown = realloc(w->pairs, cap * sizeof(DupPair));
+        if (!grown) {
+            w->failed = 1;
+            return;
+        }
+        w->pairs = grown;
+        w->pair_cap = cap;
+    }
+    w->pairs[w->pair_count++] = (DupPair){ id, other, percent };
+}
+
+typedef struct {
+    ReportWorker *w;
+    int id;
+} NearCtx;
+
+static void collect_near(int other, int percent, void *ctx) {
+    NearCtx *n = ctx;
+    add_pair(n->w, n->id, other, percent);
+}
+
+// Runs under the report's read lock, so the index cannot change underneath
+static void *report_worker(void *arg) {
+    ReportWorker *w = arg;
+    for (int i = w->first; i < w->count; i += w->stride) {
+        int id = entries[i].id;
+        const Signature *sig = &entries[i].sig;
+        int exact = first_exact(sig, id);
+        if (exact && exact < id) add_pair(w, id, exact, 0);
+        NearCtx ctx = { w, id };
+        for_each_near(sig, id, id, w->min_percent, collect_near, &ctx);
+    }
+    return NULL;
+}
+
+static int compare_pairs(const void *a, const void *b) {
+    const DupPair *pa = a, *pb = b;
+    if ((pa->percent == 0) != (pb->percent == 0)) return pa->percent == 0 ? -1 : 1;
+    if (pa->id != pb->id) return pa->id - pb->id;
+    return pa->other - pb->other;
+}
+
+int dedup_report(int min_percent, int threads, char *output, int max_size,
+                 int *exact_out, int *near_out) {
+    output[0] = '\0';
+    *exact_out = *near_out = 0;
+    if (threads < 1) threads = 1;
+    if (threads > DEDUP_MAX_THREADS) threads = DEDUP_MAX_THREADS;
+
+    pthread_rwlock_rdlock(&dedup_lock);
+    if (!built) {
+        pthread_rwlock_unlock(&dedup_lock);
+        return -1;
+    }
+    int count = entry_count;
+
+    ReportWorker workers[DEDUP_MAX_THREADS];
+    pthread_t tids[DEDUP_MAX_THREADS];
+    int started = 0;
+    memset(workers, 0, sizeof(workers));
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (ReportWorker){ .count = count, .first = t, .stride = threads,
+                                     .min_percent = min_percent };
+    }
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, report_worker, &workers[t]) != 0) break;
+        started = t;
+    }
+    // This thread takes the first share, plus any that could not be started
+    for (int t = 0; t < threads; t++) {
+        if (t == 0 || t > started) report_worker(&workers[t]);
+    }
+    for (int t = 1; t <= started; t++) pthread_join(tids[t], NULL);
+    pthread_rwlock_unlock(&dedup_lock);
+
+    int total = 0, failed = 0;
+    for (int t = 0; t < threads; t++) {
+        total += workers[t].pair_count;
+        failed |= workers[t].failed;
+    }
+    DupPair *pairs = malloc((total > 0 ? total : 1) * sizeof(DupPair));
+    if (!pairs) failed = 1;
+    int n = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pairs) memcpy(pairs + n, workers[t].pairs, workers[t].pair_count * sizeof(DupPair));
+        n += workers[t].pair_count;
+        free(workers[t].pairs);
+    }
+    if (failed) {
+        free(pairs);
+        return -1;
+    }
+    qsort(pairs, total, sizeof(DupPair), compare_pairs);
+
+    int len = 0, full = 0;
+    for (int i = 0; i < total; i++) {
+        if (pairs[i].percent == 0) (*exact_out)++;
+        else (*near_out)++;
+        if (full) continue;
+        int w = pairs[i].percent == 0
+            ? snprintf(output + len, max_size - len, "EXACT %d = %d\n", pairs[i].id, pairs[i].other)
+            : snprintf(output + len, max_size - len, "NEAR %d ~ %d (%d%%)\n",
+                       pairs[i].id, pairs[i].other, pairs[i].percent);
+        if (w < 0 || w >= max_size - len) {
+            output[len] = '\0';
+            full = 1;
+        } else {
+            len += w;
+        }
+    }
+    free(pairs);
+    return count;
+}
@@ -0,0 +1,70 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+// Duplicate detection over question text and options (A-D).
+//  - content hash: 64-bit hash of the words in order, lowercased, punctuation
+//    and spacing dropped; equal hashes are exact duplicates
+//  - MinHash: 32-value signature of the words and adjacent word pairs; the
+//    share of equal values estimates the Jaccard similarity of two questions
+//    (one word changed in a ten-word question leaves about 85%)
+//  - LSH bands: the signature is cut into 16 bands of 2 values, each indexing
+//    a bucket table; questions sharing a band are the near-duplicate
+//    candidates (found with probability 1-(1-s^2)^16: 99% at s = 0.5)
+// Kept in sync write-through like the catalog (each storage engine's
+// add_question/delete_question calls the dedup_on_* hooks), so a lookup is
+// one content bucket plus sixteen band buckets: O(1) expected. The index holds
+// one entry per live question; the compiled bank image stores every question's
+// signature, so startup indexes without rereading or rehashing the bank.
+
+#include <stdint.h>
+
+#define DEDUP_NEAR_PERCENT 70        // Default similarity for a near duplicate
+#define DEDUP_MAX_THREADS 16
+#define DEDUP_MINHASH_SIZE 32
+
+typedef struct BankImage BankImage;
+
+typedef struct {
+    uint64_t content;
+    uint32_t minhash[DEDUP_MINHASH_SIZE];
+} DedupSignature;
+
+typedef struct {
+    int exact_id;                    // Question with the same content, 0 if none
+    int near_id;                     // Most similar other question, 0 if none
+    int similarity;                  // Estimated similarity of near_id, percent
+} DedupMatch;
+
+// Index every live question in storage (stale bank image, after a bulk rollback).
+// Returns the number indexed, -1 on failure.
+int dedup_rebuild(void);
+
+// Index the signatures stored in a bank image (startup). Returns the number
+// indexed, -1 on failure.
+int dedup_load_image(const BankImage *img);
+
+// Fingerprints of a question, as the index computes them
+void dedup_compute_signature(const char *text, const char *opt_a, const char *opt_b,
+                             const char *opt_c, const char *opt_d, DedupSignature *sig);
+
+// Copy the indexed signature of question id; returns 0 if it is not indexed
+int dedup_get_signature(int id, DedupSignature *sig);
+
+// Write-through hooks (no-ops until dedup_rebuild has run)
+void dedup_on_question_added(int id, const char *text, const char *opt_a, const char *opt_b,
+                             const char *opt_c, const char *opt_d);
+void dedup_on_question_deleted(int id);
+
+// Look up a question before it is added. Returns 1 and fills m if the bank holds
+// an exact duplicate or one at least min_percent similar, else 0.
+int dedup_find(const char *text, const char *opt_a, const char *opt_b, const char *opt_c,
+               const char *opt_d, int min_percent, DedupMatch *m);
+
+// Full-bank report, split over threads workers: one "EXACT <id> = <first id>" or
+// "NEAR <id> ~ <id> (<p>%)" line per pair, newer id first, into output (cut at a
+// line boundary when full). exact_out / near_out receive the pair counts.
+// Returns the number of questions scanned, -1 if the index is not built.
+int dedup_report(int min_percent, int threads, char *output, int max_size,
+                 int *exact_out, int *near_out);
+
+#endif // DEDUP_H
@@ -0,0 +1,247 @@
+#define _DEFAULT_SOURCE
+#include "exam_pool.h"
+#include "catalog.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef struct {
+    Question questions[MAX_QUESTIONS_PER_ROOM];
+    int count;
+    Arena arena;               // Strings of questions[], handed to the room
+} ExamVariant;
+
+typedef struct {
+    int in_use;
+    DBExamTemplate spec;
+    unsigned long generation;  // Bumped on replace/drop; refills of an older one are discarded
+    ExamVariant *ready[EXAM_POOL_MAX_VARIANTS];
+    int ready_count;
+    int starved;               // Last draw found no question; retried once the catalog changes
+    unsigned long starved_version;
+} ExamTemplate;
+
+static ExamTemplate templates[EXAM_POOL_TEMPLATES];
+static unsigned long next_generation = 1;
+static int refill_cursor = 0;  // Round-robin, so one large pool does not starve the rest
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+
+// ===== TEMPLATES (caller holds pool_lock) =====
+
+static ExamTemplate *template_find(const char *name) {
+    for (int i = 0; i < EXAM_POOL_TEMPLATES; i++) {
+        if (templates[i].in_use && strcmp(templates[i].spec.name, name) == 0) return &templates[i];
+    }
+    return NULL;
+}
+
+static void variant_free(ExamVariant *v) {
+    if (!v) return;
+    arena_free(&v->arena);
+    free(v);
+}
+
+static void template_clear(ExamTemplate *t) {
+    for (int i = 0; i < t->ready_count; i++) variant_free(t->ready[i]);
+    t->ready_count = 0;
+    t->starved = 0;
+    t->generation = next_generation++;
+}
+
+// Fill the named slot (or a free one) with spec. Returns 1 added, 2 replaced, 0 full.
+static int template_set(const DBExamTemplate *spec) {
+    ExamTemplate *t = template_find(spec->name);
+    int replaced = t != NULL;
+    for (int i = 0; !t && i < EXAM_POOL_TEMPLATES; i++) {
+        if (!templates[i].in_use) t = &templates[i];
+    }
+    if (!t) return 0;
+    template_clear(t);
+    t->spec = *spec;
+    t->in_use = 1;
+    return replaced ? 2 : 1;
+}
+
+// ===== LOADING AND REGISTRATION =====
+
+static void load_template(const DBExamTemplate *spec, void *ctx) {
+    int *loaded = ctx;
+    if (spec->num_questions < 1 || spec->num_questions > MAX_QUESTIONS_PER_ROOM) return;
+    if (spec->pool_size < 1 || spec->pool_size > EXAM_POOL_MAX_VARIANTS) return;
+    if (template_set(spec)) (*loaded)++;
+}
+
+int exam_pool_load(void) {
+    pthread_mutex_lock(&pool_lock);
+    int loaded = 0;
+    storage->for_each_exam_template(load_template, &loaded);
+    pthread_cond_signal(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    return loaded;
+}
+
+int exam_pool_register(const DBExamTemplate *spec, int created_by) {
+    pthread_mutex_lock(&pool_lock);
+    int exists = template_find(spec->name) != NULL;
+    int has_slot = exists;
+    for (int i = 0; !has_slot && i < EXAM_POOL_TEMPLATES; i++) has_slot = !templates[i].in_use;
+    if (!has_slot) {
+        pthread_mutex_unlock(&pool_lock);
+        return 0;
+    }
+    if (!storage->save_exam_template(spec, created_by)) {
+        pthread_mutex_unlock(&pool_lock);
+        return -1;
+    }
+    int result = template_set(spec);
+    pthread_cond_signal(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    return result;
+}
+
+int exam_pool_drop(const char *name) {
+    pthread_mutex_lock(&pool_lock);
+    ExamTemplate *t = template_find(name);
+    int result = 0;
+    if (t) {
+        result = storage->delete_exam_template(name) ? 1 : -1;
+        if (result == 1) {
+            template_clear(t);
+            t->in_use = 0;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return result;
+}
+
+int exam_pool_find(DBExamTemplate *spec) {
+    pthread_mutex_lock(&pool_lock);
+    ExamTemplate *found = NULL;
+    if (spec->name[0]) {
+        found = template_find(spec->name);
+    } else {
+        for (int i = 0; !found && i < EXAM_POOL_TEMPLATES; i++) {
+            const DBExamTemplate *s = &templates[i].spec;
+            if (templates[i].in_use && s->num_questions == spec->num_questions &&
+                strcmp(s->topic_filter, spec->topic_filter) == 0 &&
+                strcmp(s->diff_filter, spec->diff_filter) == 0) {
+                found = &templates[i];
+            }
+        }
+    }
+    if (found) *spec = found->spec;
+    pthread_mutex_unlock(&pool_lock);
+    return found != NULL;
+}
+
+// ===== HANDING OUT =====
+
+static int variant_is_live(const ExamVariant *v) {
+    for (int i = 0; i < v->count; i++) {
+        if (!catalog_question_exists(v->questions[i].id)) return 0;
+    }
+    return 1;
+}
+
+int exam_pool_take(const char *name, Question *out, Arena *arena) {
+    pthread_mutex_lock(&pool_lock);
+    ExamTemplate *t = template_find(name);
+    ExamVariant *v = NULL;
+    while (t && t->ready_count > 0) {
+        v = t->ready[--t->ready_count];
+        if (variant_is_live(v)) break;
+        variant_free(v);       // A question was deleted since the draw
+        v = NULL;
+    }
+    if (t) pthread_cond_signal(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!v) return 0;
+    int count = v->count;
+    memcpy(out, v->questions, count * sizeof(Question));
+    *arena = v->arena;         // Moved, not copied: the strings stay where they are
+    free(v);
+    return count;
+}
+
+// ===== REFILLING =====
+
+// Next template short of variants, round-robin; copies its spec. Returns its
+// generation, 0 if none.
+static unsigned long next_to_refill(DBExamTemplate *spec) {
+    unsigned long version = catalog_version();
+    for (int k = 0; k < EXAM_POOL_TEMPLATES; k++) {
+        ExamTemplate *t = &templates[(refill_cursor + k) % EXAM_POOL_TEMPLATES];
+        if (!t->in_use || t->ready_count >= t->spec.pool_size) continue;
+        if (t->starved && t->starved_version == version) continue;
+        refill_cursor = (refill_cursor + k + 1) % EXAM_POOL_TEMPLATES;
+        *spec = t->spec;
+        return t->generation;
+    }
+    return 0;
+}
+
+int exam_pool_refill(int max_variants) {
+    if (!catalog_is_loaded()) return 0;
+    int added = 0;
+    while (added < max_variants) {
+        DBExamTemplate spec;
+        pthread_mutex_lock(&pool_lock);
+        unsigned long generation = next_to_refill(&spec);
+        pthread_mutex_unlock(&pool_lock);
+        if (generation == 0) break;
+
+        // Drawn outside pool_lock: CREATE keeps taking variants meanwhile
+        unsigned long version = catalog_version();
+        ExamVariant *v = calloc(1, sizeof(ExamVariant));
+        if (!v) break;
+        v->count = catalog_sample(spec.topic_filter[0] ? spec.topic_filter : NULL,
+                                  spec.diff_filter[0] ? spec.diff_filter : NULL,
+                                  v->questions, spec.num_questions, &v->arena);
+
+        pthread_mutex_lock(&pool_lock);
+        ExamTemplate *t = template_find(spec.name);
+        int kept = 0;
+        if (t && t->generation == generation) {
+            if (v->count <= 0) {
+                t->starved = 1;
+                t->starved_version = version;
+            } else if (t->ready_count < t->spec.pool_size) {
+                t->ready[t->ready_count++] = v;
+                t->starved = 0;
+                kept = 1;
+            }
+        }
+        pthread_mutex_unlock(&pool_lock);
+        if (!kept) variant_free(v);
+        else added++;
+    }
+    return added;
+}
+
+void exam_pool_wait(int seconds) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += seconds;
+    pthread_mutex_lock(&pool_lock);
+    pthread_cond_timedwait(&pool_wake, &pool_lock, &until);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+int exam_pool_list(ExamPoolInfo *out, int max) {
+    pthread_mutex_lock(&pool_lock);
+    int n = 0;
+    for (int i = 0; i < EXAM_POOL_TEMPLATES && n < max; i++) {
+        if (!templates[i].in_use) continue;
+        out[n].spec = templates[i].spec;
+        out[n].ready = templates[i].ready_count;
+        n++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return n;
+}
@@ -0,0 +1,58 @@
+#ifndef EXAM_POOL_H
+#define EXAM_POOL_H
+
+#include "common.h"
+#include "db_queries.h"
+
+// Pregenerated question sets for CREATE.
+//  - an exam template is a named CREATE spec: question count plus the topic and
+//    difficulty filters, and how many variants to keep ready
+//  - a background thread keeps each template's pool full, drawing every
+//    variant from the catalog (catalog_sample) without the server lock
+//  - CREATE with a template's name, or with a spec equal to a template's, takes
+//    a ready variant: the questions and their strings move to the room, so
+//    creating a room costs no sampling at all
+// A variant whose questions were deleted since it was drawn is discarded on
+// take. Templates are stored through storage; variants live in memory only.
+
+#define EXAM_POOL_TEMPLATES 32         // Templates registered at once
+#define EXAM_POOL_MAX_VARIANTS 64      // Largest pool per template
+
+typedef struct {
+    DBExamTemplate spec;
+    int ready;                         // Variants waiting in the pool
+} ExamPoolInfo;
+
+// Load stored templates (startup, after the catalog). Returns the template count.
+int exam_pool_load(void);
+
+// Register or replace a template (caller holds the server lock). Returns 1 when
+// added, 2 when replaced (its pool is refilled), 0 when all slots are taken,
+// -1 when storage failed.
+int exam_pool_register(const DBExamTemplate *spec, int created_by);
+
+// Drop a template and its pool (caller holds the server lock). Returns 1,
+// 0 if unknown, -1 when storage failed.
+int exam_pool_drop(const char *name);
+
+// Resolve a CREATE spec: with spec->name set, fill the rest from that template;
+// else look for a template with the same count and filters and fill its name.
+// Returns 1 if a template was found.
+int exam_pool_find(DBExamTemplate *spec);
+
+// Move a ready variant of the named template into out[]; arena, which must be
+// empty, takes over its strings. Returns the question count, 0 when the pool
+// is empty.
+int exam_pool_take(const char *name, Question *out, Arena *arena);
+
+// Draw up to max_variants missing variants. Returns the number added,
+// 0 when every pool is full (or cannot be filled from the current bank).
+int exam_pool_refill(int max_variants);
+
+// Sleep until a pool needs refilling or seconds pass
+void exam_pool_wait(int seconds);
+
+// Templates with their pool levels; returns the number written
+int exam_pool_list(ExamPoolInfo *out, int max);
+
+#endif // EXAM_POOL_H
@@ -0,0 +1,378 @@
+#include "export.h"
+#include "archive.h"
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define SPOOL_BUF 4096
+#define DICT_INITIAL 256
+
+// ===== COLUMN SPOOLS =====
+
+// One column being written: buffered appends to an anonymous temp file
+typedef struct {
+    const char *name;
+    int type;
+    FILE *fp;
+    unsigned char buf[SPOOL_BUF];
+    size_t used;
+    uint64_t bytes;
+    uint32_t bits;        // Pending bit-packed values
+    int bit_count;
+} Spool;
+
+static int spool_open(Spool *s, const char *name, int type) {
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->type = type;
+    s->fp = tmpfile();
+    return s->fp != NULL;
+}
+
+static void spool_flush(Spool *s) {
+    if (s->used > 0) fwrite(s->buf, 1, s->used, s->fp);
+    s->used = 0;
+}
+
+static void spool_write(Spool *s, const void *data, size_t n) {
+    const unsigned char *p = data;
+    s->bytes += n;
+    while (n > 0) {
+        size_t room = SPOOL_BUF - s->used;
+        size_t chunk = n < room ? n : room;
+        memcpy(s->buf + s->used, p, chunk);
+        s->used += chunk;
+        p += chunk;
+        n -= chunk;
+        if (s->used == SPOOL_BUF) spool_flush(s);
+    }
+}
+
+static void spool_put_u32(Spool *s, uint32_t v) {
+    unsigned char b[4] = { v, v >> 8, v >> 16, v >> 24 };
+    spool_write(s, b, 4);
+}
+
+static void spool_put_i64(Spool *s, int64_t v) {
+    uint64_t u = (uint64_t)v;
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++) b[i] = u >> (8 * i);
+    spool_write(s, b, 8);
+}
+
+// Append an nbits-wide value, LSB-first
+static void spool_put_bits(Spool *s, unsigned value, int nbits) {
+    s->bits |= (value & ((1u << nbits) - 1)) << s->bit_count;
+    s->bit_count += nbits;
+    while (s->bit_count >= 8) {
+        unsigned char b = s->bits & 0xFF;
+        spool_write(s, &b, 1);
+        s->bits >>= 8;
+        s->bit_count -= 8;
+    }
+}
+
+static void spool_finish(Spool *s) {
+    if (s->bit_count > 0) {
+        unsigned char b = s->bits & 0xFF;
+        spool_write(s, &b, 1);
+        s->bits = 0;
+        s->bit_count = 0;
+    }
+    spool_flush(s);
+}
+
+static void spool_close(Spool *s) {
+    if (s->fp) fclose(s->fp);
+    s->fp = NULL;
+}
+
+// ===== USERNAME DICTIONARY =====
+
+typedef struct {
+    char **names;          // Open-addressing table of owned strings
+    uint32_t *codes;
+    int cap;
+    int count;
+    Spool *values;         // Dictionary strings, in code order
+} UserDict;
+
+static unsigned hash_name(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static int dict_grow(UserDict *d) {
+    int cap = d->cap ? d->cap * 2 : DICT_INITIAL;
+    char **names = calloc(cap, sizeof(char*));
+    uint32_t *codes = calloc(cap, sizeof(uint32_t));
+    if (!names || !codes) {
+        free(names);
+        free(codes);
+        return 0;
+    }
+    for (int i = 0; i < d->cap; i++) {
+        if (!d->names[i]) continue;
+        unsigned slot = hash_name(d->names[i]) & (cap - 1);
+        while (names[slot]) slot = (slot + 1) & (cap - 1);
+        names[slot] = d->names[i];
+        codes[slot] = d->codes[i];
+    }
+    free(d->names);
+    free(d->codes);
+    d->names = names;
+    d->codes = codes;
+    d->cap = cap;
+    return 1;
+}
+
+// Code for a username, appending it to the dictionary on first sight
+static uint32_t dict_code(UserDict *d, const char *name) {
+    if (!name) name = "";
+    if (d->count * 2 >= d->cap && !dict_grow(d)) return 0;
+
+    unsigned slot = hash_name(name) & (d->cap - 1);
+    while (d->names[slot]) {
+        if (strcmp(d->names[slot], name) == 0) return d->codes[slot];
+        slot = (slot + 1) & (d->cap - 1);
+    }
+    uint32_t len = strlen(name);
+    d->names[slot] = malloc(len + 1);
+    if (!d->names[slot]) return 0;
+    memcpy(d->names[slot], name, len + 1);
+    d->codes[slot] = d->count;
+    spool_put_u32(d->values, len);
+    spool_write(d->values, name, len);
+    return d->count++;
+}
+
+static void dict_free(UserDict *d) {
+    for (int i = 0; i < d->cap; i++) free(d->names[i]);
+    free(d->names);
+    free(d->codes);
+}
+
+// ===== FILE ASSEMBLY =====
+
+static void write_u32(FILE *out, uint32_t v) {
+    unsigned char b[4] = { v, v >> 8, v >> 16, v >> 24 };
+    fwrite(b, 1, 4, out);
+}
+
+static void write_name(FILE *out, const char *name) {
+    char padded[16] = {0};
+    strncpy(padded, name, sizeof(padded) - 1);
+    fwrite(padded, 1, sizeof(padded), out);
+}
+
+static int write_table(FILE *out, const char *name, int rows, Spool *cols, int ncols) {
+    write_name(out, name);
+    write_u32(out, rows);
+    write_u32(out, ncols);
+    for (int c = 0; c < ncols; c++) {
+        Spool *s = &cols[c];
+        spool_finish(s);
+        write_name(out, s->name);
+        write_u32(out, s->type);
+        write_u32(out, 0);
+        unsigned char len[8];
+        for (int i = 0; i < 8; i++) len[i] = s->bytes >> (8 * i);
+        fwrite(len, 1, 8, out);
+
+        rewind(s->fp);
+        unsigned char block[SPOOL_BUF];
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), s->fp)) > 0) {
+            if (fwrite(block, 1, n, out) != n) return 0;
+        }
+    }
+    return !ferror(out);
+}
+
+// ===== EXPORT =====
+
+// Row filter shared by the three queries: ?1 room name, ?2 since, ?3 until
+#define FILTER_ROOM(col) "(?1 IS NULL OR " col " IN (SELECT id FROM rooms WHERE name = ?1)) "
+#define FILTER_TIME(col) "AND (?2 IS NULL OR " col " >= datetime(?2)) AND (?3 IS NULL OR " col " < datetime(?3)) "
+
+static sqlite3_stmt *prepare_filtered(sqlite3 *conn, const char *query, const ExportFilter *f) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Export query error: %s\n", sqlite3_errmsg(conn));
+        return NULL;
+    }
+    if (f->room_name) sqlite3_bind_text(stmt, 1, f->room_name, -1, SQLITE_STATIC);
+    if (f->since) sqlite3_bind_text(stmt, 2, f->since, -1, SQLITE_STATIC);
+    if (f->until) sqlite3_bind_text(stmt, 3, f->until, -1, SQLITE_STATIC);
+    return stmt;
+}
+
+static int export_participants(sqlite3 *conn, const ExportFilter *f, UserDict *dict, FILE *out, int *rows) {
+    const char *query =
+        "SELECT p.id, p.room_id, u.username, "
+        "COALESCE(strftime('%s', p.joined_at), 0), COALESCE(strftime('%s', p.submitted_at), 0) "
+        "FROM participants p JOIN users u ON p.user_id = u.id "
+        "WHERE " FILTER_ROOM("p.room_id") FILTER_TIME("p.joined_at") "ORDER BY p.id";
+    Spool cols[5];
+    const char *names[] = { "id", "room_id", "user", "joined_at", "submitted_at" };
+    const int types[] = { EXPORT_COL_I32, EXPORT_COL_I32, EXPORT_COL_DICT, EXPORT_COL_I64, EXPORT_COL_I64 };
+    int opened = 0;
+    for (; opened < 5; opened++) if (!spool_open(&cols[opened], names[opened], types[opened])) break;
+
+    sqlite3_stmt *stmt = opened == 5 ? prepare_filtered(conn, query, f) : NULL;
+    int ok = stmt != NULL;
+    *rows = 0;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        spool_put_u32(&cols[0], sqlite3_column_int(stmt, 0));
+        spool_put_u32(&cols[1], sqlite3_column_int(stmt, 1));
+        spool_put_u32(&cols[2], dict_code(dict, (const char*)sqlite3_column_text(stmt, 2)));
+        spool_put_i64(&cols[3], sqlite3_column_int64(stmt, 3));
+        spool_put_i64(&cols[4], sqlite3_column_int64(stmt, 4));
+        (*rows)++;
+    }
+    sqlite3_finalize(stmt);
+    if (ok) ok = write_table(out, "participants", *rows, cols, 5);
+    for (int i = 0; i < opened; i++) spool_close(&cols[i]);
+    return ok;
+}
+
+// Results and answers may live partly in archived months: each source schema
+// (archives oldest first, then main) is read in turn into the same spools
+static int export_result_rows(sqlite3 *conn, const ExportFilter *f, char schemas[][16], int sources,
+                              UserDict *dict, FILE *out, int *rows) {
+    const char *format =
+        "SELECT r.participant_id, r.room_id, u.username, r.score, r.total_questions, "
+        "r.correct_answers, COALESCE(strftime('%%s', r.submitted_at), 0) "
+        "FROM %s.results r JOIN participants p ON r.participant_id = p.id JOIN users u ON p.user_id = u.id "
+        "WHERE " FILTER_ROOM("r.room_id") FILTER_TIME("r.submitted_at") "ORDER BY r.id";
+    Spool cols[7];
+    const char *names[] = { "participant_id", "room_id", "user", "score", "total", "correct", "submitted_at" };
+    const int types[] = { EXPORT_COL_I32, EXPORT_COL_I32, EXPORT_COL_DICT, EXPORT_COL_I32,
+                          EXPORT_COL_I32, EXPORT_COL_I32, EXPORT_COL_I64 };
+    int opened = 0;
+    for (; opened < 7; opened++) if (!spool_open(&cols[opened], names[opened], types[opened])) break;
+
+    int ok = opened == 7;
+    *rows = 0;
+    for (int s = 0; ok && s < sources; s++) {
+        char query[1024];
+        snprintf(query, sizeof(query), format, schemas[s]);
+        sqlite3_stmt *stmt = prepare_filtered(conn, query, f);
+        ok = stmt != NULL;
+        while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+            spool_put_u32(&cols[0], sqlite3_column_int(stmt, 0));
+            spool_put_u32(&cols[1], sqlite3_column_int(stmt, 1));
+            spool_put_u32(&cols[2], dict_code(dict, (const char*)sqlite3_column_text(stmt, 2)));
+            for (int c = 3; c <= 5; c++) spool_put_u32(&cols[c], sqlite3_column_int(stmt, c));
+            spool_put_i64(&cols[6], sqlite3_column_int64(stmt, 6));
+            (*rows)++;
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (ok) ok = write_table(out, "results", *rows, cols, 7);
+    for (int i = 0; i < opened; i++) spool_close(&cols[i]);
+    return ok;
+}
+
+static int export_answers(sqlite3 *conn, const ExportFilter *f, char schemas[][16], int sources,
+                          FILE *out, int *rows) {
+    const char *format =
+        "SELECT a.participant_id, a.question_id, a.selected_option, a.is_correct "
+        "FROM %s.answer_rows a JOIN participants p ON a.participant_id = p.id "
+        "WHERE " FILTER_ROOM("p.room_id") FILTER_TIME("a.submitted_at")
+        "ORDER BY a.participant_id, a.position";
+    Spool cols[5];
+    const char *names[] = { "participant_id", "question_id", "answer", "answered", "is_correct" };
+    const int types[] = { EXPORT_COL_I32, EXPORT_COL_I32, EXPORT_COL_BITS2, EXPORT_COL_BITS1, EXPORT_COL_BITS1 };
+    int opened = 0;
+    for (; opened < 5; opened++) if (!spool_open(&cols[opened], names[opened], types[opened])) break;
+
+    int ok = opened == 5;
+    *rows = 0;
+    for (int s = 0; ok && s < sources; s++) {
+        char query[1024];
+        snprintf(query, sizeof(query), format, schemas[s]);
+        sqlite3_stmt *stmt = prepare_filtered(conn, query, f);
+        ok = stmt != NULL;
+        while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *sel = (const char*)sqlite3_column_text(stmt, 2);
+            char c = sel ? sel[0] : '.';
+            if (c >= 'a' && c <= 'd') c -= 'a' - 'A';
+            int answered = c >= 'A' && c <= 'D';
+
+            spool_put_u32(&cols[0], sqlite3_column_int(stmt, 0));
+            spool_put_u32(&cols[1], sqlite3_column_int(stmt, 1));
+            spool_put_bits(&cols[2], answered ? c - 'A' : 0, 2);
+            spool_put_bits(&cols[3], answered, 1);
+            spool_put_bits(&cols[4], sqlite3_column_int(stmt, 3) ? 1 : 0, 1);
+            (*rows)++;
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (ok) ok = write_table(out, "answers", *rows, cols, 5);
+    for (int i = 0; i < opened; i++) spool_close(&cols[i]);
+    return ok;
+}
+
+int export_results(const char *db_path, const ExportFilter *filter, const char *out_path,
+                   ExportStats *stats) {
+    ExportFilter none = { NULL, NULL, NULL };
+    if (!filter) filter = &none;
+    ExportStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    sqlite3 *conn = NULL;
+    if (sqlite3_open_v2(db_path, &conn, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Export: cannot open %s: %s\n", db_path, sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return 0;
+    }
+    sqlite3_busy_timeout(conn, 5000);
+
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        perror(out_path);
+        sqlite3_close(conn);
+        return 0;
+    }
+
+    Spool dict_values;
+    UserDict dict = { NULL, NULL, 0, 0, &dict_values };
+    int ok = spool_open(&dict_values, "username", EXPORT_COL_STRINGS);
+
+    fwrite("QCOL1\n\0\0", 1, 8, out);
+    write_u32(out, 4);
+
+    // Archived months overlapping the range are attached next to main
+    char schemas[ARCHIVE_MAX_ATTACHED + 1][16];
+    int archived = archive_attach_range(conn, filter->since, filter->until, schemas, ARCHIVE_MAX_ATTACHED);
+    ok = ok && archived >= 0;
+    int sources = archived >= 0 ? archived : 0;
+    memcpy(schemas[sources++], "main", 5);
+
+    // One read transaction: every table comes from the same snapshot
+    ok = ok && sqlite3_exec(conn, "BEGIN;", NULL, NULL, NULL) == SQLITE_OK;
+    ok = ok && export_participants(conn, filter, &dict, out, &stats->participants);
+    ok = ok && export_result_rows(conn, filter, schemas, sources, &dict, out, &stats->results);
+    ok = ok && export_answers(conn, filter, schemas, sources, out, &stats->answers);
+    sqlite3_exec(conn, "COMMIT;", NULL, NULL, NULL);
+    if (archived >= 0) archive_detach(conn, archived);
+    sqlite3_close(conn);
+
+    stats->users = dict.count;
+    ok = ok && write_table(out, "users", dict.count, &dict_values, 1);
+    stats->bytes = ftell(out);
+
+    spool_close(&dict_values);
+    dict_free(&dict);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Export to %s failed\n", out_path);
+        remove(out_path);
+    }
+    return ok;
+}
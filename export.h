@@ -0,0 +1,51 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+// Columnar export of exam data (participants, results, answers) for offline
+// analysis. Reads through its own read-only connection inside one read
+// transaction, so the export is a consistent snapshot and (in WAL mode) never
+// blocks the exam server's writers. Memory is bounded: every column is spooled
+// to a temporary file through a small buffer and stitched together at the end.
+//
+// File layout (all integers little-endian):
+//   "QCOL1\n\0\0"                          8-byte magic
+//   u32 table_count
+//   per table:  char name[16], u32 row_count, u32 column_count
+//     per column: char name[16], u32 type, u32 reserved, u64 byte_length, data
+//
+// Column types:
+//   EXPORT_COL_I32     int32 per row
+//   EXPORT_COL_I64     int64 per row (timestamps: unix seconds, 0 = NULL)
+//   EXPORT_COL_DICT    uint32 code per row, index into the "users" table
+//   EXPORT_COL_BITS2   2 bits per row, LSB-first (answers: A=0 B=1 C=2 D=3)
+//   EXPORT_COL_BITS1   1 bit per row, LSB-first
+//   EXPORT_COL_STRINGS u32 length + bytes per row (dictionary values)
+//
+// Tables: participants, results, answers, users (the username dictionary).
+
+#define EXPORT_COL_I32 1
+#define EXPORT_COL_I64 2
+#define EXPORT_COL_DICT 3
+#define EXPORT_COL_BITS2 4
+#define EXPORT_COL_BITS1 5
+#define EXPORT_COL_STRINGS 6
+
+typedef struct {
+    const char *room_name;   // NULL = every room
+    const char *since;       // Inclusive lower bound, any SQLite datetime() input; NULL = open
+    const char *until;       // Exclusive upper bound; NULL = open
+} ExportFilter;
+
+typedef struct {
+    int participants;
+    int results;
+    int answers;
+    int users;
+    long bytes;
+} ExportStats;
+
+// Export into out_path. Returns 1 on success, 0 on error (message on stderr).
+int export_results(const char *db_path, const ExportFilter *filter, const char *out_path,
+                   ExportStats *stats);
+
+#endif // EXPORT_H
@@ -0,0 +1,31 @@
+// Standalone columnar export of exam data (see export.h for the file format)
+//
+// Usage: ./export_results <out_file> [room|*] [since] [until] [db_path]
+//   since/until: any SQLite datetime() input, e.g. 2025-01-31 or 2025-01-31T08:00:00
+//   Defaults: every room, no time bounds, test_system.db
+//
+// Safe to run against the live database: it reads one snapshot through its own
+// read-only connection.
+
+#include "export.h"
+#include "common.h"
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <out_file> [room|*] [since] [until] [db_path]\n", argv[0]);
+        return 1;
+    }
+
+    ExportFilter filter = { NULL, NULL, NULL };
+    if (argc > 2 && strcmp(argv[2], "*") != 0) filter.room_name = argv[2];
+    if (argc > 3 && strcmp(argv[3], "*") != 0) filter.since = argv[3];
+    if (argc > 4 && strcmp(argv[4], "*") != 0) filter.until = argv[4];
+    const char *db_path = argc > 5 ? argv[5] : DB_PATH;
+
+    ExportStats stats;
+    if (!export_results(db_path, &filter, argv[1], &stats)) return 1;
+
+    printf("Exported %d participants, %d results, %d answers, %d users -> %s (%ld bytes)\n",
+           stats.participants, stats.results, stats.answers, stats.users, argv[1], stats.bytes);
+    return 0;
+}
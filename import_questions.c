@@ -0,0 +1,481 @@
+// Bulk question importer
+//
+// Loads a pipe-delimited question bank (id|text|A|B|C|D|correct|topic|difficulty,
+// the data/questions.txt format; the id column is ignored) into the database:
+//  - the input is mmap'd and split at line boundaries into one chunk per thread
+//  - chunks are parsed and validated in parallel (validate_question_input rules);
+//    bad lines are reported with their line number and skipped
+//  - rows are inserted by one writer with cached prepared statements, topic ids
+//    interned in a hash map, IMPORT_BATCH rows per transaction
+//  - rows whose content is already in the bank (or earlier in the file) are
+//    skipped and near duplicates reported, using the dedup.h index
+//
+// Usage: ./import_questions <file> [db_path] [threads]   (defaults: test_system.db, nproc)
+// Run it while the server is stopped - the server loads its catalog at startup.
+
+#define _DEFAULT_SOURCE           // madvise() under -std=c11
+#include "common.h"
+#include "dedup.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IMPORT_BATCH 50000        // Rows per transaction
+#define IMPORT_MAX_THREADS 16
+#define IMPORT_FIELDS 9
+#define IMPORT_MAX_ERRORS_SHOWN 20
+#define TOPIC_TABLE_SIZE 4096     // Power of two
+
+// A parsed line: fields are located by offset into the mapping, no copies
+typedef struct {
+    size_t start;                         // Offset of field 0
+    unsigned short len[IMPORT_FIELDS];    // Field lengths (fields are '|'-separated)
+} ParsedRow;
+
+typedef struct {
+    const char *base;
+    size_t begin, end;            // Byte range of this chunk (whole lines)
+    ParsedRow *rows;
+    int row_count, row_cap;
+    int line_count;               // Lines seen, for global line numbers
+    int bad_count;
+    int bad_lines[IMPORT_MAX_ERRORS_SHOWN];
+    char bad_reason[IMPORT_MAX_ERRORS_SHOWN][64];
+    char *scratch;                // NUL-split copy of the line being validated
+    size_t scratch_cap;
+} ParseChunk;
+
+typedef struct {
+    char name[64];
+    int id;
+} TopicSlot;
+
+static TopicSlot topic_table[TOPIC_TABLE_SIZE];
+static int topic_interned = 0;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static const char *field_ptr(const char *base, const ParsedRow *r, int field) {
+    const char *p = base + r->start;
+    for (int i = 0; i < field; i++) p += r->len[i] + 1;
+    return p;
+}
+
+static void reject(ParseChunk *c, int line, const char *reason) {
+    if (c->bad_count < IMPORT_MAX_ERRORS_SHOWN) {
+        c->bad_lines[c->bad_count] = line;
+        snprintf(c->bad_reason[c->bad_count], sizeof(c->bad_reason[0]), "%s", reason);
+    }
+    c->bad_count++;
+}
+
+// ===== PARALLEL PARSE =====
+
+static int parse_line(ParseChunk *c, const char *line, size_t len, ParsedRow *row, char *reason) {
+    const char *fields[IMPORT_FIELDS];
+    size_t lens[IMPORT_FIELDS];
+    int n = 0;
+    const char *f = line;
+    for (size_t i = 0; i <= len && n < IMPORT_FIELDS; i++) {
+        if (i == len || line[i] == '|') {
+            fields[n] = f;
+            lens[n] = (line + i) - f;
+            n++;
+            f = line + i + 1;
+        }
+    }
+    if (n != IMPORT_FIELDS || f <= line + len) {
+        strcpy(reason, "ERROR: Expected 9 '|'-separated fields");
+        return 0;
+    }
+    int too_long = lens[0] > 32;
+    for (int i = 1; i < IMPORT_FIELDS; i++) too_long |= lens[i] > USHRT_MAX;
+    if (too_long) {
+        strcpy(reason, "ERROR: Field too long");
+        return 0;
+    }
+    if (lens[6] != 1) {
+        strcpy(reason, "ERROR: Correct answer must be A, B, C, or D");
+        return 0;
+    }
+
+    // Same rules as ADD_QUESTION, on a Question viewing a NUL-split copy of
+    // fields 1..8 (the correct field's slot stays unused)
+    if (len + 1 > c->scratch_cap) {
+        char *scratch = realloc(c->scratch, len + 1);
+        if (!scratch) {
+            strcpy(reason, "ERROR: Out of memory");
+            return 0;
+        }
+        c->scratch = scratch;
+        c->scratch_cap = len + 1;
+    }
+    unsigned int offs[IMPORT_FIELDS];
+    size_t off = 0;
+    for (int i = 1; i < IMPORT_FIELDS; i++) {
+        offs[i] = (unsigned int)off;
+        memcpy(c->scratch + off, fields[i], lens[i]);
+        c->scratch[off + lens[i]] = '\0';
+        off += lens[i] + 1;
+    }
+    Question q = { .strings = c->scratch, .correct = fields[6][0],
+                   .off = { offs[2], offs[3], offs[4], offs[5], offs[7], offs[8] } };
+    if (!validate_question_input(&q, reason)) return 0;
+
+    row->start = fields[0] - c->base;
+    for (int i = 0; i < IMPORT_FIELDS; i++) row->len[i] = (unsigned short)lens[i];
+    return 1;
+}
+
+static void *parse_chunk(void *arg) {
+    ParseChunk *c = arg;
+    const char *p = c->base + c->begin;
+    const char *end = c->base + c->end;
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *line_end = nl ? nl : end;
+        size_t len = line_end - p;
+        if (len > 0 && p[len - 1] == '\r') len--;
+        c->line_count++;
+
+        if (len > 0) {
+            if (c->row_count == c->row_cap) {
+                int cap = c->row_cap ? c->row_cap * 2 : 4096;
+                ParsedRow *rows = realloc(c->rows, cap * sizeof(ParsedRow));
+                if (!rows) {
+                    reject(c, c->line_count, "ERROR: Out of memory");
+                    break;
+                }
+                c->rows = rows;
+                c->row_cap = cap;
+            }
+            char reason[128];
+            if (parse_line(c, p, len, &c->rows[c->row_count], reason)) {
+                c->row_count++;
+            } else {
+                reject(c, c->line_count, reason);
+            }
+        }
+        p = line_end + 1;
+    }
+    return NULL;
+}
+
+// ===== INSERT =====
+
+static unsigned hash_topic(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+// Topic name -> id, creating the topic on first sight
+static int intern_topic(const char *name, sqlite3_stmt *insert_topic, sqlite3_stmt *select_topic) {
+    unsigned slot = hash_topic(name) & (TOPIC_TABLE_SIZE - 1);
+    while (topic_table[slot].id) {
+        if (strcmp(topic_table[slot].name, name) == 0) return topic_table[slot].id;
+        slot = (slot + 1) & (TOPIC_TABLE_SIZE - 1);
+    }
+    sqlite3_bind_text(insert_topic, 1, name, -1, SQLITE_STATIC);
+    sqlite3_step(insert_topic);
+    sqlite3_reset(insert_topic);
+
+    int id = -1;
+    sqlite3_bind_text(select_topic, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_step(select_topic) == SQLITE_ROW) id = sqlite3_column_int(select_topic, 0);
+    sqlite3_reset(select_topic);
+    if (id <= 0 || topic_interned >= TOPIC_TABLE_SIZE / 2) return id > 0 ? id : -1;
+
+    snprintf(topic_table[slot].name, sizeof(topic_table[slot].name), "%s", name);
+    topic_table[slot].id = id;
+    topic_interned++;
+    return id;
+}
+
+static int difficulty_id(const char *name) {
+    int id = -1;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id FROM difficulties WHERE name = ?", -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) id = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return id;
+}
+
+static void lower_copy(char *dst, size_t size, const char *src, size_t len) {
+    if (len >= size) len = size - 1;
+    for (size_t i = 0; i < len; i++) dst[i] = tolower((unsigned char)src[i]);
+    dst[len] = '\0';
+}
+
+// The full-text insert trigger costs ~4x the row insert itself. Each batch
+// transaction drops it, indexes the batch's rows with one INSERT ... SELECT,
+// and recreates it before COMMIT, so a crash never leaves the index stale.
+static char *fts_trigger_sql = NULL;   // NULL when the FTS index is absent
+
+static void load_fts_trigger(void) {
+    sqlite3_stmt *stmt;
+    const char *query = "SELECT sql FROM sqlite_master WHERE type = 'trigger' AND name = 'trg_questions_fts_insert'";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) return;
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+        fts_trigger_sql = strdup((const char*)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+}
+
+static void begin_batch(void) {
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (fts_trigger_sql) sqlite3_exec(db, "DROP TRIGGER trg_questions_fts_insert;", NULL, NULL, NULL);
+}
+
+static int commit_batch(sqlite3_stmt *fts_fill, sqlite3_int64 first_id) {
+    if (fts_trigger_sql) {
+        if (first_id > 0) {
+            sqlite3_bind_int64(fts_fill, 1, first_id);
+            sqlite3_step(fts_fill);
+            sqlite3_reset(fts_fill);
+        }
+        if (sqlite3_exec(db, fts_trigger_sql, NULL, NULL, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Error restoring full-text trigger: %s\n", sqlite3_errmsg(db));
+            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+            return 0;
+        }
+    }
+    return sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+// NUL-terminated copies of a row's text and options for the dedup index;
+// fields[0..4] point into *buf. Returns 0 when out of memory.
+static int row_strings(const char *base, const ParsedRow *r, char **buf, size_t *cap,
+                       const char *fields[5]) {
+    size_t need = 0;
+    for (int f = 1; f <= 5; f++) need += r->len[f] + 1;
+    if (need > *cap) {
+        char *grown = realloc(*buf, need);
+        if (!grown) return 0;
+        *buf = grown;
+        *cap = need;
+    }
+    size_t off = 0;
+    for (int f = 1; f <= 5; f++) {
+        memcpy(*buf + off, field_ptr(base, r, f), r->len[f]);
+        (*buf)[off + r->len[f]] = '\0';
+        fields[f - 1] = *buf + off;
+        off += r->len[f] + 1;
+    }
+    return 1;
+}
+
+// Insert every parsed row; returns rows inserted, -1 on a fatal database error.
+// Exact duplicates are skipped and counted in *duplicates, near ones in *similar.
+static int insert_rows(const char *base, ParseChunk *chunks, int num_chunks, int *failed,
+                       int *duplicates, int *similar) {
+    int diff_ids[3] = { difficulty_id("easy"), difficulty_id("medium"), difficulty_id("hard") };
+    if (diff_ids[0] < 0 || diff_ids[1] < 0 || diff_ids[2] < 0) {
+        fprintf(stderr, "Error: difficulties table is not initialized\n");
+        return -1;
+    }
+
+    load_fts_trigger();
+    sqlite3_stmt *insert_q = NULL, *insert_topic = NULL, *select_topic = NULL;
+    sqlite3_stmt *fts_fill = NULL;
+    const char *insert_query =
+        "INSERT INTO questions (text, option_a, option_b, option_c, option_d, "
+        "correct_option, topic_id, difficulty_id) VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+    if (sqlite3_prepare_v2(db, insert_query, -1, &insert_q, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO topics (name) VALUES (?)", -1, &insert_topic, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT id FROM topics WHERE name = ?", -1, &select_topic, NULL) != SQLITE_OK ||
+        (fts_trigger_sql && sqlite3_prepare_v2(db,
+            "INSERT INTO questions_fts (rowid, text, option_a, option_b, option_c, option_d) "
+            "SELECT id, text, option_a, option_b, option_c, option_d FROM questions WHERE id >= ?",
+            -1, &fts_fill, NULL) != SQLITE_OK)) {
+        fprintf(stderr, "Error preparing import statements: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(insert_q);
+        sqlite3_finalize(insert_topic);
+        sqlite3_finalize(select_topic);
+        free(fts_trigger_sql);
+        return -1;
+    }
+
+    int inserted = 0, in_batch = 0, ok = 1;
+    sqlite3_int64 batch_first_id = 0;
+    char *strings = NULL;
+    size_t strings_cap = 0;
+    begin_batch();
+    for (int c = 0; c < num_chunks && ok; c++) {
+        for (int i = 0; i < chunks[c].row_count && ok; i++) {
+            const ParsedRow *r = &chunks[c].rows[i];
+            char topic[64], difficulty[32], correct[2];
+            lower_copy(topic, sizeof(topic), field_ptr(base, r, 7), r->len[7]);
+            lower_copy(difficulty, sizeof(difficulty), field_ptr(base, r, 8), r->len[8]);
+            correct[0] = toupper((unsigned char)*field_ptr(base, r, 6));
+            correct[1] = '\0';
+
+            int topic_id = intern_topic(topic, insert_topic, select_topic);
+            int diff_id = diff_ids[difficulty[0] == 'e' ? 0 : difficulty[0] == 'm' ? 1 : 2];
+            if (topic_id < 0) {
+                (*failed)++;
+                continue;
+            }
+
+            const char *fields[5];
+            DedupMatch dup = {0};
+            if (!row_strings(base, r, &strings, &strings_cap, fields)) {
+                (*failed)++;
+                continue;
+            }
+            if (dedup_find(fields[0], fields[1], fields[2], fields[3], fields[4],
+                           DEDUP_NEAR_PERCENT, &dup) && dup.exact_id) {
+                (*duplicates)++;
+                continue;
+            }
+
+            // Text fields are bound straight out of the mapping
+            for (int f = 1; f <= 5; f++) {
+                sqlite3_bind_text(insert_q, f, field_ptr(base, r, f), r->len[f], SQLITE_STATIC);
+            }
+            sqlite3_bind_text(insert_q, 6, correct, 1, SQLITE_STATIC);
+            sqlite3_bind_int(insert_q, 7, topic_id);
+            sqlite3_bind_int(insert_q, 8, diff_id);
+
+            if (sqlite3_step(insert_q) == SQLITE_DONE) {
+                int new_id = (int)sqlite3_last_insert_rowid(db);
+                if (!batch_first_id) batch_first_id = new_id;
+                dedup_on_question_added(new_id, fields[0], fields[1], fields[2], fields[3], fields[4]);
+                if (dup.near_id && (*similar)++ < IMPORT_MAX_ERRORS_SHOWN) {
+                    printf("  question %d is %d%% similar to question %d\n", new_id, dup.similarity, dup.near_id);
+                }
+                inserted++;
+            } else {
+                (*failed)++;
+            }
+            sqlite3_reset(insert_q);
+
+            if (++in_batch == IMPORT_BATCH) {
+                ok = commit_batch(fts_fill, batch_first_id);
+                if (!ok) break;
+                printf("  inserted %d rows\n", inserted);
+                in_batch = 0;
+                batch_first_id = 0;
+                begin_batch();
+            }
+        }
+    }
+    if (ok) ok = commit_batch(fts_fill, batch_first_id);
+    if (!ok) inserted = -1;
+
+    sqlite3_finalize(insert_q);
+    sqlite3_finalize(insert_topic);
+    sqlite3_finalize(select_topic);
+    sqlite3_finalize(fts_fill);
+    free(fts_trigger_sql);
+    free(strings);
+    return inserted;
+}
+
+// ===== MAIN =====
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [db_path] [threads]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    const char *db_path = argc > 2 ? argv[2] : DB_PATH;
+    int threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > IMPORT_MAX_THREADS) threads = IMPORT_MAX_THREADS;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "Error: %s is empty or unreadable\n", path);
+        close(fd);
+        return 1;
+    }
+    size_t size = st.st_size;
+    const char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise((void*)base, size, MADV_SEQUENTIAL);
+
+    if (!db_init(db_path) || !db_create_tables() || !db_init_default_difficulties()) {
+        fprintf(stderr, "Failed to initialize database %s\n", db_path);
+        return 1;
+    }
+
+    // Split into chunks that end on a newline
+    ParseChunk chunks[IMPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    size_t pos = 0;
+    int num_chunks = 0;
+    for (int t = 0; t < threads && pos < size; t++) {
+        size_t end = (t == threads - 1) ? size : pos + (size - pos) / (threads - t);
+        if (end <= pos) end = pos + 1;
+        while (end < size && base[end - 1] != '\n') end++;
+        chunks[num_chunks].base = base;
+        chunks[num_chunks].begin = pos;
+        chunks[num_chunks].end = end;
+        num_chunks++;
+        pos = end;
+    }
+
+    double t0 = now_ms();
+    pthread_t tids[IMPORT_MAX_THREADS];
+    for (int t = 0; t < num_chunks; t++) pthread_create(&tids[t], NULL, parse_chunk, &chunks[t]);
+    for (int t = 0; t < num_chunks; t++) pthread_join(tids[t], NULL);
+    double t_parse = now_ms() - t0;
+
+    int parsed = 0, bad = 0, line_base = 0;
+    for (int t = 0; t < num_chunks; t++) {
+        for (int i = 0; i < chunks[t].bad_count && i < IMPORT_MAX_ERRORS_SHOWN; i++) {
+            fprintf(stderr, "Line %d: %s\n", line_base + chunks[t].bad_lines[i], chunks[t].bad_reason[i]);
+        }
+        parsed += chunks[t].row_count;
+        bad += chunks[t].bad_count;
+        line_base += chunks[t].line_count;
+    }
+    printf("Parsed %d valid rows, %d rejected (%d threads, %.0f ms)\n", parsed, bad, num_chunks, t_parse);
+
+    double t1 = now_ms();
+    int failed = 0, duplicates = 0, similar = 0;
+    int indexed = dedup_rebuild();
+    if (indexed > 0) printf("Indexed %d existing questions for duplicate checks\n", indexed);
+    int inserted = insert_rows(base, chunks, num_chunks, &failed, &duplicates, &similar);
+    double t_insert = now_ms() - t1;
+    double t_total = now_ms() - t0;
+
+    for (int t = 0; t < num_chunks; t++) {
+        free(chunks[t].rows);
+        free(chunks[t].scratch);
+    }
+    munmap((void*)base, size);
+    db_close();
+
+    if (inserted < 0) return 1;
+    printf("Inserted %d questions (%d failed) in %.0f ms\n", inserted, failed, t_insert);
+    printf("Skipped %d exact duplicates, %d inserted questions are near duplicates\n", duplicates, similar);
+    printf("Throughput: %.0f rows/sec overall (parse %.0f rows/sec, insert %.0f rows/sec)\n",
+           t_total > 0 ? inserted / (t_total / 1000.0) : 0.0,
+           t_parse > 0 ? parsed / (t_parse / 1000.0) : 0.0,
+           t_insert > 0 ? inserted / (t_insert / 1000.0) : 0.0);
+    return bad > 0 || failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,181 @@
+#include "item_stats.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+
+typedef struct {
+    DBItemStats s;
+    int dirty;                 // Queued for the next snapshot
+} ItemEntry;
+
+static ItemEntry **items = NULL;   // Indexed by question id
+static int item_cap = 0;
+
+// Questions changed since the last snapshot
+static int *dirty_ids = NULL;
+static int dirty_count = 0;
+static int dirty_cap = 0;
+
+static pthread_mutex_t item_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== ENTRIES (caller holds item_lock) =====
+
+static ItemEntry *entry_get(int question_id, int create) {
+    if (question_id <= 0) return NULL;
+    if (question_id >= item_cap) {
+        if (!create) return NULL;
+        int new_cap = item_cap ? item_cap : 1024;
+        while (new_cap <= question_id) new_cap *= 2;
+        ItemEntry **grown = realloc(items, new_cap * sizeof(ItemEntry*));
+        if (!grown) return NULL;
+        memset(grown + item_cap, 0, (new_cap - item_cap) * sizeof(ItemEntry*));
+        items = grown;
+        item_cap = new_cap;
+    }
+    if (!items[question_id] && create) {
+        items[question_id] = calloc(1, sizeof(ItemEntry));
+        if (items[question_id]) items[question_id]->s.question_id = question_id;
+    }
+    return items[question_id];
+}
+
+static void mark_dirty(ItemEntry *e) {
+    if (e->dirty) return;
+    if (dirty_count == dirty_cap) {
+        int new_cap = dirty_cap ? dirty_cap * 2 : 256;
+        int *grown = realloc(dirty_ids, new_cap * sizeof(int));
+        if (!grown) return;            // Retried on the question's next answer
+        dirty_ids = grown;
+        dirty_cap = new_cap;
+    }
+    dirty_ids[dirty_count++] = e->s.question_id;
+    e->dirty = 1;
+}
+
+// ===== LOADING =====
+
+static void load_item(const DBItemStats *item, void *ctx) {
+    int *loaded = ctx;
+    ItemEntry *e = entry_get(item->question_id, 1);
+    if (!e) return;
+    e->s = *item;
+    (*loaded)++;
+}
+
+int item_stats_load(void) {
+    pthread_mutex_lock(&item_lock);
+    int loaded = 0;
+    storage->for_each_item_stats(load_item, &loaded);
+    pthread_mutex_unlock(&item_lock);
+    return loaded;
+}
+
+// ===== WRITE-THROUGH HOOK =====
+
+void item_stats_on_answers(int count, const int *question_ids, const char *selected,
+                           const int *is_correct) {
+    if (count <= 0) return;
+    int score = 0;
+    for (int i = 0; i < count; i++) score += is_correct[i] ? 1 : 0;
+
+    pthread_mutex_lock(&item_lock);
+    for (int i = 0; i < count; i++) {
+        ItemEntry *e = entry_get(question_ids[i], 1);
+        if (!e) continue;
+        DBItemStats *s = &e->s;
+
+        int choice = toupper((unsigned char)selected[i]) - 'A';
+        s->choices[choice >= 0 && choice < 4 ? choice : 4]++;
+
+        // Item score against the rest score, so the item is not correlated with itself
+        double x = is_correct[i] ? 1.0 : 0.0;
+        double y = count > 1 ? (score - x) / (count - 1) : 0.0;
+        s->attempts++;
+        if (is_correct[i]) s->correct++;
+        double dx = x - s->mean_item;
+        double dy = y - s->mean_rest;
+        s->mean_item += dx / s->attempts;
+        s->mean_rest += dy / s->attempts;
+        s->m2_item += dx * (x - s->mean_item);
+        s->m2_rest += dy * (y - s->mean_rest);
+        s->co_moment += dx * (y - s->mean_rest);
+        mark_dirty(e);
+    }
+    pthread_mutex_unlock(&item_lock);
+}
+
+// ===== QUERIES =====
+
+int item_stats_get(int question_id, ItemSummary *out) {
+    pthread_mutex_lock(&item_lock);
+    ItemEntry *e = entry_get(question_id, 0);
+    int found = e && e->s.attempts > 0;
+    if (found) {
+        const DBItemStats *s = &e->s;
+        out->attempts = s->attempts;
+        out->correct = s->correct;
+        memcpy(out->choices, s->choices, sizeof(out->choices));
+        out->p_value = (double)s->correct / s->attempts;
+        out->has_discrimination = s->m2_item > 1e-12 && s->m2_rest > 1e-12;
+        out->discrimination = out->has_discrimination
+                              ? s->co_moment / sqrt(s->m2_item * s->m2_rest) : 0.0;
+    }
+    pthread_mutex_unlock(&item_lock);
+    return found;
+}
+
+const char *item_stats_flag(const ItemSummary *s, char correct) {
+    if (s->attempts < ITEM_STATS_MIN_ATTEMPTS) return "";
+    if (s->has_discrimination && s->discrimination < 0) return "negative discrimination";
+
+    int key = toupper((unsigned char)correct) - 'A';
+    if (key >= 0 && key < 4) {
+        for (int c = 0; c < 4; c++) {
+            if (c != key && s->choices[c] > s->choices[key]) return "distractor beats key";
+        }
+    }
+    if (s->has_discrimination && s->discrimination < 0.2) return "low discrimination";
+    if (s->p_value < 0.25) return "harder than guessing";
+    if (s->p_value > 0.95) return "too easy";
+    for (int c = 0; c < 4; c++) {
+        if (c != key && s->choices[c] == 0) return "unused distractor";
+    }
+    return "";
+}
+
+// ===== SNAPSHOTS =====
+
+int item_stats_snapshot(void) {
+    pthread_mutex_lock(&item_lock);
+    int count = dirty_count;
+    DBItemStats *batch = count > 0 ? malloc(count * sizeof(DBItemStats)) : NULL;
+    if (count > 0 && !batch) {
+        pthread_mutex_unlock(&item_lock);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        ItemEntry *e = entry_get(dirty_ids[i], 0);
+        batch[i] = e->s;
+        e->dirty = 0;
+    }
+    dirty_count = 0;
+    pthread_mutex_unlock(&item_lock);
+
+    if (count == 0) return 0;
+    int ok = storage->save_item_stats(count, batch);
+    if (!ok) {
+        // Requeue; the rows are rewritten with whatever they hold by then
+        pthread_mutex_lock(&item_lock);
+        for (int i = 0; i < count; i++) {
+            ItemEntry *e = entry_get(batch[i].question_id, 0);
+            if (e) mark_dirty(e);
+        }
+        pthread_mutex_unlock(&item_lock);
+    }
+    free(batch);
+    return ok ? count : -1;
+}
@@ -0,0 +1,43 @@
+#ifndef ITEM_STATS_H
+#define ITEM_STATS_H
+
+// Streaming item statistics, O(1) state per question:
+//  - p-value: share of attempts answered correctly
+//  - discrimination: point-biserial correlation between the item score (0/1)
+//    and the rest score (the submission's share correct on its other
+//    questions), from Welford running means and co-moments
+//  - distractor frequencies: how often each of A-D (and blank) was picked
+// Kept in sync write-through: each storage engine's record_answers calls
+// item_stats_on_answers() after a successful write, so an exam's items can be
+// watched while it runs. item_stats_snapshot() writes changed questions to the
+// item_stats table; item_stats_load() resumes from it at startup.
+
+#define ITEM_STATS_MIN_ATTEMPTS 20     // Attempts before an item is flagged
+
+typedef struct {
+    int attempts;
+    int correct;
+    int choices[5];                    // A, B, C, D, blank/other
+    double p_value;                    // correct / attempts
+    double discrimination;             // Point-biserial vs rest score; 0 until defined
+    int has_discrimination;            // 0 while either score has no variance yet
+} ItemSummary;
+
+// Load the last snapshot (startup). Returns the number of questions loaded.
+int item_stats_load(void);
+
+// Write-through hook: one submission, selected letters as stored
+void item_stats_on_answers(int count, const int *question_ids, const char *selected,
+                           const int *is_correct);
+
+// Returns 1 and fills out if the question has been answered, else 0
+int item_stats_get(int question_id, ItemSummary *out);
+
+// Short review flags for an item ("" when fine or too few attempts)
+const char *item_stats_flag(const ItemSummary *s, char correct);
+
+// Write questions changed since the last snapshot (caller holds the server
+// lock). Returns the number written, -1 on failure (they stay queued).
+int item_stats_snapshot(void);
+
+#endif // ITEM_STATS_H
@@ -0,0 +1,227 @@
+#include "leaderboard.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define BOARD_BUCKETS 256
+
+typedef struct {
+    char username[64];
+    int score;
+    int total;
+    long seq;              // Submission order, earlier submissions win ties
+} LeaderEntry;
+
+// Each room keeps a bounded min-heap: the root is the weakest entry on the board,
+// so a new result only has to beat the root to get in.
+typedef struct RoomBoard {
+    int room_id;
+    char room_name[64];
+    LeaderEntry heap[LEADERBOARD_TOP_K];
+    int size;
+    struct RoomBoard *next;
+    struct RoomBoard *name_next;   // Chain in name_buckets
+} RoomBoard;
+
+static RoomBoard *buckets[BOARD_BUCKETS];          // By room id
+static RoomBoard *name_buckets[BOARD_BUCKETS];     // By room name
+static long next_seq = 0;
+static pthread_mutex_t board_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== HEAP HELPERS =====
+
+// 1 if a ranks below b (lower score, or same score submitted later)
+static int ranks_below(const LeaderEntry *a, const LeaderEntry *b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->seq > b->seq;
+}
+
+static void swap_entries(LeaderEntry *a, LeaderEntry *b) {
+    LeaderEntry tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void sift_up(RoomBoard *b, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ranks_below(&b->heap[i], &b->heap[parent])) break;
+        swap_entries(&b->heap[i], &b->heap[parent]);
+        i = parent;
+    }
+}
+
+static void sift_down(RoomBoard *b, int i) {
+    while (1) {
+        int left = 2 * i + 1, right = left + 1, lowest = i;
+        if (left < b->size && ranks_below(&b->heap[left], &b->heap[lowest])) lowest = left;
+        if (right < b->size && ranks_below(&b->heap[right], &b->heap[lowest])) lowest = right;
+        if (lowest == i) break;
+        swap_entries(&b->heap[i], &b->heap[lowest]);
+        i = lowest;
+    }
+}
+
+// Best first, for display
+static int compare_best_first(const void *a, const void *b) {
+    const LeaderEntry *ea = a, *eb = b;
+    if (ranks_below(ea, eb)) return 1;
+    if (ranks_below(eb, ea)) return -1;
+    return 0;
+}
+
+// ===== BOARD LOOKUP (caller holds board_lock) =====
+
+static unsigned hash_name(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static RoomBoard *find_board(int room_id) {
+    for (RoomBoard *b = buckets[(unsigned)room_id % BOARD_BUCKETS]; b; b = b->next) {
+        if (b->room_id == room_id) return b;
+    }
+    return NULL;
+}
+
+static RoomBoard *get_or_create_board(int room_id, const char *room_name) {
+    RoomBoard *b = find_board(room_id);
+    if (b) return b;
+
+    b = calloc(1, sizeof(RoomBoard));
+    if (!b) return NULL;
+    b->room_id = room_id;
+    snprintf(b->room_name, sizeof(b->room_name), "%s", room_name ? room_name : "");
+
+    unsigned slot = (unsigned)room_id % BOARD_BUCKETS;
+    b->next = buckets[slot];
+    buckets[slot] = b;
+    slot = hash_name(b->room_name) % BOARD_BUCKETS;
+    b->name_next = name_buckets[slot];
+    name_buckets[slot] = b;
+    return b;
+}
+
+static void record_locked(int room_id, const char *room_name, const char *username,
+                          int score, int total) {
+    RoomBoard *b = get_or_create_board(room_id, room_name);
+    if (!b) return;
+
+    LeaderEntry e;
+    snprintf(e.username, sizeof(e.username), "%s", username);
+    e.score = score;
+    e.total = total;
+    e.seq = next_seq++;
+
+    if (b->size < LEADERBOARD_TOP_K) {
+        b->heap[b->size] = e;
+        sift_up(b, b->size);
+        b->size++;
+    } else if (ranks_below(&b->heap[0], &e)) {
+        b->heap[0] = e;
+        sift_down(b, 0);
+    }
+}
+
+// ===== PUBLIC API =====
+
+void leaderboard_record(int room_id, const char *room_name, const char *username,
+                        int score, int total) {
+    if (room_id <= 0 || !username) return;
+    pthread_mutex_lock(&board_lock);
+    record_locked(room_id, room_name, username, score, total);
+    pthread_mutex_unlock(&board_lock);
+}
+
+static void rebuild_row(int room_id, const char *room_name, const char *username,
+                        int score, int total, void *ctx) {
+    int *loaded = ctx;
+    record_locked(room_id, room_name, username, score, total);
+    (*loaded)++;
+}
+
+int leaderboard_rebuild(void) {
+    pthread_mutex_lock(&board_lock);
+    for (int i = 0; i < BOARD_BUCKETS; i++) {
+        while (buckets[i]) {
+            RoomBoard *next = buckets[i]->next;
+            free(buckets[i]);
+            buckets[i] = next;
+        }
+        name_buckets[i] = NULL;
+    }
+    next_seq = 0;
+
+    int loaded = 0;
+    storage->for_each_result(rebuild_row, &loaded);
+    pthread_mutex_unlock(&board_lock);
+    return loaded;
+}
+
+void leaderboard_remove_room(int room_id) {
+    pthread_mutex_lock(&board_lock);
+    RoomBoard *dead = NULL;
+    RoomBoard **link = &buckets[(unsigned)room_id % BOARD_BUCKETS];
+    while (*link) {
+        if ((*link)->room_id == room_id) {
+            dead = *link;
+            *link = dead->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    if (dead) {
+        link = &name_buckets[hash_name(dead->room_name) % BOARD_BUCKETS];
+        while (*link != dead) link = &(*link)->name_next;
+        *link = dead->name_next;
+        free(dead);
+    }
+    pthread_mutex_unlock(&board_lock);
+}
+
+int leaderboard_find_room(const char *room_name) {
+    if (!room_name) return -1;
+    int room_id = -1;
+    pthread_mutex_lock(&board_lock);
+    for (RoomBoard *b = name_buckets[hash_name(room_name) % BOARD_BUCKETS]; b; b = b->name_next) {
+        if (b->room_id > room_id && strcmp(b->room_name, room_name) == 0) room_id = b->room_id;
+    }
+    pthread_mutex_unlock(&board_lock);
+    return room_id;
+}
+
+int leaderboard_format(int room_id, char *output, int max_size) {
+    if (!output || max_size <= 0) return -1;
+    output[0] = '\0';
+
+    LeaderEntry sorted[LEADERBOARD_TOP_K];
+    int count;
+
+    pthread_mutex_lock(&board_lock);
+    RoomBoard *b = find_board(room_id);
+    if (!b) {
+        pthread_mutex_unlock(&board_lock);
+        return -1;
+    }
+    count = b->size;
+    memcpy(sorted, b->heap, count * sizeof(LeaderEntry));
+    pthread_mutex_unlock(&board_lock);
+
+    qsort(sorted, count, sizeof(LeaderEntry), compare_best_first);
+
+    int len = 0, written = 0;
+    for (int i = 0; i < count; i++) {
+        int n = snprintf(output + len, max_size - len, "%d. %s - %d/%d\n",
+                         i + 1, sorted[i].username, sorted[i].score, sorted[i].total);
+        if (n < 0 || n >= max_size - len) {
+            output[len] = '\0';
+            break;
+        }
+        len += n;
+        written++;
+    }
+    return written;
+}
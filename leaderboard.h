@@ -0,0 +1,24 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+// Number of entries kept per room (matches the old SQL "LIMIT 100")
+#define LEADERBOARD_TOP_K 100
+
+// Rebuild all per-room boards from the results table (call once at startup)
+int leaderboard_rebuild(void);
+
+// Record a submitted result, O(log K). Safe to call from any thread.
+void leaderboard_record(int room_id, const char *room_name, const char *username,
+                        int score, int total);
+
+// Drop a room's board (room deleted)
+void leaderboard_remove_room(int room_id);
+
+// Look up a room id by name (most recent room wins); -1 if there is no board
+int leaderboard_find_room(const char *room_name);
+
+// Format a room's board as "1. user - score/total\n..." into output.
+// Returns the number of entries written, -1 if the room has no board.
+int leaderboard_format(int room_id, char *output, int max_size);
+
+#endif // LEADERBOARD_H
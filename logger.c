@@ -1,28 +1,276 @@
+#define _DEFAULT_SOURCE  // localtime_r, sched_yield under -std=c11
 #include "common.h"
+#include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #define LOG_FILE "data/logs.txt"
+#define LOG_BATCH_BYTES 65536      // Records gathered per write()
+#define LOG_FLUSH_INTERVAL_MS 50   // Flusher sleep when the ring is empty
+#define LOG_WAKE_EVERY (LOG_RING_SLOTS / 4)  // Producers wake the flusher every this many records
 
-void writeLog(const char *event) {
-    if (!event) return;
+// Bounded MPSC ring: a slot is free for the producer claiming position pos when
+// seq == pos, and ready for the consumer when seq == pos + 1
+typedef struct {
+    atomic_size_t seq;
+    unsigned short len;
+    char data[LOG_RECORD_MAX];
+} LogSlot;
+
+static LogSlot ring[LOG_RING_SLOTS];
+static atomic_size_t enqueue_pos;
+static atomic_size_t dequeue_pos;          // Written by the flusher only
+static atomic_int accepting = 0;
+static atomic_int overflow_policy = LOG_OVERFLOW_DROP;
+static atomic_int file_enabled = 1;
+static pthread_t flusher_tid;
+
+// Only the flusher's idle wait and the occasional wake-up use these; enqueueing is lock-free
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+
+static atomic_ulong stat_records, stat_dropped, stat_blocked;
+static atomic_ulong stat_flushes, stat_bytes, stat_rotations;
+
+// Flusher-owned output state
+static int log_fd = -1;
+static long log_size = 0;
+static long rotate_limit = 0;
+static char batch[LOG_BATCH_BYTES];
+
+// "YYYY-mm-dd HH:MM:SS", reformatted at most once per second per thread
+static const char *log_timestamp(void) {
+    static _Thread_local time_t cached_sec = -1;
+    static _Thread_local char cached[32];
+    time_t now = time(NULL);
+    if (now != cached_sec) {
+        struct tm t;
+        localtime_r(&now, &t);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &t);
+        cached_sec = now;
+    }
+    return cached;
+}
+
+static int format_record(char *out, size_t size, const char *event) {
+    int len = snprintf(out, size, "%s - %s\n", log_timestamp(), event);
+    if (len < 0) return 0;
+    if ((size_t)len >= size) {
+        len = (int)size - 1;
+        out[len - 1] = '\n';
+    }
+    return len;
+}
+
+static int open_log_file(void) {
+    mkdir("data", 0700);
+    log_fd = open(LOG_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log_fd < 0) return 0;
+    struct stat st;
+    log_size = (fstat(log_fd, &st) == 0) ? (long)st.st_size : 0;
+    return 1;
+}
+
+// logs.txt.(N-1) -> logs.txt.N, ..., logs.txt -> logs.txt.1
+static void rotate_log_file(void) {
+    close(log_fd);
+    char from[64], to[64];
+    for (int i = LOG_ROTATE_KEEP - 1; i >= 1; i--) {
+        snprintf(from, sizeof(from), "%s.%d", LOG_FILE, i);
+        snprintf(to, sizeof(to), "%s.%d", LOG_FILE, i + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", LOG_FILE);
+    rename(LOG_FILE, to);
+    atomic_fetch_add(&stat_rotations, 1);
+    open_log_file();
+}
+
+static void write_batch(size_t len) {
+    if (len == 0) return;
+    if (rotate_limit > 0 && log_size > 0 && log_size + (long)len > rotate_limit) {
+        rotate_log_file();
+    }
+    if (log_fd < 0 && !open_log_file()) return;
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(log_fd, batch + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Log write failed: %s\n", strerror(errno));
+            break;
+        }
+        done += (size_t)n;
+    }
+    log_size += (long)done;
+    atomic_fetch_add(&stat_flushes, 1);
+    atomic_fetch_add(&stat_bytes, done);
+}
+
+// Move every published record into batches; returns the number of records drained
+static int drain_ring(void) {
+    size_t len = 0;
+    int drained = 0;
+    size_t pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+    while (1) {
+        LogSlot *slot = &ring[pos & (LOG_RING_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1) break;
+
+        if (len + slot->len > sizeof(batch)) {
+            write_batch(len);
+            len = 0;
+        }
+        memcpy(batch + len, slot->data, slot->len);
+        len += slot->len;
+        atomic_store_explicit(&slot->seq, pos + LOG_RING_SLOTS, memory_order_release);
+        atomic_store_explicit(&dequeue_pos, ++pos, memory_order_relaxed);
+        drained++;
+    }
+    write_batch(len);
+    return drained;
+}
+
+static void wake_flusher(void) {
+    pthread_mutex_lock(&wake_lock);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+}
+
+static void* flusher_thread(void *arg) {
+    (void)arg;
+    while (atomic_load(&accepting)) {
+        if (drain_ring() > 0) continue;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&wake_lock);
+        pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline);
+        pthread_mutex_unlock(&wake_lock);
+    }
+    // Producers that claimed a slot before accepting dropped still publish it
+    while (atomic_load(&dequeue_pos) != atomic_load(&enqueue_pos)) {
+        if (drain_ring() == 0) sched_yield();
+    }
+    return NULL;
+}
 
-    struct stat st = {0};
-    if (stat("data", &st) == -1) {
-        mkdir("data", 0700);
+int logger_start(int policy, long rotate_bytes) {
+    if (atomic_load(&accepting)) return 1;
+    for (size_t i = 0; i < LOG_RING_SLOTS; i++) atomic_store(&ring[i].seq, i);
+    atomic_store(&enqueue_pos, 0);
+    atomic_store(&dequeue_pos, 0);
+    rotate_limit = rotate_bytes;
+    logger_set_overflow_policy(policy);
+
+    if (!open_log_file()) {
+        fprintf(stderr, "Cannot open %s: %s\n", LOG_FILE, strerror(errno));
+        return 0;
+    }
+    atomic_store(&accepting, 1);
+    if (pthread_create(&flusher_tid, NULL, flusher_thread, NULL) != 0) {
+        atomic_store(&accepting, 0);
+        close(log_fd);
+        log_fd = -1;
+        return 0;
     }
+    return 1;
+}
+
+void logger_stop(void) {
+    if (!atomic_exchange(&accepting, 0)) return;
+    wake_flusher();
+    pthread_join(flusher_tid, NULL);
+    close(log_fd);
+    log_fd = -1;
+}
+
+void logger_set_overflow_policy(int policy) {
+    atomic_store(&overflow_policy, policy == LOG_OVERFLOW_BLOCK ? LOG_OVERFLOW_BLOCK : LOG_OVERFLOW_DROP);
+}
+
+void logger_set_file_enabled(int enabled) {
+    atomic_store(&file_enabled, enabled ? 1 : 0);
+}
 
+int logger_file_enabled(void) {
+    return atomic_load(&file_enabled);
+}
+
+void logger_get_stats(LoggerStats *stats) {
+    stats->records = atomic_load(&stat_records);
+    stats->dropped = atomic_load(&stat_dropped);
+    stats->blocked = atomic_load(&stat_blocked);
+    stats->flushes = atomic_load(&stat_flushes);
+    stats->bytes = atomic_load(&stat_bytes);
+    stats->rotations = atomic_load(&stat_rotations);
+    size_t written = atomic_load(&dequeue_pos);
+    size_t queued = atomic_load(&enqueue_pos);
+    stats->pending = queued > written ? (unsigned long)(queued - written) : 0;
+    stats->overflow_policy = atomic_load(&overflow_policy);
+}
+
+// Synchronous fallback used when the flusher is not running
+static void write_log_direct(const char *event) {
+    mkdir("data", 0700);
     FILE *fp = fopen(LOG_FILE, "a");
     if (!fp) return;
+    char record[LOG_RECORD_MAX];
+    int len = format_record(record, sizeof(record), event);
+    fwrite(record, 1, len, fp);
+    fclose(fp);
+}
 
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timebuf[64];
-    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", t);
+void writeLog(const char *event) {
+    if (!event || !atomic_load(&file_enabled)) return;
+    if (!atomic_load(&accepting)) {
+        write_log_direct(event);
+        return;
+    }
 
-    fprintf(fp, "%s - %s\n", timebuf, event);
-    fclose(fp);
-}
\ No newline at end of file
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    int waited = 0;
+    LogSlot *slot;
+    while (1) {
+        slot = &ring[pos & (LOG_RING_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        long diff = (long)seq - (long)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the slot still holds a record from one lap ago
+            if (atomic_load(&overflow_policy) == LOG_OVERFLOW_DROP) {
+                atomic_fetch_add(&stat_dropped, 1);
+                return;
+            }
+            if (!waited) wake_flusher();
+            waited = 1;
+            sched_yield();
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    slot->len = (unsigned short)format_record(slot->data, sizeof(slot->data), event);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add(&stat_records, 1);
+    if (waited) atomic_fetch_add(&stat_blocked, 1);
+    if ((pos + 1) % LOG_WAKE_EVERY == 0) wake_flusher();
+}
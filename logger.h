@@ -0,0 +1,50 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Asynchronous event log (data/logs.txt).
+// writeLog() formats "YYYY-mm-dd HH:MM:SS - event\n" straight into a slot of a
+// lock-free multi-producer ring buffer and returns; a background flusher thread
+// drains the ring, batching many records into one write() and rotating the file
+// by size (logs.txt -> logs.txt.1 -> ... -> logs.txt.LOG_ROTATE_KEEP).
+// Before logger_start() (and after logger_stop()) writeLog() appends synchronously.
+
+#define LOG_RING_SLOTS 1024        // Power of two
+#define LOG_RECORD_MAX 256         // Longer records are truncated
+#define LOG_ROTATE_KEEP 5          // Rotated files kept
+
+// What writeLog() does when the ring is full
+#define LOG_OVERFLOW_DROP 0        // Discard the record and count it; callers never wait
+#define LOG_OVERFLOW_BLOCK 1       // Wait for the flusher to free a slot; nothing is lost
+
+// Where audit events go; the file sink is this module, the database sink is
+// db_add_log() (db_set_log_enabled). Operators can shed either under load.
+#define LOG_MODE_OFF 0
+#define LOG_MODE_FILE 1
+#define LOG_MODE_DB 2
+#define LOG_MODE_BOTH (LOG_MODE_FILE | LOG_MODE_DB)
+
+typedef struct {
+    unsigned long records;         // Accepted into the ring
+    unsigned long dropped;         // Discarded because the ring was full
+    unsigned long blocked;         // Records that had to wait for a free slot
+    unsigned long flushes;         // write() batches
+    unsigned long bytes;           // Bytes written
+    unsigned long rotations;
+    unsigned long pending;         // Accepted but not yet written
+    int overflow_policy;
+} LoggerStats;
+
+// Start the flusher thread. rotate_bytes <= 0 disables rotation. Returns 1 on success.
+int logger_start(int overflow_policy, long rotate_bytes);
+
+// Drain everything still queued, then stop the flusher
+void logger_stop(void);
+
+void logger_set_overflow_policy(int policy);
+
+// 0 turns writeLog() into a no-op
+void logger_set_file_enabled(int enabled);
+int logger_file_enabled(void);
+void logger_get_stats(LoggerStats *stats);
+
+#endif // LOGGER_H
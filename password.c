@@ -0,0 +1,241 @@
+#include "password.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define RECORD_PREFIX "pbkdf2-sha256$"
+
+// ===== SHA-256 (FIPS 180-4) =====
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;                 // Bytes hashed so far
+    unsigned char block[64];
+    size_t used;
+} Sha256;
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const unsigned char *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void sha256_init(Sha256 *s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(s->state, iv, sizeof(iv));
+    s->length = 0;
+    s->used = 0;
+}
+
+static void sha256_update(Sha256 *s, const unsigned char *data, size_t len) {
+    s->length += len;
+    while (len > 0) {
+        size_t n = 64 - s->used;
+        if (n > len) n = len;
+        memcpy(s->block + s->used, data, n);
+        s->used += n;
+        data += n;
+        len -= n;
+        if (s->used == 64) {
+            sha256_compress(s->state, s->block);
+            s->used = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256 *s, unsigned char out[32]) {
+    uint64_t bits = s->length * 8;
+    s->block[s->used++] = 0x80;
+    if (s->used > 56) {
+        memset(s->block + s->used, 0, 64 - s->used);
+        sha256_compress(s->state, s->block);
+        s->used = 0;
+    }
+    memset(s->block + s->used, 0, 56 - s->used);
+    for (int i = 0; i < 8; i++) s->block[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha256_compress(s->state, s->block);
+    for (int i = 0; i < 8; i++) {
+        out[4 * i] = (unsigned char)(s->state[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(s->state[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(s->state[i] >> 8);
+        out[4 * i + 3] = (unsigned char)s->state[i];
+    }
+}
+
+// ===== PBKDF2-HMAC-SHA256 (RFC 8018), one output block =====
+
+// HMAC key pads hashed once; each iteration then costs two compressions
+typedef struct {
+    Sha256 inner, outer;
+} HmacKey;
+
+static void hmac_init(HmacKey *h, const unsigned char *key, size_t key_len) {
+    unsigned char block[64] = {0}, pad[64];
+    if (key_len > 64) {
+        Sha256 s;
+        sha256_init(&s);
+        sha256_update(&s, key, key_len);
+        sha256_final(&s, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+    sha256_init(&h->inner);
+    sha256_update(&h->inner, pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+    sha256_init(&h->outer);
+    sha256_update(&h->outer, pad, 64);
+}
+
+static void hmac(const HmacKey *h, const unsigned char *msg, size_t len, unsigned char out[32]) {
+    Sha256 s = h->inner;
+    sha256_update(&s, msg, len);
+    sha256_final(&s, out);
+    s = h->outer;
+    sha256_update(&s, out, 32);
+    sha256_final(&s, out);
+}
+
+static void pbkdf2_sha256(const char *password, const unsigned char *salt, size_t salt_len,
+                          int iterations, unsigned char out[32]) {
+    HmacKey key;
+    hmac_init(&key, (const unsigned char*)password, strlen(password));
+
+    unsigned char msg[64 + 4], u[32];
+    memcpy(msg, salt, salt_len);
+    msg[salt_len] = 0; msg[salt_len + 1] = 0; msg[salt_len + 2] = 0; msg[salt_len + 3] = 1;
+    hmac(&key, msg, salt_len + 4, u);
+    memcpy(out, u, 32);
+    for (int i = 1; i < iterations; i++) {
+        hmac(&key, u, 32, u);
+        for (int j = 0; j < 32; j++) out[j] ^= u[j];
+    }
+}
+
+// ===== Records =====
+
+static void to_hex(const unsigned char *in, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 15];
+    }
+    out[2 * len] = '\0';
+}
+
+// Decode exactly len bytes of hex; returns 1 on success
+static int from_hex(const char *in, unsigned char *out, size_t len) {
+    for (size_t i = 0; i < 2 * len; i++) {
+        char c = in[i];
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+        if (v < 0) return 0;
+        if (i % 2 == 0) out[i / 2] = (unsigned char)(v << 4);
+        else out[i / 2] |= (unsigned char)v;
+    }
+    return 1;
+}
+
+// Split a hashed record; returns 1 if well formed
+static int parse_record(const char *record, int *iterations, unsigned char *salt, unsigned char *hash) {
+    if (strncmp(record, RECORD_PREFIX, strlen(RECORD_PREFIX)) != 0) return 0;
+    const char *p = record + strlen(RECORD_PREFIX);
+    char *end;
+    long iter = strtol(p, &end, 10);
+    if (end == p || *end != '$' || iter < 1 || iter > 10000000) return 0;
+    p = end + 1;
+    if (strlen(p) != 2 * PASSWORD_SALT_BYTES + 1 + 2 * PASSWORD_HASH_BYTES ||
+        p[2 * PASSWORD_SALT_BYTES] != '$') {
+        return 0;
+    }
+    if (!from_hex(p, salt, PASSWORD_SALT_BYTES) ||
+        !from_hex(p + 2 * PASSWORD_SALT_BYTES + 1, hash, PASSWORD_HASH_BYTES)) {
+        return 0;
+    }
+    *iterations = (int)iter;
+    return 1;
+}
+
+static int random_bytes(unsigned char *out, size_t len) {
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return 0;
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, out + got, len - got);
+        if (n <= 0) break;
+        got += n;
+    }
+    close(fd);
+    return got == len;
+}
+
+int password_hash(const char *password, char *record, size_t size) {
+    unsigned char salt[PASSWORD_SALT_BYTES], hash[PASSWORD_HASH_BYTES];
+    if (!password || !random_bytes(salt, sizeof(salt))) return 0;
+    pbkdf2_sha256(password, salt, sizeof(salt), PASSWORD_ITERATIONS, hash);
+
+    char salt_hex[2 * PASSWORD_SALT_BYTES + 1], hash_hex[2 * PASSWORD_HASH_BYTES + 1];
+    to_hex(salt, sizeof(salt), salt_hex);
+    to_hex(hash, sizeof(hash), hash_hex);
+    int n = snprintf(record, size, RECORD_PREFIX "%d$%s$%s", PASSWORD_ITERATIONS, salt_hex, hash_hex);
+    return n > 0 && (size_t)n < size;
+}
+
+int password_verify(const char *password, const char *record) {
+    if (!password || !record) return 0;
+
+    int iterations;
+    unsigned char salt[PASSWORD_SALT_BYTES], expected[PASSWORD_HASH_BYTES], actual[PASSWORD_HASH_BYTES];
+    if (!parse_record(record, &iterations, salt, expected)) {
+        // Plaintext record from an older build
+        return strncmp(record, RECORD_PREFIX, strlen(RECORD_PREFIX)) != 0 &&
+               strcmp(password, record) == 0;
+    }
+
+    pbkdf2_sha256(password, salt, sizeof(salt), iterations, actual);
+    unsigned char diff = 0;
+    for (int i = 0; i < PASSWORD_HASH_BYTES; i++) diff |= actual[i] ^ expected[i];
+    return diff == 0;
+}
+
+int password_needs_rehash(const char *record) {
+    int iterations;
+    unsigned char salt[PASSWORD_SALT_BYTES], hash[PASSWORD_HASH_BYTES];
+    if (!record || !parse_record(record, &iterations, salt, hash)) return 1;
+    return iterations < PASSWORD_ITERATIONS;
+}
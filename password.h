@@ -0,0 +1,28 @@
+#ifndef PASSWORD_H
+#define PASSWORD_H
+
+#include <stddef.h>
+
+// Salted password records stored in users.password:
+//
+//   pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>
+//
+// PBKDF2-HMAC-SHA256 with a random 16-byte salt per user. Records written by
+// older builds hold the plaintext password; password_verify() still accepts
+// them and password_needs_rehash() tells the caller to replace them.
+
+#define PASSWORD_ITERATIONS 10000     // ~8-15 ms per hash on one core (raising it rehashes on login)
+#define PASSWORD_SALT_BYTES 16
+#define PASSWORD_HASH_BYTES 32
+#define PASSWORD_RECORD_MAX 128
+
+// Hash password with a fresh salt into record. Returns 1 on success, 0 on failure.
+int password_hash(const char *password, char *record, size_t size);
+
+// 1 if password matches record (constant time for hashed records), 0 otherwise
+int password_verify(const char *password, const char *record);
+
+// 1 if record is plaintext or uses fewer than PASSWORD_ITERATIONS rounds
+int password_needs_rehash(const char *record);
+
+#endif // PASSWORD_H
@@ -0,0 +1,350 @@
+#include "practice.h"
+#include "catalog.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Box 0 (wrong or new) comes back within minutes, box 5 after three weeks
+static const long intervals[PRACTICE_BOXES] = {
+    60, 10 * 60, 24 * 3600, 3 * 24 * 3600, 7 * 24 * 3600, 21 * 24 * 3600
+};
+
+typedef struct {
+    int question_id;
+    unsigned int due;          // Unix time (32 bits last until 2106)
+    int heap_pos;
+    unsigned char box;
+} Card;
+
+typedef struct {
+    Card *cards;               // Dense: dropping a card moves the last one into its index
+    int count;
+    int cap;
+    int *heap;                 // Card indexes, earliest due first
+    int heap_count;
+    int *slots;                // Open addressing: question id -> card index + 1
+    int slot_cap;              // Power of two, at least twice count
+} Deck;
+
+static Deck **decks = NULL;    // Indexed by user id
+static int deck_cap = 0;
+
+// Write-behind queue; a later entry for the same card supersedes earlier ones
+static DBPracticeCard *pending = NULL;
+static int pending_count = 0;
+static int pending_cap = 0;
+
+static pthread_mutex_t practice_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== HEAP (caller holds practice_lock) =====
+
+static int card_before(const Deck *d, int a, int b) {
+    return d->cards[d->heap[a]].due < d->cards[d->heap[b]].due;
+}
+
+static void heap_swap(Deck *d, int a, int b) {
+    int t = d->heap[a];
+    d->heap[a] = d->heap[b];
+    d->heap[b] = t;
+    d->cards[d->heap[a]].heap_pos = a;
+    d->cards[d->heap[b]].heap_pos = b;
+}
+
+static void sift_up(Deck *d, int pos) {
+    while (pos > 0 && card_before(d, pos, (pos - 1) / 2)) {
+        heap_swap(d, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void sift_down(Deck *d, int pos) {
+    while (1) {
+        int first = pos, left = 2 * pos + 1, right = left + 1;
+        if (left < d->heap_count && card_before(d, left, first)) first = left;
+        if (right < d->heap_count && card_before(d, right, first)) first = right;
+        if (first == pos) return;
+        heap_swap(d, pos, first);
+        pos = first;
+    }
+}
+
+static void heap_push(Deck *d, int card) {
+    d->heap[d->heap_count] = card;
+    d->cards[card].heap_pos = d->heap_count;
+    sift_up(d, d->heap_count++);
+}
+
+static void heap_remove(Deck *d, int pos) {
+    if (--d->heap_count == pos) return;
+    d->heap[pos] = d->heap[d->heap_count];
+    d->cards[d->heap[pos]].heap_pos = pos;
+    sift_up(d, pos);
+    sift_down(d, pos);
+}
+
+// ===== DECKS (caller holds practice_lock) =====
+
+static unsigned int slot_of(const Deck *d, int question_id) {
+    return ((unsigned int)question_id * 2654435761u) & (unsigned int)(d->slot_cap - 1);
+}
+
+// Hash slot holding question_id's card, -1 if the user has none
+static int find_slot(const Deck *d, int question_id) {
+    if (!d || d->slot_cap == 0) return -1;
+    for (unsigned int s = slot_of(d, question_id); d->slots[s]; s = (s + 1) & (d->slot_cap - 1)) {
+        if (d->cards[d->slots[s] - 1].question_id == question_id) return (int)s;
+    }
+    return -1;
+}
+
+static int deck_find(const Deck *d, int question_id) {
+    int s = find_slot(d, question_id);
+    return s < 0 ? -1 : d->slots[s] - 1;
+}
+
+// Empty slot s, shifting later entries of its probe run back so none is cut off
+static void slot_remove(Deck *d, unsigned int s) {
+    unsigned int mask = (unsigned int)d->slot_cap - 1;
+    for (unsigned int j = (s + 1) & mask; d->slots[j]; j = (j + 1) & mask) {
+        unsigned int home = slot_of(d, d->cards[d->slots[j] - 1].question_id);
+        if (((j - home) & mask) >= ((j - s) & mask)) {
+            d->slots[s] = d->slots[j];
+            s = j;
+        }
+    }
+    d->slots[s] = 0;
+}
+
+static Deck *deck_get(int user_id, int create) {
+    if (user_id <= 0) return NULL;
+    if (user_id >= deck_cap) {
+        if (!create) return NULL;
+        int new_cap = deck_cap ? deck_cap : 1024;
+        while (new_cap <= user_id) new_cap *= 2;
+        Deck **grown = realloc(decks, new_cap * sizeof(Deck*));
+        if (!grown) return NULL;
+        memset(grown + deck_cap, 0, (new_cap - deck_cap) * sizeof(Deck*));
+        decks = grown;
+        deck_cap = new_cap;
+    }
+    if (!decks[user_id] && create) decks[user_id] = calloc(1, sizeof(Deck));
+    return decks[user_id];
+}
+
+// Append a card and schedule it. Returns its index, -1 when out of memory.
+static int deck_add(Deck *d, int question_id, int box, long due_at) {
+    if (d->count == d->cap) {
+        int new_cap = d->cap ? d->cap * 2 : 16;
+        Card *cards = realloc(d->cards, new_cap * sizeof(Card));
+        if (!cards) return -1;
+        d->cards = cards;
+        int *heap = realloc(d->heap, new_cap * sizeof(int));
+        if (!heap) return -1;
+        d->heap = heap;
+        d->cap = new_cap;
+    }
+    if ((d->count + 1) * 2 > d->slot_cap) {
+        int new_cap = d->slot_cap ? d->slot_cap * 2 : 32;
+        int *slots = calloc(new_cap, sizeof(int));
+        if (!slots) return -1;
+        free(d->slots);
+        d->slots = slots;
+        d->slot_cap = new_cap;
+        for (int i = 0; i < d->count; i++) {
+            unsigned int s = slot_of(d, d->cards[i].question_id);
+            while (d->slots[s]) s = (s + 1) & (new_cap - 1);
+            d->slots[s] = i + 1;
+        }
+    }
+
+    int idx = d->count++;
+    Card *c = &d->cards[idx];
+    c->question_id = question_id;
+    c->due = (unsigned int)due_at;
+    c->box = (unsigned char)box;
+    unsigned int s = slot_of(d, question_id);
+    while (d->slots[s]) s = (s + 1) & (d->slot_cap - 1);
+    d->slots[s] = idx + 1;
+    heap_push(d, idx);
+    return idx;
+}
+
+// Forget a card (its question was deleted); the last card takes its index
+static void deck_drop(Deck *d, int idx) {
+    heap_remove(d, d->cards[idx].heap_pos);
+    slot_remove(d, (unsigned int)find_slot(d, d->cards[idx].question_id));
+    int last = --d->count;
+    if (idx == last) return;
+    d->cards[idx] = d->cards[last];
+    d->slots[find_slot(d, d->cards[idx].question_id)] = idx + 1;
+    d->heap[d->cards[idx].heap_pos] = idx;
+}
+
+static void queue_change(int user_id, int question_id, int box, long due_at) {
+    if (pending_count == pending_cap) {
+        int new_cap = pending_cap ? pending_cap * 2 : 256;
+        DBPracticeCard *grown = realloc(pending, new_cap * sizeof(DBPracticeCard));
+        if (!grown) {
+            fprintf(stderr, "Practice: out of memory, card change of user %d not saved\n", user_id);
+            return;
+        }
+        pending = grown;
+        pending_cap = new_cap;
+    }
+    DBPracticeCard *row = &pending[pending_count++];
+    row->user_id = user_id;
+    row->question_id = question_id;
+    row->box = box;
+    row->due_at = due_at;
+}
+
+static void fill_pick(const Card *c, PracticePick *pick) {
+    pick->question_id = c->question_id;
+    pick->box = c->box;
+    pick->due_at = (long)c->due;
+}
+
+// ===== LOADING =====
+
+static void load_card(const DBPracticeCard *card, void *ctx) {
+    int *loaded = ctx;
+    if (card->box < 0 || card->box >= PRACTICE_BOXES) return;
+    if (!catalog_question_exists(card->question_id)) {
+        queue_change(card->user_id, card->question_id, -1, 0);
+        return;
+    }
+    Deck *d = deck_get(card->user_id, 1);
+    if (d && deck_find(d, card->question_id) < 0 &&
+        deck_add(d, card->question_id, card->box, card->due_at) >= 0) {
+        (*loaded)++;
+    }
+}
+
+int practice_load(void) {
+    pthread_mutex_lock(&practice_lock);
+    int loaded = 0;
+    storage->for_each_practice_card(load_card, &loaded);
+    pthread_mutex_unlock(&practice_lock);
+    return loaded;
+}
+
+// ===== SCHEDULING =====
+
+int practice_next(int user_id, time_t now, PracticePick *pick) {
+    pthread_mutex_lock(&practice_lock);
+    Deck *d = deck_get(user_id, 0);
+
+    // A due review first; cards of deleted questions are dropped on the way
+    while (d && d->heap_count > 0) {
+        Card *c = &d->cards[d->heap[0]];
+        if (!catalog_question_exists(c->question_id)) {
+            queue_change(user_id, c->question_id, -1, 0);
+            deck_drop(d, d->heap[0]);
+            continue;
+        }
+        if (c->due <= (unsigned int)now) {
+            fill_pick(c, pick);
+            pthread_mutex_unlock(&practice_lock);
+            return 1;
+        }
+        break;
+    }
+
+    // Else something new: uniform draws from the catalog until one is unseen
+    for (int i = 0; i < PRACTICE_NEW_TRIES; i++) {
+        int id = catalog_random_id();
+        if (id <= 0) break;
+        if (deck_find(d, id) < 0) {
+            pick->question_id = id;
+            pick->box = -1;
+            pick->due_at = 0;
+            pthread_mutex_unlock(&practice_lock);
+            return 1;
+        }
+    }
+
+    // The user has seen (nearly) everything: review the earliest card early
+    int found = d && d->heap_count > 0;
+    if (found) fill_pick(&d->cards[d->heap[0]], pick);
+    pthread_mutex_unlock(&practice_lock);
+    return found;
+}
+
+long practice_interval(int box) {
+    if (box < 0) box = 0;
+    if (box >= PRACTICE_BOXES) box = PRACTICE_BOXES - 1;
+    return intervals[box];
+}
+
+int practice_record(int user_id, int question_id, int correct, time_t now, long *due_at) {
+    pthread_mutex_lock(&practice_lock);
+    Deck *d = deck_get(user_id, 1);
+    int idx = deck_find(d, question_id);
+    int box = 0;
+    if (correct) box = idx >= 0 ? d->cards[idx].box + 1 : 1;
+    if (box >= PRACTICE_BOXES) box = PRACTICE_BOXES - 1;
+    long due = (long)now + intervals[box];
+
+    if (!d || (idx < 0 && deck_add(d, question_id, box, due) < 0)) {
+        pthread_mutex_unlock(&practice_lock);
+        return -1;
+    }
+    if (idx >= 0) {
+        Card *c = &d->cards[idx];
+        c->box = (unsigned char)box;
+        c->due = (unsigned int)due;
+        sift_up(d, c->heap_pos);
+        sift_down(d, c->heap_pos);
+    }
+    queue_change(user_id, question_id, box, due);
+    pthread_mutex_unlock(&practice_lock);
+
+    if (due_at) *due_at = due;
+    return box;
+}
+
+// ===== WRITE-BEHIND =====
+
+int practice_flush(void) {
+    pthread_mutex_lock(&practice_lock);
+    DBPracticeCard *batch = pending;
+    int count = pending_count;
+    int cap = pending_cap;
+    pending = NULL;
+    pending_count = pending_cap = 0;
+    pthread_mutex_unlock(&practice_lock);
+
+    if (count == 0) {
+        free(batch);
+        return 0;
+    }
+    if (storage->save_practice_cards(count, batch)) {
+        free(batch);
+        return count;
+    }
+
+    // Put the batch back in front of anything queued meanwhile, keeping the
+    // order in which later entries win
+    pthread_mutex_lock(&practice_lock);
+    if (count + pending_count > cap) {
+        DBPracticeCard *grown = realloc(batch, (count + pending_count) * sizeof(DBPracticeCard));
+        if (grown) {
+            batch = grown;
+            cap = count + pending_count;
+        }
+    }
+    if (count + pending_count <= cap) {
+        memcpy(batch + count, pending, pending_count * sizeof(DBPracticeCard));
+        free(pending);
+        pending = batch;
+        pending_count += count;
+        pending_cap = cap;
+    } else {
+        fprintf(stderr, "Practice: out of memory, %d card changes dropped\n", count);
+        free(batch);
+    }
+    pthread_mutex_unlock(&practice_lock);
+    return -1;
+}
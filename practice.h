@@ -0,0 +1,45 @@
+#ifndef PRACTICE_H
+#define PRACTICE_H
+
+#include <time.h>
+
+// Per-user spaced-repetition scheduler for PRACTICE (Leitner boxes).
+//  - one card per (user, question) answered in practice: its box and due time.
+//    A correct answer moves the card up a box, a wrong one back to box 0, and
+//    the next review is practice_interval(box) seconds later
+//  - each user's cards sit in a min-heap by due time plus an id -> card hash,
+//    so picking the next due card and recording an answer are O(log n) in the
+//    user's deck, whatever the number of users
+//  - with nothing due, a question the user has not seen yet is drawn from the
+//    catalog's live set; once those run out the earliest card comes back early
+// Cards live in memory (about 28 bytes each); changed ones are queued and
+// written behind by practice_flush() in one transaction.
+
+#define PRACTICE_BOXES 6
+#define PRACTICE_NEW_TRIES 8           // Draws for an unseen question per pick
+
+typedef struct {
+    int question_id;
+    int box;                           // -1 for a question new to the user
+    long due_at;                       // Review time of a known card
+} PracticePick;
+
+// Load every stored card (startup, after the catalog). Returns the card count.
+int practice_load(void);
+
+// Next question for a user: a due card, else an unseen question, else the
+// earliest card. Returns 1 and fills pick, 0 if the bank is empty.
+int practice_next(int user_id, time_t now, PracticePick *pick);
+
+// Record an answer and reschedule the card. Returns the new box (due_at, if
+// given, receives the next review time), -1 when out of memory.
+int practice_record(int user_id, int question_id, int correct, time_t now, long *due_at);
+
+// Seconds until the next review of a card in box
+long practice_interval(int box);
+
+// Write queued card changes through storage (caller holds the server lock).
+// Returns the number written, -1 on failure (the changes stay queued).
+int practice_flush(void);
+
+#endif // PRACTICE_H
@@ -0,0 +1,121 @@
+#include "question.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_MIN 4096
+#define ARENA_CHUNK_MAX (1024 * 1024)
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t size;               // Usable bytes in data
+    char data[];
+};
+
+// ===== ARENA =====
+
+void *arena_alloc(Arena *a, size_t size) {
+    if (!a->head || a->head->size - a->used < size) {
+        // Chunks double with the arena, so a big one costs few mallocs
+        size_t chunk = a->bytes < ARENA_CHUNK_MIN ? ARENA_CHUNK_MIN : a->bytes;
+        if (chunk > ARENA_CHUNK_MAX) chunk = ARENA_CHUNK_MAX;
+        if (chunk < size) chunk = size;
+        ArenaChunk *c = malloc(sizeof(ArenaChunk) + chunk);
+        if (!c) return NULL;
+        c->next = a->head;
+        c->size = chunk;
+        a->head = c;
+        a->used = 0;
+        a->bytes += chunk;
+    }
+    void *p = a->head->data + a->used;
+    a->used += size;
+    return p;
+}
+
+void arena_free(Arena *a) {
+    ArenaChunk *c = a->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+// ===== QUESTION =====
+
+const char *question_text(const Question *q) {
+    return q->strings ? q->strings : "";
+}
+
+const char *question_option(const Question *q, int i) {
+    return q->strings && i >= 0 && i < 4 ? q->strings + q->off[i] : "";
+}
+
+const char *question_topic(const Question *q) {
+    return q->strings ? q->strings + q->off[4] : "";
+}
+
+const char *question_difficulty(const Question *q) {
+    return q->strings ? q->strings + q->off[5] : "";
+}
+
+int question_build(Question *q, Arena *a, int id, const char *text,
+                   const char *opt_a, const char *opt_b, const char *opt_c, const char *opt_d,
+                   char correct, const char *topic, const char *difficulty) {
+    const char *parts[7] = { text, opt_a, opt_b, opt_c, opt_d, topic, difficulty };
+    size_t lens[7], total = 0;
+    for (int i = 0; i < 7; i++) {
+        lens[i] = parts[i] ? strlen(parts[i]) : 0;
+        total += lens[i] + 1;
+    }
+
+    char *block = arena_alloc(a, total);
+    if (!block) return 0;
+
+    size_t off = 0;
+    for (int i = 0; i < 7; i++) {
+        if (i > 0) q->off[i - 1] = (unsigned int)off;
+        memcpy(block + off, parts[i] ? parts[i] : "", lens[i]);
+        block[off + lens[i]] = '\0';
+        off += lens[i] + 1;
+    }
+    q->strings = block;
+    q->id = id;
+    q->correct = correct;
+    return 1;
+}
+
+int question_parse(Question *q, char *record) {
+    char *fields[8];
+    int n = 0;
+    char *p = record;
+    fields[n++] = p;
+    while (*p && n < 8) {
+        if (*p == '|') {
+            *p = '\0';
+            fields[n++] = p + 1;
+        }
+        p++;
+    }
+    if (n != 8) return 0;
+
+    // The difficulty is a single word
+    char *end = fields[7];
+    while (*end && !isspace((unsigned char)*end)) end++;
+    *end = '\0';
+
+    for (int i = 0; i < 8; i++) {
+        if (fields[i][0] == '\0') return 0;
+    }
+    if (fields[5][1] != '\0') return 0;
+
+    memset(q, 0, sizeof(*q));
+    q->strings = record;
+    for (int i = 0; i < 4; i++) q->off[i] = (unsigned int)(fields[i + 1] - record);
+    q->off[4] = (unsigned int)(fields[6] - record);
+    q->off[5] = (unsigned int)(fields[7] - record);
+    q->correct = (char)toupper((unsigned char)fields[5][0]);
+    return 1;
+}
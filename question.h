@@ -0,0 +1,55 @@
+#ifndef QUESTION_H
+#define QUESTION_H
+
+#include <stddef.h>
+
+// ===== Bump arena =====
+// Allocations are carved out of chunks and released all together; used for
+// question strings, which are written once and dropped with their owner
+// (a room, the practice set, one request). A zeroed Arena is empty and ready.
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;          // Newest chunk first
+    size_t used;               // Bytes used in head
+    size_t bytes;              // Bytes allocated over all chunks
+} Arena;
+
+// size bytes (unaligned, for strings); NULL when out of memory
+void *arena_alloc(Arena *a, size_t size);
+
+// Release every chunk; a is empty and reusable afterwards
+void arena_free(Arena *a);
+
+// ===== Question =====
+// One question as a single string block "text\0A\0B\0C\0D\0...topic\0difficulty\0"
+// plus offsets into it: 40 bytes besides the text itself, against ~900 for the
+// fixed-array structs it replaced, and no field is ever truncated. The block
+// lives in an arena, a parsed request buffer or storage that outlives the
+// Question; copying a Question never copies its strings.
+
+typedef struct {
+    const char *strings;       // Starts with the text
+    int id;
+    unsigned int off[6];       // A, B, C, D, topic, difficulty
+    char correct;              // 'A'..'D'
+} Question;
+
+const char *question_text(const Question *q);
+const char *question_option(const Question *q, int i);   // i = 0..3 for A..D
+const char *question_topic(const Question *q);
+const char *question_difficulty(const Question *q);
+
+// Copy the fields into one block allocated from a (NULL fields become "").
+// Returns 1, 0 when out of memory.
+int question_build(Question *q, Arena *a, int id, const char *text,
+                   const char *opt_a, const char *opt_b, const char *opt_c, const char *opt_d,
+                   char correct, const char *topic, const char *difficulty);
+
+// Split "text|A|B|C|D|correct|topic|difficulty" in place: the '|' become NULs
+// and q points into record. The difficulty ends at the first whitespace.
+// Returns 1 for eight non-empty fields with a one-letter correct field, else 0.
+int question_parse(Question *q, char *record);
+
+#endif // QUESTION_H
@@ -1,4 +1,7 @@
 #include "common.h"
+#include "catalog.h"
+#include "dedup.h"
+#include "rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,124 +29,189 @@ int get_all_topics_with_counts(char *output) {
     if (!output) return -1;
     
     // Use database function db_get_all_topics instead of file I/O
-    return db_get_all_topics(output);
+    return storage->get_all_topics(output);
 }
 
 int get_all_difficulties_with_counts(char *output) {
     if (!output) return -1;
 
     // Use database function db_get_all_difficulties instead of file I/O
-    return db_get_all_difficulties(output);
+    return storage->get_all_difficulties(output);
 }
 
 // ===== QUESTION VALIDATION =====
 
-int validate_question_input(const QItem *q, char *error_msg) {
-    if (!q || !error_msg) return 0;
+int validate_question_code(const Question *q) {
+    if (!q) return QUESTION_ERR_FORMAT;
 
-    if (strlen(q->text) < 10) {
-        strcpy(error_msg, "ERROR: Question text too short (min 10 chars)");
-        return 0;
-    }
+    if (strlen(question_text(q)) < 10) return QUESTION_ERR_TEXT_SHORT;
 
-    if (strlen(q->A) == 0) {
-        strcpy(error_msg, "ERROR: Option A is empty");
-        return 0;
-    }
-    if (strlen(q->B) == 0) {
-        strcpy(error_msg, "ERROR: Option B is empty");
-        return 0;
-    }
-    if (strlen(q->C) == 0) {
-        strcpy(error_msg, "ERROR: Option C is empty");
-        return 0;
-    }
-    if (strlen(q->D) == 0) {
-        strcpy(error_msg, "ERROR: Option D is empty");
-        return 0;
+    for (int i = 0; i < 4; i++) {
+        if (question_option(q, i)[0] == '\0') return QUESTION_ERR_OPTION_EMPTY;
     }
 
     char correct_upper = toupper(q->correct);
     if (correct_upper != 'A' && correct_upper != 'B' && correct_upper != 'C' && correct_upper != 'D') {
-        strcpy(error_msg, "ERROR: Correct answer must be A, B, C, or D");
-        return 0;
+        return QUESTION_ERR_CORRECT;
     }
 
-    if (strlen(q->topic) == 0) {
-        strcpy(error_msg, "ERROR: Topic cannot be empty");
-        return 0;
+    size_t topic_len = strlen(question_topic(q));
+    if (topic_len == 0) return QUESTION_ERR_TOPIC_EMPTY;
+    if (topic_len > MAX_TOPIC_NAME) return QUESTION_ERR_TOPIC_LONG;
+
+    const char *diff = question_difficulty(q);
+    if (strcasecmp(diff, "easy") != 0 && strcasecmp(diff, "medium") != 0 && strcasecmp(diff, "hard") != 0) {
+        return QUESTION_ERR_DIFFICULTY;
     }
 
-    char diff_lower[32];
-    strcpy(diff_lower, q->difficulty);
-    to_lowercase(diff_lower);
+    return QUESTION_OK;
+}
 
-    if (strcmp(diff_lower, "easy") != 0 && strcmp(diff_lower, "medium") != 0 && strcmp(diff_lower, "hard") != 0) {
-        strcpy(error_msg, "ERROR: Difficulty must be: easy, medium, or hard");
-        return 0;
-    }
+int validate_question_input(const Question *q, char *error_msg) {
+    if (!q || !error_msg) return 0;
 
-    return 1;
+    switch (validate_question_code(q)) {
+        case QUESTION_OK:
+            return 1;
+        case QUESTION_ERR_TEXT_SHORT:
+            strcpy(error_msg, "ERROR: Question text too short (min 10 chars)");
+            break;
+        case QUESTION_ERR_OPTION_EMPTY:
+            for (int i = 0; i < 4; i++) {
+                if (question_option(q, i)[0] == '\0') {
+                    sprintf(error_msg, "ERROR: Option %c is empty", 'A' + i);
+                    break;
+                }
+            }
+            break;
+        case QUESTION_ERR_CORRECT:
+            strcpy(error_msg, "ERROR: Correct answer must be A, B, C, or D");
+            break;
+        case QUESTION_ERR_TOPIC_EMPTY:
+            strcpy(error_msg, "ERROR: Topic cannot be empty");
+            break;
+        case QUESTION_ERR_TOPIC_LONG:
+            sprintf(error_msg, "ERROR: Topic name too long (max %d chars)", MAX_TOPIC_NAME);
+            break;
+        case QUESTION_ERR_DIFFICULTY:
+            strcpy(error_msg, "ERROR: Difficulty must be: easy, medium, or hard");
+            break;
+        default:
+            strcpy(error_msg, "ERROR: Invalid question");
+            break;
+    }
+    return 0;
 }
 
 // ===== FILE OPERATIONS =====
 
-int add_question_to_file(const QItem *q) {
-    if (!q) return -1;
+// Insert one validated question; the engines store topic and difficulty lowercased
+static int store_question(const Question *q, int created_by) {
+    return storage->add_question(question_text(q), question_option(q, 0), question_option(q, 1),
+                                 question_option(q, 2), question_option(q, 3),
+                                 (char)toupper((unsigned char)q->correct),
+                                 question_topic(q), question_difficulty(q), created_by);
+}
 
-    // Normalize question
-    QItem new_q = *q;
-    to_lowercase(new_q.topic);
-    to_lowercase(new_q.difficulty);
-    new_q.correct = toupper(new_q.correct);
+int add_question_to_file(const Question *q) {
+    if (!q) return -1;
 
     // Use database function instead of file I/O
     // Note: created_by should be passed as parameter (currently 0, can be updated by caller)
-    int result = db_add_question(new_q.text, new_q.A, new_q.B, new_q.C, new_q.D,
-                                 new_q.correct, new_q.topic, new_q.difficulty, 0);
-    
+    int result = store_question(q, 0);
+
     return result;  // Returns question ID on success, or negative on error
 }
 
+int add_questions_bulk(const Question *items, int count, int created_by, int *ids, int *codes,
+                       int *similar) {
+    if (!items || count <= 0) return 0;
+    if (similar) memset(similar, 0, count * sizeof(int));
+
+    if (!storage->begin_transaction()) {
+        for (int i = 0; i < count; i++) {
+            ids[i] = 0;
+            codes[i] = QUESTION_ERR_DB;
+        }
+        return 0;
+    }
+
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        // Each insert is indexed as it happens, so repeats within items are caught too
+        const Question *q = &items[i];
+        DedupMatch dup;
+        if (dedup_find(question_text(q), question_option(q, 0), question_option(q, 1),
+                       question_option(q, 2), question_option(q, 3), DEDUP_NEAR_PERCENT, &dup)) {
+            if (dup.exact_id) {
+                ids[i] = 0;
+                codes[i] = QUESTION_ERR_DUPLICATE;
+                continue;
+            }
+            if (similar) similar[i] = dup.near_id;
+        }
+        ids[i] = store_question(q, created_by);
+        if (ids[i] > 0) {
+            codes[i] = QUESTION_OK;
+            added++;
+        } else {
+            ids[i] = 0;
+            codes[i] = QUESTION_ERR_DB;
+        }
+    }
+
+    if (!storage->commit_transaction()) {
+        storage->rollback_transaction();
+        // The write-through hooks already saw these rows; resync the catalog
+        if (catalog_is_loaded()) catalog_load();
+        dedup_rebuild();
+        for (int i = 0; i < count; i++) {
+            ids[i] = 0;
+            codes[i] = QUESTION_ERR_DB;
+        }
+        return 0;
+    }
+    return added;
+}
+
 // ===== DEDUPLICATION & RANDOMIZATION =====
 
-int remove_duplicate_questions(QItem *questions, int *count) {
+// Drops repeated ids, keeping first occurrences in order; O(n) with a hash set
+// of seen ids. Content duplicates are dedup.c's job.
+int remove_duplicate_questions(Question *questions, int *count) {
     if (!questions || !count || *count <= 0) return 0;
 
-    int seen_ids[200];
-    memset(seen_ids, -1, sizeof(seen_ids));
+    int size = 16;
+    while (size < *count * 2) size *= 2;
+    int *seen = calloc(size, sizeof(int));   // 0 = empty slot (ids are >= 1)
+    if (!seen) return 0;
 
     int write_idx = 0;
     int original_count = *count;
 
     for (int i = 0; i < original_count; i++) {
-        // Check if ID already seen
-        int found = 0;
-        for (int j = 0; j < write_idx; j++) {
-            if (seen_ids[j] == questions[i].id) {
-                found = 1;
-                break;
-            }
-        }
-
-        if (!found) {
-            seen_ids[write_idx] = questions[i].id;
-            questions[write_idx] = questions[i];
-            write_idx++;
-        }
+        int id = questions[i].id;
+        unsigned slot = ((unsigned)id * 2654435761u) & (size - 1);
+        while (seen[slot] && seen[slot] != id) slot = (slot + 1) & (size - 1);
+        if (seen[slot]) continue;
+        seen[slot] = id;
+        questions[write_idx++] = questions[i];
     }
+    free(seen);
 
     int removed = original_count - write_idx;
     *count = write_idx;
     return removed;
 }
 
-int shuffle_questions(QItem *questions, int count) {
+int shuffle_questions(Question *questions, int count) {
     if (!questions || count <= 1) return 0;
 
+    // Questions are 40-byte views now, so swapping them never moves their strings
+    Rng *rng = rng_thread();
     for (int i = count - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        QItem temp = questions[i];
+        int j = (int)rng_below(rng, (uint32_t)i + 1);
+        Question temp = questions[i];
         questions[i] = questions[j];
         questions[j] = temp;
     }
@@ -152,29 +220,18 @@ int shuffle_questions(QItem *questions, int count) {
 
 // ===== MAIN LOADING FUNCTION =====
 
-int loadQuestionsTxt(const char *filename, QItem *questions, int maxQ,
-                     const char *topic, const char *diff) {
+int loadQuestionsTxt(const char *filename, Question *questions, int maxQ,
+                     const char *topic, const char *diff, Arena *arena) {
     // Note: filename parameter ignored - we now use database as single source of truth
     if (!questions || maxQ <= 0) return 0;
 
-    DBQuestion db_questions[maxQ];
-    int count = db_get_questions_with_distribution(topic, diff, db_questions, maxQ);
+    // The catalog samples from memory / the mapped bank image, no query needed
+    if (catalog_is_loaded()) return catalog_sample(topic, diff, questions, maxQ, arena);
+
+    int count = storage->get_questions_with_distribution(topic, diff, questions, maxQ, arena);
     
     if (count <= 0) return 0;
 
-    // Convert DBQuestion to QItem format
-    for (int i = 0; i < count; i++) {
-        questions[i].id = db_questions[i].id;
-        strncpy(questions[i].text, db_questions[i].text, sizeof(questions[i].text)-1);
-        strncpy(questions[i].A, db_questions[i].option_a, sizeof(questions[i].A)-1);
-        strncpy(questions[i].B, db_questions[i].option_b, sizeof(questions[i].B)-1);
-        strncpy(questions[i].C, db_questions[i].option_c, sizeof(questions[i].C)-1);
-        strncpy(questions[i].D, db_questions[i].option_d, sizeof(questions[i].D)-1);
-        questions[i].correct = db_questions[i].correct_option;
-        strncpy(questions[i].topic, db_questions[i].topic, sizeof(questions[i].topic)-1);
-        strncpy(questions[i].difficulty, db_questions[i].difficulty, sizeof(questions[i].difficulty)-1);
-    }
-
     // Randomize question order
     shuffle_questions(questions, count);
 
@@ -184,31 +241,20 @@ int loadQuestionsTxt(const char *filename, QItem *questions, int maxQ,
 // Load questions with topic and difficulty distribution filters
 // topic_filter format: "topic1:count1 topic2:count2 ..."
 // diff_filter format: "difficulty1:count1 difficulty2:count2 ..."
-int loadQuestionsWithFilters(const char *filename, QItem *questions, int maxQ,
-                             const char *topic_filter, const char *diff_filter) {
+int loadQuestionsWithFilters(const char *filename, Question *questions, int maxQ,
+                             const char *topic_filter, const char *diff_filter, Arena *arena) {
     // Note: filename parameter ignored - we now use database as single source of truth
     // This function uses db_get_questions_with_distribution which handles filtering
     
     if (!questions || maxQ <= 0) return 0;
 
-    DBQuestion db_questions[maxQ];
-    int count = db_get_questions_with_distribution(topic_filter, diff_filter, db_questions, maxQ);
+    if (catalog_is_loaded()) return catalog_sample(topic_filter, diff_filter, questions, maxQ, arena);
+
+    int count = storage->get_questions_with_distribution(topic_filter, diff_filter, questions, maxQ,
+                                                         arena);
     
     if (count <= 0) return 0;
 
-    // Convert DBQuestion to QItem format
-    for (int i = 0; i < count; i++) {
-        questions[i].id = db_questions[i].id;
-        strncpy(questions[i].text, db_questions[i].text, sizeof(questions[i].text)-1);
-        strncpy(questions[i].A, db_questions[i].option_a, sizeof(questions[i].A)-1);
-        strncpy(questions[i].B, db_questions[i].option_b, sizeof(questions[i].B)-1);
-        strncpy(questions[i].C, db_questions[i].option_c, sizeof(questions[i].C)-1);
-        strncpy(questions[i].D, db_questions[i].option_d, sizeof(questions[i].D)-1);
-        questions[i].correct = db_questions[i].correct_option;
-        strncpy(questions[i].topic, db_questions[i].topic, sizeof(questions[i].topic)-1);
-        strncpy(questions[i].difficulty, db_questions[i].difficulty, sizeof(questions[i].difficulty)-1);
-    }
-
     // Randomize question order
     shuffle_questions(questions, count);
 
@@ -216,77 +262,106 @@ int loadQuestionsWithFilters(const char *filename, QItem *questions, int maxQ,
 }
 
 // Search questions by ID
-int search_questions_by_id(int id, QItem *result) {
-    // Use database function instead of file I/O
-    DBQuestion db_question;
-    if (!db_get_question(id, &db_question)) {
-        return 0;
+int search_questions_by_id(int id, Question *result, Arena *arena) {
+    // Served from the in-memory catalog's primary index once it is loaded
+    if (catalog_is_loaded()) {
+        return catalog_get_question(id, result, arena);
     }
-
-    // Convert DBQuestion to QItem
-    result->id = db_question.id;
-    strncpy(result->text, db_question.text, sizeof(result->text)-1);
-    strncpy(result->A, db_question.option_a, sizeof(result->A)-1);
-    strncpy(result->B, db_question.option_b, sizeof(result->B)-1);
-    strncpy(result->C, db_question.option_c, sizeof(result->C)-1);
-    strncpy(result->D, db_question.option_d, sizeof(result->D)-1);
-    result->correct = db_question.correct_option;
-    strncpy(result->topic, db_question.topic, sizeof(result->topic)-1);
-    strncpy(result->difficulty, db_question.difficulty, sizeof(result->difficulty)-1);
     
-    return 1;
+    return storage->get_question(id, result, arena);
 }
 
-// Search questions by topic (returns formatted string)
-int search_questions_by_topic(const char *topic, char *output) {
-    // Use database function instead of file I/O
-    DBQuestion questions[100];
-    int count = db_get_questions_by_topic(topic, questions, 100);
-    
-    if (count <= 0) {
-        output[0] = '\0';
-        return 0;
+// ===== KEYSET PAGINATION =====
+
+// Streams "id|text\n" rows straight into the caller's buffer; no row arrays
+typedef struct {
+    char *out;
+    int max_size;
+    int len;
+    int count;
+    int limit;
+    int last_id;
+    int more;      // Another row exists past this page
+} PageWriter;
+
+static void page_write(PageWriter *w, int id, const char *text) {
+    if (w->more) return;
+    if (w->count >= w->limit) {
+        w->more = 1;
+        return;
     }
-
-    // Format output as id|text\nid|text\n...
-    output[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        char entry[512];
-        snprintf(entry, sizeof(entry), "%d|%s\n", questions[i].id, questions[i].text);
-        if (strlen(output) + strlen(entry) < 8000) {
-            strcat(output, entry);
-        }
+    int n = snprintf(w->out + w->len, w->max_size - w->len, "%d|%s\n", id, text);
+    if (n < 0 || n >= w->max_size - w->len) {
+        // Buffer full: end the page here, the next one resumes after last_id
+        w->out[w->len] = '\0';
+        w->more = 1;
+        return;
     }
-    
-    return count;
+    w->len += n;
+    w->count++;
+    w->last_id = id;
 }
 
-// Search questions by difficulty (returns formatted string)
-int search_questions_by_difficulty(const char *difficulty, char *output) {
-    // Use database function instead of file I/O
-    DBQuestion questions[100];
-    int count = db_get_questions_by_difficulty(difficulty, questions, 100);
-    
-    if (count <= 0) {
-        output[0] = '\0';
-        return 0;
+static void page_write_view(const DBQuestionView *q, void *ctx) {
+    page_write(ctx, q->id, q->text ? q->text : "");
+}
+
+// Walk a catalog posting list from after_id in small chunks
+static int page_catalog(int by_topic, const char *name, int after_id, PageWriter *w) {
+    int ids[64];
+    int cursor = after_id;
+    Arena scratch = {0};
+    while (!w->more) {
+        int n = by_topic ? catalog_ids_by_topic(name, cursor, ids, 64)
+                         : catalog_ids_by_difficulty(name, cursor, ids, 64);
+        if (n < 0) {
+            arena_free(&scratch);
+            return 0;
+        }
+        for (int i = 0; i < n && !w->more; i++) {
+            Question q;
+            if (catalog_get_question(ids[i], &q, &scratch)) page_write(w, q.id, question_text(&q));
+        }
+        arena_free(&scratch);
+        if (n < 64) break;
+        cursor = ids[n - 1];
     }
+    return 1;
+}
 
-    // Format output as id|text\nid|text\n...
+static int search_questions_page(int by_topic, const char *name, int after_id, int limit,
+                                 char *output, int max_size, int *next_id) {
+    PageWriter w = { output, max_size, 0, 0, limit, 0, 0 };
     output[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        char entry[512];
-        snprintf(entry, sizeof(entry), "%d|%s\n", questions[i].id, questions[i].text);
-        if (strlen(output) + strlen(entry) < 8000) {
-            strcat(output, entry);
-        }
+    
+    if (catalog_is_loaded()) {
+        page_catalog(by_topic, name, after_id, &w);
+    } else if (by_topic) {
+        // One extra row tells us whether a next page exists
+        storage->for_each_question_in_topic(name, after_id, limit + 1, page_write_view, &w);
+    } else {
+        storage->for_each_question_in_difficulty(name, after_id, limit + 1, page_write_view, &w);
     }
     
-    return count;
+    if (next_id) *next_id = w.more ? w.last_id : 0;
+    return w.count;
+}
+
+// Search questions by topic: one page of "id|text\n" rows with id > after_id.
+// *next_id is the continuation cursor (0 on the last page).
+int search_questions_by_topic(const char *topic, int after_id, int limit,
+                              char *output, int max_size, int *next_id) {
+    return search_questions_page(1, topic, after_id, limit, output, max_size, next_id);
+}
+
+// Search questions by difficulty (same paging contract as by topic)
+int search_questions_by_difficulty(const char *difficulty, int after_id, int limit,
+                                   char *output, int max_size, int *next_id) {
+    return search_questions_page(0, difficulty, after_id, limit, output, max_size, next_id);
 }
 
 // Delete question by ID
 int delete_question_by_id(int id) {
     // Use database function instead of file I/O
-    return db_delete_question(id);
+    return storage->delete_question(id);
 }
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "ranking.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct UserRank {
+    char username[64];
+    long score_sum;
+    long total_sum;
+    int tests;
+    int bucket;                   // Fenwick index: 0 = best average, -1 = not ranked
+    struct UserRank *prev, *next; // Users sharing the same bucket
+    struct UserRank *hnext;       // Hash chain
+} UserRank;
+
+static UserRank **table = NULL;   // username -> UserRank
+static int table_size = 0;
+static int user_count = 0;
+static int ranked_count = 0;
+
+static int fenwick[RANKING_BUCKETS + 1];     // 1-based
+static UserRank *bucket_head[RANKING_BUCKETS];
+static pthread_mutex_t rank_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== FENWICK TREE =====
+
+static void fenwick_add(int idx, int delta) {
+    for (int i = idx + 1; i <= RANKING_BUCKETS; i += i & -i) fenwick[i] += delta;
+}
+
+// Number of users in buckets [0, idx)
+static int fenwick_prefix(int idx) {
+    int sum = 0;
+    for (int i = idx; i > 0; i -= i & -i) sum += fenwick[i];
+    return sum;
+}
+
+// Smallest bucket whose prefix count reaches k (k is 1-based)
+static int fenwick_find(int k) {
+    int pos = 0, step = 1;
+    while (step * 2 <= RANKING_BUCKETS) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= RANKING_BUCKETS && fenwick[pos + step] < k) {
+            pos += step;
+            k -= fenwick[pos];
+        }
+    }
+    return pos;  // 0-based bucket
+}
+
+// ===== USER TABLE =====
+
+static unsigned hash_name(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static void table_grow(void) {
+    int new_size = table_size ? table_size * 2 : 1024;
+    UserRank **new_table = calloc(new_size, sizeof(UserRank*));
+    if (!new_table) return;
+    for (int i = 0; i < table_size; i++) {
+        UserRank *u = table[i];
+        while (u) {
+            UserRank *next = u->hnext;
+            unsigned slot = hash_name(u->username) % new_size;
+            u->hnext = new_table[slot];
+            new_table[slot] = u;
+            u = next;
+        }
+    }
+    free(table);
+    table = new_table;
+    table_size = new_size;
+}
+
+static UserRank *find_user(const char *username) {
+    if (!table) return NULL;
+    for (UserRank *u = table[hash_name(username) % table_size]; u; u = u->hnext) {
+        if (strcmp(u->username, username) == 0) return u;
+    }
+    return NULL;
+}
+
+static UserRank *get_or_create_user(const char *username) {
+    UserRank *u = find_user(username);
+    if (u) return u;
+
+    if (user_count >= table_size) table_grow();
+    if (!table) return NULL;
+
+    u = calloc(1, sizeof(UserRank));
+    if (!u) return NULL;
+    snprintf(u->username, sizeof(u->username), "%s", username);
+    u->bucket = -1;
+
+    unsigned slot = hash_name(username) % table_size;
+    u->hnext = table[slot];
+    table[slot] = u;
+    user_count++;
+    return u;
+}
+
+// ===== BUCKET MAINTENANCE (caller holds rank_lock) =====
+
+static int bucket_for(const UserRank *u) {
+    long bp = u->total_sum > 0 ? (u->score_sum * 10000L) / u->total_sum : 0;
+    if (bp < 0) bp = 0;
+    if (bp > 10000) bp = 10000;
+    return 10000 - (int)bp;  // best averages get the lowest index
+}
+
+static void unlink_bucket(UserRank *u) {
+    if (u->bucket < 0) return;
+    if (u->prev) u->prev->next = u->next;
+    else bucket_head[u->bucket] = u->next;
+    if (u->next) u->next->prev = u->prev;
+    fenwick_add(u->bucket, -1);
+    u->prev = u->next = NULL;
+    u->bucket = -1;
+    ranked_count--;
+}
+
+static void link_bucket(UserRank *u) {
+    u->bucket = bucket_for(u);
+    u->prev = NULL;
+    u->next = bucket_head[u->bucket];
+    if (u->next) u->next->prev = u;
+    bucket_head[u->bucket] = u;
+    fenwick_add(u->bucket, 1);
+    ranked_count++;
+}
+
+static void apply_sums(UserRank *u, long score, long total, int tests) {
+    unlink_bucket(u);
+    u->score_sum += score;
+    u->total_sum += total;
+    u->tests += tests;
+    if (u->tests > 0 && u->total_sum > 0) link_bucket(u);
+}
+
+static void clear_locked(void) {
+    for (int i = 0; i < table_size; i++) {
+        while (table[i]) {
+            UserRank *next = table[i]->hnext;
+            free(table[i]);
+            table[i] = next;
+        }
+    }
+    memset(fenwick, 0, sizeof(fenwick));
+    memset(bucket_head, 0, sizeof(bucket_head));
+    user_count = 0;
+    ranked_count = 0;
+}
+
+// ===== PUBLIC API =====
+
+static void rebuild_row(const char *username, int tests, long score_sum, long total_sum, void *ctx) {
+    int *loaded = ctx;
+    UserRank *u = get_or_create_user(username);
+    if (!u) return;
+    apply_sums(u, score_sum, total_sum, tests);
+    (*loaded)++;
+}
+
+int ranking_rebuild(void) {
+    pthread_mutex_lock(&rank_lock);
+    clear_locked();
+    int loaded = 0;
+    storage->for_each_user_stat(rebuild_row, &loaded);
+    pthread_mutex_unlock(&rank_lock);
+    return loaded;
+}
+
+static void remove_row(const char *username, int tests, long score_sum, long total_sum, void *ctx) {
+    int *removed = ctx;
+    UserRank *u = find_user(username);
+    if (!u) return;
+    apply_sums(u, -score_sum, -total_sum, -tests);
+    (*removed)++;
+}
+
+int ranking_remove_room(int room_id) {
+    pthread_mutex_lock(&rank_lock);
+    int removed = 0;
+    storage->for_each_room_user_stat(room_id, remove_row, &removed);
+    pthread_mutex_unlock(&rank_lock);
+    return removed;
+}
+
+void ranking_record(const char *username, int score, int total) {
+    if (!username || total <= 0) return;
+    pthread_mutex_lock(&rank_lock);
+    UserRank *u = get_or_create_user(username);
+    if (u) apply_sums(u, score, total, 1);
+    pthread_mutex_unlock(&rank_lock);
+}
+
+int ranking_get_rank(const char *username, double *avg_out, int *tests_out) {
+    if (!username) return 0;
+    int rank = 0;
+    pthread_mutex_lock(&rank_lock);
+    UserRank *u = find_user(username);
+    if (u && u->bucket >= 0) {
+        rank = fenwick_prefix(u->bucket) + 1;
+        if (avg_out) *avg_out = (double)u->score_sum * 100.0 / u->total_sum;
+        if (tests_out) *tests_out = u->tests;
+    }
+    pthread_mutex_unlock(&rank_lock);
+    return rank;
+}
+
+int ranking_user_count(void) {
+    pthread_mutex_lock(&rank_lock);
+    int count = ranked_count;
+    pthread_mutex_unlock(&rank_lock);
+    return count;
+}
+
+int ranking_format_top(int n, char *output, int max_size) {
+    if (!output || max_size <= 0) return 0;
+    output[0] = '\0';
+
+    int len = 0, written = 0;
+    pthread_mutex_lock(&rank_lock);
+    int k = 1;
+    while (written < n && k <= ranked_count) {
+        // Jump straight to the bucket holding the k-th best user
+        int bucket = fenwick_find(k);
+        int rank = fenwick_prefix(bucket) + 1;
+        for (UserRank *u = bucket_head[bucket]; u && written < n; u = u->next) {
+            int m = snprintf(output + len, max_size - len, "%d. %s - %.2f%% (%d tests)\n",
+                             rank, u->username, (double)u->score_sum * 100.0 / u->total_sum, u->tests);
+            if (m < 0 || m >= max_size - len) {
+                output[len] = '\0';
+                pthread_mutex_unlock(&rank_lock);
+                return written;
+            }
+            len += m;
+            written++;
+            k++;
+        }
+    }
+    pthread_mutex_unlock(&rank_lock);
+    return written;
+}
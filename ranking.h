@@ -0,0 +1,33 @@
+#ifndef RANKING_H
+#define RANKING_H
+
+// Global (cross-room) ranking by average score percentage per user.
+// Users are bucketed by average in basis points (0..10000) and a Fenwick tree
+// over the buckets answers "how many users are ahead of me" in O(log n).
+
+#define RANKING_BUCKETS 10001
+// Longest ranking_format_top line: 10-digit rank and test count, 63-char name
+#define RANKING_LINE_MAX 112
+
+// Reload per-user running sums from the user_stats table (startup)
+int ranking_rebuild(void);
+
+// Take a room's results out of its users' sums before the room is deleted,
+// O(log n) per user in the room. Returns the number of users updated.
+int ranking_remove_room(int room_id);
+
+// Add one result to a user's running sums, O(log n)
+void ranking_record(const char *username, int score, int total);
+
+// 1-based rank of a user (ties share a rank); 0 if the user has no results.
+// avg_out (optional) receives the average percentage, tests_out the result count.
+int ranking_get_rank(const char *username, double *avg_out, int *tests_out);
+
+// Number of ranked users
+int ranking_user_count(void);
+
+// Format the top n users as "1. user - 85.50% (4 tests)\n..." into output.
+// Returns the number of users written.
+int ranking_format_top(int n, char *output, int max_size);
+
+#endif // RANKING_H
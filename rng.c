@@ -0,0 +1,89 @@
+#define _DEFAULT_SOURCE
+#include "rng.h"
+#include <pthread.h>
+#include <time.h>
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// ===== GENERATOR =====
+
+void rng_seed(Rng *r, uint64_t seed) {
+    // splitmix64 never yields four zero words, the one state xoshiro cannot leave
+    for (int i = 0; i < 4; i++) r->s[i] = splitmix64(&seed);
+}
+
+uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+uint32_t rng_below(Rng *r, uint32_t n) {
+    if (n == 0) return 0;
+    // Lemire's multiply-shift; redraw the few values that would favour low results
+    uint64_t m = (rng_next(r) >> 32) * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t)m < threshold) m = (rng_next(r) >> 32) * n;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+static __thread Rng thread_rng;
+static __thread int thread_rng_seeded;
+static uint64_t thread_counter;
+
+Rng *rng_thread(void) {
+    if (!thread_rng_seeded) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t seed = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+        seed ^= (uint64_t)pthread_self() * 0x9E3779B97F4A7C15ULL;
+        seed ^= __atomic_add_fetch(&thread_counter, 1, __ATOMIC_RELAXED) << 48;
+        rng_seed(&thread_rng, seed);
+        thread_rng_seeded = 1;
+    }
+    return &thread_rng;
+}
+
+uint64_t rng_hash(const char *s, uint64_t seed) {
+    uint64_t h = 1469598103934665603ULL ^ seed;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// ===== PERMUTATIONS =====
+
+void rng_permutation(Rng *r, unsigned char *perm, int n) {
+    // Inside-out Fisher-Yates: builds the shuffled order in one pass
+    for (int i = 0; i < n; i++) {
+        int j = (int)rng_below(r, (uint32_t)i + 1);
+        perm[i] = perm[j];
+        perm[j] = (unsigned char)i;
+    }
+}
+
+unsigned char rng_option_order(Rng *r) {
+    unsigned char perm[4];
+    rng_permutation(r, perm, 4);
+    return (unsigned char)(perm[0] | perm[1] << 2 | perm[2] << 4 | perm[3] << 6);
+}
@@ -0,0 +1,39 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// ===== xoshiro256** =====
+// Small, fast generator with 256 bits of state, seeded through splitmix64.
+// An Rng belongs to one thread (or one participant's order): no locking and no
+// shared state, unlike rand().
+
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+void rng_seed(Rng *r, uint64_t seed);
+uint64_t rng_next(Rng *r);
+
+// Uniform in [0, n) without modulo bias; 0 when n is 0
+uint32_t rng_below(Rng *r, uint32_t n);
+
+// The calling thread's generator, seeded from the clock and thread on first use
+Rng *rng_thread(void);
+
+// 64-bit seed from a string (FNV-1a), for mixing a username into a seed
+uint64_t rng_hash(const char *s, uint64_t seed);
+
+// ===== Permutations =====
+
+// perm = a uniformly random order of 0..n-1 (n <= 256)
+void rng_permutation(Rng *r, unsigned char *perm, int n);
+
+// A random order of the options A-D packed in one byte: displayed option k is
+// original option OPTION_AT(order, k). OPTION_IDENTITY keeps A-D in place.
+unsigned char rng_option_order(Rng *r);
+
+#define OPTION_IDENTITY 0xE4                  // A,B,C,D from the low bits up
+#define OPTION_AT(order, k) (((order) >> (2 * (k))) & 3)
+
+#endif // RNG_H
@@ -1,4 +1,18 @@
 #include "common.h"
+#include "leaderboard.h"
+#include "ranking.h"
+#include "catalog.h"
+#include "dedup.h"
+#include "rng.h"
+#include "practice.h"
+#include "item_stats.h"
+#include "exam_pool.h"
+#include "bank_image.h"
+#include "export.h"
+#include "logger.h"
+#include "archive.h"
+#include "backup.h"
+#include "user_directory.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,14 +23,44 @@
 #include <ctype.h>
 #include <sys/stat.h>
 #include <strings.h>
+#include <signal.h>
 
 #define ADMIN_CODE "network_programming"
 #define PORT 9000
 #define BUF_SIZE 8192
 #define MAX_ROOMS 100
 #define MAX_PARTICIPANTS 50
-#define MAX_Q 200
 #define MAX_ATTEMPTS 10
+#define COMPACT_INTERVAL 30      // Seconds between question compaction passes (0 = disabled)
+#define COMPACT_BATCH 200        // Rows touched per compaction pass
+#define GLOBAL_TOP_DEFAULT 20    // Users shown by a bare LEADERBOARD
+#define GLOBAL_TOP_MAX 200
+#define TEXT_SEARCH_LIMIT 50     // Ranked matches returned by SEARCH_QUESTIONS text
+#define SEARCH_PAGE_DEFAULT 100  // SEARCH_QUESTIONS topic/difficulty rows per page
+#define SEARCH_PAGE_MAX 500
+#define BULK_ADD_MAX 4000        // Records per BULK_ADD_QUESTIONS upload
+#define DUPLICATE_REPORT_MAX (BUF_SIZE - 256)  // Pair lines shown by DUPLICATES
+#define ITEM_STATS_TOPIC_MAX 200 // Questions per ITEM_STATS <topic> page
+#define ITEM_STATS_SNAPSHOT_INTERVAL 60  // Seconds between item_stats snapshots
+#define EXAM_POOL_REFILL_BATCH 4          // Variants drawn between checks for new work
+#define EXAM_POOL_IDLE_WAIT 1            // Seconds the refill thread sleeps with every pool full
+#define EXPORT_DIR "exports"     // EXPORT_RESULTS output files
+#define ANSWER_STORAGE ANSWER_STORAGE_PACKED  // One packed row per submission (or ANSWER_STORAGE_ROWS)
+#define LOG_OVERFLOW_POLICY LOG_OVERFLOW_DROP  // Full log ring: drop and count (or LOG_OVERFLOW_BLOCK)
+#define LOG_ROTATE_BYTES (10L * 1024 * 1024)   // Rotate data/logs.txt past this size (0 = never)
+#define LOG_MODE LOG_MODE_BOTH                 // Audit sinks at startup (LOG_MODE command changes it)
+#define LOG_FLUSH_INTERVAL 2                   // Seconds between flushes of queued db_add_log rows
+#define PRACTICE_FLUSH_INTERVAL 5                // Seconds between writes of changed practice cards
+#define ARCHIVE_AFTER_DAYS 90    // Logs/results/answers older than this move to archive/YYYY-MM.db
+#define ARCHIVE_INTERVAL 300     // Seconds between archiver passes (0 = disabled)
+#define ARCHIVE_BATCH 500        // Rows per table moved per transaction
+#define BACKUP_INTERVAL 3600     // Seconds between scheduled backups (0 = disabled)
+#define BACKUP_KEEP 7            // Newest backups kept in backups/
+#define BACKUP_PAGES_PER_STEP 64 // Pages copied per backup step
+#define BACKUP_STEP_PAUSE_MS 2   // Pause between steps so the copy never hogs the disk
+#define USER_CACHE_CAPACITY 4096 // Users kept in the login directory (LRU beyond that)
+#define AUTH_WORKERS 2           // Threads hashing passwords for LOGIN/REGISTER
+#define STORAGE_ENGINE "sqlite"  // Or "memory" (no disk I/O); --storage=<name> overrides
 
 #define ROOMS_FILE "data/rooms.txt"
 #define RESULTS_FILE "data/results.txt"
@@ -26,7 +70,9 @@ typedef struct {
     char username[64];
     int db_id;                           // Database participant ID
     int score; 
-    char answers[MAX_QUESTIONS_PER_ROOM];
+    char answers[MAX_QUESTIONS_PER_ROOM];        // Displayed letters, in displayed order
+    unsigned char order[MAX_QUESTIONS_PER_ROOM]; // Displayed question i is room question order[i]
+    unsigned char option_order[MAX_QUESTIONS_PER_ROOM]; // Packed A-D order of each (rng.h)
     int score_history[MAX_ATTEMPTS]; 
     int history_count; 
     time_t submit_time;
@@ -39,7 +85,9 @@ typedef struct {
     char owner[64];
     int numQuestions;
     int duration;
-    QItem questions[MAX_QUESTIONS_PER_ROOM];
+    Question questions[MAX_QUESTIONS_PER_ROOM];
+    Arena arena;                         // Strings of questions[], freed with the room
+    uint64_t seed;                       // Salt of the participants' question orders
     Participant participants[MAX_PARTICIPANTS];
     int participantCount;
     int started;
@@ -56,16 +104,12 @@ typedef struct {
 
 // Chỉ khai báo prototype, không viết hàm ở đây nữa
 void writeLog(const char *event); 
-int register_user_with_role(const char *username, const char *password, const char *role);
-int validate_user(const char *username, const char *password, char *role_out);
 void save_rooms();
 void load_rooms();
 void save_results();
 
 Room rooms[MAX_ROOMS];
 int roomCount = 0;
-QItem practiceQuestions[MAX_Q];
-int practiceQuestionCount = 0;
 pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 
 void trim_newline(char *s) {
@@ -79,6 +123,61 @@ void send_msg(int sock, const char *msg) {
     send(sock, full, strlen(full), 0);
 }
 
+// Strip trailing "AFTER <id>" / "LIMIT <n>" options (either order) off a search value
+void parse_page_options(char *value, int *after_id, int *limit) {
+    for (int pass = 0; pass < 2; pass++) {
+        char *num = strrchr(value, ' ');
+        if (!num) return;
+        *num = '\0';
+        char *kw = strrchr(value, ' ');
+        if (!kw || (strcmp(kw + 1, "AFTER") != 0 && strcmp(kw + 1, "LIMIT") != 0)) {
+            *num = ' ';
+            return;
+        }
+        if (strcmp(kw + 1, "AFTER") == 0) *after_id = atoi(num + 1);
+        else *limit = atoi(num + 1);
+        *kw = '\0';
+    }
+}
+
+// Buffered line reader for multi-line uploads (BULK_ADD_QUESTIONS)
+typedef struct {
+    int sock;
+    char buf[BUF_SIZE];
+    int len;
+    int pos;
+} LineReader;
+
+// Read one '\n'-terminated line into out (truncated to size-1). Returns 0 on disconnect.
+int recv_line(LineReader *r, char *out, int size) {
+    int n = 0;
+    while (1) {
+        if (r->pos == r->len) {
+            r->len = recv(r->sock, r->buf, sizeof(r->buf), 0);
+            r->pos = 0;
+            if (r->len <= 0) {
+                r->len = 0;
+                out[n] = '\0';
+                return 0;
+            }
+        }
+        char c = r->buf[r->pos++];
+        if (c == '\n') break;
+        if (c != '\r' && n < size - 1) out[n++] = c;
+    }
+    out[n] = '\0';
+    return 1;
+}
+
+// Parse "text|A|B|C|D|correct|topic|difficulty" (the ADD_QUESTION payload) into q,
+// in place: q points into record, which must outlive it.
+// Returns QUESTION_OK or a QUESTION_ERR_* code.
+int parse_question_record(char *record, Question *q) {
+    while (*record == ' ') record++;
+    if (!question_parse(q, record)) return QUESTION_ERR_FORMAT;
+    return validate_question_code(q);
+}
+
 Room* find_room(const char *name) {
     for (int i = 0; i < roomCount; i++)
         if (strcmp(rooms[i].name, name) == 0) return &rooms[i];
@@ -112,6 +211,57 @@ void save_results() {
     // The in-memory participant[] arrays are used for active session management
 }
 
+// Publish a stored result to the in-memory room leaderboard and global ranking
+void record_result_rankings(Room *r, const char *username, int score) {
+    leaderboard_record(r->db_id, r->name, username, score, r->numQuestions);
+    ranking_record(username, score, r->numQuestions);
+}
+
+// Draw p's question and option order for a new attempt. Every participant
+// shares the room's questions; only these 2 * numQuestions bytes differ.
+void assign_participant_order(Room *r, Participant *p) {
+    Rng rng;
+    rng_seed(&rng, rng_hash(p->username, r->seed) + (uint64_t)p->history_count);
+    rng_permutation(&rng, p->order, r->numQuestions);
+    for (int i = 0; i < r->numQuestions; i++) p->option_order[i] = rng_option_order(&rng);
+}
+
+// Room question shown to p at position i
+Question *participant_question(Room *r, Participant *p, int i) {
+    return &r->questions[p->order[i]];
+}
+
+// Letter of the original option behind displayed choice ans at position i;
+// anything but A-D (e.g. '.' for unanswered) is returned unchanged
+char original_answer(Participant *p, int i, char ans) {
+    int k = toupper((unsigned char)ans) - 'A';
+    if (k < 0 || k > 3) return ans;
+    return (char)('A' + OPTION_AT(p->option_order[i], k));
+}
+
+// Score the first count displayed answers against the room's answer key
+int score_answers(Room *r, Participant *p, const char *answers, int count) {
+    int score = 0;
+    for (int i = 0; i < count; i++) {
+        if (original_answer(p, i, answers[i]) == participant_question(r, p, i)->correct) score++;
+    }
+    return score;
+}
+
+// Persist the first count answers of a submission in one write, as room
+// question ids and original letters
+void persist_answers(Room *r, Participant *p, int count) {
+    int question_ids[MAX_QUESTIONS_PER_ROOM], is_correct[MAX_QUESTIONS_PER_ROOM];
+    char selected[MAX_QUESTIONS_PER_ROOM];
+    for (int q = 0; q < count; q++) {
+        Question *question = participant_question(r, p, q);
+        question_ids[q] = question->id;
+        selected[q] = original_answer(p, q, p->answers[q]);
+        is_correct[q] = selected[q] == question->correct ? 1 : 0;
+    }
+    storage->record_answers(p->db_id, count, question_ids, selected, is_correct);
+}
+
 void* monitor_exam_thread(void *arg) {
     (void)arg;
     while (1) {
@@ -127,21 +277,15 @@ void* monitor_exam_thread(void *arg) {
                 if (p->score == -1 && p->start_time > 0) {
                     double elapsed = difftime(now, p->start_time);
                     if (elapsed >= r->duration + 2) {
-                        p->score = 0;
-                        for (int q = 0; q < r->numQuestions; q++) {
-                            if (p->answers[q] != '.' && toupper(p->answers[q]) == r->questions[q].correct)
-                                p->score++;
-                        }
+                        p->score = score_answers(r, p, p->answers, r->numQuestions);
                         p->submit_time = now;
                         printf("Auto-submitted for user %s in room %s\n", p->username, r->name);
                         
                         // Persist auto-submitted answers to database
-                        for (int q = 0; q < r->numQuestions; q++) {
-                            char selected = p->answers[q];
-                            int is_correct = (selected != '.' && toupper(selected) == r->questions[q].correct) ? 1 : 0;
-                            db_record_answer(p->db_id, r->questions[q].id, selected, is_correct);
+                        persist_answers(r, p, r->numQuestions);
+                        if (storage->add_result(p->db_id, r->db_id, p->score, r->numQuestions, p->score) > 0) {
+                            record_result_rankings(r, p->username, p->score);
                         }
-                        db_add_result(p->db_id, r->db_id, p->score, r->numQuestions, p->score);
                         
                         char log_msg[256];
                         sprintf(log_msg, "User %s auto-submitted in room %s: %d/%d", 
@@ -156,6 +300,228 @@ void* monitor_exam_thread(void *arg) {
     return NULL;
 }
 
+// Purges tombstoned questions in small batches, releasing the lock between
+// passes so deletions never stall other clients
+void* compaction_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(COMPACT_INTERVAL);
+        int changed;
+        do {
+            pthread_mutex_lock(&lock);
+            changed = storage->compact_questions(COMPACT_BATCH);
+            pthread_mutex_unlock(&lock);
+        } while (changed >= COMPACT_BATCH);
+    }
+    return NULL;
+}
+
+// Moves rows older than max_age_days into the monthly archive files, one small
+// batch at a time with the lock released in between. Returns rows moved, -1 on error.
+int archive_pass(int max_age_days) {
+    int total = 0, moved;
+    do {
+        pthread_mutex_lock(&lock);
+        storage->flush_logs();
+        moved = archive_run(db, max_age_days, ARCHIVE_BATCH);
+        pthread_mutex_unlock(&lock);
+        if (moved > 0) total += moved;
+    } while (moved > 0);
+    return moved < 0 ? -1 : total;
+}
+
+void* archive_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(ARCHIVE_INTERVAL);
+        archive_pass(ARCHIVE_AFTER_DAYS);
+    }
+    return NULL;
+}
+
+// Takes an online backup into BACKUP_DIR and prunes old ones. Runs on its own
+// connection, so the server lock is not needed. Returns backup_run()'s result.
+int backup_pass(BackupProgress *result) {
+    int ok = backup_run(DB_PATH, BACKUP_DIR, BACKUP_PAGES_PER_STEP, BACKUP_STEP_PAUSE_MS, result);
+    if (ok == 1) {
+        int pruned = backup_prune(DB_PATH, BACKUP_DIR, BACKUP_KEEP);
+        char log_msg[512];
+        snprintf(log_msg, sizeof(log_msg), "BACKUP %s (%d pages, %.0f ms, %.1f MB/s, %d pruned)",
+                 result->path, result->pages_total, result->elapsed_ms, result->mb_per_sec, pruned);
+        writeLog(log_msg);
+    } else if (ok == 0) {
+        writeLog("BACKUP_FAILED");
+    }
+    return ok;
+}
+
+void* backup_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(BACKUP_INTERVAL);
+        BackupProgress result;
+        backup_pass(&result);
+    }
+    return NULL;
+}
+
+// Writes queued audit rows (db_add_log) in one transaction every LOG_FLUSH_INTERVAL
+void* log_flush_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(LOG_FLUSH_INTERVAL);
+        pthread_mutex_lock(&lock);
+        storage->flush_logs();
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+// SIGINT/SIGTERM: every other thread blocks them, so this one takes them and
+// closes the listening socket, which ends the accept loop in main()
+static int listen_sock = -1;
+static volatile sig_atomic_t stopping = 0;
+
+void* signal_thread(void *arg) {
+    sigset_t *set = arg;
+    int sig;
+    if (sigwait(set, &sig) == 0) {
+        printf("Received signal %d, shutting down\n", sig);
+        stopping = 1;
+        shutdown(listen_sock, SHUT_RDWR);
+    }
+    return NULL;
+}
+
+// Writes changed practice cards (practice.h) in one transaction every PRACTICE_FLUSH_INTERVAL
+void* practice_flush_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(PRACTICE_FLUSH_INTERVAL);
+        pthread_mutex_lock(&lock);
+        practice_flush();
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+// Writes the item statistics changed since the last pass every ITEM_STATS_SNAPSHOT_INTERVAL
+void* item_stats_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(ITEM_STATS_SNAPSHOT_INTERVAL);
+        pthread_mutex_lock(&lock);
+        item_stats_snapshot();
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+// Keeps the exam template pools (exam_pool.h) topped up; draws from the catalog
+// without the server lock, so CREATE never waits on it
+void* exam_pool_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        if (exam_pool_refill(EXAM_POOL_REFILL_BATCH) == 0) exam_pool_wait(EXAM_POOL_IDLE_WAIT);
+    }
+    return NULL;
+}
+
+// Split "[TOPICS t:n ...] [DIFFICULTIES d:n ...]" into the two filter lists,
+// single-spaced so that equal specs compare equal (exam templates)
+void parse_exam_filters(const char *rest, char *topic_filter, char *diff_filter, size_t size) {
+    char *target = NULL;
+    char word[256];
+    int used;
+    topic_filter[0] = diff_filter[0] = '\0';
+    while (sscanf(rest, "%255s%n", word, &used) == 1) {
+        rest += used;
+        if (strcmp(word, "TOPICS") == 0) {
+            target = topic_filter;
+        } else if (strcmp(word, "DIFFICULTIES") == 0) {
+            target = diff_filter;
+        } else if (target) {
+            size_t len = strlen(target);
+            snprintf(target + len, size - len, "%s%s", len ? " " : "", word);
+        }
+    }
+}
+
+// One ITEM_STATS line; returns 1 if the item is flagged
+int format_item_stats(const Question *q, char *line, size_t size) {
+    ItemSummary st;
+    if (!item_stats_get(q->id, &st)) {
+        snprintf(line, size, "#%d key %c: no answers yet\n", q->id, q->correct);
+        return 0;
+    }
+    const char *flag = item_stats_flag(&st, q->correct);
+    char r[16] = "-";
+    if (st.has_discrimination) snprintf(r, sizeof(r), "%.2f", st.discrimination);
+    snprintf(line, size, "#%d key %c: n=%d p=%.2f r=%s A %d%% B %d%% C %d%% D %d%% blank %d%%%s%s\n",
+             q->id, q->correct, st.attempts, st.p_value, r,
+             st.choices[0] * 100 / st.attempts, st.choices[1] * 100 / st.attempts,
+             st.choices[2] * 100 / st.attempts, st.choices[3] * 100 / st.attempts,
+             st.choices[4] * 100 / st.attempts, flag[0] ? "  FLAG " : "", flag);
+    return flag[0] != '\0';
+}
+
+// "10 min", "3 h", "1 day", "21 days"
+void format_interval(long seconds, char *out, size_t size) {
+    if (seconds < 3600) snprintf(out, size, "%ld min", (seconds + 59) / 60);
+    else if (seconds < 86400) snprintf(out, size, "%ld h", seconds / 3600);
+    else snprintf(out, size, "%ld day%s", seconds / 86400, seconds < 2 * 86400 ? "" : "s");
+}
+
+void apply_log_mode(int mode) {
+    logger_set_file_enabled(mode & LOG_MODE_FILE);
+    storage->set_log_enabled(mode & LOG_MODE_DB);
+}
+
+// Admin commands that work on the database file itself (unavailable with memory storage)
+int command_needs_database_file(const char *cmd) {
+    return strcmp(cmd, "EXPORT_RESULTS") == 0 || strcmp(cmd, "ARCHIVE") == 0 ||
+           strcmp(cmd, "BACKUP") == 0 || strcmp(cmd, "QUERY_AUDIT") == 0;
+}
+
+// Build the question catalog and the duplicate index: map the compiled bank
+// image when it matches the database's bank version (the catalog in O(1), the
+// index from the image's stored signatures), otherwise load the bank from
+// storage and recompile the image for the next start
+void load_catalog(void) {
+    long bank_version = storage->on_disk ? db_get_bank_version() : -1;
+    if (bank_version >= 0) {
+        BankImage *img = bank_image_open(BANK_IMAGE_PATH);
+        if (img && bank_image_version(img) == (unsigned long)bank_version) {
+            int indexed = dedup_load_image(img);   // Before the catalog takes img
+            int count = catalog_load_image(img);
+            if (count >= 0) {
+                printf("Mapped %d questions from %s\n", count, BANK_IMAGE_PATH);
+                if (indexed < 0) indexed = dedup_rebuild();
+                printf("Indexed %d questions for duplicate detection\n", indexed);
+                return;
+            }
+        } else {
+            if (img) printf("Bank image %s is stale, rebuilding\n", BANK_IMAGE_PATH);
+            bank_image_close(img);
+        }
+    }
+
+    printf("Loaded %d questions into catalog\n", catalog_load());
+    printf("Indexed %d questions for duplicate detection\n", dedup_rebuild());
+    if (bank_version >= 0) {
+        // Takes the signatures from the index just built
+        int written = bank_image_compile(BANK_IMAGE_PATH, (unsigned long)bank_version);
+        if (written >= 0) printf("Compiled %d questions into %s\n", written, BANK_IMAGE_PATH);
+    }
+}
+
+const char* log_mode_name(void) {
+    static const char *names[] = { "off", "file", "db", "both" };
+    DBLogStats ds;
+    storage->get_log_stats(&ds);
+    return names[(logger_file_enabled() ? LOG_MODE_FILE : 0) | (ds.enabled ? LOG_MODE_DB : 0)];
+}
+
 void* handle_client(void *arg) {
     Client *cli = (Client*)arg;
     char buffer[BUF_SIZE];
@@ -187,8 +553,10 @@ void* handle_client(void *arg) {
                     sprintf(log_msg, "Register failed for admin %s (Wrong Code)", user);
                     writeLog(log_msg);
                 } else {
-                    // 🔧 FIX: Use database directly instead of register_user_with_role
-                    int user_id = db_add_user(user, pass, role);
+                    // Hashing runs on the auth pool; the directory takes the lock for the insert
+                    pthread_mutex_unlock(&lock);
+                    int user_id = user_directory_register(user, pass, role);
+                    pthread_mutex_lock(&lock);
                     if (user_id > 0) {
                         send_msg(cli->sock, "SUCCESS Registered. Please login.\n");
                         sprintf(log_msg, "User %s registered as %s in database", user, role);
@@ -204,10 +572,13 @@ void* handle_client(void *arg) {
         else if (strcmp(cmd, "LOGIN") == 0) {
             char user[64], pass[64], role[32] = "student";
             sscanf(buffer, "LOGIN %63s %63s", user, pass);
-            // 🔧 FIX: Use database functions directly
-            int user_id = db_validate_user(user, pass);
-            if (user_id > 0) {  // Only succeed if user_id is positive (valid user)
-                db_get_user_role(user, role);
+            // One directory lookup (cached id/role/hash); verification runs on the
+            // auth pool with the lock released
+            int user_id = -1;
+            pthread_mutex_unlock(&lock);
+            int valid = user_directory_login(user, pass, &user_id, role, sizeof(role));
+            pthread_mutex_lock(&lock);
+            if (valid > 0) {
                 strcpy(cli->username, user);
                 strcpy(cli->role, role);
                 cli->user_id = user_id;
@@ -229,92 +600,160 @@ void* handle_client(void *arg) {
             send_msg(cli->sock, "FAIL Please login first");
         }
         else if (strcmp(cmd, "CREATE") == 0 && strcmp(cli->role, "admin") == 0) {
-            char name[64], rest[512] = "";
-            int numQ, dur;
-            char topic_filter[256] = "", diff_filter[256] = "";
-            
-            // Parse command: CREATE name numQ dur [TOPICS topic:count ...] [DIFFICULTIES diff:count ...]
-            sscanf(buffer, "CREATE %63s %d %d %511s", name, &numQ, &dur, rest);
-            
-            // Parse filters from rest
-            if (strlen(rest) > 0) {
-                char rest_copy[512];
-                strcpy(rest_copy, rest);
-                
-                // Look for TOPICS and DIFFICULTIES keywords
-                char *topics_start = strstr(rest_copy, "TOPICS");
-                char *diffs_start = strstr(rest_copy, "DIFFICULTIES");
-                
-                if (topics_start) {
-                    topics_start += 6; // Skip "TOPICS"
-                    while (*topics_start == ' ') topics_start++;
-                    
-                    int topic_len = 0;
-                    if (diffs_start) {
-                        topic_len = diffs_start - topics_start - 1;
-                    } else {
-                        topic_len = strlen(topics_start);
-                    }
-                    strncpy(topic_filter, topics_start, topic_len);
-                    topic_filter[topic_len] = '\0';
-                }
-                
-                if (diffs_start) {
-                    diffs_start += 12; // Skip "DIFFICULTIES"
-                    while (*diffs_start == ' ') diffs_start++;
-                    strcpy(diff_filter, diffs_start);
+            // CREATE name numQ dur [TOPICS topic:count ...] [DIFFICULTIES diff:count ...]
+            // CREATE name template dur
+            char name[64] = "", second[64] = "";
+            int dur = 0, consumed = 0;
+            DBExamTemplate spec = {0};
+            sscanf(buffer, "CREATE %63s %63s %d%n", name, second, &dur, &consumed);
+            int by_template = second[0] && !isdigit((unsigned char)second[0]);
+            if (by_template) {
+                snprintf(spec.name, sizeof(spec.name), "%s", second);
+            } else {
+                spec.num_questions = atoi(second);
+                if (consumed > 0) {
+                    parse_exam_filters(buffer + consumed, spec.topic_filter, spec.diff_filter,
+                                       sizeof(spec.topic_filter));
                 }
             }
+            // A template's name, or the same count and filters as one, selects its pool
+            int pooled = exam_pool_find(&spec);
+            int numQ = spec.num_questions;
             
             // Validate inputs
-            if (numQ < 1 || numQ > MAX_QUESTIONS_PER_ROOM) {
+            if (by_template && !pooled) {
+                send_msg(cli->sock, "FAIL Unknown template");
+            } else if (numQ < 1 || numQ > MAX_QUESTIONS_PER_ROOM) {
                 send_msg(cli->sock, "FAIL Number of questions must be 1-50");
             } else if (dur < 10 || dur > 86400) {
                 send_msg(cli->sock, "FAIL Duration must be 10-86400 seconds");
             } else if (find_room(name)) {
                 send_msg(cli->sock, "FAIL Room already exists");
+            } else if (roomCount >= MAX_ROOMS) {
+                send_msg(cli->sock, "FAIL Room limit reached");
             } else {
-                // Load questions with combined filters
-                QItem temp_questions[MAX_QUESTIONS_PER_ROOM];
-                int loaded = loadQuestionsWithFilters("data/questions.txt", temp_questions, numQ,
-                                                      strlen(topic_filter) > 0 ? topic_filter : NULL,
-                                                      strlen(diff_filter) > 0 ? diff_filter : NULL);
+                // A pregenerated variant when there is one, else a fresh draw
+                Question temp_questions[MAX_QUESTIONS_PER_ROOM];
+                Arena temp_arena = {0};
+                int loaded = pooled ? exam_pool_take(spec.name, temp_questions, &temp_arena) : 0;
+                int from_pool = loaded > 0;
+                if (!from_pool) {
+                    loaded = loadQuestionsWithFilters("data/questions.txt", temp_questions, numQ,
+                                                      spec.topic_filter[0] ? spec.topic_filter : NULL,
+                                                      spec.diff_filter[0] ? spec.diff_filter : NULL,
+                                                      &temp_arena);
+                }
+                
+                int ids[MAX_QUESTIONS_PER_ROOM];
+                for (int q_idx = 0; q_idx < loaded; q_idx++) ids[q_idx] = temp_questions[q_idx].id;
+                int room_id = loaded > 0 ? storage->create_room(name, cli->user_id, dur) : 0;
+                if (room_id > 0 && !storage->add_questions_to_room(room_id, loaded, ids)) {
+                    storage->delete_room(room_id);
+                    room_id = -1;
+                }
                 
                 if (loaded == 0) {
+                    arena_free(&temp_arena);
                     send_msg(cli->sock, "FAIL No questions match your criteria");
+                } else if (room_id <= 0) {
+                    arena_free(&temp_arena);
+                    send_msg(cli->sock, "FAIL Could not create room in database");
                 } else {
-                    // Create room in database
-                    int room_id = db_create_room(name, cli->user_id, dur);
-                    if (room_id <= 0) {
-                        send_msg(cli->sock, "FAIL Could not create room in database");
-                    } else {
-                        // Add questions to room in database
-                        for (int q_idx = 0; q_idx < loaded; q_idx++) {
-                            db_add_question_to_room(room_id, temp_questions[q_idx].id, q_idx);
-                        }
-                        
-                        // Add to in-memory array for active session management
-                        Room *r = &rooms[roomCount++];
-                        r->db_id = room_id;                  // Store database room ID
-                        strcpy(r->name, name);
-                        strcpy(r->owner, cli->username);
-                        r->duration = dur;
-                        r->started = 1;
-                        r->start_time = time(NULL);
-                        r->participantCount = 0;
-                        r->numQuestions = loaded;
-                        memcpy(r->questions, temp_questions, loaded * sizeof(QItem));
-                        
-                        char log_msg[256];
-                        sprintf(log_msg, "Admin %s created room %s with %d questions", cli->username, name, loaded);
-                        writeLog(log_msg);
-                        db_add_log(cli->user_id, "CREATE_ROOM", log_msg);
-                        
-                        send_msg(cli->sock, "SUCCESS Room created");
-                    }
+                    // Add to in-memory array for active session management
+                    Room *r = &rooms[roomCount++];
+                    r->db_id = room_id;                  // Store database room ID
+                    strcpy(r->name, name);
+                    strcpy(r->owner, cli->username);
+                    r->duration = dur;
+                    r->started = 1;
+                    r->start_time = time(NULL);
+                    r->participantCount = 0;
+                    r->numQuestions = loaded;
+                    memcpy(r->questions, temp_questions, loaded * sizeof(Question));
+                    r->arena = temp_arena;               // The room owns the strings now
+                    r->seed = rng_next(rng_thread());
+                    
+                    char log_msg[256];
+                    snprintf(log_msg, sizeof(log_msg), "Admin %s created room %s with %d questions%s%s",
+                             cli->username, name, loaded, from_pool ? " from template " : "",
+                             from_pool ? spec.name : "");
+                    writeLog(log_msg);
+                    storage->add_log(cli->user_id, "CREATE_ROOM", log_msg);
+                    
+                    send_msg(cli->sock, "SUCCESS Room created");
+                }
+            }
+        }
+        else if (strcmp(cmd, "TEMPLATE") == 0 && strcmp(cli->role, "admin") == 0) {
+            // TEMPLATE name numQ pool [TOPICS topic:count ...] [DIFFICULTIES diff:count ...]
+            DBExamTemplate spec = {0};
+            int consumed = 0;
+            sscanf(buffer, "TEMPLATE %63s %d %d%n", spec.name, &spec.num_questions,
+                   &spec.pool_size, &consumed);
+            if (consumed > 0) {
+                parse_exam_filters(buffer + consumed, spec.topic_filter, spec.diff_filter,
+                                   sizeof(spec.topic_filter));
+            }
+
+            if (consumed == 0) {
+                send_msg(cli->sock, "FAIL Usage: TEMPLATE <name> <questions> <pool> [TOPICS ...] [DIFFICULTIES ...]");
+            } else if (isdigit((unsigned char)spec.name[0])) {
+                send_msg(cli->sock, "FAIL Template name must not start with a digit");
+            } else if (spec.num_questions < 1 || spec.num_questions > MAX_QUESTIONS_PER_ROOM) {
+                send_msg(cli->sock, "FAIL Number of questions must be 1-50");
+            } else if (spec.pool_size < 1 || spec.pool_size > EXAM_POOL_MAX_VARIANTS) {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "FAIL Pool size must be 1-%d", EXAM_POOL_MAX_VARIANTS);
+                send_msg(cli->sock, msg);
+            } else {
+                int result = exam_pool_register(&spec, cli->user_id);
+                if (result == 0) {
+                    send_msg(cli->sock, "FAIL Too many templates");
+                } else if (result < 0) {
+                    send_msg(cli->sock, "FAIL Could not save template");
+                } else {
+                    char log_msg[256];
+                    snprintf(log_msg, sizeof(log_msg), "Admin %s %s template %s (%d questions, pool %d)",
+                             cli->username, result == 2 ? "replaced" : "registered", spec.name,
+                             spec.num_questions, spec.pool_size);
+                    writeLog(log_msg);
+                    storage->add_log(cli->user_id, "EXAM_TEMPLATE", log_msg);
+
+                    char msg[128];
+                    snprintf(msg, sizeof(msg), "SUCCESS Template %s %s, pool of %d filling",
+                             spec.name, result == 2 ? "replaced" : "registered", spec.pool_size);
+                    send_msg(cli->sock, msg);
                 }
             }
         }
+        else if (strcmp(cmd, "TEMPLATES") == 0 && strcmp(cli->role, "admin") == 0) {
+            ExamPoolInfo list[EXAM_POOL_TEMPLATES];
+            int n = exam_pool_list(list, EXAM_POOL_TEMPLATES);
+            char msg[BUF_SIZE];
+            int len = snprintf(msg, sizeof(msg), "SUCCESS %d templates\n", n);
+            for (int i = 0; i < n && len < (int)sizeof(msg); i++) {
+                const DBExamTemplate *t = &list[i].spec;
+                len += snprintf(msg + len, sizeof(msg) - len, "- %s: %d questions, %d/%d ready%s%s%s%s\n",
+                                t->name, t->num_questions, list[i].ready, t->pool_size,
+                                t->topic_filter[0] ? " TOPICS " : "", t->topic_filter,
+                                t->diff_filter[0] ? " DIFFICULTIES " : "", t->diff_filter);
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "DELETE_TEMPLATE") == 0 && strcmp(cli->role, "admin") == 0) {
+            char name[64] = "";
+            sscanf(buffer, "DELETE_TEMPLATE %63s", name);
+            int result = name[0] ? exam_pool_drop(name) : 0;
+            if (result > 0) {
+                char log_msg[256];
+                snprintf(log_msg, sizeof(log_msg), "Admin %s deleted template %s", cli->username, name);
+                writeLog(log_msg);
+                storage->add_log(cli->user_id, "EXAM_TEMPLATE", log_msg);
+                send_msg(cli->sock, "SUCCESS Template deleted");
+            } else {
+                send_msg(cli->sock, result < 0 ? "FAIL Could not delete template" : "FAIL Unknown template");
+            }
+        }
         else if (strcmp(cmd, "LIST") == 0) {
             char msg[4096] = "SUCCESS Rooms:\n";
             if (roomCount == 0) strcat(msg, "No rooms.\n");
@@ -337,13 +776,14 @@ void* handle_client(void *arg) {
                 if (!p) {
                     p = &r->participants[r->participantCount++];
                     strcpy(p->username, cli->username);
-                    p->db_id = db_add_participant(r->db_id, cli->user_id);  // Add to database and store ID
+                    p->db_id = storage->add_participant(r->db_id, cli->user_id);  // Add to database and store ID
                     p->score = -1;
                     p->history_count = 0;
                     memset(p->answers, '.', MAX_QUESTIONS_PER_ROOM);
+                    assign_participant_order(r, p);
                     p->submit_time = 0;
                     p->start_time = time(NULL);
-                    db_add_log(cli->user_id, "JOIN_ROOM", name);
+                    storage->add_log(cli->user_id, "JOIN_ROOM", name);
                 } else {
                     if (p->score != -1) { 
                         if (p->history_count < MAX_ATTEMPTS) {
@@ -351,6 +791,7 @@ void* handle_client(void *arg) {
                         }
                         p->score = -1;
                         memset(p->answers, '.', MAX_QUESTIONS_PER_ROOM);
+                        assign_participant_order(r, p);   // A retake gets a new order
                         p->submit_time = 0;
                         p->start_time = time(NULL);
                     }
@@ -369,11 +810,13 @@ void* handle_client(void *arg) {
             char name[64]; int idx;
             sscanf(buffer, "GET_QUESTION %63s %d", name, &idx);
             Room *r = find_room(name);
-            if (!r || idx >= r->numQuestions) {
+            Participant *p = r ? find_participant(r, cli->username) : NULL;
+            if (!r || !p || idx < 0 || idx >= r->numQuestions) {
                 send_msg(cli->sock, "FAIL Invalid");
             } else {
-                Participant *p = find_participant(r, cli->username);
-                QItem *q = &r->questions[idx];
+                // Rendered in p's own question and option order
+                Question *q = participant_question(r, p, idx);
+                unsigned char options = p->option_order[idx];
                 
                 // --- LẤY ĐÁP ÁN HIỆN TẠI TỪ SERVER ---
                 char currentAns = ' ';
@@ -387,7 +830,9 @@ void* handle_client(void *arg) {
                 // Gửi kèm dòng [Your Selection: X] ở cuối
                 snprintf(temp, sizeof(temp),
                          "[%d/%d] %s\nA) %s\nB) %s\nC) %s\nD) %s\n\n[Your Selection: %c]\n",
-                         idx+1, r->numQuestions, q->text, q->A, q->B, q->C, q->D, 
+                         idx+1, r->numQuestions, question_text(q),
+                         question_option(q, OPTION_AT(options, 0)), question_option(q, OPTION_AT(options, 1)),
+                         question_option(q, OPTION_AT(options, 2)), question_option(q, OPTION_AT(options, 3)),
                          currentAns);
                 send_msg(cli->sock, temp);
             }
@@ -416,30 +861,27 @@ void* handle_client(void *arg) {
                 Participant *p = find_participant(r, cli->username);
                 if (!p || p->score != -1) send_msg(cli->sock, "FAIL Not in room or submitted");
                 else {
-                    int score = 0;
-                    for (int i = 0; i < r->numQuestions && i < (int)strlen(ans); i++) {
-                        if (ans[i] != '.' && toupper(ans[i]) == r->questions[i].correct) score++;
-                    }
+                    int answered = (int)strlen(ans);
+                    if (answered > r->numQuestions) answered = r->numQuestions;
+                    int score = score_answers(r, p, ans, answered);
                     p->score = score;
                     p->submit_time = time(NULL);
-                    strcpy(p->answers, ans);
+                    memcpy(p->answers, ans, answered);   // answers[] holds numQuestions letters, not a string
                     
                     // Persist results to database
-                    // 1. Record each answer
-                    for (int i = 0; i < r->numQuestions && i < (int)strlen(ans); i++) {
-                        char selected = ans[i];
-                        int is_correct = (selected != '.' && toupper(selected) == r->questions[i].correct) ? 1 : 0;
-                        db_record_answer(p->db_id, r->questions[i].id, selected, is_correct);
-                    }
+                    // 1. Record the answers
+                    persist_answers(r, p, answered);
                     
-                    // 2. Save result summary
-                    db_add_result(p->db_id, r->db_id, score, r->numQuestions, score);
+                    // 2. Save result summary (only the first result per room is stored)
+                    if (storage->add_result(p->db_id, r->db_id, score, r->numQuestions, score) > 0) {
+                        record_result_rankings(r, cli->username, score);
+                    }
                     
                     char log_msg[256];
                     sprintf(log_msg, "User %s submitted answers in room %s: %d/%d", 
                             cli->username, name, score, r->numQuestions);
                     writeLog(log_msg);
-                    db_add_log(cli->user_id, "SUBMIT_ROOM", log_msg);
+                    storage->add_log(cli->user_id, "SUBMIT_ROOM", log_msg);
                     
                     char msg[128];
                     sprintf(msg, "SUCCESS Score: %d/%d", score, r->numQuestions);
@@ -483,12 +925,20 @@ void* handle_client(void *arg) {
             else if (strcmp(r->owner, cli->username) != 0) send_msg(cli->sock, "FAIL Not your room");
             else {
                 char msg[BUF_SIZE] = "SUCCESS Preview:\n";
+                int len = strlen(msg);
                 for (int i = 0; i < r->numQuestions; i++) {
-                    QItem *q = &r->questions[i];
-                    char line[1024];
-                    snprintf(line, sizeof(line),"[%d/%d] %s\nA) %s\nB) %s\nC) %s\nD) %s\nCorrect: %c\n\n",
-                             i+1, r->numQuestions, q->text, q->A, q->B, q->C, q->D, q->correct);
-                    strcat(msg, line);
+                    Question *q = &r->questions[i];
+                    // Questions are unbounded now; stop at the last one that fits
+                    int n = snprintf(msg + len, sizeof(msg) - len,
+                                     "[%d/%d] %s\nA) %s\nB) %s\nC) %s\nD) %s\nCorrect: %c\n\n",
+                                     i+1, r->numQuestions, question_text(q), question_option(q, 0),
+                                     question_option(q, 1), question_option(q, 2),
+                                     question_option(q, 3), q->correct);
+                    if (n < 0 || n >= (int)sizeof(msg) - len) {
+                        msg[len] = '\0';
+                        break;
+                    }
+                    len += n;
                 }
                 send_msg(cli->sock, msg);
             }
@@ -500,13 +950,17 @@ void* handle_client(void *arg) {
             else if (strcmp(r->owner, cli->username) != 0) send_msg(cli->sock, "FAIL Not your room");
             else {
                 // 🔧 FIX: Delete from database
-                int room_id = db_get_room_id_by_name(name);
+                int room_id = storage->get_room_id_by_name(name);
                 if (room_id > 0) {
-                    db_delete_room(room_id);
+                    // Room results no longer count toward averages; read them before they go
+                    ranking_remove_room(room_id);
+                    if (!storage->delete_room(room_id)) ranking_rebuild();  // Back to what is stored
+                    leaderboard_remove_room(room_id);
                     printf("[DEBUG] Room '%s' (id=%d) deleted from database\n", name, room_id);
                 }
                 
                 // Remove from in-memory array
+                arena_free(&r->arena);
                 for (int i = r - rooms; i < roomCount - 1; i++) rooms[i] = rooms[i + 1];
                 roomCount--;
                 
@@ -517,143 +971,400 @@ void* handle_client(void *arg) {
                 send_msg(cli->sock, "SUCCESS Room deleted");
             }
         }
+        else if (!storage->on_disk && command_needs_database_file(cmd) && strcmp(cli->role, "admin") == 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "FAIL %s needs the sqlite storage engine", cmd);
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "EXPORT_RESULTS") == 0 && strcmp(cli->role, "admin") == 0) {
+            // EXPORT_RESULTS <room|*> [since|*] [until|*] -> columnar file under exports/
+            char room_arg[64] = "*", since[32] = "*", until[32] = "*";
+            sscanf(buffer, "EXPORT_RESULTS %63s %31s %31s", room_arg, since, until);
+            
+            ExportFilter filter = { NULL, NULL, NULL };
+            if (strcmp(room_arg, "*") != 0) filter.room_name = room_arg;
+            if (strcmp(since, "*") != 0) filter.since = since;
+            if (strcmp(until, "*") != 0) filter.until = until;
+            
+            // File name from the room name, keeping only safe characters
+            char safe[64];
+            int n = 0;
+            for (int i = 0; room_arg[i] && n < (int)sizeof(safe) - 1; i++) {
+                char c = room_arg[i];
+                safe[n++] = (isalnum((unsigned char)c) || c == '-' || c == '_') ? c : '_';
+            }
+            safe[n] = '\0';
+            if (!filter.room_name) strcpy(safe, "all");
+            
+            char path[256];
+            mkdir(EXPORT_DIR, 0755);
+            snprintf(path, sizeof(path), "%s/%s_%ld.qcol", EXPORT_DIR, safe, (long)time(NULL));
+            
+            // The export reads its own snapshot connection; don't hold the server lock
+            pthread_mutex_unlock(&lock);
+            ExportStats stats;
+            int ok = export_results(DB_PATH, &filter, path, &stats);
+            pthread_mutex_lock(&lock);
+            
+            char msg[512];
+            if (ok) {
+                snprintf(msg, sizeof(msg),
+                         "SUCCESS %s (%d participants, %d results, %d answers, %d users, %ld bytes)",
+                         path, stats.participants, stats.results, stats.answers, stats.users, stats.bytes);
+                sprintf(log_msg, "Admin %s exported results to %s", cli->username, path);
+                writeLog(log_msg);
+            } else {
+                snprintf(msg, sizeof(msg), "FAIL Export failed");
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "ARCHIVE") == 0 && strcmp(cli->role, "admin") == 0) {
+            int days = ARCHIVE_AFTER_DAYS;
+            sscanf(buffer, "ARCHIVE %d", &days);
+            if (days < 0) {
+                send_msg(cli->sock, "FAIL Usage: ARCHIVE [days]");
+            } else {
+                // Batches take the lock themselves
+                pthread_mutex_unlock(&lock);
+                int moved = archive_pass(days);
+                pthread_mutex_lock(&lock);
+                
+                char msg[128];
+                if (moved < 0) snprintf(msg, sizeof(msg), "FAIL Archiving failed");
+                else snprintf(msg, sizeof(msg), "SUCCESS Archived %d rows older than %d days", moved, days);
+                sprintf(log_msg, "Admin %s archived %d rows older than %d days", cli->username, moved, days);
+                writeLog(log_msg);
+                send_msg(cli->sock, msg);
+            }
+        }
+        else if (strcmp(cmd, "BACKUP") == 0 && strcmp(cli->role, "admin") == 0) {
+            // The copy uses its own connection; do not hold up other clients
+            pthread_mutex_unlock(&lock);
+            BackupProgress result;
+            int ok = backup_pass(&result);
+            pthread_mutex_lock(&lock);
+
+            char msg[512];
+            if (ok < 0) {
+                snprintf(msg, sizeof(msg), "FAIL Backup already running");
+            } else if (ok == 0) {
+                snprintf(msg, sizeof(msg), "FAIL Backup failed");
+            } else {
+                snprintf(msg, sizeof(msg), "SUCCESS %s (%d pages, %.1f MB in %.0f ms, %.1f MB/s)",
+                         result.path, result.pages_total, result.bytes / 1048576.0,
+                         result.elapsed_ms, result.mb_per_sec);
+            }
+            sprintf(log_msg, "Admin %s requested a backup", cli->username);
+            writeLog(log_msg);
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "BACKUP_STATUS") == 0 && strcmp(cli->role, "admin") == 0) {
+            BackupProgress p;
+            backup_get_progress(&p);
+            char msg[512];
+            if (p.running) {
+                snprintf(msg, sizeof(msg), "BACKUP_STATUS running %s %d/%d pages, %.1f MB/s",
+                         p.path, p.pages_done, p.pages_total, p.mb_per_sec);
+            } else if (p.finished_at == 0) {
+                snprintf(msg, sizeof(msg), "BACKUP_STATUS idle (no backup yet)");
+            } else {
+                char when[32];
+                struct tm t;
+                localtime_r(&p.finished_at, &t);
+                strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &t);
+                snprintf(msg, sizeof(msg), "BACKUP_STATUS idle last=%s %s at %s (%d pages, %.0f ms, %.1f MB/s)",
+                         p.ok ? "ok" : "failed", p.path, when, p.pages_total, p.elapsed_ms, p.mb_per_sec);
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "QUERY_AUDIT") == 0 && strcmp(cli->role, "admin") == 0) {
+            char report[BUF_SIZE - 128];
+            int audited = 0;
+            int warnings = db_audit_query_plans(report, sizeof(report), &audited);
+            char msg[BUF_SIZE];
+            if (warnings < 0) {
+                snprintf(msg, sizeof(msg), "FAIL Query audit unavailable");
+            } else {
+                snprintf(msg, sizeof(msg), "SUCCESS %d statements, %d unexpected scans\n%s",
+                         audited, warnings, report);
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "DUPLICATES") == 0 && strcmp(cli->role, "admin") == 0) {
+            // DUPLICATES [min_percent]: full-bank duplicate report on every core
+            int min_percent = DEDUP_NEAR_PERCENT;
+            sscanf(buffer, "DUPLICATES %d", &min_percent);
+            if (min_percent < 1) min_percent = 1;
+            if (min_percent > 100) min_percent = 100;
+            int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (threads < 1) threads = 1;
+            if (threads > DEDUP_MAX_THREADS) threads = DEDUP_MAX_THREADS;
+
+            // The index has its own lock; other clients keep going meanwhile
+            pthread_mutex_unlock(&lock);
+            char report[DUPLICATE_REPORT_MAX];
+            int exact = 0, near = 0;
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            int scanned = dedup_report(min_percent, threads, report, sizeof(report), &exact, &near);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            pthread_mutex_lock(&lock);
+
+            char msg[BUF_SIZE];
+            if (scanned < 0) {
+                snprintf(msg, sizeof(msg), "FAIL Duplicate report unavailable");
+            } else {
+                double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+                snprintf(msg, sizeof(msg), "SUCCESS %d exact, %d near (>= %d%%) in %d questions (%d threads, %.0f ms)\n%s",
+                         exact, near, min_percent, scanned, threads, ms, report);
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "ITEM_STATS") == 0 && strcmp(cli->role, "admin") == 0) {
+            // ITEM_STATS <id|topic> [AFTER <id>]: running p-value, discrimination, distractors
+            char arg[MAX_TOPIC_NAME + 1] = "";
+            int after_id = 0;
+            sscanf(buffer, "ITEM_STATS %63s AFTER %d", arg, &after_id);
+            int ids[ITEM_STATS_TOPIC_MAX];
+            int n = -1, total = 0;
+            int by_topic = arg[0] && !isdigit((unsigned char)arg[0]);
+            if (!by_topic && arg[0]) {
+                ids[0] = atoi(arg);
+                n = total = 1;
+            } else if (by_topic) {
+                n = catalog_ids_by_topic(arg, after_id, ids, ITEM_STATS_TOPIC_MAX);
+                total = catalog_topic_count(arg);
+            }
+
+            if (!arg[0]) {
+                send_msg(cli->sock, "FAIL Usage: ITEM_STATS <question_id|topic> [AFTER <id>]");
+            } else if (n < 0) {
+                send_msg(cli->sock, "FAIL Unknown topic");
+            } else {
+                // A page ends at ITEM_STATS_TOPIC_MAX ids or when the reply is full;
+                // "NEXT <id>" resumes it, as with SEARCH_QUESTIONS
+                char body[BUF_SIZE - 128] = "";
+                int len = 0, shown = 0, flagged = 0, last_id = 0, full = 0;
+                Arena scratch = {0};
+                for (int i = 0; i < n && !full; i++) {
+                    Question q;
+                    if (!search_questions_by_id(ids[i], &q, &scratch)) continue;
+                    char line[256];
+                    int is_flagged = format_item_stats(&q, line, sizeof(line));
+                    int line_len = (int)strlen(line);
+                    if (len + line_len >= (int)sizeof(body) - 32) {
+                        full = 1;
+                        break;
+                    }
+                    memcpy(body + len, line, line_len + 1);
+                    len += line_len;
+                    flagged += is_flagged;
+                    shown++;
+                    last_id = q.id;
+                }
+                arena_free(&scratch);
+
+                int more = by_topic && shown > 0 &&
+                           (full || (n == ITEM_STATS_TOPIC_MAX &&
+                                     catalog_ids_by_topic(arg, last_id, ids, 1) > 0));
+                if (more) snprintf(body + len, sizeof(body) - len, "NEXT %d", last_id);
+
+                char msg[BUF_SIZE];
+                if (shown == 0 && after_id > 0) snprintf(msg, sizeof(msg), "FAIL No more questions");
+                else if (shown == 0) snprintf(msg, sizeof(msg), "FAIL Question not found");
+                else if (by_topic) snprintf(msg, sizeof(msg), "SUCCESS %d of %d items, %d flagged\n%s",
+                                            shown, total, flagged, body);
+                else snprintf(msg, sizeof(msg), "SUCCESS %d items, %d flagged\n%s", shown, flagged, body);
+                send_msg(cli->sock, msg);
+            }
+        }
+        else if (strcmp(cmd, "LOG_STATS") == 0 && strcmp(cli->role, "admin") == 0) {
+            LoggerStats ls;
+            DBLogStats ds;
+            logger_get_stats(&ls);
+            storage->get_log_stats(&ds);
+            char msg[512];
+            snprintf(msg, sizeof(msg),
+                     "SUCCESS Log mode=%s\n"
+                     "FILE records=%lu dropped=%lu blocked=%lu pending=%lu flushes=%lu "
+                     "bytes=%lu rotations=%lu policy=%s\n"
+                     "DB pending=%d written=%lu failed=%lu flushes=%lu",
+                     log_mode_name(), ls.records, ls.dropped, ls.blocked, ls.pending, ls.flushes,
+                     ls.bytes, ls.rotations, ls.overflow_policy == LOG_OVERFLOW_BLOCK ? "block" : "drop",
+                     ds.pending, ds.written, ds.failed, ds.flushes);
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "LOG_MODE") == 0 && strcmp(cli->role, "admin") == 0) {
+            char mode_name[16] = "";
+            sscanf(buffer, "LOG_MODE %15s", mode_name);
+            int mode = -1;
+            if (strcasecmp(mode_name, "off") == 0) mode = LOG_MODE_OFF;
+            else if (strcasecmp(mode_name, "file") == 0) mode = LOG_MODE_FILE;
+            else if (strcasecmp(mode_name, "db") == 0) mode = LOG_MODE_DB;
+            else if (strcasecmp(mode_name, "both") == 0) mode = LOG_MODE_BOTH;
+            
+            if (mode < 0) {
+                send_msg(cli->sock, "FAIL Usage: LOG_MODE off|file|db|both");
+            } else {
+                sprintf(log_msg, "Admin %s set log mode to %s", cli->username, mode_name);
+                writeLog(log_msg);
+                apply_log_mode(mode);
+                char msg[64];
+                snprintf(msg, sizeof(msg), "SUCCESS Log mode %s", log_mode_name());
+                send_msg(cli->sock, msg);
+            }
+        }
         else if (strcmp(cmd, "LEADERBOARD") == 0) {
-            // 🔧 FIX: Query database directly instead of reading file
-            char output[2048] = "SUCCESS ";
-            db_get_leaderboard(0, output + 8, sizeof(output) - 9);
+            // Served from the in-memory per-room top-K boards (no SQLite access)
+            char name[64] = "";
+            sscanf(buffer, "LEADERBOARD %63s", name);
+            if (strlen(name) == 0) {
+                // No room given: global ranking across all rooms
+                char output[BUF_SIZE];
+                int len = snprintf(output, sizeof(output), "SUCCESS Leaderboard (Avg Score):\n");
+                if (ranking_format_top(GLOBAL_TOP_DEFAULT, output + len, sizeof(output) - len - 1) == 0) {
+                    strcat(output, "No results yet.\n");
+                }
+                send_msg(cli->sock, output);
+            } else {
+                Room *r = find_room(name);
+                int room_id = r ? r->db_id : leaderboard_find_room(name);
+                char output[BUF_SIZE];
+                int len = snprintf(output, sizeof(output), "SUCCESS Leaderboard: %s\n", name);
+                if (leaderboard_format(room_id, output + len, sizeof(output) - len - 1) <= 0) {
+                    strcat(output, "No results yet.\n");
+                }
+                send_msg(cli->sock, output);
+            }
+        }
+        else if (strcmp(cmd, "RANK") == 0) {
+            char user[64] = "";
+            sscanf(buffer, "RANK %63s", user);
+            if (strlen(user) == 0) strcpy(user, cli->username);
+            
+            double avg = 0;
+            int tests = 0;
+            int rank = ranking_get_rank(user, &avg, &tests);
+            char msg[256];
+            if (rank == 0) {
+                snprintf(msg, sizeof(msg), "FAIL No results for %s", user);
+            } else {
+                snprintf(msg, sizeof(msg), "SUCCESS %s rank %d/%d avg %.2f%% (%d tests)",
+                         user, rank, ranking_user_count(), avg, tests);
+            }
+            send_msg(cli->sock, msg);
+        }
+        else if (strcmp(cmd, "TOP") == 0) {
+            int n = GLOBAL_TOP_DEFAULT;
+            sscanf(buffer, "TOP %d", &n);
+            if (n < 1) n = 1;
+            if (n > GLOBAL_TOP_MAX) n = GLOBAL_TOP_MAX;
+            
+            char output[BUF_SIZE];
+            int len = snprintf(output, sizeof(output), "SUCCESS Top %d:\n", n);
+            if (ranking_format_top(n, output + len, sizeof(output) - len - 1) == 0) {
+                strcat(output, "No results yet.\n");
+            }
             send_msg(cli->sock, output);
         }
         else if (strcmp(cmd, "PRACTICE") == 0) {
-            if (practiceQuestionCount == 0) send_msg(cli->sock, "FAIL No practice questions");
+            // The user's scheduler picks a due review, else a question new to them
+            PracticePick pick;
+            Question q;
+            Arena scratch = {0};
+            int found = practice_next(cli->user_id, time(NULL), &pick) &&
+                        search_questions_by_id(pick.question_id, &q, &scratch);
+            if (!found) send_msg(cli->sock, "FAIL No practice questions");
             else {
-                int idx = rand() % practiceQuestionCount;
-                QItem *q = &practiceQuestions[idx];
+                char label[32] = "new";
+                if (pick.box >= 0) snprintf(label, sizeof(label), "box %d", pick.box);
                 char temp[BUF_SIZE];
-                snprintf(temp, sizeof(temp),"PRACTICE_Q [%d/%d] %s\nA) %s\nB) %s\nC) %s\nD) %s\nANSWER %c\n",
-                         idx+1, practiceQuestionCount, q->text, q->A, q->B, q->C, q->D, q->correct);
+                snprintf(temp, sizeof(temp),"PRACTICE_Q [ID %d, %s] %s\nA) %s\nB) %s\nC) %s\nD) %s\nANSWER %c\n",
+                         q.id, label, question_text(&q), question_option(&q, 0),
+                         question_option(&q, 1), question_option(&q, 2), question_option(&q, 3),
+                         q.correct);
                 send_msg(cli->sock, temp);
             }
+            arena_free(&scratch);
         }
-        else if (strcmp(cmd, "GET_TOPICS") == 0) {
-            char topics_output[2048] = "SUCCESS ";
-            char topics_data[1024] = "";
-            
-            // Use database function instead of file I/O
-            if (get_all_topics_with_counts(topics_data) > 0 && strlen(topics_data) > 0) {
-                // Format: topic1:count|topic2:count|... -> Topic1(count)|Topic2(count)|...
-                char result[2048] = "";
-                char *saveptr;
-                char *token = strtok_r(topics_data, "|", &saveptr);
-                int first = 1;
-                
-                while (token) {
-                    char *colon = strchr(token, ':');
-                    if (colon) {
-                        int name_len = colon - token;
-                        char topic_name[64];
-                        strncpy(topic_name, token, name_len);
-                        topic_name[name_len] = '\0';
-                        int count = atoi(colon + 1);
-                        
-                        // Capitalize first letter
-                        if (topic_name[0] >= 'a' && topic_name[0] <= 'z') {
-                            topic_name[0] = topic_name[0] - 'a' + 'A';
-                        }
-                        
-                        if (!first) strcat(result, "|");
-                        char formatted[128];
-                        snprintf(formatted, sizeof(formatted), "%s(%d)", topic_name, count);
-                        strcat(result, formatted);
-                        first = 0;
+        else if (strcmp(cmd, "PRACTICE_ANSWER") == 0) {
+            int question_id = 0;
+            char letter = 0;
+            Question q;
+            Arena scratch = {0};
+            if (sscanf(buffer, "PRACTICE_ANSWER %d %c", &question_id, &letter) != 2 ||
+                !strchr("ABCDabcd", letter)) {
+                send_msg(cli->sock, "FAIL Usage: PRACTICE_ANSWER <question_id> <A-D>");
+            } else if (!search_questions_by_id(question_id, &q, &scratch)) {
+                send_msg(cli->sock, "FAIL Question not found");
+            } else {
+                int correct = toupper((unsigned char)letter) == q.correct;
+                int box = practice_record(cli->user_id, question_id, correct, time(NULL), NULL);
+                if (box < 0) {
+                    send_msg(cli->sock, "FAIL Could not record answer");
+                } else {
+                    char when[32], msg[128];
+                    format_interval(practice_interval(box), when, sizeof(when));
+                    if (correct) {
+                        snprintf(msg, sizeof(msg), "SUCCESS Correct, box %d, next review in %s", box, when);
+                    } else {
+                        snprintf(msg, sizeof(msg), "SUCCESS Wrong (answer %c), box %d, next review in %s",
+                                 q.correct, box, when);
                     }
-                    token = strtok_r(NULL, "|", &saveptr);
-                }
-                if (strlen(result) > 0) {
-                    strcat(result, "|");
-                    strcat(topics_output, result);
+                    send_msg(cli->sock, msg);
                 }
             }
+            arena_free(&scratch);
+        }
+        else if (strcmp(cmd, "GET_TOPICS") == 0) {
+            // Cached by the catalog until the next question/topic change
+            char topics_output[BUF_SIZE] = "SUCCESS ";
+            catalog_format_topics(topics_output + 8, sizeof(topics_output) - 9);
             send_msg(cli->sock, topics_output);
         }
         else if (strcmp(cmd, "GET_DIFFICULTIES") == 0) {
             char diff_output[1024] = "SUCCESS ";
-            char diff_data[256] = "";
-            
-            // Use database function instead of file I/O
-            if (get_all_difficulties_with_counts(diff_data) > 0 && strlen(diff_data) > 0) {
-                // Format: easy:count|medium:count|hard:count -> Easy(count)|Medium(count)|Hard(count)|
-                char result[1024] = "";
-                char *saveptr;
-                char *token = strtok_r(diff_data, "|", &saveptr);
-                
-                while (token) {
-                    char *colon = strchr(token, ':');
-                    if (colon) {
-                        int name_len = colon - token;
-                        char diff_name[32];
-                        strncpy(diff_name, token, name_len);
-                        diff_name[name_len] = '\0';
-                        int count = atoi(colon + 1);
-                        
-                        // Capitalize first letter
-                        if (diff_name[0] >= 'a' && diff_name[0] <= 'z') {
-                            diff_name[0] = diff_name[0] - 'a' + 'A';
-                        }
-                        
-                        char formatted[128];
-                        snprintf(formatted, sizeof(formatted), "%s(%d)|", diff_name, count);
-                        strcat(result, formatted);
-                    }
-                    token = strtok_r(NULL, "|", &saveptr);
-                }
-                strcat(diff_output, result);
-            }
+            catalog_format_difficulties(diff_output + 8, sizeof(diff_output) - 9);
             send_msg(cli->sock, diff_output);
         }
         else if (strcmp(cmd, "ADD_QUESTION") == 0 && strcmp(cli->role, "admin") == 0) {
             // Format: ADD_QUESTION text|A|B|C|D|correct|topic|difficulty
-            char text[256], A[128], B[128], C[128], D[128];
-            char correct_str[2], topic[64], difficulty[32];
-            
-            int parsed = sscanf(buffer, 
-                "ADD_QUESTION %255[^|]|%127[^|]|%127[^|]|%127[^|]|%127[^|]|%1[^|]|%63[^|]|%31s",
-                text, A, B, C, D, correct_str, topic, difficulty);
-            
-            if (parsed != 8) {
+            // Parsed in place: new_q's fields point into buffer, nothing is truncated
+            Question new_q;
+            if (parse_question_record(buffer + strlen("ADD_QUESTION"), &new_q) == QUESTION_ERR_FORMAT) {
                 send_msg(cli->sock, "FAIL Invalid format: ADD_QUESTION text|A|B|C|D|correct|topic|difficulty");
             } else {
-                // Create QItem for validation
-                QItem new_q;
-                memset(&new_q, 0, sizeof(QItem));
-                strncpy(new_q.text, text, sizeof(new_q.text)-1);
-                strncpy(new_q.A, A, sizeof(new_q.A)-1);
-                strncpy(new_q.B, B, sizeof(new_q.B)-1);
-                strncpy(new_q.C, C, sizeof(new_q.C)-1);
-                strncpy(new_q.D, D, sizeof(new_q.D)-1);
-                new_q.correct = toupper(correct_str[0]);
-                strncpy(new_q.topic, topic, sizeof(new_q.topic)-1);
-                strncpy(new_q.difficulty, difficulty, sizeof(new_q.difficulty)-1);
-                
-                // Validate question
+                // Validate question, then refuse exact duplicates and flag near ones
                 char error_msg[256];
+                DedupMatch dup;
                 if (!validate_question_input(&new_q, error_msg)) {
                     send_msg(cli->sock, error_msg);
+                } else if (dedup_find(question_text(&new_q), question_option(&new_q, 0),
+                                      question_option(&new_q, 1), question_option(&new_q, 2),
+                                      question_option(&new_q, 3), DEDUP_NEAR_PERCENT, &dup) &&
+                           dup.exact_id) {
+                    char msg[128];
+                    snprintf(msg, sizeof(msg), "FAIL Duplicate of question ID %d", dup.exact_id);
+                    send_msg(cli->sock, msg);
                 } else {
                     // 🔧 FIX: Use database directly (don't call add_question_to_file to avoid duplicates)
-                    int new_id = db_add_question(text, A, B, C, D, correct_str[0], 
-                                                 topic, difficulty, cli->user_id);
+                    int new_id = storage->add_question(question_text(&new_q), question_option(&new_q, 0),
+                                                      question_option(&new_q, 1), question_option(&new_q, 2),
+                                                      question_option(&new_q, 3), new_q.correct,
+                                                      question_topic(&new_q), question_difficulty(&new_q),
+                                                      cli->user_id);
                     if (new_id > 0) {
                         // Success - question added to database
                         char log_msg[512];
-                        sprintf(log_msg, "Admin %s added question ID %d to database: %s/%s", 
-                                cli->username, new_id, topic, difficulty);
+                        snprintf(log_msg, sizeof(log_msg), "Admin %s added question ID %d to database: %s/%s", 
+                                 cli->username, new_id, question_topic(&new_q), question_difficulty(&new_q));
                         writeLog(log_msg);
                         
-                        // Reload practice questions from database
-                        practiceQuestionCount = loadQuestionsTxt("data/questions.txt", practiceQuestions, MAX_Q, NULL, NULL);
-                        
                         char msg[256];
-                        sprintf(msg, "SUCCESS Question added with ID %d", new_id);
+                        int len = sprintf(msg, "SUCCESS Question added with ID %d", new_id);
+                        if (dup.near_id) {
+                            sprintf(msg + len, " (similar to ID %d, %d%%)", dup.near_id, dup.similarity);
+                        }
                         send_msg(cli->sock, msg);
                     } else {
                         char msg[256];
@@ -663,6 +1374,106 @@ void* handle_client(void *arg) {
                 }
             }
         }
+        else if (strcmp(cmd, "BULK_ADD_QUESTIONS") == 0 && strcmp(cli->role, "admin") == 0) {
+            // BULK_ADD_QUESTIONS <n>, then (after READY) n lines of text|A|B|C|D|correct|topic|difficulty
+            int total = 0;
+            sscanf(buffer, "BULK_ADD_QUESTIONS %d", &total);
+            Question *items = NULL;
+            Arena records = {0};                 // Received lines; items point into them
+            int *codes = NULL, *ids = NULL, *bulk_codes = NULL, *similar = NULL;
+            if (total >= 1 && total <= BULK_ADD_MAX) {
+                items = malloc(total * sizeof(Question));
+                codes = malloc(total * sizeof(int));
+                ids = calloc(total, sizeof(int));
+                bulk_codes = calloc(total, sizeof(int));
+                similar = calloc(total, sizeof(int));
+            }
+            
+            if (total < 1 || total > BULK_ADD_MAX) {
+                char msg[128];
+                sprintf(msg, "FAIL Record count must be 1-%d", BULK_ADD_MAX);
+                send_msg(cli->sock, msg);
+            } else if (!items || !codes || !ids || !bulk_codes || !similar) {
+                send_msg(cli->sock, "FAIL Server error");
+            } else {
+                char msg[64];
+                sprintf(msg, "READY %d", total);
+                send_msg(cli->sock, msg);
+                
+                // Receive without holding the server lock - uploads can be slow
+                pthread_mutex_unlock(&lock);
+                LineReader reader = { .sock = cli->sock };
+                char line[BUF_SIZE];
+                int received = 0, valid = 0;
+                while (received < total && recv_line(&reader, line, sizeof(line))) {
+                    size_t size = strlen(line) + 1;
+                    char *record = arena_alloc(&records, size);
+                    if (record) {
+                        memcpy(record, line, size);
+                        codes[received] = parse_question_record(record, &items[valid]);
+                    } else {
+                        codes[received] = QUESTION_ERR_DB;
+                    }
+                    if (codes[received] == QUESTION_OK) valid++;
+                    received++;
+                }
+                pthread_mutex_lock(&lock);
+                
+                if (received == total) {
+                    // One transaction for every valid record, then refresh derived caches once
+                    int added = add_questions_bulk(items, valid, cli->user_id, ids, bulk_codes, similar);
+                    
+                    // Spread results back to record positions (back to front, v <= i)
+                    int first_id = 0, last_id = 0;
+                    for (int i = total - 1, v = valid - 1; i >= 0; i--) {
+                        if (codes[i] != QUESTION_OK) {
+                            ids[i] = 0;
+                            similar[i] = 0;
+                            continue;
+                        }
+                        codes[i] = bulk_codes[v];
+                        ids[i] = ids[v];
+                        similar[i] = similar[v];
+                        v--;
+                    }
+                    for (int i = 0; i < total; i++) {
+                        if (ids[i] <= 0) continue;
+                        if (!first_id) first_id = ids[i];
+                        last_id = ids[i];
+                    }
+                    // Reply: summary line, then one code digit per record (0 = added), then
+                    // "SIMILAR <record>:<id> ..." for added records that are near duplicates
+                    char reply[BUF_SIZE];
+                    int len = snprintf(reply, sizeof(reply), "%s Added %d of %d questions (IDs %d-%d)\nCODES ",
+                                       added > 0 ? "SUCCESS" : "FAIL", added, total, first_id, last_id);
+                    for (int i = 0; i < total && len < (int)sizeof(reply) - 2; i++) {
+                        reply[len++] = '0' + codes[i];
+                    }
+                    reply[len] = '\0';
+                    const char *sep = "\nSIMILAR";
+                    for (int i = 0; i < total; i++) {
+                        if (!similar[i] || codes[i] != QUESTION_OK) continue;
+                        int n = snprintf(reply + len, sizeof(reply) - len, "%s %d:%d", sep, i + 1, similar[i]);
+                        if (n < 0 || n >= (int)sizeof(reply) - len) {
+                            reply[len] = '\0';
+                            break;
+                        }
+                        len += n;
+                        sep = "";
+                    }
+                    send_msg(cli->sock, reply);
+                    
+                    sprintf(log_msg, "Admin %s bulk-added %d of %d questions", cli->username, added, total);
+                    writeLog(log_msg);
+                }
+            }
+            free(items);
+            arena_free(&records);
+            free(codes);
+            free(ids);
+            free(bulk_codes);
+            free(similar);
+        }
         else if (strcmp(cmd, "SEARCH_QUESTIONS") == 0 && strcmp(cli->role, "admin") == 0) {
             char filter_type[32], search_value[256];
             sscanf(buffer, "SEARCH_QUESTIONS %31s %255[^\n]", filter_type, search_value);
@@ -672,35 +1483,56 @@ void* handle_client(void *arg) {
             
             if (strcmp(filter_type, "id") == 0) {
                 int id = atoi(search_value);
-                QItem q;
-                if (search_questions_by_id(id, &q)) {
-                    sprintf(result + strlen(result), "%d|%s|%s|%s|%s|%s|%c|%s|%s",
-                            q.id, q.text, q.A, q.B, q.C, q.D, q.correct, q.topic, q.difficulty);
+                Question q;
+                Arena scratch = {0};
+                if (search_questions_by_id(id, &q, &scratch)) {
+                    snprintf(result + 8, sizeof(result) - 8, "%d|%s|%s|%s|%s|%s|%c|%s|%s",
+                             q.id, question_text(&q), question_option(&q, 0), question_option(&q, 1),
+                             question_option(&q, 2), question_option(&q, 3), q.correct,
+                             question_topic(&q), question_difficulty(&q));
                     count = 1;
                 } else {
                     strcpy(result, "FAIL No question found with that ID");
                 }
+                arena_free(&scratch);
             }
-            else if (strcmp(filter_type, "topic") == 0) {
-                char output[8192];
-                count = search_questions_by_topic(search_value, output);
-                if (count > 0) {
-                    strcat(result, output);
+            else if (strcmp(filter_type, "topic") == 0 || strcmp(filter_type, "difficulty") == 0) {
+                // Keyset page: rows stream into result, "NEXT <id>" resumes via AFTER <id>
+                int after_id = 0, limit = SEARCH_PAGE_DEFAULT, next_id = 0;
+                parse_page_options(search_value, &after_id, &limit);
+                if (limit < 1) limit = 1;
+                if (limit > SEARCH_PAGE_MAX) limit = SEARCH_PAGE_MAX;
+                
+                int room = sizeof(result) - 8 - 32;  // Keep space for the NEXT line
+                if (filter_type[0] == 't') {
+                    count = search_questions_by_topic(search_value, after_id, limit,
+                                                      result + 8, room, &next_id);
                 } else {
-                    strcpy(result, "FAIL No questions found with that topic");
+                    count = search_questions_by_difficulty(search_value, after_id, limit,
+                                                           result + 8, room, &next_id);
                 }
-            }
-            else if (strcmp(filter_type, "difficulty") == 0) {
-                char output[8192];
-                count = search_questions_by_difficulty(search_value, output);
+                
                 if (count > 0) {
-                    strcat(result, output);
+                    if (next_id > 0) sprintf(result + strlen(result), "NEXT %d", next_id);
+                } else if (after_id > 0) {
+                    strcpy(result, "FAIL No more questions");
+                } else if (filter_type[0] == 't') {
+                    strcpy(result, "FAIL No questions found with that topic");
                 } else {
                     strcpy(result, "FAIL No questions found with that difficulty");
                 }
             }
+            else if (strcmp(filter_type, "text") == 0) {
+                count = storage->search_questions_text(search_value, result + 8, sizeof(result) - 9,
+                                                      TEXT_SEARCH_LIMIT);
+                if (count < 0) {
+                    strcpy(result, "FAIL Full-text search is not available");
+                } else if (count == 0) {
+                    strcpy(result, "FAIL No questions match that text");
+                }
+            }
             else {
-                strcpy(result, "FAIL Invalid filter type: use id, topic, or difficulty");
+                strcpy(result, "FAIL Invalid filter type: use id, topic, difficulty, or text");
             }
             
             send_msg(cli->sock, result);
@@ -709,33 +1541,28 @@ void* handle_client(void *arg) {
             int question_id;
             sscanf(buffer, "DELETE_QUESTION %d", &question_id);
             
-            // First verify the question exists
-            QItem q;
-            if (!search_questions_by_id(question_id, &q)) {
+            // First verify the question exists (catalog primary index, no SQL)
+            Question q;
+            Arena scratch = {0};
+            if (!search_questions_by_id(question_id, &q, &scratch)) {
                 send_msg(cli->sock, "FAIL Question not found");
             } else {
-                // Delete the question
+                // Delete the question (tombstoned; compaction_thread cleans up later)
                 if (delete_question_by_id(question_id)) {
-                    // Renumber remaining questions to remove gaps
-                    if (!db_renumber_questions()) {
-                        fprintf(stderr, "Warning: Failed to renumber questions\n");
-                    }
-                    
-                    // Reload practice questions
-                    practiceQuestionCount = loadQuestionsTxt("data/questions.txt", practiceQuestions, MAX_Q, NULL, NULL);
-                    
                     char msg[256];
                     sprintf(msg, "SUCCESS Question ID %d deleted", question_id);
                     send_msg(cli->sock, msg);
                     
                     // Log
                     char log_msg[512];
-                    sprintf(log_msg, "Admin %s deleted question ID %d (%s)", cli->username, question_id, q.text);
+                    snprintf(log_msg, sizeof(log_msg), "Admin %s deleted question ID %d (%s)",
+                             cli->username, question_id, question_text(&q));
                     writeLog(log_msg);
                 } else {
                     send_msg(cli->sock, "FAIL Could not delete question");
                 }
             }
+            arena_free(&scratch);
         }
         else if (strcmp(cmd, "EXIT") == 0) {
             send_msg(cli->sock, "SUCCESS Goodbye");
@@ -751,42 +1578,74 @@ void* handle_client(void *arg) {
     return NULL;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    // Block the stop signals before any thread starts; signal_thread waits for them
+    static sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
     mkdir("data", 0755);
     pthread_mutex_init(&lock, NULL);
-    srand(time(NULL));
     
-    // ===== PHASE 1-2: Initialize Database =====
-    printf("Initializing SQLite database...\n");
-    if (!db_init(DB_PATH)) {
-        fprintf(stderr, "Failed to initialize database\n");
-        return 1;
+    // ===== PHASE 1-2: Initialize Storage =====
+    const char *engine = STORAGE_ENGINE;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--storage=", 10) == 0) engine = argv[i] + 10;
     }
-    
-    if (!db_create_tables()) {
-        fprintf(stderr, "Failed to create database tables\n");
-        db_close();
+    if (!storage_select(engine)) {
+        fprintf(stderr, "Unknown storage engine '%s' (use sqlite or memory)\n", engine);
         return 1;
     }
     
-    if (!db_init_default_difficulties()) {
-        fprintf(stderr, "Failed to initialize difficulties\n");
-        db_close();
+    printf("Initializing %s storage...\n", storage->name);
+    if (!storage->open(DB_PATH)) {
+        fprintf(stderr, "Failed to initialize %s storage\n", storage->name);
         return 1;
     }
     
-    printf("Database initialized successfully\n");
+    if (storage->on_disk) {
+        db_set_answer_storage(ANSWER_STORAGE);
+        
+        // Flag statements whose plan scans a table or sorts (e.g. a missing index)
+        char audit[4096];
+        int audited = 0;
+        int audit_warnings = db_audit_query_plans(audit, sizeof(audit), &audited);
+        printf("Query plan audit: %d statements, %d unexpected scans\n", audited, audit_warnings);
+        if (audit_warnings > 0) fprintf(stderr, "%s", audit);
+    }
+    printf("Storage initialized successfully\n");
     
     // 🔧 FIX: Remove text file migration - all data is SQLite-only
     // Database starts empty, data added via client commands
     
-    // Load practice questions from database (not from file)
-    // Use loadQuestionsTxt which converts DBQuestion to QItem format
-    practiceQuestionCount = loadQuestionsTxt("data/questions.txt", practiceQuestions, MAX_Q, NULL, NULL);
-    printf("Loaded %d practice questions from database\n", practiceQuestionCount);
+    // Build the in-memory question catalog and duplicate index (kept in sync write-through)
+    load_catalog();
+    printf("Practice draws from all %d questions\n", catalog_question_count());
+    printf("Loaded %d practice cards\n", practice_load());
+    printf("Loaded item statistics for %d questions\n", item_stats_load());
+    printf("Loaded %d exam templates\n", exam_pool_load());
+    
+    // Archived results of rooms deleted before a shutdown leave user_stats first
+    if (storage->on_disk && archive_purge_rooms(db) < 0) {
+        fprintf(stderr, "Warning: archived results of deleted rooms not purged\n");
+    }
+    
+    // Rebuild per-room leaderboards from stored results
+    printf("Loaded %d results into leaderboards\n", leaderboard_rebuild());
+    printf("Loaded %d users into global ranking\n", ranking_rebuild());
     
+    if (!logger_start(LOG_OVERFLOW_POLICY, LOG_ROTATE_BYTES)) {
+        fprintf(stderr, "Warning: async logger unavailable, logging synchronously\n");
+    }
+    apply_log_mode(LOG_MODE);
     writeLog("SERVER_STARTED");
     
+    if (!user_directory_init(USER_CACHE_CAPACITY, AUTH_WORKERS, &lock)) {
+        fprintf(stderr, "Warning: auth workers unavailable, hashing on client threads\n");
+    }
+    
     // Load rooms from database instead of text files
     load_rooms();
 
@@ -794,7 +1653,42 @@ int main() {
     pthread_create(&mon_tid, NULL, monitor_exam_thread, NULL);
     pthread_detach(mon_tid); 
 
+    pthread_t log_tid;
+    pthread_create(&log_tid, NULL, log_flush_thread, NULL);
+    pthread_detach(log_tid);
+
+    pthread_t practice_tid;
+    pthread_create(&practice_tid, NULL, practice_flush_thread, NULL);
+    pthread_detach(practice_tid);
+
+    pthread_t item_stats_tid;
+    pthread_create(&item_stats_tid, NULL, item_stats_thread, NULL);
+    pthread_detach(item_stats_tid);
+
+    pthread_t exam_pool_tid;
+    pthread_create(&exam_pool_tid, NULL, exam_pool_thread, NULL);
+    pthread_detach(exam_pool_tid);
+
+    if (ARCHIVE_INTERVAL > 0 && storage->on_disk) {
+        pthread_t archive_tid;
+        pthread_create(&archive_tid, NULL, archive_thread, NULL);
+        pthread_detach(archive_tid);
+    }
+
+    if (BACKUP_INTERVAL > 0 && storage->on_disk) {
+        pthread_t backup_tid;
+        pthread_create(&backup_tid, NULL, backup_thread, NULL);
+        pthread_detach(backup_tid);
+    }
+
+    if (COMPACT_INTERVAL > 0) {
+        pthread_t compact_tid;
+        pthread_create(&compact_tid, NULL, compaction_thread, NULL);
+        pthread_detach(compact_tid);
+    }
+
     int server_sock = socket(AF_INET, SOCK_STREAM, 0);
+    listen_sock = server_sock;
     struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(PORT), .sin_addr.s_addr = INADDR_ANY };
     int opt = 1;
     setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
@@ -802,7 +1696,11 @@ int main() {
     listen(server_sock, 10);
     printf("Server running on port %d\n", PORT);
 
-    while (1) {
+    pthread_t signal_tid;
+    pthread_create(&signal_tid, NULL, signal_thread, &stop_signals);
+    pthread_detach(signal_tid);
+
+    while (!stopping) {
         struct sockaddr_in cli_addr;
         socklen_t len = sizeof(cli_addr);
         int cli_sock = accept(server_sock, (struct sockaddr*)&cli_addr, &len);
@@ -815,6 +1713,16 @@ int main() {
         }
     }
     
-    db_close();
+    // Write back what the background threads would have written next. The lock
+    // stays held: client threads must not touch storage once it is closed.
+    pthread_mutex_lock(&lock);
+    writeLog("SERVER_STOPPED");
+    if (practice_flush() < 0) fprintf(stderr, "Warning: practice cards not saved at shutdown\n");
+    if (item_stats_snapshot() < 0) fprintf(stderr, "Warning: item statistics not saved at shutdown\n");
+    storage->flush_logs();
+    storage->close();
+    logger_stop();
+    close(server_sock);
+    printf("Server stopped\n");
     return 0;
 }
\ No newline at end of file
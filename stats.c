@@ -2,32 +2,35 @@
 #include <stdlib.h>
 #include <string.h>
 #include "db_queries.h"
+#include "ranking.h"
 
-#define MAX_RECORDS 1000
-#define MAX_NAME 100
 #define OUTPUT_FILE "leaderboard_output.txt"  // CHO CLIENT ĐỌC
 
-typedef struct { char username[MAX_NAME]; int total; int count; } UserStat;
-
 void show_leaderboard(const char *output_file) {
-    // Use database to get leaderboard data instead of text file
-    char leaderboard[8192] = "";
-    
-    // Call database function to get leaderboard (uses SQL GROUP BY)
-    // For now, output empty leaderboard as db_get_leaderboard needs room_id parameter
-    // TODO: Modify to get leaderboard for all rooms combined or specific room
+    // Global ranking (average score across all rooms) is maintained incrementally
+    // by ranking.c, so this is just a walk over the best buckets
+    int users = ranking_user_count();
+    size_t max_size = (size_t)users * RANKING_LINE_MAX + 1;
+    char *leaderboard = malloc(max_size);
+    if (!leaderboard) return;
+    ranking_format_top(users, leaderboard, (int)max_size);
     
     FILE *out = fopen(output_file, "w");
-    if (!out) return;
+    if (!out) {
+        free(leaderboard);
+        return;
+    }
     fprintf(out, "=== LEADERBOARD (Avg Score) ===\n");
-    fprintf(out, "Database leaderboard feature in progress\n");
+    if (users == 0) fprintf(out, "No results yet\n");
+    else fputs(leaderboard, out);
     fclose(out);
+    free(leaderboard);
 }
 
 // DÙNG TRONG SERVER
 #ifdef TEST_STATS
 int main() {
-    show_leaderboard("leaderboard_output.txt");
+    show_leaderboard(OUTPUT_FILE);
     return 0;
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,15 @@
+#include "storage.h"
+#include <string.h>
+
+const StorageEngine *storage = &storage_sqlite;
+
+int storage_select(const char *name) {
+    static const StorageEngine *engines[] = { &storage_sqlite, &storage_memory };
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+        if (name && strcmp(name, engines[i]->name) == 0) {
+            storage = engines[i];
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "db_queries.h"
+
+// Storage engine vtable: every read and write the server makes against its
+// data (questions, users, rooms, participants, results, logs) goes through
+// the engine selected at startup.
+//
+//   sqlite  the database file (db_queries.c), the default
+//   memory  plain arrays in this process (storage_memory.c); nothing is
+//           written to disk, so it is for benchmarks and ephemeral practice
+//           servers. Backup, archive, export and the query audit need the
+//           database file and are unavailable.
+//
+// Return conventions are those of the db_* function each entry replaces.
+// Callers hold the server lock around every call, as with db_* (the log
+// functions also take their own lock).
+
+typedef struct {
+    const char *name;
+    int on_disk;               // 1 if the data lives in the SQLite file
+
+    // path: the database file (memory engine: copied from read-only if it exists)
+    int  (*open)(const char *path);
+    void (*close)(void);
+
+    // ---- Questions ----
+    int (*add_question)(const char *text, const char *opt_a, const char *opt_b,
+                        const char *opt_c, const char *opt_d, char correct,
+                        const char *topic, const char *difficulty, int created_by_id);
+    // Question strings are allocated from arena, or point into storage that
+    // lives as long as the engine (memory)
+    int (*get_question)(int id, Question *q, Arena *arena);
+    int (*delete_question)(int id);
+    int (*get_questions_with_distribution)(const char *topic_filter, const char *diff_filter,
+                                           Question *questions, int max_count, Arena *arena);
+    int (*get_all_topics)(char *output);
+    int (*get_all_difficulties)(char *output);
+    int (*for_each_question)(db_question_callback cb, void *ctx);
+    int (*for_each_question_in_topic)(const char *topic, int after_id, int limit,
+                                      db_question_callback cb, void *ctx);
+    int (*for_each_question_in_difficulty)(const char *difficulty, int after_id, int limit,
+                                           db_question_callback cb, void *ctx);
+    int (*for_each_topic)(db_name_callback cb, void *ctx);
+    int (*for_each_difficulty)(db_name_callback cb, void *ctx);
+    int (*search_questions_text)(const char *terms, char *output, int max_size, int limit);
+    int (*compact_questions)(int batch_size);
+
+    // ---- Users ----
+    int (*add_user)(const char *username, const char *password, const char *role);
+    int (*get_user_auth)(const char *username, int *user_id, char *role, size_t role_size,
+                         char *record, size_t record_size);
+    int (*set_user_password)(int user_id, const char *record);
+    int (*username_exists)(const char *username);
+
+    // ---- Rooms ----
+    int (*create_room)(const char *name, int owner_id, int duration_minutes);
+    int (*add_questions_to_room)(int room_id, int count, const int *question_ids);
+    int (*get_room_id_by_name)(const char *room_name);
+    int (*delete_room)(int room_id);
+
+    // ---- Participants & answers ----
+    int (*add_participant)(int room_id, int user_id);
+    int (*record_answers)(int participant_id, int count, const int *question_ids,
+                          const char *selected, const int *is_correct);
+
+    // ---- Results ----
+    int (*add_result)(int participant_id, int room_id, int score, int total, int correct);
+    int (*for_each_result)(db_result_callback cb, void *ctx);
+    int (*for_each_user_stat)(db_user_stat_callback cb, void *ctx);
+    int (*for_each_room_user_stat)(int room_id, db_user_stat_callback cb, void *ctx);
+
+    // ---- Practice scheduler state ----
+    int (*save_practice_cards)(int count, const DBPracticeCard *cards);
+    int (*for_each_practice_card)(db_practice_card_callback cb, void *ctx);
+
+    // ---- Item statistics snapshots ----
+    int (*save_item_stats)(int count, const DBItemStats *items);
+    int (*for_each_item_stats)(db_item_stats_callback cb, void *ctx);
+
+    // ---- Exam templates ----
+    int (*save_exam_template)(const DBExamTemplate *t, int created_by);
+    int (*delete_exam_template)(const char *name);
+    int (*for_each_exam_template)(db_exam_template_callback cb, void *ctx);
+
+    // ---- Logs ----
+    int  (*add_log)(int user_id, const char *event_type, const char *description);
+    int  (*flush_logs)(void);
+    void (*set_log_enabled)(int enabled);
+    void (*get_log_stats)(DBLogStats *stats);
+
+    // ---- Transactions ----
+    int  (*begin_transaction)(void);
+    int  (*commit_transaction)(void);
+    void (*rollback_transaction)(void);
+} StorageEngine;
+
+extern const StorageEngine storage_sqlite;
+extern const StorageEngine storage_memory;
+
+// Active engine (storage_sqlite until storage_select() picks another)
+extern const StorageEngine *storage;
+
+// Select an engine by name ("sqlite" or "memory") before opening it.
+// Returns 1 on success, 0 for an unknown name.
+int storage_select(const char *name);
+
+#endif // STORAGE_H
@@ -0,0 +1,971 @@
+#include "storage.h"
+#include "catalog.h"
+#include "dedup.h"
+#include "rng.h"
+#include "item_stats.h"
+#include "answer_sheet.h"
+#include "password.h"
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// In-memory storage engine: every table is a growable array indexed by id - 1,
+// so lookups by id are O(1) and ids are never reused. Nothing is written to
+// disk; the server lock serializes callers exactly as it does for SQLite.
+
+#define MEM_LOG_KEEP 4096          // Newest audit events kept (older ones are overwritten)
+
+typedef struct {
+    int *ids;
+    int count;
+    int cap;
+} IntList;
+
+typedef struct {
+    char name[64];
+    int count;                     // Live questions
+} MemTopic;
+
+typedef struct {
+    char name[32];
+    int level;
+    int count;
+} MemDifficulty;
+
+typedef struct {
+    Question q;                    // Strings in question_strings, topic/difficulty names included
+    int topic_id;
+    int difficulty_id;
+    int is_deleted;
+} MemQuestion;
+
+typedef struct {
+    char username[64];
+    char role[32];
+    char record[PASSWORD_RECORD_MAX];
+    int next_in_bucket;            // -1 terminates
+    int results_count;             // Running sums, like the user_stats table
+    long score_sum;
+    long total_sum;
+} MemUser;
+
+typedef struct {
+    char name[128];
+    int owner_id;
+    int duration_minutes;
+    int is_deleted;
+    IntList questions;             // Question ids in order_num order
+    IntList participants;
+} MemRoom;
+
+typedef struct {
+    int room_id;
+    int user_id;
+    int result_id;                 // 0 until a result is stored
+    int answer_count;
+    unsigned char *sheet;          // Packed answer sheet: ids then marks (answer_sheet.h)
+} MemParticipant;
+
+typedef struct {
+    int participant_id;
+    int room_id;
+    int score;
+    int total;
+    int correct;
+    int is_deleted;
+} MemResult;
+
+typedef struct {
+    int user_id;
+    time_t at;
+    char event_type[32];
+    char description[256];
+} MemLog;
+
+static MemTopic *topics = NULL;
+static int topic_count = 0, topic_cap = 0;
+static MemDifficulty *difficulties = NULL;
+static int difficulty_count = 0, difficulty_cap = 0;
+static MemQuestion *questions = NULL;
+static int question_count = 0, question_cap = 0;
+static Arena question_strings;     // Freed only on close, so readers get views
+static MemUser *users = NULL;
+static int user_count = 0, user_cap = 0;
+static int *user_buckets = NULL;
+static int user_bucket_count = 0;  // Power of two
+static MemRoom *rooms = NULL;
+static int room_count = 0, room_cap = 0;
+static MemParticipant *participants = NULL;
+static int participant_count = 0, participant_cap = 0;
+static MemResult *results = NULL;
+static int result_count = 0, result_cap = 0;
+
+// Transactions only need to undo question inserts (add_questions_bulk)
+static int txn_open = 0, txn_question_mark = 0, txn_topic_mark = 0;
+
+static MemLog log_ring[MEM_LOG_KEEP];
+static int log_enabled = 1;
+static unsigned long log_rows_written = 0, log_flushes = 0;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Make room for one more element; returns 0 when out of memory
+static int reserve_slot(void **items, int *cap, int count, size_t size) {
+    if (count < *cap) return 1;
+    int new_cap = *cap ? *cap * 2 : 64;
+    void *grown = realloc(*items, (size_t)new_cap * size);
+    if (!grown) {
+        fprintf(stderr, "Memory storage: out of memory\n");
+        return 0;
+    }
+    *items = grown;
+    *cap = new_cap;
+    return 1;
+}
+
+#define RESERVE(items, count, cap) reserve_slot((void**)&(items), &(cap), (count), sizeof(*(items)))
+
+static int int_list_push(IntList *list, int id) {
+    if (!RESERVE(list->ids, list->count, list->cap)) return 0;
+    list->ids[list->count++] = id;
+    return 1;
+}
+
+static void int_list_free(IntList *list) {
+    free(list->ids);
+    memset(list, 0, sizeof(*list));
+}
+
+// ===== Lookups =====
+
+// Topic and difficulty names compare case-insensitively (COLLATE NOCASE in SQLite)
+static int find_topic(const char *name) {
+    for (int i = 0; i < topic_count; i++) {
+        if (strcasecmp(topics[i].name, name) == 0) return i + 1;
+    }
+    return 0;
+}
+
+static int find_difficulty(const char *name) {
+    for (int i = 0; i < difficulty_count; i++) {
+        if (strcasecmp(difficulties[i].name, name) == 0) return i + 1;
+    }
+    return 0;
+}
+
+static MemQuestion* live_question(int id) {
+    if (id <= 0 || id > question_count || questions[id - 1].is_deleted) return NULL;
+    return &questions[id - 1];
+}
+
+static MemRoom* live_room(int id) {
+    if (id <= 0 || id > room_count || rooms[id - 1].is_deleted) return NULL;
+    return &rooms[id - 1];
+}
+
+static unsigned int name_hash(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+// Returns the user index or -1
+static int find_user(const char *username) {
+    if (user_bucket_count == 0) return -1;
+    int i = user_buckets[name_hash(username) & (user_bucket_count - 1)];
+    for (; i >= 0; i = users[i].next_in_bucket) {
+        if (strcmp(users[i].username, username) == 0) return i;
+    }
+    return -1;
+}
+
+static void link_user(int i) {
+    int *bucket = &user_buckets[name_hash(users[i].username) & (user_bucket_count - 1)];
+    users[i].next_in_bucket = *bucket;
+    *bucket = i;
+}
+
+// Keep chains short: double the bucket array once users outnumber buckets
+static int grow_user_buckets(void) {
+    int nbuckets = user_bucket_count ? user_bucket_count * 2 : 256;
+    int *grown = malloc(nbuckets * sizeof(int));
+    if (!grown) return 0;
+    free(user_buckets);
+    user_buckets = grown;
+    user_bucket_count = nbuckets;
+    for (int i = 0; i < nbuckets; i++) user_buckets[i] = -1;
+    for (int i = 0; i < user_count; i++) {
+        if (users[i].username[0]) link_user(i);
+    }
+    return 1;
+}
+
+static void fill_view(const MemQuestion *m, DBQuestionView *v) {
+    v->id = m->q.id;
+    v->text = question_text(&m->q);
+    v->option_a = question_option(&m->q, 0);
+    v->option_b = question_option(&m->q, 1);
+    v->option_c = question_option(&m->q, 2);
+    v->option_d = question_option(&m->q, 3);
+    v->correct_option = m->q.correct;
+    v->topic_id = m->topic_id;
+    v->difficulty_id = m->difficulty_id;
+}
+
+// ===== Questions =====
+
+static int add_topic(const char *name) {
+    if (!RESERVE(topics, topic_count, topic_cap)) return 0;
+    MemTopic *t = &topics[topic_count++];
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->count = 0;
+    return topic_count;
+}
+
+static int add_difficulty(const char *name, int level) {
+    if (!RESERVE(difficulties, difficulty_count, difficulty_cap)) return 0;
+    MemDifficulty *d = &difficulties[difficulty_count++];
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    d->level = level;
+    d->count = 0;
+    return difficulty_count;
+}
+
+static int mem_add_question(const char *text, const char *opt_a, const char *opt_b,
+                            const char *opt_c, const char *opt_d, char correct,
+                            const char *topic, const char *difficulty, int created_by_id) {
+    (void)created_by_id;
+    char topic_lower[64], difficulty_lower[32];
+    snprintf(topic_lower, sizeof(topic_lower), "%s", topic);
+    snprintf(difficulty_lower, sizeof(difficulty_lower), "%s", difficulty);
+    for (int i = 0; topic_lower[i]; i++) topic_lower[i] = tolower((unsigned char)topic_lower[i]);
+    for (int i = 0; difficulty_lower[i]; i++) {
+        difficulty_lower[i] = tolower((unsigned char)difficulty_lower[i]);
+    }
+
+    int topic_id = find_topic(topic_lower);
+    if (topic_id == 0) {
+        topic_id = add_topic(topic_lower);
+        if (topic_id == 0) {
+            fprintf(stderr, "Error: failed to create topic '%s'\n", topic_lower);
+            return -1;
+        }
+        catalog_on_topic_added(topic_id, topic_lower);
+    }
+
+    int difficulty_id = find_difficulty(difficulty_lower);
+    if (difficulty_id == 0) {
+        fprintf(stderr, "Error: invalid difficulty '%s' (must be easy, medium, or hard)\n", difficulty_lower);
+        return -2;
+    }
+
+    if (!RESERVE(questions, question_count, question_cap)) return -1;
+    MemQuestion *m = &questions[question_count];
+    memset(m, 0, sizeof(*m));
+    Question *q = &m->q;
+    if (!question_build(q, &question_strings, question_count + 1, text, opt_a, opt_b, opt_c, opt_d,
+                        correct, topics[topic_id - 1].name, difficulties[difficulty_id - 1].name)) {
+        return -1;
+    }
+    question_count++;
+    m->topic_id = topic_id;
+    m->difficulty_id = difficulty_id;
+    topics[topic_id - 1].count++;
+    difficulties[difficulty_id - 1].count++;
+
+    catalog_on_question_added(q->id, text, opt_a, opt_b, opt_c, opt_d, correct,
+                              topic_id, difficulty_id);
+    dedup_on_question_added(q->id, text, opt_a, opt_b, opt_c, opt_d);
+    return q->id;
+}
+
+static int mem_get_question(int id, Question *q, Arena *arena) {
+    (void)arena;
+    MemQuestion *m = live_question(id);
+    if (!m) return 0;
+    *q = m->q;
+    return 1;
+}
+
+static void unlink_question(MemQuestion *m) {
+    m->is_deleted = 1;
+    topics[m->topic_id - 1].count--;
+    difficulties[m->difficulty_id - 1].count--;
+}
+
+static int mem_delete_question(int id) {
+    MemQuestion *m = live_question(id);
+    if (!m) return 0;
+    unlink_question(m);
+    catalog_on_question_deleted(id);
+    dedup_on_question_deleted(id);
+    return 1;
+}
+
+// Mark the names of a "name:count name:count ..." filter in wanted[id]
+static void mark_filter(const char *filter, int (*find)(const char*), char *wanted) {
+    char name[128];
+    int n;
+    while (filter && sscanf(filter, "%127s%n", name, &n) == 1) {
+        filter += n;
+        char *colon = strchr(name, ':');
+        if (colon) *colon = '\0';
+        wanted[find(name)] = 1;
+    }
+}
+
+// Same contract as the SQL version: live questions whose topic and difficulty
+// are named in the filters (empty filter = any), in random order
+static int mem_get_questions_with_distribution(const char *topic_filter, const char *diff_filter,
+                                               Question *out, int max_count, Arena *arena) {
+    (void)arena;
+    int any_topic = !topic_filter || !topic_filter[0];
+    int any_diff = !diff_filter || !diff_filter[0];
+    char *topic_wanted = calloc(topic_count + 1, 1);
+    char *diff_wanted = calloc(difficulty_count + 1, 1);
+    int *picks = malloc((question_count + 1) * sizeof(int));
+    if (!topic_wanted || !diff_wanted || !picks) {
+        free(topic_wanted);
+        free(diff_wanted);
+        free(picks);
+        return 0;
+    }
+    if (!any_topic) mark_filter(topic_filter, find_topic, topic_wanted);
+    if (!any_diff) mark_filter(diff_filter, find_difficulty, diff_wanted);
+
+    int matches = 0;
+    for (int i = 0; i < question_count; i++) {
+        const MemQuestion *m = &questions[i];
+        if (m->is_deleted) continue;
+        if (!any_topic && !topic_wanted[m->topic_id]) continue;
+        if (!any_diff && !diff_wanted[m->difficulty_id]) continue;
+        picks[matches++] = i;
+    }
+
+    // Partial Fisher-Yates: only the first max_count slots need shuffling
+    int count = matches < max_count ? matches : max_count;
+    Rng *rng = rng_thread();
+    for (int i = 0; i < count; i++) {
+        int j = i + (int)rng_below(rng, (uint32_t)(matches - i));
+        int tmp = picks[i];
+        picks[i] = picks[j];
+        picks[j] = tmp;
+        out[i] = questions[picks[i]].q;
+    }
+
+    free(topic_wanted);
+    free(diff_wanted);
+    free(picks);
+    return count;
+}
+
+static int compare_topic_names(const void *a, const void *b) {
+    return strcasecmp(topics[*(const int*)a].name, topics[*(const int*)b].name);
+}
+
+static int mem_get_all_topics(char *output) {
+    output[0] = '\0';
+    int *order = malloc((topic_count + 1) * sizeof(int));
+    if (!order) return 0;
+    for (int i = 0; i < topic_count; i++) order[i] = i;
+    qsort(order, topic_count, sizeof(int), compare_topic_names);
+
+    int len = 0;
+    for (int i = 0; i < topic_count; i++) {
+        const MemTopic *t = &topics[order[i]];
+        len += sprintf(output + len, "%s%s:%d", i ? "|" : "", t->name, t->count);
+    }
+    free(order);
+    return topic_count;
+}
+
+static int mem_get_all_difficulties(char *output) {
+    output[0] = '\0';
+    int len = 0, count = 0;
+    for (int level = 1; level <= 3; level++) {
+        for (int i = 0; i < difficulty_count; i++) {
+            if (difficulties[i].level != level) continue;
+            len += sprintf(output + len, "%s%s:%d", count ? "|" : "",
+                           difficulties[i].name, difficulties[i].count);
+            count++;
+        }
+    }
+    return count;
+}
+
+static int mem_for_each_question(db_question_callback cb, void *ctx) {
+    if (!cb) return 0;
+    int count = 0;
+    for (int i = 0; i < question_count; i++) {
+        if (questions[i].is_deleted) continue;
+        DBQuestionView v;
+        fill_view(&questions[i], &v);
+        cb(&v, ctx);
+        count++;
+    }
+    return count;
+}
+
+// Keyset page over one topic or difficulty: ids start right after after_id
+static int mem_for_each_question_page(int by_topic, int key_id, int after_id, int limit,
+                                      db_question_callback cb, void *ctx) {
+    if (!cb || key_id == 0) return 0;
+    int count = 0;
+    for (int i = after_id > 0 ? after_id : 0; i < question_count && count < limit; i++) {
+        const MemQuestion *m = &questions[i];
+        if (m->is_deleted || (by_topic ? m->topic_id : m->difficulty_id) != key_id) continue;
+        DBQuestionView v;
+        fill_view(m, &v);
+        cb(&v, ctx);
+        count++;
+    }
+    return count;
+}
+
+static int mem_for_each_question_in_topic(const char *topic, int after_id, int limit,
+                                          db_question_callback cb, void *ctx) {
+    if (!topic) return 0;
+    return mem_for_each_question_page(1, find_topic(topic), after_id, limit, cb, ctx);
+}
+
+static int mem_for_each_question_in_difficulty(const char *difficulty, int after_id, int limit,
+                                               db_question_callback cb, void *ctx) {
+    if (!difficulty) return 0;
+    return mem_for_each_question_page(0, find_difficulty(difficulty), after_id, limit, cb, ctx);
+}
+
+static int mem_for_each_topic(db_name_callback cb, void *ctx) {
+    if (!cb) return 0;
+    for (int i = 0; i < topic_count; i++) cb(i + 1, topics[i].name, 0, ctx);
+    return topic_count;
+}
+
+static int mem_for_each_difficulty(db_name_callback cb, void *ctx) {
+    if (!cb) return 0;
+    for (int i = 0; i < difficulty_count; i++) {
+        cb(i + 1, difficulties[i].name, difficulties[i].level, ctx);
+    }
+    return difficulty_count;
+}
+
+static int contains_nocase(const char *haystack, const char *needle, int needle_len) {
+    for (; *haystack; haystack++) {
+        if (strncasecmp(haystack, needle, needle_len) == 0) return 1;
+    }
+    return 0;
+}
+
+// No full-text index here: every term (same tokenizing as the FTS5 query) must
+// appear in the text or an option, case-insensitively. Matches come in id order.
+static int mem_search_questions_text(const char *terms, char *output, int max_size, int limit) {
+    if (!terms || !output || max_size <= 0) return -1;
+    output[0] = '\0';
+
+    const char *starts[16];
+    int lens[16], term_count = 0;
+    const char *p = terms;
+    while (*p && term_count < 16) {
+        while (*p && !isalnum((unsigned char)*p) && (unsigned char)*p < 0x80) p++;
+        if (!*p) break;
+        const char *start = p;
+        while (*p && (isalnum((unsigned char)*p) || (unsigned char)*p >= 0x80)) p++;
+        starts[term_count] = start;
+        lens[term_count++] = (int)(p - start);
+    }
+    if (term_count == 0) return 0;
+
+    int count = 0, len = 0;
+    for (int i = 0; i < question_count && count < limit; i++) {
+        const MemQuestion *m = &questions[i];
+        if (m->is_deleted) continue;
+        int all = 1;
+        for (int t = 0; t < term_count && all; t++) {
+            all = contains_nocase(question_text(&m->q), starts[t], lens[t]);
+            for (int o = 0; o < 4 && !all; o++) {
+                all = contains_nocase(question_option(&m->q, o), starts[t], lens[t]);
+            }
+        }
+        if (!all) continue;
+        int n = snprintf(output + len, max_size - len, "%d|%s\n", m->q.id, question_text(&m->q));
+        if (n < 0 || n >= max_size - len) {
+            output[len] = '\0';
+            break;
+        }
+        len += n;
+        count++;
+    }
+    return count;
+}
+
+// Ids index the question array, so tombstones stay where they are; there is
+// nothing to purge or renumber
+static int mem_compact_questions(int batch_size) {
+    return batch_size > 0 ? 0 : -1;
+}
+
+// ===== Users =====
+
+static int mem_add_user(const char *username, const char *password, const char *role) {
+    if (!username || !username[0] || find_user(username) >= 0) return -1;
+    if (!RESERVE(users, user_count, user_cap)) return -1;
+    if (user_count >= user_bucket_count && !grow_user_buckets()) return -1;
+
+    MemUser *u = &users[user_count];
+    memset(u, 0, sizeof(*u));
+    snprintf(u->username, sizeof(u->username), "%s", username);
+    snprintf(u->role, sizeof(u->role), "%s", role ? role : "student");
+    snprintf(u->record, sizeof(u->record), "%s", password ? password : "");
+    link_user(user_count);
+    return ++user_count;
+}
+
+static int mem_get_user_auth(const char *username, int *user_id, char *role, size_t role_size,
+                             char *record, size_t record_size) {
+    if (!username) return -1;
+    int i = find_user(username);
+    if (i < 0) return 0;
+    if (user_id) *user_id = i + 1;
+    if (role) snprintf(role, role_size, "%s", users[i].role);
+    if (record) snprintf(record, record_size, "%s", users[i].record);
+    return 1;
+}
+
+static int mem_set_user_password(int user_id, const char *record) {
+    if (user_id <= 0 || user_id > user_count || !users[user_id - 1].username[0]) return 0;
+    snprintf(users[user_id - 1].record, PASSWORD_RECORD_MAX, "%s", record);
+    return 1;
+}
+
+static int mem_username_exists(const char *username) {
+    return username && find_user(username) >= 0;
+}
+
+// ===== Rooms =====
+
+static int mem_create_room(const char *name, int owner_id, int duration_minutes) {
+    if (!name || !RESERVE(rooms, room_count, room_cap)) return -1;
+    MemRoom *r = &rooms[room_count++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->owner_id = owner_id;
+    r->duration_minutes = duration_minutes;
+    return room_count;
+}
+
+static int mem_add_questions_to_room(int room_id, int count, const int *question_ids) {
+    MemRoom *r = live_room(room_id);
+    if (!r) return 0;
+    for (int i = 0; i < count; i++) {
+        if (question_ids[i] <= 0 || !int_list_push(&r->questions, question_ids[i])) return 0;
+    }
+    return 1;
+}
+
+static int mem_get_room_id_by_name(const char *room_name) {
+    if (!room_name) return -1;
+    for (int i = 0; i < room_count; i++) {
+        if (!rooms[i].is_deleted && strcmp(rooms[i].name, room_name) == 0) return i + 1;
+    }
+    return -1;
+}
+
+// Drops the room's results (and their share of the user sums) with the room
+static int mem_delete_room(int room_id) {
+    MemRoom *r = live_room(room_id);
+    if (!r) return 0;
+    for (int i = 0; i < r->participants.count; i++) {
+        MemParticipant *p = &participants[r->participants.ids[i] - 1];
+        if (p->result_id == 0) continue;
+        MemResult *res = &results[p->result_id - 1];
+        MemUser *u = &users[p->user_id - 1];
+        u->results_count--;
+        u->score_sum -= res->score;
+        u->total_sum -= res->total;
+        res->is_deleted = 1;
+        p->result_id = 0;
+    }
+    int_list_free(&r->questions);
+    int_list_free(&r->participants);
+    r->is_deleted = 1;
+    return 1;
+}
+
+// ===== Participants & answers =====
+
+static int mem_add_participant(int room_id, int user_id) {
+    MemRoom *r = live_room(room_id);
+    if (!r || user_id <= 0 || user_id > user_count) return -1;
+    for (int i = 0; i < r->participants.count; i++) {
+        if (participants[r->participants.ids[i] - 1].user_id == user_id) return -1;
+    }
+    if (!RESERVE(participants, participant_count, participant_cap)) return -1;
+    if (!int_list_push(&r->participants, participant_count + 1)) return -1;
+
+    MemParticipant *p = &participants[participant_count++];
+    memset(p, 0, sizeof(*p));
+    p->room_id = room_id;
+    p->user_id = user_id;
+    return participant_count;
+}
+
+// Kept packed, as in ANSWER_STORAGE_PACKED mode (a later sheet replaces the earlier one)
+static int mem_record_answers(int participant_id, int count, const int *question_ids,
+                              const char *selected, const int *is_correct) {
+    if (count <= 0) return 1;
+    if (participant_id <= 0 || participant_id > participant_count) return 0;
+
+    unsigned char *sheet = malloc(ANSWER_SHEET_IDS_SIZE(count) + ANSWER_SHEET_MARKS_SIZE(count));
+    if (!sheet) return 0;
+    answer_sheet_pack(count, question_ids, selected, is_correct,
+                      sheet, sheet + ANSWER_SHEET_IDS_SIZE(count));
+
+    MemParticipant *p = &participants[participant_id - 1];
+    free(p->sheet);
+    p->sheet = sheet;
+    p->answer_count = count;
+    item_stats_on_answers(count, question_ids, selected, is_correct);
+    return 1;
+}
+
+// ===== Results =====
+
+static int mem_add_result(int participant_id, int room_id, int score, int total, int correct) {
+    if (participant_id <= 0 || participant_id > participant_count || !live_room(room_id)) return -1;
+    MemParticipant *p = &participants[participant_id - 1];
+    if (p->result_id != 0 || p->room_id != room_id) return -1;
+    if (!RESERVE(results, result_count, result_cap)) return -1;
+
+    MemResult *res = &results[result_count++];
+    res->participant_id = participant_id;
+    res->room_id = room_id;
+    res->score = score;
+    res->total = total;
+    res->correct = correct;
+    res->is_deleted = 0;
+    p->result_id = result_count;
+
+    MemUser *u = &users[p->user_id - 1];
+    u->results_count++;
+    u->score_sum += score;
+    u->total_sum += total;
+    return result_count;
+}
+
+static int mem_for_each_result(db_result_callback cb, void *ctx) {
+    if (!cb) return 0;
+    int count = 0;
+    for (int i = 0; i < result_count; i++) {
+        const MemResult *res = &results[i];
+        if (res->is_deleted) continue;
+        const MemParticipant *p = &participants[res->participant_id - 1];
+        cb(res->room_id, rooms[res->room_id - 1].name, users[p->user_id - 1].username,
+           res->score, res->total, ctx);
+        count++;
+    }
+    return count;
+}
+
+static int mem_for_each_user_stat(db_user_stat_callback cb, void *ctx) {
+    if (!cb) return 0;
+    int count = 0;
+    for (int i = 0; i < user_count; i++) {
+        const MemUser *u = &users[i];
+        if (u->results_count <= 0) continue;
+        cb(u->username, u->results_count, u->score_sum, u->total_sum, ctx);
+        count++;
+    }
+    return count;
+}
+
+static int mem_for_each_room_user_stat(int room_id, db_user_stat_callback cb, void *ctx) {
+    MemRoom *r = live_room(room_id);
+    if (!r || !cb) return 0;
+    int count = 0;
+    for (int i = 0; i < r->participants.count; i++) {
+        const MemParticipant *p = &participants[r->participants.ids[i] - 1];
+        if (p->result_id == 0) continue;
+        const MemResult *res = &results[p->result_id - 1];
+        cb(users[p->user_id - 1].username, 1, res->score, res->total, ctx);
+        count++;
+    }
+    return count;
+}
+
+// ===== Practice, item statistics and exam templates =====
+
+// The scheduler's decks, the running item statistics and the exam templates
+// are the only copy: like everything else here, they end with the process
+static int mem_save_practice_cards(int count, const DBPracticeCard *cards) {
+    (void)count; (void)cards;
+    return 1;
+}
+
+static int mem_for_each_practice_card(db_practice_card_callback cb, void *ctx) {
+    (void)cb; (void)ctx;
+    return 0;
+}
+
+static int mem_save_item_stats(int count, const DBItemStats *items) {
+    (void)count; (void)items;
+    return 1;
+}
+
+static int mem_for_each_item_stats(db_item_stats_callback cb, void *ctx) {
+    (void)cb; (void)ctx;
+    return 0;
+}
+
+static int mem_save_exam_template(const DBExamTemplate *t, int created_by) {
+    (void)t; (void)created_by;
+    return 1;
+}
+
+static int mem_delete_exam_template(const char *name) {
+    (void)name;
+    return 1;
+}
+
+static int mem_for_each_exam_template(db_exam_template_callback cb, void *ctx) {
+    (void)cb; (void)ctx;
+    return 0;
+}
+
+// ===== Logs =====
+
+// Events go straight into a ring of the newest MEM_LOG_KEEP; nothing is pending
+static int mem_add_log(int user_id, const char *event_type, const char *description) {
+    pthread_mutex_lock(&log_lock);
+    if (log_enabled) {
+        MemLog *row = &log_ring[log_rows_written % MEM_LOG_KEEP];
+        row->user_id = user_id;
+        row->at = time(NULL);
+        snprintf(row->event_type, sizeof(row->event_type), "%s", event_type ? event_type : "");
+        snprintf(row->description, sizeof(row->description), "%s", description ? description : "");
+        log_rows_written++;
+    }
+    pthread_mutex_unlock(&log_lock);
+    return 1;
+}
+
+static int mem_flush_logs(void) {
+    pthread_mutex_lock(&log_lock);
+    log_flushes++;
+    pthread_mutex_unlock(&log_lock);
+    return 0;
+}
+
+static void mem_set_log_enabled(int enabled) {
+    pthread_mutex_lock(&log_lock);
+    log_enabled = enabled ? 1 : 0;
+    pthread_mutex_unlock(&log_lock);
+}
+
+static void mem_get_log_stats(DBLogStats *stats) {
+    pthread_mutex_lock(&log_lock);
+    stats->enabled = log_enabled;
+    stats->pending = 0;
+    stats->written = log_rows_written;
+    stats->failed = 0;
+    stats->flushes = log_flushes;
+    pthread_mutex_unlock(&log_lock);
+}
+
+// ===== Transactions =====
+
+static int mem_begin_transaction(void) {
+    if (txn_open) {
+        fprintf(stderr, "Error beginning transaction: already open\n");
+        return 0;
+    }
+    txn_open = 1;
+    txn_question_mark = question_count;
+    txn_topic_mark = topic_count;
+    return 1;
+}
+
+static int mem_commit_transaction(void) {
+    if (!txn_open) return 0;
+    txn_open = 0;
+    return 1;
+}
+
+// Drops questions and topics added since BEGIN (callers reload the catalog);
+// their strings stay in question_strings until close
+static void mem_rollback_transaction(void) {
+    if (!txn_open) return;
+    while (question_count > txn_question_mark) {
+        MemQuestion *m = &questions[--question_count];
+        if (!m->is_deleted) unlink_question(m);
+    }
+    topic_count = txn_topic_mark;
+    txn_open = 0;
+}
+
+// ===== Lifecycle =====
+
+static void mem_close(void) {
+    for (int i = 0; i < room_count; i++) {
+        int_list_free(&rooms[i].questions);
+        int_list_free(&rooms[i].participants);
+    }
+    for (int i = 0; i < participant_count; i++) free(participants[i].sheet);
+    free(topics);
+    free(difficulties);
+    free(questions);
+    arena_free(&question_strings);
+    free(users);
+    free(user_buckets);
+    free(rooms);
+    free(participants);
+    free(results);
+    topics = NULL; difficulties = NULL; questions = NULL; users = NULL;
+    user_buckets = NULL; rooms = NULL; participants = NULL; results = NULL;
+    topic_count = topic_cap = difficulty_count = difficulty_cap = 0;
+    question_count = question_cap = user_count = user_cap = user_bucket_count = 0;
+    room_count = room_cap = participant_count = participant_cap = result_count = result_cap = 0;
+    txn_open = 0;
+}
+
+#define SQL_SEED_TOPICS "SELECT name FROM topics ORDER BY id"
+#define SQL_SEED_QUESTIONS \
+    "SELECT q.id, q.text, q.option_a, q.option_b, q.option_c, q.option_d, " \
+    "q.correct_option, t.name, d.name FROM questions q " \
+    "JOIN topics t ON q.topic_id = t.id JOIN difficulties d ON q.difficulty_id = d.id " \
+    "WHERE q.is_deleted = 0 ORDER BY q.id"
+#define SQL_SEED_USERS "SELECT id, username, password, role FROM users ORDER BY id"
+
+static const char* column_text(sqlite3_stmt *stmt, int col) {
+    const char *s = (const char*)sqlite3_column_text(stmt, col);
+    return s ? s : "";
+}
+
+// Copy the question bank and accounts out of a database file, keeping their
+// ids (gaps become tombstones / unused slots). Rooms, results and logs start empty.
+static void mem_seed(const char *path) {
+    sqlite3 *src = NULL;
+    if (sqlite3_open_v2(path, &src, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Memory storage: cannot read %s: %s\n", path, sqlite3_errmsg(src));
+        sqlite3_close(src);
+        return;
+    }
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(src, SQL_SEED_TOPICS, -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *name = column_text(stmt, 0);
+            if (!find_topic(name)) add_topic(name);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    int seeded_questions = 0, seeded_users = 0;
+    if (sqlite3_prepare_v2(src, SQL_SEED_QUESTIONS, -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int id = sqlite3_column_int(stmt, 0);
+            while (question_count < id - 1 && RESERVE(questions, question_count, question_cap)) {
+                memset(&questions[question_count], 0, sizeof(MemQuestion));
+                questions[question_count].q.id = question_count + 1;
+                questions[question_count++].is_deleted = 1;
+            }
+            const char *correct = column_text(stmt, 6);
+            if (mem_add_question(column_text(stmt, 1), column_text(stmt, 2), column_text(stmt, 3),
+                                 column_text(stmt, 4), column_text(stmt, 5), correct[0] ? correct[0] : 'A',
+                                 column_text(stmt, 7), column_text(stmt, 8), 0) > 0) {
+                seeded_questions++;
+            }
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        // e.g. a file from an older build; the sqlite engine upgrades it on open
+        fprintf(stderr, "Memory storage: cannot copy questions from %s: %s\n", path, sqlite3_errmsg(src));
+    }
+
+    if (sqlite3_prepare_v2(src, SQL_SEED_USERS, -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int id = sqlite3_column_int(stmt, 0);
+            while (user_count < id - 1 && RESERVE(users, user_count, user_cap)) {
+                memset(&users[user_count++], 0, sizeof(MemUser));
+            }
+            if (mem_add_user(column_text(stmt, 1), column_text(stmt, 2), column_text(stmt, 3)) > 0) {
+                seeded_users++;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(src);
+    printf("Memory storage: copied %d questions and %d users from %s\n",
+           seeded_questions, seeded_users, path);
+}
+
+static int mem_open(const char *path) {
+    mem_close();
+    if (!add_difficulty("easy", 1) || !add_difficulty("medium", 2) || !add_difficulty("hard", 3)) {
+        return 0;
+    }
+    if (path && access(path, R_OK) == 0) mem_seed(path);
+    return 1;
+}
+
+const StorageEngine storage_memory = {
+    .name = "memory",
+    .on_disk = 0,
+    .open = mem_open,
+    .close = mem_close,
+
+    .add_question = mem_add_question,
+    .get_question = mem_get_question,
+    .delete_question = mem_delete_question,
+    .get_questions_with_distribution = mem_get_questions_with_distribution,
+    .get_all_topics = mem_get_all_topics,
+    .get_all_difficulties = mem_get_all_difficulties,
+    .for_each_question = mem_for_each_question,
+    .for_each_question_in_topic = mem_for_each_question_in_topic,
+    .for_each_question_in_difficulty = mem_for_each_question_in_difficulty,
+    .for_each_topic = mem_for_each_topic,
+    .for_each_difficulty = mem_for_each_difficulty,
+    .search_questions_text = mem_search_questions_text,
+    .compact_questions = mem_compact_questions,
+
+    .add_user = mem_add_user,
+    .get_user_auth = mem_get_user_auth,
+    .set_user_password = mem_set_user_password,
+    .username_exists = mem_username_exists,
+
+    .create_room = mem_create_room,
+    .add_questions_to_room = mem_add_questions_to_room,
+    .get_room_id_by_name = mem_get_room_id_by_name,
+    .delete_room = mem_delete_room,
+
+    .add_participant = mem_add_participant,
+    .record_answers = mem_record_answers,
+
+    .add_result = mem_add_result,
+    .for_each_result = mem_for_each_result,
+    .for_each_user_stat = mem_for_each_user_stat,
+    .for_each_room_user_stat = mem_for_each_room_user_stat,
+
+    .save_practice_cards = mem_save_practice_cards,
+    .for_each_practice_card = mem_for_each_practice_card,
+
+    .save_item_stats = mem_save_item_stats,
+    .for_each_item_stats = mem_for_each_item_stats,
+
+    .save_exam_template = mem_save_exam_template,
+    .delete_exam_template = mem_delete_exam_template,
+    .for_each_exam_template = mem_for_each_exam_template,
+
+    .add_log = mem_add_log,
+    .flush_logs = mem_flush_logs,
+    .set_log_enabled = mem_set_log_enabled,
+    .get_log_stats = mem_get_log_stats,
+
+    .begin_transaction = mem_begin_transaction,
+    .commit_transaction = mem_commit_transaction,
+    .rollback_transaction = mem_rollback_transaction
+};
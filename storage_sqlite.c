@@ -0,0 +1,81 @@
+#include "storage.h"
+#include "db_init.h"
+#include <stdio.h>
+
+// The SQLite engine is db_queries.c itself; only opening needs a wrapper
+
+static int sqlite_open(const char *path) {
+    if (!db_init(path)) {
+        fprintf(stderr, "Failed to initialize database\n");
+        return 0;
+    }
+    if (!db_create_tables()) {
+        fprintf(stderr, "Failed to create database tables\n");
+        db_close();
+        return 0;
+    }
+    if (!db_init_default_difficulties()) {
+        fprintf(stderr, "Failed to initialize difficulties\n");
+        db_close();
+        return 0;
+    }
+    return 1;
+}
+
+const StorageEngine storage_sqlite = {
+    .name = "sqlite",
+    .on_disk = 1,
+    .open = sqlite_open,
+    .close = db_close,
+
+    .add_question = db_add_question,
+    .get_question = db_get_question,
+    .delete_question = db_delete_question,
+    .get_questions_with_distribution = db_get_questions_with_distribution,
+    .get_all_topics = db_get_all_topics,
+    .get_all_difficulties = db_get_all_difficulties,
+    .for_each_question = db_for_each_question,
+    .for_each_question_in_topic = db_for_each_question_in_topic,
+    .for_each_question_in_difficulty = db_for_each_question_in_difficulty,
+    .for_each_topic = db_for_each_topic,
+    .for_each_difficulty = db_for_each_difficulty,
+    .search_questions_text = db_search_questions_text,
+    .compact_questions = db_compact_questions,
+
+    .add_user = db_add_user,
+    .get_user_auth = db_get_user_auth,
+    .set_user_password = db_set_user_password,
+    .username_exists = db_username_exists,
+
+    .create_room = db_create_room,
+    .add_questions_to_room = db_add_questions_to_room,
+    .get_room_id_by_name = db_get_room_id_by_name,
+    .delete_room = db_delete_room,
+
+    .add_participant = db_add_participant,
+    .record_answers = db_record_answers,
+
+    .add_result = db_add_result,
+    .for_each_result = db_for_each_result,
+    .for_each_user_stat = db_for_each_user_stat,
+    .for_each_room_user_stat = db_for_each_room_user_stat,
+
+    .save_practice_cards = db_save_practice_cards,
+    .for_each_practice_card = db_for_each_practice_card,
+
+    .save_item_stats = db_save_item_stats,
+    .for_each_item_stats = db_for_each_item_stats,
+
+    .save_exam_template = db_save_exam_template,
+    .delete_exam_template = db_delete_exam_template,
+    .for_each_exam_template = db_for_each_exam_template,
+
+    .add_log = db_add_log,
+    .flush_logs = db_flush_logs,
+    .set_log_enabled = db_set_log_enabled,
+    .get_log_stats = db_get_log_stats,
+
+    .begin_transaction = db_begin_transaction,
+    .commit_transaction = db_commit_transaction,
+    .rollback_transaction = db_rollback_transaction
+};
@@ -0,0 +1,291 @@
+#include "user_directory.h"
+#include "password.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME_MAX_LEN 64
+#define ROLE_MAX_LEN 32
+
+// ===== Cache: hash chains + LRU list over a fixed entry array =====
+
+typedef struct {
+    char username[NAME_MAX_LEN];
+    char role[ROLE_MAX_LEN];
+    char record[PASSWORD_RECORD_MAX];
+    int user_id;
+    int next_in_bucket;             // -1 terminates
+    int lru_prev, lru_next;         // Most recently used at lru_head
+} DirEntry;
+
+static DirEntry *entries = NULL;
+static int *buckets = NULL;
+static int capacity = 0, bucket_mask = 0;
+static int lru_head = -1, lru_tail = -1, free_list = -1;
+static unsigned long generation = 0;   // Bumped on invalidation; stale loads are not cached
+static pthread_mutex_t dir_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t *server_db_lock = NULL;
+
+static unsigned int name_hash(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static void lru_unlink(int i) {
+    DirEntry *e = &entries[i];
+    if (e->lru_prev >= 0) entries[e->lru_prev].lru_next = e->lru_next;
+    else lru_head = e->lru_next;
+    if (e->lru_next >= 0) entries[e->lru_next].lru_prev = e->lru_prev;
+    else lru_tail = e->lru_prev;
+}
+
+static void lru_push_front(int i) {
+    entries[i].lru_prev = -1;
+    entries[i].lru_next = lru_head;
+    if (lru_head >= 0) entries[lru_head].lru_prev = i;
+    lru_head = i;
+    if (lru_tail < 0) lru_tail = i;
+}
+
+// Caller holds dir_lock. Returns the entry index or -1.
+static int dir_find(const char *username) {
+    for (int i = buckets[name_hash(username) & bucket_mask]; i >= 0; i = entries[i].next_in_bucket) {
+        if (strcmp(entries[i].username, username) == 0) return i;
+    }
+    return -1;
+}
+
+// Caller holds dir_lock; unlinks entry i from its chain and the LRU list and frees it
+static void dir_remove(int i) {
+    int *link = &buckets[name_hash(entries[i].username) & bucket_mask];
+    while (*link != i) link = &entries[*link].next_in_bucket;
+    *link = entries[i].next_in_bucket;
+    lru_unlink(i);
+    entries[i].next_in_bucket = free_list;
+    free_list = i;
+}
+
+// Copy a cached entry out; returns 1 on a hit
+static int dir_get(const char *username, int *user_id, char *role, int role_size, char *record) {
+    pthread_mutex_lock(&dir_lock);
+    int i = dir_find(username);
+    if (i >= 0) {
+        lru_unlink(i);
+        lru_push_front(i);
+        *user_id = entries[i].user_id;
+        snprintf(role, role_size, "%s", entries[i].role);
+        memcpy(record, entries[i].record, PASSWORD_RECORD_MAX);
+    }
+    pthread_mutex_unlock(&dir_lock);
+    return i >= 0;
+}
+
+// Insert or refresh an entry, evicting the least recently used one when full.
+// Skipped when an invalidation happened since the caller read the database.
+static void dir_put(const char *username, int user_id, const char *role, const char *record,
+                    unsigned long seen_generation) {
+    if (strlen(username) >= NAME_MAX_LEN) return;
+
+    pthread_mutex_lock(&dir_lock);
+    if (seen_generation == generation) {
+        int i = dir_find(username);
+        if (i >= 0) {
+            lru_unlink(i);
+        } else {
+            if (free_list < 0) dir_remove(lru_tail);
+            i = free_list;
+            free_list = entries[i].next_in_bucket;
+            snprintf(entries[i].username, NAME_MAX_LEN, "%s", username);
+            int *bucket = &buckets[name_hash(username) & bucket_mask];
+            entries[i].next_in_bucket = *bucket;
+            *bucket = i;
+        }
+        entries[i].user_id = user_id;
+        snprintf(entries[i].role, ROLE_MAX_LEN, "%s", role);
+        snprintf(entries[i].record, PASSWORD_RECORD_MAX, "%s", record);
+        lru_push_front(i);
+    }
+    pthread_mutex_unlock(&dir_lock);
+}
+
+static unsigned long dir_generation(void) {
+    pthread_mutex_lock(&dir_lock);
+    unsigned long g = generation;
+    pthread_mutex_unlock(&dir_lock);
+    return g;
+}
+
+void user_directory_invalidate(const char *username) {
+    if (!entries || !username) return;
+    pthread_mutex_lock(&dir_lock);
+    int i = dir_find(username);
+    if (i >= 0) dir_remove(i);
+    generation++;
+    pthread_mutex_unlock(&dir_lock);
+}
+
+// ===== Hashing worker pool =====
+
+typedef enum { AUTH_VERIFY, AUTH_HASH } AuthJobType;
+
+typedef struct AuthJob {
+    AuthJobType type;
+    const char *password;
+    const char *record;             // AUTH_VERIFY input
+    char *out;                      // AUTH_HASH output (PASSWORD_RECORD_MAX bytes)
+    int result;
+    int done;
+    struct AuthJob *next;
+} AuthJob;
+
+static AuthJob *queue_head = NULL, *queue_tail = NULL;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static int pool_workers = 0;
+
+static void auth_job_execute(AuthJob *job) {
+    if (job->type == AUTH_VERIFY) job->result = password_verify(job->password, job->record);
+    else job->result = password_hash(job->password, job->out, PASSWORD_RECORD_MAX);
+}
+
+static void* auth_worker(void *arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&pool_lock);
+        while (!queue_head) pthread_cond_wait(&pool_work, &pool_lock);
+        AuthJob *job = queue_head;
+        queue_head = job->next;
+        if (!queue_head) queue_tail = NULL;
+        pthread_mutex_unlock(&pool_lock);
+
+        auth_job_execute(job);
+
+        pthread_mutex_lock(&pool_lock);
+        job->done = 1;
+        pthread_cond_broadcast(&pool_done);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return NULL;
+}
+
+// Run a job on the pool and wait for it (FIFO, so a storm is served in order)
+static int auth_run(AuthJob *job) {
+    if (pool_workers == 0) {
+        auth_job_execute(job);
+        return job->result;
+    }
+
+    job->done = 0;
+    job->next = NULL;
+    pthread_mutex_lock(&pool_lock);
+    if (queue_tail) queue_tail->next = job;
+    else queue_head = job;
+    queue_tail = job;
+    pthread_cond_signal(&pool_work);
+    while (!job->done) pthread_cond_wait(&pool_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+    return job->result;
+}
+
+static int auth_verify(const char *password, const char *record) {
+    AuthJob job = { .type = AUTH_VERIFY, .password = password, .record = record };
+    return auth_run(&job);
+}
+
+static int auth_hash(const char *password, char *out) {
+    AuthJob job = { .type = AUTH_HASH, .password = password, .out = out };
+    return auth_run(&job);
+}
+
+// ===== API =====
+
+// Verified against for unknown usernames, so they cost the same as a wrong password
+static char dummy_record[PASSWORD_RECORD_MAX];
+
+int user_directory_init(int cap, int workers, pthread_mutex_t *db_lock) {
+    server_db_lock = db_lock;
+    capacity = cap > 0 ? cap : 1;
+    int nbuckets = 1;
+    while (nbuckets < 2 * capacity) nbuckets <<= 1;
+    bucket_mask = nbuckets - 1;
+
+    entries = calloc(capacity, sizeof(DirEntry));
+    buckets = malloc(nbuckets * sizeof(int));
+    if (!entries || !buckets) {
+        fprintf(stderr, "User directory: out of memory\n");
+        free(entries);
+        free(buckets);
+        entries = NULL;
+        buckets = NULL;
+        return 0;
+    }
+    for (int i = 0; i < nbuckets; i++) buckets[i] = -1;
+    for (int i = 0; i < capacity; i++) entries[i].next_in_bucket = (i + 1 < capacity) ? i + 1 : -1;
+    free_list = 0;
+
+    password_hash("", dummy_record, sizeof(dummy_record));
+
+    for (int i = 0; i < workers; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, auth_worker, NULL) != 0) break;
+        pthread_detach(tid);
+        pool_workers++;
+    }
+    return workers <= 0 || pool_workers > 0;
+}
+
+int user_directory_login(const char *username, const char *password, int *user_id,
+                         char *role, int role_size) {
+    if (!username || !password) return 0;
+
+    int id = -1;
+    char cached_role[ROLE_MAX_LEN], record[PASSWORD_RECORD_MAX];
+    int found = entries && dir_get(username, &id, cached_role, sizeof(cached_role), record);
+    if (!found) {
+        unsigned long seen = dir_generation();
+        pthread_mutex_lock(server_db_lock);
+        found = storage->get_user_auth(username, &id, cached_role, sizeof(cached_role),
+                                       record, sizeof(record));
+        pthread_mutex_unlock(server_db_lock);
+        if (found < 0) return -1;
+        if (found && entries) dir_put(username, id, cached_role, record, seen);
+    }
+
+    if (!found) {
+        auth_verify(password, dummy_record);
+        return 0;
+    }
+    if (!auth_verify(password, record)) return 0;
+
+    if (password_needs_rehash(record)) {
+        char upgraded[PASSWORD_RECORD_MAX];
+        unsigned long seen = dir_generation();
+        if (auth_hash(password, upgraded)) {
+            pthread_mutex_lock(server_db_lock);
+            int saved = storage->set_user_password(id, upgraded);
+            pthread_mutex_unlock(server_db_lock);
+            if (saved && entries) dir_put(username, id, cached_role, upgraded, seen);
+        }
+    }
+
+    if (user_id) *user_id = id;
+    if (role) snprintf(role, role_size, "%s", cached_role);
+    return 1;
+}
+
+int user_directory_register(const char *username, const char *password, const char *role) {
+    if (!username || !password || !role) return -1;
+
+    char record[PASSWORD_RECORD_MAX];
+    if (!auth_hash(password, record)) return -1;
+
+    pthread_mutex_lock(server_db_lock);
+    int user_id = storage->username_exists(username) ? 0 : storage->add_user(username, record, role);
+    pthread_mutex_unlock(server_db_lock);
+
+    user_directory_invalidate(username);
+    return user_id;
+}
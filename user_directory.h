@@ -0,0 +1,32 @@
+#ifndef USER_DIRECTORY_H
+#define USER_DIRECTORY_H
+
+#include <pthread.h>
+
+// In-memory user directory for LOGIN/REGISTER: username -> (id, role, salted
+// password record), loaded lazily from the users table with one query and
+// bounded by LRU eviction. Password hashing (password.h) runs on a small
+// worker pool, so callers never hold the server lock while it runs and a
+// login storm is limited to `workers` cores of hashing.
+//
+// The functions below take db_lock (the server's global lock) only for their
+// short database reads and writes; call them with that lock released.
+
+// Returns 1 on success, 0 if the worker pool could not start (hashing then
+// runs on the calling thread)
+int user_directory_init(int capacity, int workers, pthread_mutex_t *db_lock);
+
+// Check a login. Returns 1 and fills user_id/role (role_size bytes) on
+// success, 0 for bad credentials, -1 on database error. Plaintext records
+// from older builds are replaced with salted hashes on first successful login.
+int user_directory_login(const char *username, const char *password, int *user_id,
+                         char *role, int role_size);
+
+// Hash the password and add the user. Returns the new id, 0 if the username
+// is taken, -1 on error. Invalidates any cached entry for the name.
+int user_directory_register(const char *username, const char *password, const char *role);
+
+// Drop a cached entry (after the users row changed outside this module)
+void user_directory_invalidate(const char *username);
+
+#endif // USER_DIRECTORY_H